@@ -0,0 +1,138 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/AuthData.h>
+#include <batchelor/common/auth/CredentialCache.h>
+#include <batchelor/common/auth/PasswordHash.h>
+#include <batchelor/common/auth/UserData.h>
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Measures the auth overhead per request of basic auth with PBKDF2 password hashes for many distinct workers.
+ * Every worker polls "polls" times. The first poll of a worker verifies the password hash, the following polls
+ * are answered by the credential cache. The steps are the same as in auth::RequestHandler::getGrantsByBasicAuth,
+ * except for base64 decoding of the token.
+ * Usage: batchelor-common-benchmark-auth [workers] [polls] [iterations]
+ */
+
+namespace {
+using batchelor::common::auth::AuthData;
+using batchelor::common::auth::CredentialCache;
+using batchelor::common::auth::PasswordHash;
+using batchelor::common::auth::UserData;
+using batchelor::common::crypto::Sha256;
+
+struct Users {
+	std::unordered_map<std::string, std::shared_ptr<const AuthData::Grants>> grantsByUser;
+	std::unordered_map<std::string, PasswordHash> passwordHashByUser;
+};
+
+std::shared_ptr<const AuthData::Grants> authenticate(const Users& users, CredentialCache& credentialCache, const std::string& token) {
+	std::shared_ptr<const AuthData::Grants> grants = credentialCache.get(token);
+	if(grants) {
+		return grants;
+	}
+
+	std::size_t pos = token.find(':');
+	std::string username = token.substr(0, pos);
+	std::string password = pos == std::string::npos ? "" : token.substr(pos + 1);
+
+	auto grantsIter = users.grantsByUser.find(username);
+	auto passwordHashIter = users.passwordHashByUser.find(username);
+	if(grantsIter == users.grantsByUser.end() || passwordHashIter == users.passwordHashByUser.end() || !passwordHashIter->second.verify(password)) {
+		return nullptr;
+	}
+
+	credentialCache.put(token, grantsIter->second);
+	return grantsIter->second;
+}
+
+void printRound(const std::string& label, std::vector<double>& durations) {
+	std::sort(durations.begin(), durations.end());
+	double sum = 0;
+	for(double duration : durations) {
+		sum += duration;
+	}
+	std::cout << label
+			<< ": requests " << durations.size()
+			<< ", avg " << (sum / durations.size()) << " us"
+			<< ", p50 " << durations[durations.size() / 2] << " us"
+			<< ", p99 " << durations[durations.size() * 99 / 100] << " us"
+			<< ", max " << durations.back() << " us\n";
+}
+} /* anonymous namespace */
+
+int main(int argc, const char* argv[]) {
+	std::size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+	std::size_t polls = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+	std::uint32_t iterations = argc > 3 ? static_cast<std::uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 10000;
+	if(workers == 0 || polls < 2 || iterations == 0) {
+		std::cerr << "Usage: " << argv[0] << " [workers] [polls >= 2] [iterations]\n";
+		return 1;
+	}
+
+	Users users;
+	std::vector<std::string> tokens;
+	for(std::size_t i = 0; i < workers; ++i) {
+		std::string username = "worker-" + std::to_string(i);
+		std::string password = Sha256::toHex(Sha256::hash("password-" + std::to_string(i)));
+		std::string salt = Sha256::hash("salt-" + std::to_string(i)).substr(0, 16);
+
+		UserData userData;
+		userData.rolesByNamespace["default"].insert(UserData::Role::worker);
+		users.grantsByUser[username] = std::make_shared<const AuthData::Grants>(userData);
+		users.passwordHashByUser.emplace(username, PasswordHash(std::to_string(iterations) + "$" + Sha256::toHex(salt) + "$" + Sha256::toHex(Sha256::pbkdf2(password, salt, iterations))));
+		tokens.push_back(username + ":" + password);
+	}
+
+	/* default settings of auth::RequestHandler */
+	CredentialCache credentialCache(4096, std::chrono::minutes(5));
+
+	std::cout << "workers " << workers << ", polls per worker " << polls << ", PBKDF2 iterations " << iterations << "\n";
+
+	std::vector<double> coldDurations;
+	std::vector<double> warmDurations;
+	for(std::size_t poll = 0; poll < polls; ++poll) {
+		for(const auto& token : tokens) {
+			auto startTS = std::chrono::steady_clock::now();
+			std::shared_ptr<const AuthData::Grants> grants = authenticate(users, credentialCache, token);
+			double duration = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTS).count();
+
+			if(!grants) {
+				std::cerr << "Authentication failed for \"" << token << "\"\n";
+				return 1;
+			}
+			(poll == 0 ? coldDurations : warmDurations).push_back(duration);
+		}
+	}
+
+	printRound("first poll (hash verified)", coldDurations);
+	printRound("next polls (cached)       ", warmDurations);
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/AuthData.h>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+const std::string AuthData::objectId = "batchelor-auth-data";
+
+AuthData::Grants::Grants(const UserData& userData) {
+	for(const auto& namespaceRoles : userData.rolesByNamespace) {
+		UserData::Roles roles(namespaceRoles.second);
+		if(namespaceRoles.first.empty() || namespaceRoles.first == "*") {
+			rolesAllNamespaces |= roles;
+		}
+		else {
+			rolesByNamespace[namespaceRoles.first] |= roles;
+		}
+	}
+}
+
+AuthData::Grants& AuthData::Grants::operator|=(const Grants& other) {
+	for(const auto& namespaceRoles : other.rolesByNamespace) {
+		rolesByNamespace[namespaceRoles.first] |= namespaceRoles.second;
+	}
+	rolesAllNamespaces |= other.rolesAllNamespaces;
+	return *this;
+}
+
+void AuthData::add(esl::object::Context& context, std::shared_ptr<const Grants> grants) {
+	AuthData* authDataPtr = context.findObject<AuthData>(objectId);
+
+	if(authDataPtr == nullptr) {
+		std::unique_ptr<AuthData> authData(new AuthData);
+		authDataPtr = authData.get();
+		context.addObject(objectId, std::move(authData));
+	}
+
+	authDataPtr->grants.push_back(std::move(grants));
+}
+
+const AuthData* AuthData::find(const esl::object::Context& context) {
+	return context.findObject<AuthData>(objectId);
+}
+
+UserData::Roles AuthData::getRoles(const std::string& namespaceId) const {
+	UserData::Roles roles;
+
+	for(const auto& grant : grants) {
+		roles |= grant->rolesAllNamespaces;
+
+		auto iter = grant->rolesByNamespace.find(namespaceId);
+		if(iter != grant->rolesByNamespace.end()) {
+			roles |= iter->second;
+		}
+	}
+
+	return roles;
+}
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
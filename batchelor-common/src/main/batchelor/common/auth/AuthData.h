@@ -0,0 +1,68 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_AUTH_AUTHDATA_H_
+#define BATCHELOR_COMMON_AUTH_AUTHDATA_H_
+
+#include <batchelor/common/auth/UserData.h>
+
+#include <esl/object/Context.h>
+#include <esl/object/Object.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+/* Typed authorization result attached to the object context of an authenticated request.
+ * The grants are computed once per user when the auth request handler is created and are shared by all requests of this user. */
+class AuthData : public esl::object::Object {
+public:
+	struct Grants {
+		Grants() = default;
+		explicit Grants(const UserData& userData);
+
+		Grants& operator|=(const Grants& other);
+
+		std::unordered_map<std::string, UserData::Roles> rolesByNamespace;
+
+		// roles for namespace "" or "*"
+		UserData::Roles rolesAllNamespaces;
+	};
+
+	static const std::string objectId;
+
+	static void add(esl::object::Context& context, std::shared_ptr<const Grants> grants);
+	static const AuthData* find(const esl::object::Context& context);
+
+	UserData::Roles getRoles(const std::string& namespaceId) const;
+
+private:
+	std::vector<std::shared_ptr<const Grants>> grants;
+};
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_AUTH_AUTHDATA_H_ */
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/CredentialCache.h>
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <random>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+namespace {
+std::string createRandomKey() {
+	std::random_device randomDevice;
+	std::string key(crypto::Sha256::digestSize, '\0');
+	for(auto& c : key) {
+		c = static_cast<char>(randomDevice() & 0xff);
+	}
+	return key;
+}
+} /* namespace */
+
+CredentialCache::CredentialCache(std::size_t aMaxEntries, std::chrono::milliseconds aTTL)
+: maxEntries(aMaxEntries),
+  ttl(aTTL),
+  hmacKey(createRandomKey())
+{ }
+
+std::shared_ptr<const AuthData::Grants> CredentialCache::get(const std::string& secret) {
+	if(maxEntries == 0 || ttl.count() <= 0) {
+		return nullptr;
+	}
+
+	std::string key = makeKey(secret);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = entryByKey.find(key);
+	if(iter == entryByKey.end()) {
+		return nullptr;
+	}
+
+	if(iter->second->expiresAt <= std::chrono::steady_clock::now()) {
+		entries.erase(iter->second);
+		entryByKey.erase(iter);
+		return nullptr;
+	}
+
+	entries.splice(entries.begin(), entries, iter->second);
+	return iter->second->grants;
+}
+
+void CredentialCache::put(const std::string& secret, std::shared_ptr<const AuthData::Grants> grants) {
+	put(secret, std::move(grants), std::chrono::steady_clock::time_point::max());
+}
+
+void CredentialCache::put(const std::string& secret, std::shared_ptr<const AuthData::Grants> grants, std::chrono::steady_clock::time_point expiresAt) {
+	if(maxEntries == 0 || ttl.count() <= 0) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(expiresAt <= now) {
+		return;
+	}
+	if(expiresAt - now > ttl) {
+		expiresAt = now + ttl;
+	}
+
+	std::string key = makeKey(secret);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = entryByKey.find(key);
+	if(iter != entryByKey.end()) {
+		iter->second->grants = std::move(grants);
+		iter->second->expiresAt = expiresAt;
+		entries.splice(entries.begin(), entries, iter->second);
+		return;
+	}
+
+	if(entries.size() >= maxEntries) {
+		entryByKey.erase(entries.back().key);
+		entries.pop_back();
+	}
+
+	entries.push_front(Entry{key, std::move(grants), expiresAt});
+	entryByKey.emplace(std::move(key), entries.begin());
+}
+
+std::string CredentialCache::makeKey(const std::string& secret) const {
+	return crypto::Sha256::hmac(hmacKey, secret);
+}
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
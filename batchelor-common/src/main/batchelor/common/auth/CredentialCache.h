@@ -0,0 +1,73 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_AUTH_CREDENTIALCACHE_H_
+#define BATCHELOR_COMMON_AUTH_CREDENTIALCACHE_H_
+
+#include <batchelor/common/auth/AuthData.h>
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+/* LRU cache of verified credentials with a time to live, so expensive password hashes are checked once per client.
+ * Secrets are not stored, entries are keyed by a HMAC of the secret with a random key of this process. */
+class CredentialCache {
+public:
+	CredentialCache(std::size_t maxEntries, std::chrono::milliseconds ttl);
+
+	std::shared_ptr<const AuthData::Grants> get(const std::string& secret);
+	void put(const std::string& secret, std::shared_ptr<const AuthData::Grants> grants);
+
+	/* Cache the credential not longer than the TTL and not longer than the given time */
+	void put(const std::string& secret, std::shared_ptr<const AuthData::Grants> grants, std::chrono::steady_clock::time_point expiresAt);
+
+private:
+	struct Entry {
+		std::string key;
+		std::shared_ptr<const AuthData::Grants> grants;
+		std::chrono::steady_clock::time_point expiresAt;
+	};
+
+	std::string makeKey(const std::string& secret) const;
+
+	const std::size_t maxEntries;
+	const std::chrono::milliseconds ttl;
+	const std::string hmacKey;
+
+	std::mutex mutex;
+
+	/* most recently used entry first */
+	std::list<Entry> entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> entryByKey;
+};
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_AUTH_CREDENTIALCACHE_H_ */
@@ -0,0 +1,291 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/Json.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+namespace {
+class JsonParser {
+public:
+	static Json parse(const std::string& str) {
+		JsonParser parser(str);
+		Json value = parser.parseValue(0);
+		parser.skipWhitespaces();
+		if(parser.pos != str.size()) {
+			throw std::runtime_error("Unexpected character at position " + std::to_string(parser.pos) + " of JSON value.");
+		}
+		return value;
+	}
+
+private:
+	static constexpr unsigned int maxDepth = 32;
+
+	JsonParser(const std::string& aStr)
+	: str(aStr)
+	{ }
+
+	void skipWhitespaces() {
+		while(pos < str.size() && (str[pos] == ' ' || str[pos] == '\t' || str[pos] == '\r' || str[pos] == '\n')) {
+			++pos;
+		}
+	}
+
+	char next() {
+		skipWhitespaces();
+		if(pos >= str.size()) {
+			throw std::runtime_error("Unexpected end of JSON value.");
+		}
+		return str[pos];
+	}
+
+	void expect(const char* literal) {
+		for(; *literal != 0; ++literal, ++pos) {
+			if(pos >= str.size() || str[pos] != *literal) {
+				throw std::runtime_error("Unexpected character at position " + std::to_string(pos) + " of JSON value.");
+			}
+		}
+	}
+
+	Json parseValue(unsigned int depth) {
+		if(depth > maxDepth) {
+			throw std::runtime_error("JSON value is nested too deep.");
+		}
+
+		Json value;
+		char c = next();
+		if(c == '{') {
+			value.type = Json::Type::object;
+			++pos;
+			if(next() == '}') {
+				++pos;
+				return value;
+			}
+			while(true) {
+				if(next() != '"') {
+					throw std::runtime_error("Expected member name at position " + std::to_string(pos) + " of JSON value.");
+				}
+				std::string key = parseString();
+				if(next() != ':') {
+					throw std::runtime_error("Expected ':' at position " + std::to_string(pos) + " of JSON value.");
+				}
+				++pos;
+				value.objectValue.emplace_back(std::move(key), parseValue(depth + 1));
+				c = next();
+				++pos;
+				if(c == '}') {
+					break;
+				}
+				if(c != ',') {
+					throw std::runtime_error("Expected ',' or '}' at position " + std::to_string(pos - 1) + " of JSON value.");
+				}
+			}
+		}
+		else if(c == '[') {
+			value.type = Json::Type::array;
+			++pos;
+			if(next() == ']') {
+				++pos;
+				return value;
+			}
+			while(true) {
+				value.arrayValue.push_back(parseValue(depth + 1));
+				c = next();
+				++pos;
+				if(c == ']') {
+					break;
+				}
+				if(c != ',') {
+					throw std::runtime_error("Expected ',' or ']' at position " + std::to_string(pos - 1) + " of JSON value.");
+				}
+			}
+		}
+		else if(c == '"') {
+			value.type = Json::Type::string;
+			value.stringValue = parseString();
+		}
+		else if(c == 't') {
+			expect("true");
+			value.type = Json::Type::boolean;
+			value.booleanValue = true;
+		}
+		else if(c == 'f') {
+			expect("false");
+			value.type = Json::Type::boolean;
+		}
+		else if(c == 'n') {
+			expect("null");
+		}
+		else {
+			std::size_t end = str.find_first_not_of("+-0123456789.eE", pos);
+			std::string number = str.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+			char* numberEnd = nullptr;
+			value.numberValue = std::strtod(number.c_str(), &numberEnd);
+			if(number.empty() || numberEnd != number.c_str() + number.size()) {
+				throw std::runtime_error("Unexpected character at position " + std::to_string(pos) + " of JSON value.");
+			}
+			value.type = Json::Type::number;
+			pos += number.size();
+		}
+
+		return value;
+	}
+
+	std::string parseString() {
+		std::string result;
+
+		// skip '"'
+		++pos;
+		while(true) {
+			if(pos >= str.size()) {
+				throw std::runtime_error("Unexpected end of JSON string.");
+			}
+
+			char c = str[pos++];
+			if(c == '"') {
+				break;
+			}
+			if(c != '\\') {
+				result += c;
+				continue;
+			}
+
+			if(pos >= str.size()) {
+				throw std::runtime_error("Unexpected end of JSON string.");
+			}
+			c = str[pos++];
+			switch(c) {
+			case '"':
+			case '\\':
+			case '/':
+				result += c;
+				break;
+			case 'b':
+				result += '\b';
+				break;
+			case 'f':
+				result += '\f';
+				break;
+			case 'n':
+				result += '\n';
+				break;
+			case 'r':
+				result += '\r';
+				break;
+			case 't':
+				result += '\t';
+				break;
+			case 'u': {
+				std::uint32_t codePoint = parseHex4();
+				if(codePoint >= 0xd800 && codePoint <= 0xdbff && str.compare(pos, 2, "\\u") == 0) {
+					pos += 2;
+					std::uint32_t low = parseHex4();
+					if(low < 0xdc00 || low > 0xdfff) {
+						throw std::runtime_error("Invalid surrogate pair in JSON string.");
+					}
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+				appendUtf8(result, codePoint);
+				break;
+			}
+			default:
+				throw std::runtime_error("Invalid escape sequence in JSON string.");
+			}
+		}
+
+		return result;
+	}
+
+	std::uint32_t parseHex4() {
+		if(pos + 4 > str.size()) {
+			throw std::runtime_error("Unexpected end of JSON string.");
+		}
+		std::uint32_t value = 0;
+		for(std::size_t i = 0; i < 4; ++i) {
+			char c = str[pos++];
+			value <<= 4;
+			if(c >= '0' && c <= '9') {
+				value |= static_cast<std::uint32_t>(c - '0');
+			}
+			else if(c >= 'a' && c <= 'f') {
+				value |= static_cast<std::uint32_t>(c - 'a' + 10);
+			}
+			else if(c >= 'A' && c <= 'F') {
+				value |= static_cast<std::uint32_t>(c - 'A' + 10);
+			}
+			else {
+				throw std::runtime_error("Invalid escape sequence in JSON string.");
+			}
+		}
+		return value;
+	}
+
+	static void appendUtf8(std::string& str, std::uint32_t codePoint) {
+		if(codePoint < 0x80) {
+			str += static_cast<char>(codePoint);
+		}
+		else if(codePoint < 0x800) {
+			str += static_cast<char>(0xc0 | (codePoint >> 6));
+			str += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else if(codePoint < 0x10000) {
+			str += static_cast<char>(0xe0 | (codePoint >> 12));
+			str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			str += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else {
+			str += static_cast<char>(0xf0 | (codePoint >> 18));
+			str += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+			str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			str += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+	}
+
+	const std::string& str;
+	std::size_t pos = 0;
+};
+} /* namespace */
+
+Json Json::parse(const std::string& str) {
+	return JsonParser::parse(str);
+}
+
+const Json* Json::find(const std::string& key) const {
+	for(const auto& member : objectValue) {
+		if(member.first == key) {
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+std::string Json::getString(const std::string& key) const {
+	const Json* value = find(key);
+	return value && value->type == Type::string ? value->stringValue : std::string();
+}
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
@@ -0,0 +1,62 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_AUTH_JSON_H_
+#define BATCHELOR_COMMON_AUTH_JSON_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+/* Minimal JSON value, just enough for JWT header, JWT claims and JWKS */
+struct Json {
+	enum class Type {
+		null,
+		boolean,
+		number,
+		string,
+		array,
+		object
+	};
+
+	/* throws std::runtime_error if "str" is not exactly one JSON value */
+	static Json parse(const std::string& str);
+
+	const Json* find(const std::string& key) const;
+
+	/* returns an empty string if there is no member "key" or if it is not a string */
+	std::string getString(const std::string& key) const;
+
+	Type type = Type::null;
+	bool booleanValue = false;
+	double numberValue = 0;
+	std::string stringValue;
+	std::vector<Json> arrayValue;
+	std::vector<std::pair<std::string, Json>> objectValue;
+};
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_AUTH_JSON_H_ */
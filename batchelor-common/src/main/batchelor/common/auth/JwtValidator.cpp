@@ -0,0 +1,509 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/Json.h>
+#include <batchelor/common/auth/JwtValidator.h>
+#include <batchelor/common/Logger.h>
+#include <batchelor/common/Timestamp.h>
+
+#include <curl4esl/com/http/client/ConnectionFactory.h>
+
+#include <esl/com/http/client/Connection.h>
+#include <esl/com/http/client/CURLConnectionFactory.h>
+#include <esl/com/http/client/Request.h>
+#include <esl/com/http/client/Response.h>
+#include <esl/io/Input.h>
+#include <esl/io/input/String.h>
+#include <esl/io/Output.h>
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/HttpMethod.h>
+#include <esl/utility/MIME.h>
+#include <esl/utility/String.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+namespace {
+Logger logger("batchelor::common::auth::JwtValidator");
+
+/* Decodes base64url without padding as used by JWT and JWKS */
+bool fromBase64Url(const std::string& str, std::string& result) {
+	result.clear();
+	result.reserve(str.size() * 3 / 4);
+
+	std::uint32_t buffer = 0;
+	unsigned int bits = 0;
+	for(char c : str) {
+		std::uint32_t value;
+		if(c >= 'A' && c <= 'Z') {
+			value = static_cast<std::uint32_t>(c - 'A');
+		}
+		else if(c >= 'a' && c <= 'z') {
+			value = static_cast<std::uint32_t>(c - 'a' + 26);
+		}
+		else if(c >= '0' && c <= '9') {
+			value = static_cast<std::uint32_t>(c - '0' + 52);
+		}
+		else if(c == '-' || c == '+') {
+			value = 62;
+		}
+		else if(c == '_' || c == '/') {
+			value = 63;
+		}
+		else if(c == '=') {
+			break;
+		}
+		else {
+			return false;
+		}
+
+		buffer = (buffer << 6) | value;
+		bits += 6;
+		if(bits >= 8) {
+			bits -= 8;
+			result += static_cast<char>((buffer >> bits) & 0xff);
+		}
+	}
+
+	return true;
+}
+
+/* Converts a NumericDate of claims "exp" and "nbf". Returns false if it is not a number or if it is out of the range of the
+ * system clock, because the conversion of such values from double is undefined behavior. Only half of the range is used,
+ * so adding the leeway cannot overflow either. */
+bool toTimePoint(const Json& value, std::chrono::system_clock::time_point& timePoint) {
+	static const double maxSeconds = std::chrono::duration<double>(std::chrono::system_clock::duration::max()).count() / 2;
+
+	if(value.type != Json::Type::number || !std::isfinite(value.numberValue) || value.numberValue < 0 || value.numberValue > maxSeconds) {
+		return false;
+	}
+
+	timePoint = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(value.numberValue)));
+	return true;
+}
+} /* namespace */
+
+JwtValidator::Settings::Settings(const std::vector<std::pair<std::string, std::string>>& settings) {
+	bool hasJwksRefresh = false;
+	bool hasLeeway = false;
+
+	for(const auto& setting : settings) {
+		if(setting.first == "jwks-url") {
+			if(!jwksUrl.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			jwksUrl = setting.second;
+			if(jwksUrl.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+		}
+		else if(setting.first == "jwks-file") {
+			if(!jwksFile.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			jwksFile = setting.second;
+			if(jwksFile.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+		}
+		else if(setting.first.size() > 10 && setting.first.substr(0, 10) == "jwks-curl.") {
+			jwksCurlSettings.emplace_back(setting.first.substr(10), setting.second);
+		}
+		else if(setting.first == "jwks-refresh") {
+			if(hasJwksRefresh) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			hasJwksRefresh = true;
+			try {
+				jwksRefresh = Timestamp::toDuration(setting.second);
+			}
+			catch(const std::exception& e) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'." + e.what()));
+			}
+			if(jwksRefresh.count() <= 0) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+		}
+		else if(setting.first == "jwt-issuer") {
+			if(!issuer.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			issuer = setting.second;
+		}
+		else if(setting.first == "jwt-audience") {
+			if(!audience.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			audience = setting.second;
+		}
+		else if(setting.first == "jwt-roles-claim") {
+			rolesClaim = setting.second;
+			if(rolesClaim.empty()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+		}
+		else if(setting.first == "jwt-leeway") {
+			if(hasLeeway) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
+			}
+			hasLeeway = true;
+			try {
+				leeway = Timestamp::toDuration(setting.second);
+			}
+			catch(const std::exception& e) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'." + e.what()));
+			}
+		}
+		else if(setting.first == "jwt-role") {
+			// jwt-role = <value of roles claim>:<user name>
+			std::size_t pos = setting.second.rfind(':');
+			if(pos == std::string::npos || pos == 0 || pos + 1 == setting.second.size()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+			usersByRole[setting.second.substr(0, pos)].insert(setting.second.substr(pos + 1));
+		}
+		else {
+			throw esl::system::Stacktrace::add(std::runtime_error("unknown attribute '" + setting.first + "'."));
+		}
+	}
+
+	if(jwksUrl.empty() == jwksFile.empty()) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Exactly one of the keys 'jwks-url' or 'jwks-file' must be defined to validate JWTs."));
+	}
+}
+
+JwtValidator::JwtValidator(const Settings& aSettings, const std::unordered_map<std::string, std::shared_ptr<const AuthData::Grants>>& grantsByUser, std::size_t cacheSize, std::chrono::milliseconds cacheTTL)
+: settings(aSettings),
+  tokenCache(cacheSize, cacheTTL),
+  keys(new Keys)
+{
+	for(const auto& roleUsers : settings.usersByRole) {
+		std::shared_ptr<AuthData::Grants> grants(new AuthData::Grants);
+		for(const auto& user : roleUsers.second) {
+			auto grantsIter = grantsByUser.find(user);
+			if(grantsIter == grantsByUser.end()) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Unknown user \"" + user + "\" for JWT role \"" + roleUsers.first + "\"."));
+			}
+			*grants |= *grantsIter->second;
+		}
+		grantsByRole[roleUsers.first] = std::move(grants);
+	}
+
+	try {
+		loadKeys();
+	}
+	catch(const std::exception& e) {
+		logger.warn << "Loading JWKS failed: " << e.what() << "\n";
+		logger.warn << "Retry in background.\n";
+		refreshRequested = true;
+	}
+
+	thread = std::thread(&JwtValidator::threadRun, this);
+}
+
+JwtValidator::~JwtValidator() {
+	{
+		std::lock_guard<std::mutex> lockKeys(keysMutex);
+		threadStopping = true;
+	}
+	refreshCV.notify_one();
+	thread.join();
+}
+
+bool JwtValidator::isJwt(const std::string& token) {
+	std::size_t pos = token.find('.');
+	return pos != std::string::npos && token.find('.', pos + 1) != std::string::npos;
+}
+
+std::shared_ptr<const AuthData::Grants> JwtValidator::validate(const std::string& token) const {
+	std::shared_ptr<const AuthData::Grants> grants = tokenCache.get(token);
+	if(grants) {
+		return grants;
+	}
+
+	std::size_t pos1 = token.find('.');
+	std::size_t pos2 = token.find('.', pos1 + 1);
+	if(pos1 == std::string::npos || pos2 == std::string::npos || token.find('.', pos2 + 1) != std::string::npos) {
+		return nullptr;
+	}
+
+	std::string headerStr;
+	std::string claimsStr;
+	std::string signature;
+	if(!fromBase64Url(token.substr(0, pos1), headerStr)
+			|| !fromBase64Url(token.substr(pos1 + 1, pos2 - pos1 - 1), claimsStr)
+			|| !fromBase64Url(token.substr(pos2 + 1), signature)) {
+		logger.debug << "JWT is not base64url encoded.\n";
+		return nullptr;
+	}
+
+	Json header;
+	Json claims;
+	try {
+		header = Json::parse(headerStr);
+		claims = Json::parse(claimsStr);
+	}
+	catch(const std::exception& e) {
+		logger.debug << "JWT is invalid: " << e.what() << "\n";
+		return nullptr;
+	}
+
+	if(header.getString("alg") != "RS256") {
+		logger.debug << "JWT algorithm \"" << header.getString("alg") << "\" is not supported.\n";
+		return nullptr;
+	}
+
+	std::shared_ptr<const Keys> currentKeys;
+	{
+		std::lock_guard<std::mutex> lockKeys(keysMutex);
+		currentKeys = keys;
+	}
+
+	bool verified = false;
+	std::string kid = header.getString("kid");
+	if(kid.empty()) {
+		for(const auto& key : *currentKeys) {
+			if(key.second.verifySha256(token.substr(0, pos2), signature)) {
+				verified = true;
+				break;
+			}
+		}
+	}
+	else {
+		auto keyIter = currentKeys->find(kid);
+		if(keyIter == currentKeys->end()) {
+			logger.debug << "JWT key ID \"" << kid << "\" is unknown, request refresh of JWKS.\n";
+			{
+				std::lock_guard<std::mutex> lockKeys(keysMutex);
+				refreshRequested = true;
+			}
+			refreshCV.notify_one();
+			return nullptr;
+		}
+		verified = keyIter->second.verifySha256(token.substr(0, pos2), signature);
+	}
+
+	if(!verified) {
+		logger.debug << "JWT signature is invalid.\n";
+		return nullptr;
+	}
+
+	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+
+	const Json* exp = claims.find("exp");
+	if(exp == nullptr) {
+		logger.debug << "JWT has no claim \"exp\".\n";
+		return nullptr;
+	}
+	std::chrono::system_clock::time_point expiresAt;
+	if(!toTimePoint(*exp, expiresAt)) {
+		logger.debug << "JWT has an invalid claim \"exp\".\n";
+		return nullptr;
+	}
+	if(expiresAt + settings.leeway <= now) {
+		logger.debug << "JWT is expired.\n";
+		return nullptr;
+	}
+
+	const Json* nbf = claims.find("nbf");
+	if(nbf) {
+		std::chrono::system_clock::time_point notBefore;
+		if(!toTimePoint(*nbf, notBefore)) {
+			logger.debug << "JWT has an invalid claim \"nbf\".\n";
+			return nullptr;
+		}
+		if(notBefore > now + settings.leeway) {
+			logger.debug << "JWT is not valid yet.\n";
+			return nullptr;
+		}
+	}
+
+	if(!settings.issuer.empty() && claims.getString("iss") != settings.issuer) {
+		logger.debug << "JWT has wrong issuer \"" << claims.getString("iss") << "\".\n";
+		return nullptr;
+	}
+
+	if(!settings.audience.empty()) {
+		bool hasAudience = false;
+		const Json* aud = claims.find("aud");
+		if(aud && aud->type == Json::Type::string) {
+			hasAudience = aud->stringValue == settings.audience;
+		}
+		else if(aud && aud->type == Json::Type::array) {
+			for(const auto& value : aud->arrayValue) {
+				if(value.type == Json::Type::string && value.stringValue == settings.audience) {
+					hasAudience = true;
+					break;
+				}
+			}
+		}
+		if(!hasAudience) {
+			logger.debug << "JWT has not the audience \"" << settings.audience << "\".\n";
+			return nullptr;
+		}
+	}
+
+	const Json* rolesValue = &claims;
+	for(const auto& claimName : esl::utility::String::split(settings.rolesClaim, '.', false)) {
+		rolesValue = rolesValue->find(claimName);
+		if(rolesValue == nullptr) {
+			break;
+		}
+	}
+
+	std::vector<std::string> roles;
+	if(rolesValue && rolesValue->type == Json::Type::array) {
+		for(const auto& value : rolesValue->arrayValue) {
+			if(value.type == Json::Type::string) {
+				roles.push_back(value.stringValue);
+			}
+		}
+	}
+	else if(rolesValue && rolesValue->type == Json::Type::string) {
+		// e.g. claim "scope"
+		roles = esl::utility::String::split(rolesValue->stringValue, ' ', true);
+	}
+
+	std::shared_ptr<AuthData::Grants> tokenGrants(new AuthData::Grants);
+	for(const auto& role : roles) {
+		auto grantsIter = grantsByRole.find(role);
+		if(grantsIter != grantsByRole.end()) {
+			*tokenGrants |= *grantsIter->second;
+		}
+	}
+
+	tokenCache.put(token, tokenGrants, std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(expiresAt - now));
+
+	return tokenGrants;
+}
+
+void JwtValidator::threadRun() {
+	std::unique_lock<std::mutex> lockKeys(keysMutex);
+	std::chrono::steady_clock::time_point lastRefresh = std::chrono::steady_clock::now();
+
+	while(!threadStopping) {
+		std::chrono::steady_clock::time_point nextRefresh = lastRefresh + settings.jwksRefresh;
+		if(refreshRequested) {
+			nextRefresh = std::min(nextRefresh, lastRefresh + minRefreshInterval);
+		}
+
+		if(std::chrono::steady_clock::now() < nextRefresh) {
+			refreshCV.wait_until(lockKeys, nextRefresh);
+			continue;
+		}
+
+		refreshRequested = false;
+		lastRefresh = std::chrono::steady_clock::now();
+
+		lockKeys.unlock();
+		try {
+			loadKeys();
+		}
+		catch(const std::exception& e) {
+			logger.warn << "Refreshing JWKS failed: " << e.what() << "\n";
+		}
+		lockKeys.lock();
+	}
+}
+
+void JwtValidator::loadKeys() {
+	Json jwks = Json::parse(loadJwks());
+
+	const Json* jwksKeys = jwks.find("keys");
+	if(jwksKeys == nullptr || jwksKeys->type != Json::Type::array) {
+		throw esl::system::Stacktrace::add(std::runtime_error("JWKS has no array \"keys\"."));
+	}
+
+	std::shared_ptr<Keys> newKeys(new Keys);
+	for(const auto& jwk : jwksKeys->arrayValue) {
+		if(jwk.getString("kty") != "RSA") {
+			continue;
+		}
+		if(!jwk.getString("use").empty() && jwk.getString("use") != "sig") {
+			continue;
+		}
+		if(!jwk.getString("alg").empty() && jwk.getString("alg") != "RS256") {
+			continue;
+		}
+
+		std::string modulus;
+		std::string exponent;
+		if(!fromBase64Url(jwk.getString("n"), modulus) || !fromBase64Url(jwk.getString("e"), exponent)) {
+			logger.warn << "JWKS contains invalid key \"" << jwk.getString("kid") << "\".\n";
+			continue;
+		}
+
+		try {
+			newKeys->emplace(jwk.getString("kid"), crypto::RsaPublicKey(modulus, exponent));
+		}
+		catch(const std::exception& e) {
+			logger.warn << "JWKS contains invalid key \"" << jwk.getString("kid") << "\": " << e.what() << "\n";
+		}
+	}
+
+	logger.debug << "Loaded " << newKeys->size() << " keys from JWKS.\n";
+
+	std::lock_guard<std::mutex> lockKeys(keysMutex);
+	keys = std::move(newKeys);
+}
+
+std::string JwtValidator::loadJwks() const {
+	if(!settings.jwksFile.empty()) {
+		std::ifstream file(settings.jwksFile);
+		if(!file.good()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Cannot open JWKS file \"" + settings.jwksFile + "\"."));
+		}
+		std::stringstream content;
+		content << file.rdbuf();
+		return content.str();
+	}
+
+	std::vector<std::pair<std::string, std::string>> curlSettings = settings.jwksCurlSettings;
+	curlSettings.emplace_back("url", settings.jwksUrl);
+	esl::com::http::client::CURLConnectionFactory::Settings connectionFactorySettings(curlSettings);
+	curl4esl::com::http::client::ConnectionFactory connectionFactory(connectionFactorySettings);
+
+	std::unique_ptr<esl::com::http::client::Connection> connection = connectionFactory.createConnection();
+	if(!connection) {
+		throw esl::system::Stacktrace::add(std::runtime_error("cannot create http connection."));
+	}
+
+	esl::com::http::client::Request request("", esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
+	request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson));
+
+	esl::io::input::String consumerString;
+	esl::com::http::client::Response response = connection->send(std::move(request), esl::io::Output(), esl::io::Input(consumerString));
+	if(response.getStatusCode() != 200) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Received status code " + std::to_string(response.getStatusCode()) + " while loading JWKS from \"" + settings.jwksUrl + "\"."));
+	}
+
+	return consumerString.getString();
+}
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
@@ -0,0 +1,115 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_AUTH_JWTVALIDATOR_H_
+#define BATCHELOR_COMMON_AUTH_JWTVALIDATOR_H_
+
+#include <batchelor/common/auth/AuthData.h>
+#include <batchelor/common/auth/CredentialCache.h>
+#include <batchelor/common/crypto/RsaPublicKey.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+/* Validates JWTs signed with RS256 locally by the keys of a JWKS, that is loaded from an URL or a file and refreshed periodically.
+ * Values of the roles claim are mapped to users and a valid token gets the grants of these users. */
+class JwtValidator {
+public:
+	struct Settings {
+		explicit Settings(const std::vector<std::pair<std::string, std::string>>& settings);
+
+		// URL of the JWKS, e.g. "https://<idp>/realms/<realm>/protocol/openid-connect/certs"
+		std::string jwksUrl;
+
+		// file of the JWKS, e.g. for a local identity provider to test
+		std::string jwksFile;
+
+		// settings of the curl connection to load the JWKS from jwksUrl
+		std::vector<std::pair<std::string, std::string>> jwksCurlSettings;
+
+		std::chrono::milliseconds jwksRefresh = std::chrono::hours(1);
+
+		// required value of claim "iss", if not empty
+		std::string issuer;
+
+		// required value of claim "aud", if not empty
+		std::string audience;
+
+		// name of the claim with the roles of the token, nested claims are separated by '.', e.g. "realm_access.roles"
+		std::string rolesClaim = "roles";
+
+		// allowed clock skew to check claims "exp" and "nbf"
+		std::chrono::milliseconds leeway = std::chrono::seconds(60);
+
+		// users by value of the roles claim
+		std::map<std::string, std::set<std::string>> usersByRole;
+	};
+
+	JwtValidator(const Settings& settings, const std::unordered_map<std::string, std::shared_ptr<const AuthData::Grants>>& grantsByUser, std::size_t cacheSize, std::chrono::milliseconds cacheTTL);
+	~JwtValidator();
+
+	static bool isJwt(const std::string& token);
+
+	/* returns nullptr if the token is not valid */
+	std::shared_ptr<const AuthData::Grants> validate(const std::string& token) const;
+
+private:
+	using Keys = std::map<std::string, crypto::RsaPublicKey>;
+
+	/* Min. time between two refreshes of the JWKS that are requested because of an unknown key ID */
+	static constexpr std::chrono::seconds minRefreshInterval{30};
+
+	const Settings settings;
+	std::map<std::string, std::shared_ptr<const AuthData::Grants>> grantsByRole;
+
+	/* Validated tokens until they expire */
+	mutable CredentialCache tokenCache;
+
+	mutable std::mutex keysMutex;
+	std::shared_ptr<const Keys> keys;
+
+	mutable std::condition_variable refreshCV;
+	mutable bool refreshRequested = false;
+	bool threadStopping = false;
+	std::thread thread;
+
+	void threadRun();
+	void loadKeys();
+	std::string loadJwks() const;
+};
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_AUTH_JWTVALIDATOR_H_ */
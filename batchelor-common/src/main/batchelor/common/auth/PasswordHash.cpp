@@ -0,0 +1,70 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/PasswordHash.h>
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/String.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+const std::string PasswordHash::type = "pbkdf2-sha256";
+
+PasswordHash::PasswordHash(const std::string& value) {
+	std::vector<std::string> values = esl::utility::String::split(value, '$', false);
+	if(values.size() != 3) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid password hash \"" + value + "\". Format should be \"<iterations>$<salt>$<hash>\"."));
+	}
+
+	unsigned long iterationsValue = 0;
+	try {
+		std::size_t pos = 0;
+		iterationsValue = std::stoul(values[0], &pos);
+		if(pos != values[0].size()) {
+			throw std::runtime_error("");
+		}
+	}
+	catch(...) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid number of iterations \"" + values[0] + "\" in password hash."));
+	}
+	if(iterationsValue == 0 || iterationsValue > UINT32_MAX) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid number of iterations \"" + values[0] + "\" in password hash."));
+	}
+	iterations = static_cast<std::uint32_t>(iterationsValue);
+
+	salt = crypto::Sha256::fromHex(values[1]);
+	hash = crypto::Sha256::fromHex(values[2]);
+	if(hash.empty()) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Empty hash in password hash \"" + value + "\"."));
+	}
+}
+
+bool PasswordHash::verify(const std::string& password) const {
+	return crypto::Sha256::equals(crypto::Sha256::pbkdf2(password, salt, iterations, hash.size()), hash);
+}
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
@@ -0,0 +1,49 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_AUTH_PASSWORDHASH_H_
+#define BATCHELOR_COMMON_AUTH_PASSWORDHASH_H_
+
+#include <cstdint>
+#include <string>
+
+namespace batchelor {
+namespace common {
+namespace auth {
+
+/* PBKDF2-HMAC-SHA256 hash of a password in format "<iterations>$<salt as hex>$<hash as hex>" */
+class PasswordHash {
+public:
+	static const std::string type;
+
+	explicit PasswordHash(const std::string& value);
+
+	bool verify(const std::string& password) const;
+
+private:
+	std::uint32_t iterations = 0;
+	std::string salt;
+	std::string hash;
+};
+
+} /* namespace auth */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_AUTH_PASSWORDHASH_H_ */
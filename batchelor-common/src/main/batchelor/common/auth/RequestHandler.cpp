@@ -17,17 +17,20 @@
  */
 
 #include <batchelor/common/auth/RequestHandler.h>
+#include <batchelor/common/crypto/Sha256.h>
 #include <batchelor/common/Logger.h>
+#include <batchelor/common/Timestamp.h>
 
 #include <esl/com/http/server/exception/StatusCode.h>
 #include <esl/com/http/server/Response.h>
 #include <esl/io/input/Closed.h>
 #include <esl/io/Output.h>
 #include <esl/io/output/String.h>
-#include <esl/object/Value.h>
 #include <esl/utility/String.h>
 #include <esl/utility/MIME.h>
 
+#include <cctype>
+#include <stdexcept>
 #include <string>
 
 namespace batchelor {
@@ -37,29 +40,55 @@ namespace auth {
 namespace {
 Logger logger("batchelor::common::auth::RequestHandler");
 
-void addAuthData(esl::com::http::server::RequestContext& requestContext, const std::map<std::string, std::set<UserData::Role>>& rolesByNamespace) {
-	esl::object::Value<std::vector<std::pair<std::string, std::string>>>* authDataPtr;
-	authDataPtr = requestContext.getObjectContext().findObject<esl::object::Value<std::vector<std::pair<std::string, std::string>>>>("auth-data");
+bool isAuthorizationHeader(const std::string& name) {
+	static const std::string authorization = "authorization";
 
-	if(authDataPtr == nullptr) {
-		std::unique_ptr<esl::object::Value<std::vector<std::pair<std::string, std::string>>>> authData;
-		authData.reset(new esl::object::Value<std::vector<std::pair<std::string, std::string>>>(std::vector<std::pair<std::string, std::string>>()));
-		authDataPtr = authData.get();
-		requestContext.getObjectContext().addObject("auth-data", std::move(authData));
+	if(name.size() != authorization.size()) {
+		return false;
 	}
+	for(std::size_t i = 0; i < name.size(); ++i) {
+		if(std::tolower(static_cast<unsigned char>(name[i])) != authorization[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Splits "<scheme> <token>" and returns the number of values found, but not more than 3 */
+std::size_t splitAuthorizationHeader(const std::string& header, std::string& scheme, std::string& token) {
+	std::size_t count = 0;
+	std::size_t pos = 0;
+
+	while(count < 3) {
+		pos = header.find_first_not_of(' ', pos);
+		if(pos == std::string::npos) {
+			break;
+		}
 
-	for(const auto& namespaceRoles : rolesByNamespace) {
-		for(const auto& role : namespaceRoles.second) {
-			authDataPtr->get().emplace_back("batchelor", namespaceRoles.first + ":" + UserData::fromRole(role));
+		std::size_t end = header.find(' ', pos);
+		if(end == std::string::npos) {
+			end = header.size();
 		}
+
+		if(count == 0) {
+			scheme = header.substr(pos, end - pos);
+		}
+		else if(count == 1) {
+			token = header.substr(pos, end - pos);
+		}
+		++count;
+		pos = end;
 	}
+
+	return count;
 }
 } /* namespace */
 
 RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std::string>>& settings) {
 	for(const auto& setting : settings) {
 		if(setting.first == "api-key") {
-			// basic = <user name>:plain:<api key>
+			// api-key = <user name>:plain:<api key>
+			// api-key = <user name>:sha256:<SHA-256 of api key as hex value>
 			auto values = esl::utility::String::split(setting.second, ':', false);
 			if(values.size() != 3) {
 				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
@@ -68,19 +97,28 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 			if(values[1] == "plain") {
 				userByPlainApiKey[values[2]] = values[0];
 			}
+			else if(values[1] == "sha256") {
+				userBySha256ApiKey[values[2]] = values[0];
+			}
 			else {
 				throw esl::system::Stacktrace::add(std::runtime_error("Unknown type \"" + values[1] + "\" in value \"" + setting.second + "\" of key '" + setting.first + "'."));
 			}
 		}
 		else if(setting.first == "basic-auth") {
-			// basic = <user name>:plain:<pw>
+			// basic-auth = <user name>:plain:<pw>
+			// basic-auth = <user name>:pbkdf2-sha256:<iterations>$<salt>$<hash>
 			auto values = esl::utility::String::split(setting.second, ':', false);
 			if(values.size() != 3) {
 				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
 			}
-			auto& password = plainBasicAuthByUser[values[0]];
+			if(plainBasicAuthByUser.count(values[0]) > 0 || pbkdf2BasicAuthByUser.count(values[0]) > 0) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of password for user \"" + values[0] + "\" at key '" + setting.first + "'."));
+			}
 			if(values[1] == "plain") {
-				password = values[2];
+				plainBasicAuthByUser[values[0]] = values[2];
+			}
+			else if(values[1] == PasswordHash::type) {
+				pbkdf2BasicAuthByUser[values[0]] = values[2];
 			}
 			else {
 				throw esl::system::Stacktrace::add(std::runtime_error("Unknown type \"" + values[1] + "\" in value \"" + setting.second + "\" of key '" + setting.first + "'."));
@@ -101,6 +139,25 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 				throw esl::system::Stacktrace::add(std::runtime_error("Unknown role \"" + values[2] + "\" for in value \"" + setting.second + "\" at key '" + setting.first + "'."));
 			}
 		}
+		else if(setting.first.substr(0, 4) == "jwt-" || setting.first.substr(0, 5) == "jwks-") {
+			jwtSettings.push_back(setting);
+		}
+		else if(setting.first == "credential-cache-size") {
+			try {
+				credentialCacheSize = std::stoul(setting.second);
+			}
+			catch(...) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'."));
+			}
+		}
+		else if(setting.first == "credential-cache-ttl") {
+			try {
+				credentialCacheTTL = Timestamp::toDuration(setting.second);
+			}
+			catch(const std::exception& e) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" of key '" + setting.first + "'." + e.what()));
+			}
+		}
 		else if(setting.first == "realm") {
 			if(!realm.empty()) {
 				throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of key '" + setting.first + "'."));
@@ -120,140 +177,121 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 	}
 }
 
-RequestHandler::Settings::Settings(const std::map<std::string, UserData>& aUsers, const std::map<std::string, std::string>& aUserByPlainApiKey, const std::map<std::string, std::string>& aPlainBasicAuthByUser)
+RequestHandler::Settings::Settings(const std::map<std::string, UserData>& aUsers, const std::map<std::string, std::string>& aUserByPlainApiKey, const std::map<std::string, std::string>& aUserBySha256ApiKey, const std::map<std::string, std::string>& aPlainBasicAuthByUser, const std::map<std::string, std::string>& aPbkdf2BasicAuthByUser, const std::vector<std::pair<std::string, std::string>>& aJwtSettings)
 : users(aUsers),
   userByPlainApiKey(aUserByPlainApiKey),
-  plainBasicAuthByUser(aPlainBasicAuthByUser)
+  userBySha256ApiKey(aUserBySha256ApiKey),
+  plainBasicAuthByUser(aPlainBasicAuthByUser),
+  pbkdf2BasicAuthByUser(aPbkdf2BasicAuthByUser),
+  jwtSettings(aJwtSettings)
 { }
 
 RequestHandler::RequestHandler(const Settings& aSettings)
-: settings(aSettings)
-{ }
+: settings(aSettings),
+  credentialCache(settings.credentialCacheSize, settings.credentialCacheTTL)
+{
+	for(const auto& user : settings.users) {
+		grantsByUser[user.first] = std::make_shared<const AuthData::Grants>(user.second);
+	}
+
+	for(const auto& apiKeyUser : settings.userByPlainApiKey) {
+		auto grantsIter = grantsByUser.find(apiKeyUser.second);
+		if(grantsIter != grantsByUser.end()) {
+			grantsByApiKeyHash[crypto::Sha256::hash(apiKeyUser.first)] = grantsIter->second;
+		}
+	}
+
+	for(const auto& apiKeyUser : settings.userBySha256ApiKey) {
+		std::string apiKeyHash = crypto::Sha256::fromHex(apiKeyUser.first);
+		if(apiKeyHash.size() != crypto::Sha256::digestSize) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid SHA-256 value \"" + apiKeyUser.first + "\" of API key for user \"" + apiKeyUser.second + "\"."));
+		}
+
+		auto grantsIter = grantsByUser.find(apiKeyUser.second);
+		if(grantsIter != grantsByUser.end()) {
+			grantsByApiKeyHash[apiKeyHash] = grantsIter->second;
+		}
+	}
+
+	for(const auto& userPassword : settings.plainBasicAuthByUser) {
+		plainPasswordHashByUser[userPassword.first] = crypto::Sha256::hash(userPassword.second);
+	}
+
+	for(const auto& userPasswordHash : settings.pbkdf2BasicAuthByUser) {
+		passwordHashByUser.emplace(userPasswordHash.first, PasswordHash(userPasswordHash.second));
+	}
+
+	if(!settings.jwtSettings.empty()) {
+		jwtValidator.reset(new JwtValidator(JwtValidator::Settings(settings.jwtSettings), grantsByUser, settings.credentialCacheSize, settings.credentialCacheTTL));
+	}
+}
 
 std::unique_ptr<esl::com::http::server::RequestHandler> RequestHandler::create(const std::vector<std::pair<std::string, std::string>>& settings) {
 	return std::unique_ptr<esl::com::http::server::RequestHandler>(new RequestHandler(Settings(settings)));
 }
 
 esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& requestContext) const {
-	if(settings.users.empty() && settings.userByPlainApiKey.empty() && settings.plainBasicAuthByUser.empty()) {
+	if(settings.users.empty() && grantsByApiKeyHash.empty() && plainPasswordHashByUser.empty() && passwordHashByUser.empty() && !jwtValidator) {
 		return esl::io::Input();
 	}
 
 	try {
 		const auto& headers = requestContext.getRequest().getHeaders();
 		auto headersIter = headers.begin();
-#if 1
 		for(;headersIter != headers.end(); ++headersIter) {
-			if(esl::utility::String::toLower(headersIter->first) == "authorization") {
+			if(isAuthorizationHeader(headersIter->first)) {
 				break;
 			}
 		}
-#else
-		auto headersIter = headers.find("Authorization");
-#endif
 		if(headersIter == headers.end()) {
 			throw esl::com::http::server::exception::StatusCode(401);
 		}
 
 		const std::string& authorizationHeader = headersIter->second;
-		std::vector<std::string> authorizationHeaderSplit = esl::utility::String::split(authorizationHeader, ' ', true);
+		std::string scheme;
+		std::string token;
+		std::size_t authorizationHeaderValues = splitAuthorizationHeader(authorizationHeader, scheme, token);
 
-		if(authorizationHeaderSplit.size() < 1) {
+		if(authorizationHeaderValues < 1) {
 			logger.warn << "Authorization header has is empty.\n";
 			throw esl::com::http::server::exception::StatusCode(400);
 		}
 
-		if(authorizationHeaderSplit[0] == "Bearer") {
-			if(authorizationHeaderSplit.size() < 2) {
-				logger.warn << "Authorization header has no token. Header should look like \"Authorization: Bearer <token>\".\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-
-			if(authorizationHeaderSplit.size() > 2) {
-				logger.warn << "Authorization header too many values:  \"" << authorizationHeaderSplit[0];
-				for(std::size_t i=1; i<authorizationHeaderSplit.size(); ++i) {
-					logger.warn << " " << authorizationHeaderSplit[i];
-				}
-				logger.warn << "\".\n";
-				logger.warn << "Authorization header should look like: \"Authorization: Bearer <token>\".\n";
-				logger.warn << "Drop values after <token> and continue.\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-
-			const std::string& apiKey = authorizationHeaderSplit[1];
-
-			auto apiKeyIter = settings.userByPlainApiKey.find(apiKey);
-			if(apiKeyIter == settings.userByPlainApiKey.end()) {
-				throw esl::com::http::server::exception::StatusCode(401);
-			}
-			const auto& username = apiKeyIter->second;
-
-			auto usersIter = settings.users.find(username);
-			if(usersIter == settings.users.end()) {
-				throw esl::com::http::server::exception::StatusCode(401);
-			}
-
-			auto& userData = usersIter->second;
-			addAuthData(requestContext, userData.rolesByNamespace);
+		if(scheme != "Bearer" && scheme != "Basic") {
+			logger.warn << "Authorization header has is not 'Basic' neither 'Bearer', but '" << scheme << "'.\n";
+			throw esl::com::http::server::exception::StatusCode(400);
 		}
-		else if(authorizationHeaderSplit[0] == "Basic") {
-			if(authorizationHeaderSplit.size() < 2) {
-				logger.warn << "Authorization header has no token. Header should look like \"Authorization: Basic <token>\".\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-
-			if(authorizationHeaderSplit.size() > 2) {
-				logger.warn << "Authorization header too many values:  \"" << authorizationHeaderSplit[0];
-				for(std::size_t i=1; i<authorizationHeaderSplit.size(); ++i) {
-					logger.warn << " " << authorizationHeaderSplit[i];
-				}
-				logger.warn << "\".\n";
-				logger.warn << "Authorization header should look like: \"Authorization: Basic <token>\".\n";
-				logger.warn << "Drop values after <token> and continue.\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-
-			const std::string& authorizationToken = authorizationHeaderSplit[1];
-			std::vector<std::string> authorizationTokenSplit = esl::utility::String::split( esl::utility::String::fromBase64(authorizationToken), ':', false);
-
-			if(authorizationTokenSplit.size() < 1) {
-				logger.warn << "Basic auth web token has no 'username'. Basic auth token should look like \"<username>:<password>\".\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-			const std::string& username = authorizationTokenSplit[0];
 
-			if(authorizationTokenSplit.size() < 2) {
-				logger.warn << "Basic auth web token has no 'password'. Basic auth token should look like \"<username>:<password>\".\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
-			const std::string& password = authorizationTokenSplit[1];
+		if(authorizationHeaderValues < 2) {
+			logger.warn << "Authorization header has no token. Header should look like \"Authorization: " << scheme << " <token>\".\n";
+			throw esl::com::http::server::exception::StatusCode(400);
+		}
 
-			if(authorizationTokenSplit.size() >= 3) {
-				logger.warn << "Basic auth web token has more arguments than required. Ignore additional arguments.\n";
-				throw esl::com::http::server::exception::StatusCode(400);
-			}
+		if(authorizationHeaderValues > 2) {
+			logger.warn << "Authorization header too many values:  \"" << authorizationHeader << "\".\n";
+			logger.warn << "Authorization header should look like: \"Authorization: " << scheme << " <token>\".\n";
+			throw esl::com::http::server::exception::StatusCode(400);
+		}
 
-			auto basicAuthIter = settings.plainBasicAuthByUser.find(username);
-			if(basicAuthIter == settings.plainBasicAuthByUser.end()) {
-				throw esl::com::http::server::exception::StatusCode(401);
+		std::shared_ptr<const AuthData::Grants> grants;
+		if(scheme == "Bearer") {
+			auto grantsIter = grantsByApiKeyHash.find(crypto::Sha256::hash(token));
+			if(grantsIter != grantsByApiKeyHash.end()) {
+				grants = grantsIter->second;
 			}
-			const auto& basicAuthPassword = basicAuthIter->second;
-			if(basicAuthPassword != password) {
-				throw esl::com::http::server::exception::StatusCode(401);
+			else if(jwtValidator && JwtValidator::isJwt(token)) {
+				grants = jwtValidator->validate(token);
 			}
-
-			auto usersIter = settings.users.find(username);
-			if(usersIter == settings.users.end()) {
-				throw esl::com::http::server::exception::StatusCode(401);
-			}
-
-			auto& userData = usersIter->second;
-			addAuthData(requestContext, userData.rolesByNamespace);
 		}
 		else {
-			logger.warn << "Authorization header has is not 'Basic' neither 'Bearer', but '" << authorizationHeaderSplit[0] << "'.\n";
-			throw esl::com::http::server::exception::StatusCode(400);
+			grants = getGrantsByBasicAuth(token);
 		}
+
+		if(!grants) {
+			throw esl::com::http::server::exception::StatusCode(401);
+		}
+
+		AuthData::add(requestContext.getObjectContext(), std::move(grants));
 	}
 	catch(const esl::com::http::server::exception::StatusCode& e) {
 		if(e.getStatusCode() != 401) {
@@ -285,6 +323,55 @@ esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& re
 	return esl::io::Input();
 }
 
+std::shared_ptr<const AuthData::Grants> RequestHandler::getGrantsByBasicAuth(const std::string& authorizationToken) const {
+	std::shared_ptr<const AuthData::Grants> grants = credentialCache.get(authorizationToken);
+	if(grants) {
+		return grants;
+	}
+
+	std::vector<std::string> authorizationTokenSplit = esl::utility::String::split( esl::utility::String::fromBase64(authorizationToken), ':', false);
+
+	if(authorizationTokenSplit.size() < 1) {
+		logger.warn << "Basic auth web token has no 'username'. Basic auth token should look like \"<username>:<password>\".\n";
+		throw esl::com::http::server::exception::StatusCode(400);
+	}
+	const std::string& username = authorizationTokenSplit[0];
+
+	if(authorizationTokenSplit.size() < 2) {
+		logger.warn << "Basic auth web token has no 'password'. Basic auth token should look like \"<username>:<password>\".\n";
+		throw esl::com::http::server::exception::StatusCode(400);
+	}
+	const std::string& password = authorizationTokenSplit[1];
+
+	if(authorizationTokenSplit.size() >= 3) {
+		logger.warn << "Basic auth web token has more arguments than required. Ignore additional arguments.\n";
+		throw esl::com::http::server::exception::StatusCode(400);
+	}
+
+	auto grantsIter = grantsByUser.find(username);
+	if(grantsIter == grantsByUser.end()) {
+		return nullptr;
+	}
+
+	auto plainPasswordHashIter = plainPasswordHashByUser.find(username);
+	if(plainPasswordHashIter != plainPasswordHashByUser.end()) {
+		if(!crypto::Sha256::equals(crypto::Sha256::hash(password), plainPasswordHashIter->second)) {
+			return nullptr;
+		}
+	}
+	else {
+		auto passwordHashIter = passwordHashByUser.find(username);
+		if(passwordHashIter == passwordHashByUser.end() || !passwordHashIter->second.verify(password)) {
+			return nullptr;
+		}
+	}
+
+	/* only verified credentials are cached, so unknown credentials cannot displace them */
+	credentialCache.put(authorizationToken, grantsIter->second);
+
+	return grantsIter->second;
+}
+
 } /* namespace auth */
 } /* namespace common */
 } /* namespace batchelor */
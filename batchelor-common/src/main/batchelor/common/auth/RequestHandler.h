@@ -19,15 +19,22 @@
 #ifndef BATCHELOR_COMMON_AUTH_REQUESTHANDLER_H_
 #define BATCHELOR_COMMON_AUTH_REQUESTHANDLER_H_
 
+#include <batchelor/common/auth/AuthData.h>
+#include <batchelor/common/auth/CredentialCache.h>
+#include <batchelor/common/auth/JwtValidator.h>
+#include <batchelor/common/auth/PasswordHash.h>
 #include <batchelor/common/auth/UserData.h>
 
 #include <esl/com/http/server/RequestContext.h>
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/io/Input.h>
 
+#include <chrono>
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -39,12 +46,29 @@ class RequestHandler : public esl::com::http::server::RequestHandler {
 public:
 	struct Settings {
 		explicit Settings(const std::vector<std::pair<std::string, std::string>>& settings);
-		explicit Settings(const std::map<std::string, UserData>& users, const std::map<std::string, std::string>& userByPlainApiKey, const std::map<std::string, std::string>& plainBasicAuthByUser);
+		explicit Settings(const std::map<std::string, UserData>& users, const std::map<std::string, std::string>& userByPlainApiKey, const std::map<std::string, std::string>& userBySha256ApiKey, const std::map<std::string, std::string>& plainBasicAuthByUser, const std::map<std::string, std::string>& pbkdf2BasicAuthByUser, const std::vector<std::pair<std::string, std::string>>& jwtSettings);
 
 		std::map<std::string, UserData> users;
 		std::map<std::string, std::string> userByPlainApiKey;
+
+		// user by SHA-256 of the API key as hex value
+		std::map<std::string, std::string> userBySha256ApiKey;
+
 		std::map<std::string, std::string> plainBasicAuthByUser;
+
+		// PBKDF2-HMAC-SHA256 password hash by user, see PasswordHash
+		std::map<std::string, std::string> pbkdf2BasicAuthByUser;
+
 		std::string realm;
+
+		// max. number of verified basic auth credentials that are cached
+		std::size_t credentialCacheSize = 4096;
+
+		// how long a verified basic auth credential or a validated JWT is cached
+		std::chrono::milliseconds credentialCacheTTL = std::chrono::minutes(5);
+
+		// settings "jwks-*" and "jwt-*" to validate bearer tokens as JWT, see JwtValidator::Settings
+		std::vector<std::pair<std::string, std::string>> jwtSettings;
 	};
 
 	RequestHandler(const Settings& settings);
@@ -55,6 +79,23 @@ public:
 
 private:
 	const Settings settings;
+
+	std::unordered_map<std::string, std::shared_ptr<const AuthData::Grants>> grantsByUser;
+
+	/* Grants by SHA-256 of the API key, so plain and hashed API keys are looked up the same way */
+	std::unordered_map<std::string, std::shared_ptr<const AuthData::Grants>> grantsByApiKeyHash;
+
+	/* SHA-256 of plain passwords, so the comparison does not depend on the length of the password */
+	std::unordered_map<std::string, std::string> plainPasswordHashByUser;
+	std::unordered_map<std::string, PasswordHash> passwordHashByUser;
+
+	/* Grants by verified basic auth token (base64 encoded "<username>:<password>") */
+	mutable CredentialCache credentialCache;
+
+	/* Validates bearer tokens that are not API keys, if JWT settings are available */
+	std::unique_ptr<JwtValidator> jwtValidator;
+
+	std::shared_ptr<const AuthData::Grants> getGrantsByBasicAuth(const std::string& authorizationToken) const;
 };
 
 } /* namespace auth */
@@ -17,6 +17,7 @@
  */
 
 #include <batchelor/common/auth/UserData.h>
+#include <batchelor/common/auth/AuthData.h>
 #include <batchelor/common/config/args/ArgumentsException.h>
 
 #include <esl/object/Value.h>
@@ -24,6 +25,7 @@
 
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -38,9 +40,15 @@ const std::string strRoleReadOnly("read-only");
 const std::string strRoleWorker("worker");
 }
 
-std::set<UserData::Role> UserData::getRoles(const esl::object::Context& context, const std::string& namespaceId) {
-	std::set<Role> roles;
+UserData::Roles UserData::getRoles(const esl::object::Context& context, const std::string& namespaceId) {
+	Roles roles;
 
+	const AuthData* precomputedAuthData = AuthData::find(context);
+	if(precomputedAuthData) {
+		roles |= precomputedAuthData->getRoles(namespaceId);
+	}
+
+	/* "auth-data" with values "<namespace>:<role>" for key "batchelor" is still supported for request handlers of other plugins */
 	auto authDataPtr = context.findObject<esl::object::Value<std::vector<std::pair<std::string, std::string>>>>("auth-data");
 	if(authDataPtr) {
 		const std::vector<std::pair<std::string, std::string>>& authData = authDataPtr->get();
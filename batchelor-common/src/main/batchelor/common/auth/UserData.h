@@ -23,6 +23,7 @@
 
 #include <esl/object/Context.h>
 
+#include <cstddef>
 #include <map>
 #include <set>
 #include <string>
@@ -38,9 +39,44 @@ struct UserData {
 		worker
 	};
 
+	/* Set of roles stored as bitset, so checking a role does not need any allocation or lookup */
+	class Roles {
+	public:
+		Roles() = default;
+		explicit Roles(const std::set<Role>& roles) {
+			for(const auto& role : roles) {
+				insert(role);
+			}
+		}
+
+		void insert(Role role) noexcept {
+			bits |= toBit(role);
+		}
+
+		std::size_t count(Role role) const noexcept {
+			return (bits & toBit(role)) ? 1 : 0;
+		}
+
+		bool empty() const noexcept {
+			return bits == 0;
+		}
+
+		Roles& operator|=(const Roles& other) noexcept {
+			bits |= other.bits;
+			return *this;
+		}
+
+	private:
+		static unsigned int toBit(Role role) noexcept {
+			return 1u << static_cast<unsigned int>(role);
+		}
+
+		unsigned int bits = 0;
+	};
+
 	std::map<std::string, std::set<Role>> rolesByNamespace;
 
-	static std::set<Role> getRoles(const esl::object::Context& context, const std::string& namespaceId);
+	static Roles getRoles(const esl::object::Context& context, const std::string& namespaceId);
 	static Role toRole(const std::string& roleStr);
 	static const std::string& fromRole(Role role);
 };
@@ -0,0 +1,142 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/crypto/RsaPublicKey.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <openssl/bn.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#else
+#include <openssl/rsa.h>
+#endif
+
+#include <stdexcept>
+
+namespace batchelor {
+namespace common {
+namespace crypto {
+
+namespace {
+using BigNum = std::unique_ptr<BIGNUM, decltype(&BN_free)>;
+
+std::string stripLeadingZeros(const std::string& value) {
+	std::size_t pos = value.find_first_not_of('\0');
+	return pos == std::string::npos ? std::string() : value.substr(pos);
+}
+
+BigNum toBigNum(const std::string& value) {
+	BigNum bigNum(BN_bin2bn(reinterpret_cast<const unsigned char*>(value.data()), static_cast<int>(value.size()), nullptr), &BN_free);
+	if(!bigNum) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot convert RSA key."));
+	}
+	return bigNum;
+}
+
+EVP_PKEY* createKey(const BigNum& modulus, const BigNum& exponent) {
+	EVP_PKEY* key = nullptr;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	std::unique_ptr<OSSL_PARAM_BLD, decltype(&OSSL_PARAM_BLD_free)> paramBuild(OSSL_PARAM_BLD_new(), &OSSL_PARAM_BLD_free);
+	if(!paramBuild
+			|| OSSL_PARAM_BLD_push_BN(paramBuild.get(), OSSL_PKEY_PARAM_RSA_N, modulus.get()) != 1
+			|| OSSL_PARAM_BLD_push_BN(paramBuild.get(), OSSL_PKEY_PARAM_RSA_E, exponent.get()) != 1) {
+		return nullptr;
+	}
+
+	std::unique_ptr<OSSL_PARAM, decltype(&OSSL_PARAM_free)> params(OSSL_PARAM_BLD_to_param(paramBuild.get()), &OSSL_PARAM_free);
+	std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> context(EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr), &EVP_PKEY_CTX_free);
+	if(!params || !context
+			|| EVP_PKEY_fromdata_init(context.get()) != 1
+			|| EVP_PKEY_fromdata(context.get(), &key, EVP_PKEY_PUBLIC_KEY, params.get()) != 1) {
+		return nullptr;
+	}
+#else
+	std::unique_ptr<RSA, decltype(&RSA_free)> rsa(RSA_new(), &RSA_free);
+	BigNum n(BN_dup(modulus.get()), &BN_free);
+	BigNum e(BN_dup(exponent.get()), &BN_free);
+	if(!rsa || !n || !e || RSA_set0_key(rsa.get(), n.get(), e.get(), nullptr) != 1) {
+		return nullptr;
+	}
+	n.release();
+	e.release();
+
+	key = EVP_PKEY_new();
+	if(key == nullptr || EVP_PKEY_assign_RSA(key, rsa.get()) != 1) {
+		EVP_PKEY_free(key);
+		return nullptr;
+	}
+	rsa.release();
+#endif
+
+	return key;
+}
+} /* namespace */
+
+constexpr std::size_t RsaPublicKey::minModulusBits;
+
+RsaPublicKey::RsaPublicKey(const std::string& aModulus, const std::string& aExponent) {
+	std::string modulusBytes = stripLeadingZeros(aModulus);
+	std::string exponentBytes = stripLeadingZeros(aExponent);
+	modulusSize = modulusBytes.size();
+
+	if(modulusSize * 8 < minModulusBits) {
+		throw esl::system::Stacktrace::add(std::runtime_error("RSA modulus has " + std::to_string(modulusSize * 8) + " bits, but at least " + std::to_string(minModulusBits) + " bits are required."));
+	}
+	if((static_cast<unsigned char>(modulusBytes.back()) & 1) == 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid RSA modulus."));
+	}
+	if(exponentBytes.empty()) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid RSA exponent."));
+	}
+
+	key.reset(createKey(toBigNum(modulusBytes), toBigNum(exponentBytes)), &EVP_PKEY_free);
+	if(!key) {
+		ERR_clear_error();
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot create RSA key."));
+	}
+}
+
+bool RsaPublicKey::verifySha256(const std::string& message, const std::string& signature) const {
+	/* RFC 8017 requires a signature of the size of the modulus, but OpenSSL accepts shorter ones as well */
+	if(signature.size() != modulusSize) {
+		return false;
+	}
+
+	std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+	bool verified = context
+			&& EVP_DigestVerifyInit(context.get(), nullptr, EVP_sha256(), nullptr, key.get()) == 1
+			&& EVP_DigestVerify(context.get(),
+					reinterpret_cast<const unsigned char*>(signature.data()), signature.size(),
+					reinterpret_cast<const unsigned char*>(message.data()), message.size()) == 1;
+
+	/* failed verifications leave errors in the queue of this thread */
+	ERR_clear_error();
+
+	return verified;
+}
+
+} /* namespace crypto */
+} /* namespace common */
+} /* namespace batchelor */
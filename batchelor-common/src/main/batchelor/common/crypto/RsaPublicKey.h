@@ -0,0 +1,55 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_CRYPTO_RSAPUBLICKEY_H_
+#define BATCHELOR_COMMON_CRYPTO_RSAPUBLICKEY_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/* EVP_PKEY of OpenSSL */
+struct evp_pkey_st;
+
+namespace batchelor {
+namespace common {
+namespace crypto {
+
+/* RSA public key to verify RSASSA-PKCS1-v1_5 signatures with SHA-256 ("RS256") by OpenSSL */
+class RsaPublicKey {
+public:
+	static constexpr std::size_t minModulusBits = 2048;
+
+	/* modulus and exponent as unsigned big-endian binary values */
+	RsaPublicKey(const std::string& modulus, const std::string& exponent);
+
+	bool verifySha256(const std::string& message, const std::string& signature) const;
+
+private:
+	std::size_t modulusSize = 0;
+
+	// shared by copies of the key, it is not modified after construction
+	std::shared_ptr<evp_pkey_st> key;
+};
+
+} /* namespace crypto */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_CRYPTO_RSAPUBLICKEY_H_ */
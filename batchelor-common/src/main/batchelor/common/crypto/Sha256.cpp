@@ -0,0 +1,280 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace batchelor {
+namespace common {
+namespace crypto {
+
+namespace {
+const std::uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t rotr(std::uint32_t x, unsigned int n) {
+	return (x >> n) | (x << (32 - n));
+}
+
+/* Hash contexts with the inner and outer padded HMAC key already processed */
+void initHmac(const std::string& key, Sha256& inner, Sha256& outer) {
+	std::string keyBlock = key.size() > Sha256::blockSize ? Sha256::hash(key) : key;
+	keyBlock.resize(Sha256::blockSize, '\0');
+
+	std::string innerPad(Sha256::blockSize, '\0');
+	std::string outerPad(Sha256::blockSize, '\0');
+	for(std::size_t i = 0; i < Sha256::blockSize; ++i) {
+		innerPad[i] = static_cast<char>(keyBlock[i] ^ 0x36);
+		outerPad[i] = static_cast<char>(keyBlock[i] ^ 0x5c);
+	}
+
+	inner.update(innerPad);
+	outer.update(outerPad);
+}
+} /* namespace */
+
+Sha256::Sha256()
+: state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{ }
+
+void Sha256::update(const void* data, std::size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	totalSize += size;
+
+	if(bufferSize > 0) {
+		std::size_t count = std::min(size, blockSize - bufferSize);
+		std::memcpy(buffer + bufferSize, bytes, count);
+		bufferSize += count;
+		bytes += count;
+		size -= count;
+
+		if(bufferSize < blockSize) {
+			return;
+		}
+		processBlock(buffer);
+		bufferSize = 0;
+	}
+
+	for(; size >= blockSize; bytes += blockSize, size -= blockSize) {
+		processBlock(bytes);
+	}
+
+	std::memcpy(buffer, bytes, size);
+	bufferSize = size;
+}
+
+void Sha256::update(const std::string& data) {
+	update(data.data(), data.size());
+}
+
+std::string Sha256::finish() {
+	std::uint64_t totalBits = totalSize * 8;
+
+	unsigned char padding[blockSize + 8] = { 0x80 };
+	std::size_t paddingSize = (bufferSize < 56 ? 56 : 120) - bufferSize;
+	for(std::size_t i = 0; i < 8; ++i) {
+		padding[paddingSize + i] = static_cast<unsigned char>(totalBits >> (56 - 8 * i));
+	}
+	update(padding, paddingSize + 8);
+
+	std::string digest(digestSize, '\0');
+	for(std::size_t i = 0; i < 8; ++i) {
+		digest[4*i]   = static_cast<char>(state[i] >> 24);
+		digest[4*i+1] = static_cast<char>(state[i] >> 16);
+		digest[4*i+2] = static_cast<char>(state[i] >> 8);
+		digest[4*i+3] = static_cast<char>(state[i]);
+	}
+	return digest;
+}
+
+std::string Sha256::hash(const std::string& data) {
+	Sha256 sha256;
+	sha256.update(data);
+	return sha256.finish();
+}
+
+std::string Sha256::hmac(const std::string& key, const std::string& data) {
+	Sha256 inner;
+	Sha256 outer;
+	initHmac(key, inner, outer);
+
+	inner.update(data);
+	outer.update(inner.finish());
+	return outer.finish();
+}
+
+std::string Sha256::pbkdf2(const std::string& password, const std::string& salt, std::uint32_t iterations, std::size_t size) {
+	if(iterations == 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid number of iterations 0 for PBKDF2."));
+	}
+
+	Sha256 innerInit;
+	Sha256 outerInit;
+	initHmac(password, innerInit, outerInit);
+
+	std::string result;
+	for(std::uint32_t blockIndex = 1; result.size() < size; ++blockIndex) {
+		unsigned char blockIndexBytes[4] = {
+				static_cast<unsigned char>(blockIndex >> 24),
+				static_cast<unsigned char>(blockIndex >> 16),
+				static_cast<unsigned char>(blockIndex >> 8),
+				static_cast<unsigned char>(blockIndex) };
+
+		Sha256 inner(innerInit);
+		inner.update(salt);
+		inner.update(blockIndexBytes, sizeof(blockIndexBytes));
+		Sha256 outer(outerInit);
+		outer.update(inner.finish());
+		std::string u = outer.finish();
+		std::string t = u;
+
+		for(std::uint32_t i = 1; i < iterations; ++i) {
+			inner = innerInit;
+			inner.update(u);
+			outer = outerInit;
+			outer.update(inner.finish());
+			u = outer.finish();
+
+			for(std::size_t j = 0; j < digestSize; ++j) {
+				t[j] ^= u[j];
+			}
+		}
+
+		result += t;
+	}
+
+	result.resize(size);
+	return result;
+}
+
+bool Sha256::equals(const std::string& value1, const std::string& value2) noexcept {
+	if(value1.size() != value2.size()) {
+		return false;
+	}
+
+	unsigned char diff = 0;
+	for(std::size_t i = 0; i < value1.size(); ++i) {
+		diff |= static_cast<unsigned char>(value1[i] ^ value2[i]);
+	}
+	return diff == 0;
+}
+
+std::string Sha256::toHex(const std::string& data) {
+	static const char digits[] = "0123456789abcdef";
+
+	std::string hex;
+	hex.reserve(data.size() * 2);
+	for(char c : data) {
+		hex += digits[static_cast<unsigned char>(c) >> 4];
+		hex += digits[static_cast<unsigned char>(c) & 0x0f];
+	}
+	return hex;
+}
+
+std::string Sha256::fromHex(const std::string& hex) {
+	if(hex.size() % 2 != 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid hex value \"" + hex + "\"."));
+	}
+
+	auto toNibble = [&hex](char c) {
+		if(c >= '0' && c <= '9') {
+			return c - '0';
+		}
+		if(c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		}
+		if(c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid hex value \"" + hex + "\"."));
+	};
+
+	std::string data;
+	data.reserve(hex.size() / 2);
+	for(std::size_t i = 0; i < hex.size(); i += 2) {
+		data += static_cast<char>((toNibble(hex[i]) << 4) | toNibble(hex[i+1]));
+	}
+	return data;
+}
+
+void Sha256::processBlock(const unsigned char* block) {
+	std::uint32_t w[64];
+	for(std::size_t i = 0; i < 16; ++i) {
+		w[i] = (static_cast<std::uint32_t>(block[4*i]) << 24) | (static_cast<std::uint32_t>(block[4*i+1]) << 16)
+				| (static_cast<std::uint32_t>(block[4*i+2]) << 8) | static_cast<std::uint32_t>(block[4*i+3]);
+	}
+	for(std::size_t i = 16; i < 64; ++i) {
+		std::uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+		std::uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	std::uint32_t a = state[0];
+	std::uint32_t b = state[1];
+	std::uint32_t c = state[2];
+	std::uint32_t d = state[3];
+	std::uint32_t e = state[4];
+	std::uint32_t f = state[5];
+	std::uint32_t g = state[6];
+	std::uint32_t h = state[7];
+
+	for(std::size_t i = 0; i < 64; ++i) {
+		std::uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+		std::uint32_t ch = (e & f) ^ (~e & g);
+		std::uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+		std::uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+		std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		std::uint32_t temp2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+} /* namespace crypto */
+} /* namespace common */
+} /* namespace batchelor */
@@ -0,0 +1,66 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_COMMON_CRYPTO_SHA256_H_
+#define BATCHELOR_COMMON_CRYPTO_SHA256_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace batchelor {
+namespace common {
+namespace crypto {
+
+/* SHA-256 with HMAC and PBKDF2 on top of it. Digests are returned as binary strings. */
+class Sha256 {
+public:
+	static constexpr std::size_t digestSize = 32;
+	static constexpr std::size_t blockSize = 64;
+
+	Sha256();
+
+	void update(const void* data, std::size_t size);
+	void update(const std::string& data);
+	std::string finish();
+
+	static std::string hash(const std::string& data);
+	static std::string hmac(const std::string& key, const std::string& data);
+	static std::string pbkdf2(const std::string& password, const std::string& salt, std::uint32_t iterations, std::size_t size = digestSize);
+
+	/* Compares in time that depends on the size, but not on the content of the values */
+	static bool equals(const std::string& value1, const std::string& value2) noexcept;
+
+	static std::string toHex(const std::string& data);
+	static std::string fromHex(const std::string& hex);
+
+private:
+	void processBlock(const unsigned char* block);
+
+	std::uint32_t state[8];
+	unsigned char buffer[blockSize];
+	std::size_t bufferSize = 0;
+	std::uint64_t totalSize = 0;
+};
+
+} /* namespace crypto */
+} /* namespace common */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_COMMON_CRYPTO_SHA256_H_ */
@@ -19,11 +19,15 @@
 #include <batchelor/common/plugin/oidc/ConnectionFactory.h>
 #include <batchelor/common/plugin/oidc/ProxyConnectionFactory.h>
 #include <batchelor/common/plugin/oidc/TokenFactoryClientCredentials.h>
+#include <batchelor/common/crypto/Sha256.h>
 
 #include <curl4esl/com/http/client/ConnectionFactory.h>
 
 #include <esl/com/http/client/CURLConnectionFactory.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 namespace batchelor {
@@ -31,6 +35,31 @@ namespace common {
 namespace plugin {
 namespace oidc {
 
+namespace {
+/* Token factories are shared by all connection factories with the same IdP settings and client credentials,
+ * so they share the token as well and there is only one request to the IdP for all of them. */
+std::mutex tokenFactoriesMutex;
+std::map<std::string, std::weak_ptr<TokenFactory>> tokenFactories;
+
+std::shared_ptr<TokenFactory> getTokenFactory(const std::vector<std::pair<std::string, std::string>>& curlIDPSettings, const std::string& clientId, const std::string& clientSecret) {
+	std::string key;
+	for(const auto& setting : curlIDPSettings) {
+		key += setting.first + '\0' + setting.second + '\0';
+	}
+	key += clientId + '\0' + crypto::Sha256::hash(clientSecret);
+
+	std::lock_guard<std::mutex> lock(tokenFactoriesMutex);
+
+	std::shared_ptr<TokenFactory> tokenFactory = tokenFactories[key].lock();
+	if(!tokenFactory) {
+		tokenFactory = std::make_shared<TokenFactoryClientCredentials>(std::unique_ptr<esl::com::http::client::ConnectionFactory>(new curl4esl::com::http::client::ConnectionFactory(esl::com::http::client::CURLConnectionFactory::Settings(curlIDPSettings))), clientId, clientSecret);
+		tokenFactories[key] = tokenFactory;
+	}
+
+	return tokenFactory;
+}
+} /* namespace */
+
 std::unique_ptr<plugin::ConnectionFactory> ConnectionFactory::create(const std::vector<std::pair<std::string, std::string>>& settings) {
 	return std::unique_ptr<plugin::ConnectionFactory>(new ConnectionFactory(settings));
 }
@@ -147,7 +176,7 @@ ConnectionFactory::ConnectionFactory(const std::vector<std::pair<std::string, st
 	curlUserSettings.emplace_back("url", url);
 	curlIDPSettings.emplace_back("url", identityProvider);
 
-	tokenFactory.reset(new TokenFactoryClientCredentials(std::unique_ptr<esl::com::http::client::ConnectionFactory>(new curl4esl::com::http::client::ConnectionFactory(esl::com::http::client::CURLConnectionFactory::Settings(curlIDPSettings))), clientId, clientSecret));
+	tokenFactory = getTokenFactory(curlIDPSettings, clientId, clientSecret);
 	connectionFactoryOriginal.reset(new curl4esl::com::http::client::ConnectionFactory(esl::com::http::client::CURLConnectionFactory::Settings(curlUserSettings)));
 	connectionFactoryProxy.reset(new ProxyConnectionFactory(*connectionFactoryOriginal, *tokenFactory));
 }
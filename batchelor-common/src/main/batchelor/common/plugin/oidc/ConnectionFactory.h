@@ -45,7 +45,7 @@ public:
 private:
 	std::unique_ptr<esl::com::http::client::ConnectionFactory> connectionFactoryProxy;
 	std::unique_ptr<esl::com::http::client::ConnectionFactory> connectionFactoryOriginal;
-	std::unique_ptr<TokenFactory> tokenFactory;
+	std::shared_ptr<TokenFactory> tokenFactory;
 };
 
 } /* namespace oidc */
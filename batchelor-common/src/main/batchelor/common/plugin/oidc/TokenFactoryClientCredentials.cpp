@@ -17,6 +17,7 @@
  */
 
 #include <batchelor/common/plugin/oidc/TokenFactoryClientCredentials.h>
+#include <batchelor/common/Logger.h>
 
 #include <esl/com/http/client/Connection.h>
 #include <esl/com/http/client/Request.h>
@@ -28,7 +29,9 @@
 #include <esl/utility/MIME.h>
 #include <esl/utility/String.h>
 
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <stdexcept>
 
 namespace batchelor {
@@ -36,6 +39,10 @@ namespace common {
 namespace plugin {
 namespace oidc {
 
+namespace {
+Logger logger("batchelor::common::plugin::oidc::TokenFactoryClientCredentials");
+} /* namespace */
+
 TokenFactoryClientCredentials::TokenFactoryClientCredentials(std::unique_ptr<esl::com::http::client::ConnectionFactory> aConnectionFactory, const std::string& aClientId, const std::string& aClientSecret)
 : connectionFactory(std::move(aConnectionFactory)),
   clientId(aClientId),
@@ -44,32 +51,124 @@ TokenFactoryClientCredentials::TokenFactoryClientCredentials(std::unique_ptr<esl
 	if(!connectionFactory) {
 		throw std::runtime_error("HTTP connection factory is empty");
 	}
+
+	thread = std::thread(&TokenFactoryClientCredentials::threadRun, this);
+}
+
+TokenFactoryClientCredentials::~TokenFactoryClientCredentials() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		threadStopping = true;
+	}
+	threadCV.notify_one();
+	thread.join();
 }
 
 std::string TokenFactoryClientCredentials::getToken() {
-	if(accessTokenExpiresAt <= std::chrono::steady_clock::now() || accessToken.empty()) {
-	    std::map<std::string, std::string> requestHeaders;
+	std::unique_lock<std::mutex> lock(mutex);
+	std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+
+	if(hasValidToken(now)) {
+		if(renewAt <= now) {
+			threadCV.notify_one();
+		}
+		return accessToken;
+	}
+
+	if(refreshing) {
+		// another caller requests a token already, so wait for its result instead of requesting a token as well
+		refreshCV.wait(lock, [this] { return !refreshing; });
+	}
+	else {
+		refresh(lock);
+	}
+
+	if(!hasValidToken(std::chrono::steady_clock::now())) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Refresh failed: " + refreshError));
+	}
+
+	return accessToken;
+}
+
+bool TokenFactoryClientCredentials::hasValidToken(std::chrono::time_point<std::chrono::steady_clock> now) const {
+	return !accessToken.empty() && accessTokenExpiresAt > now;
+}
+
+bool TokenFactoryClientCredentials::refresh(std::unique_lock<std::mutex>& lock) {
+	refreshing = true;
+	lock.unlock();
 
-	    requestHeaders["Accept"] = esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson);
-	    requestHeaders["Authorization"] = "Basic " + esl::utility::String::toBase64(clientId + ":" + clientSecret, esl::utility::String::base64);
+	std::string errorMessage;
+	esl::io::input::String consumerString;
+	std::unique_ptr<esl::com::http::client::Response> response;
+	try {
+		std::map<std::string, std::string> requestHeaders;
 
-	    esl::com::http::client::Request request("", esl::utility::HttpMethod::Type::httpPost, esl::utility::MIME("application/x-www-form-urlencoded"), requestHeaders);
+		requestHeaders["Accept"] = esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson);
+		requestHeaders["Authorization"] = "Basic " + esl::utility::String::toBase64(clientId + ":" + clientSecret, esl::utility::String::base64);
+
+		esl::com::http::client::Request request("", esl::utility::HttpMethod::Type::httpPost, esl::utility::MIME("application/x-www-form-urlencoded"), requestHeaders);
 
 		std::unique_ptr<esl::com::http::client::Connection> connection = connectionFactory->createConnection();
 		if(!connection) {
 			throw esl::system::Stacktrace::add(std::runtime_error("cannot create http connection."));
 		}
 
-	    esl::io::input::String consumerString;
-	    esl::com::http::client::Response response = connection->send(std::move(request), esl::io::output::String::create("grant_type=client_credentials"), esl::io::Input(consumerString));
-	    processResponse(response, consumerString.getString());
+		response.reset(new esl::com::http::client::Response(connection->send(std::move(request), esl::io::output::String::create("grant_type=client_credentials"), esl::io::Input(consumerString))));
+	}
+	catch(const std::exception& e) {
+		errorMessage = e.what();
+	}
+
+	lock.lock();
+
+	if(response) {
+		try {
+			processResponse(*response, consumerString.getString());
+		}
+		catch(const std::exception& e) {
+			errorMessage = e.what();
+		}
 	}
 
-	if(accessTokenExpiresAt <= std::chrono::steady_clock::now() || accessToken.empty()) {
-		throw esl::system::Stacktrace::add(std::runtime_error("Refresh failed."));
+	std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+	if(errorMessage.empty()) {
+		std::chrono::steady_clock::duration renewBeforeExpiry = std::min<std::chrono::steady_clock::duration>((accessTokenExpiresAt - now) / 5, maxRenewBeforeExpiry);
+		renewAt = accessTokenExpiresAt - renewBeforeExpiry;
+		refreshError.clear();
+	}
+	else {
+		logger.warn << "Refreshing token failed: " << errorMessage << "\n";
+		renewAt = now + retryInterval;
+		refreshError = errorMessage;
 	}
 
-	return accessToken;
+	refreshing = false;
+	refreshCV.notify_all();
+	threadCV.notify_one();
+
+	return errorMessage.empty();
+}
+
+void TokenFactoryClientCredentials::threadRun() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(!threadStopping) {
+		std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+
+		// Renew only tokens that are still valid. Without a valid token the next call of getToken requests a new one.
+		if(refreshing || !hasValidToken(now)) {
+			threadCV.wait(lock);
+			continue;
+		}
+
+		if(now < renewAt) {
+			threadCV.wait_until(lock, renewAt);
+			continue;
+		}
+
+		refresh(lock);
+	}
 }
 
 } /* namespace oidc */
@@ -23,24 +23,51 @@
 
 #include <esl/com/http/client/ConnectionFactory.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace batchelor {
 namespace common {
 namespace plugin {
 namespace oidc {
 
+/* Thread safe token factory. Only one request to the IdP is made at the same time, and a background thread renews the token
+ * before it expires. If renewal fails, the current token is used until it is expired. */
 class TokenFactoryClientCredentials : public TokenFactory {
 public:
 	TokenFactoryClientCredentials(std::unique_ptr<esl::com::http::client::ConnectionFactory> connectionFactory, const std::string& clientId, const std::string& clientSecret);
+	~TokenFactoryClientCredentials();
 
 	std::string getToken() override;
 
 private:
+	/* Renew the token when 1/5 of its lifetime is left, but not earlier than this time before it expires */
+	static constexpr std::chrono::seconds maxRenewBeforeExpiry{60};
+
+	/* Time to wait for the next try, if renewal failed */
+	static constexpr std::chrono::seconds retryInterval{5};
+
 	std::unique_ptr<esl::com::http::client::ConnectionFactory> connectionFactory;
 	const std::string clientId;
 	const std::string clientSecret;
+
+	std::mutex mutex;
+	std::condition_variable refreshCV;
+	std::condition_variable threadCV;
+	bool refreshing = false;
+	std::string refreshError;
+	std::chrono::time_point<std::chrono::steady_clock> renewAt;
+
+	bool threadStopping = false;
+	std::thread thread;
+
+	bool hasValidToken(std::chrono::time_point<std::chrono::steady_clock> now) const;
+	bool refresh(std::unique_lock<std::mutex>& lock);
+	void threadRun();
 };
 
 } /* namespace oidc */
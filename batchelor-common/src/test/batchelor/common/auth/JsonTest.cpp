@@ -0,0 +1,127 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/auth/Json.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/* Checks the JSON parser that is used for JWT header, JWT claims and JWKS. */
+
+namespace {
+using batchelor::common::auth::Json;
+
+int failures = 0;
+
+void check(bool condition, const std::string& description) {
+	if(!condition) {
+		std::cerr << "FAILED: " << description << "\n";
+		++failures;
+	}
+}
+
+void checkInvalid(const std::string& str, const std::string& description) {
+	try {
+		Json::parse(str);
+		std::cerr << "FAILED: " << description << " is rejected\n";
+		++failures;
+	}
+	catch(const std::runtime_error&) {
+	}
+}
+
+void checkValues() {
+	check(Json::parse("null").type == Json::Type::null, "null");
+	check(Json::parse(" true ").type == Json::Type::boolean && Json::parse("true").booleanValue, "true");
+	check(Json::parse("false").type == Json::Type::boolean && !Json::parse("false").booleanValue, "false");
+	check(Json::parse("1700000000").numberValue == 1700000000, "integer");
+	check(Json::parse("-1.5e3").numberValue == -1500, "number with fraction and exponent");
+	check(Json::parse("\"abc\"").stringValue == "abc", "string");
+
+	Json object = Json::parse("{ \"alg\" : \"RS256\", \"exp\":1700000000, \"aud\":[\"a\", \"b\"], \"realm_access\":{\"roles\":[]}, \"n\":null }");
+	check(object.type == Json::Type::object && object.objectValue.size() == 5, "object with 5 members");
+	check(object.getString("alg") == "RS256", "string member");
+	check(object.getString("exp").empty(), "getString of a number member is empty");
+	check(object.getString("missing").empty(), "getString of a missing member is empty");
+	check(object.find("missing") == nullptr, "find of a missing member");
+	check(object.find("exp") && object.find("exp")->type == Json::Type::number, "number member");
+	check(object.find("aud") && object.find("aud")->arrayValue.size() == 2 && object.find("aud")->arrayValue[1].stringValue == "b", "array member");
+	check(object.find("realm_access") && object.find("realm_access")->find("roles") && object.find("realm_access")->find("roles")->type == Json::Type::array, "nested object with empty array");
+	check(object.find("n") && object.find("n")->type == Json::Type::null, "null member");
+
+	check(Json::parse("{}").type == Json::Type::object && Json::parse("{}").objectValue.empty(), "empty object");
+	check(Json::parse("[]").type == Json::Type::array && Json::parse("[]").arrayValue.empty(), "empty array");
+}
+
+void checkStrings() {
+	check(Json::parse("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"").stringValue == "\"\\/\b\f\n\r\t", "simple escape sequences");
+	check(Json::parse("\"\\u0041\"").stringValue == "A", "escaped ASCII character");
+	check(Json::parse("\"\\u00e9\"").stringValue == "\xc3\xa9", "escaped 2 byte UTF-8 character");
+	check(Json::parse("\"\\u20AC\"").stringValue == "\xe2\x82\xac", "escaped 3 byte UTF-8 character");
+	check(Json::parse("\"\\ud83d\\ude00\"").stringValue == "\xf0\x9f\x98\x80", "escaped surrogate pair");
+	check(Json::parse("\"\xc3\xa9\"").stringValue == "\xc3\xa9", "unescaped UTF-8 character");
+}
+
+void checkInvalidValues() {
+	checkInvalid("", "empty input");
+	checkInvalid("   ", "whitespaces only");
+	checkInvalid("{", "unterminated object");
+	checkInvalid("[1, 2", "unterminated array");
+	checkInvalid("\"abc", "unterminated string");
+	checkInvalid("{\"a\" 1}", "member without ':'");
+	checkInvalid("{\"a\":1 \"b\":2}", "members without ','");
+	checkInvalid("{a:1}", "member name without quotes");
+	checkInvalid("[1 2]", "array values without ','");
+	checkInvalid("{} {}", "two values");
+	checkInvalid("tru", "truncated literal");
+	checkInvalid("nul", "truncated null");
+	checkInvalid("Infinity", "Infinity");
+	checkInvalid("1-2", "number with '-' inside");
+	checkInvalid("\"\\x\"", "invalid escape sequence");
+	checkInvalid("\"\\u12\"", "truncated unicode escape sequence");
+	checkInvalid("\"\\u12g4\"", "unicode escape sequence with invalid hex digit");
+	checkInvalid("\"\\ud83d\\u0041\"", "high surrogate followed by a non low surrogate");
+
+	std::string deep;
+	for(int i = 0; i < 100; ++i) {
+		deep += "[";
+	}
+	for(int i = 0; i < 100; ++i) {
+		deep += "]";
+	}
+	checkInvalid(deep, "value nested too deep");
+
+	std::string notTooDeep = "[[[[[[[[[[1]]]]]]]]]]";
+	check(Json::parse(notTooDeep).type == Json::Type::array, "value nested 10 levels");
+}
+} /* anonymous namespace */
+
+int main() {
+	checkValues();
+	checkStrings();
+	checkInvalidValues();
+
+	if(failures > 0) {
+		std::cerr << failures << " check(s) failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
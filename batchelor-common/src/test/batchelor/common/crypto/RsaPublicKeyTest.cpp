@@ -0,0 +1,131 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/crypto/RsaPublicKey.h>
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <iostream>
+#include <string>
+
+/* Known answer tests of RS256 signatures. The key and the signature have been created by
+ *   openssl genrsa -out key.pem 2048
+ *   openssl dgst -sha256 -sign key.pem -out signature message
+ */
+
+namespace {
+using batchelor::common::crypto::RsaPublicKey;
+using batchelor::common::crypto::Sha256;
+
+const std::string modulus = Sha256::fromHex(
+		"b50e47b6cab8ec1acc2f7f4069ad7bd5826fae78419a137751b6f332a9d92d023802eef1f4eead8795a6505171db3a54099f4be2b580d9d560daae3ae874ca8f"
+		"d762cd555e209f4d9ad9d2387ae915f48bb06b8ab78d791483a0f36438cbd588d91d1991caba469fa563e33a116f27cfac05668fcf6dc50708d74cbda539bfbc"
+		"ea7b5672698ba62a1fb7a2a1a8e8ef1c82d497d79ff9febde0fa0e3689692b1dfd69576b34f2a5b10b60022e56d052093b2432ec88fbe59994cbc37a6f690ed9"
+		"1eabaf36cfab8b6a1eecce558646f5fb1fc26f98ef0cbf305a9078e7e1286efaf85b0d106ffc5ea78b9d809a72296413e50ede4783a37d9d15b4840343f3e945");
+
+const std::string exponent = Sha256::fromHex("010001");
+
+const std::string message = "eyJhbGciOiJSUzI1NiJ9.eyJzdWIiOiJ3b3JrZXIifQ";
+
+const std::string signature = Sha256::fromHex(
+		"54c26fbe0a6395f45a9e53c286ab3349b02a23621a5a3f3ad3950e3618886932c815427cf1af463491b683ce78d5febb7852fbe02a9d9ff4060ff6ec93611214"
+		"c514d7d15c3021a6857676218393872b6ee58e5c2889726ec018bc084346f44237094f055f2cc11580bce92a1d4b31cdfc2637030b8ae6ce0ec7c485c9658af2"
+		"fffdd5a21031bc6c845178232bf676efc70f5945b84943eafd9dd1966e9b177ab49e85d53cd7958115693566190f27c255a94cfcbf6e1250e964d81cb83d9e18"
+		"7d761e58a490b72cb290b47a5cc9ac9b4b4e8c6b246b3c106c27bb331cecb9f179593e2dae6a689fa7a0fb053e9d8c5d65f9c2bc50f1f3f5e07370fe11a81b37");
+
+int failures = 0;
+
+void check(bool condition, const std::string& description) {
+	if(!condition) {
+		std::cerr << "FAILED: " << description << "\n";
+		++failures;
+	}
+}
+
+void checkVerify() {
+	RsaPublicKey key(modulus, exponent);
+
+	check(key.verifySha256(message, signature), "valid signature is accepted");
+
+	/* a copy shares the key */
+	RsaPublicKey keyCopy = key;
+	check(keyCopy.verifySha256(message, signature), "valid signature is accepted by a copy of the key");
+
+	std::string tamperedMessage = message;
+	tamperedMessage.back() ^= 1;
+	check(!key.verifySha256(tamperedMessage, signature), "tampered message is rejected");
+
+	std::string tamperedSignature = signature;
+	tamperedSignature[tamperedSignature.size() / 2] ^= 1;
+	check(!key.verifySha256(message, tamperedSignature), "tampered signature is rejected");
+
+	check(!key.verifySha256(message, signature.substr(1)), "signature that is too short is rejected");
+	check(!key.verifySha256(message, std::string(1, '\0') + signature), "signature with leading zero is rejected");
+	check(!key.verifySha256(message, ""), "empty signature is rejected");
+
+	/* s >= n is not a valid signature */
+	check(!key.verifySha256(message, modulus), "signature equal to the modulus is rejected");
+	check(!key.verifySha256(message, std::string(modulus.size(), '\xff')), "signature greater than the modulus is rejected");
+
+	/* after rejected signatures valid ones are still accepted */
+	check(key.verifySha256(message, signature), "valid signature is accepted after rejected ones");
+}
+
+void checkInvalidKeys() {
+	bool thrown = false;
+	try {
+		RsaPublicKey key(modulus.substr(128), exponent);
+	}
+	catch(const std::exception&) {
+		thrown = true;
+	}
+	check(thrown, "modulus with less than 2048 bits is rejected");
+
+	std::string evenModulus = modulus;
+	evenModulus.back() &= '\xfe';
+	thrown = false;
+	try {
+		RsaPublicKey key(evenModulus, exponent);
+	}
+	catch(const std::exception&) {
+		thrown = true;
+	}
+	check(thrown, "even modulus is rejected");
+
+	thrown = false;
+	try {
+		RsaPublicKey key(modulus, std::string(3, '\0'));
+	}
+	catch(const std::exception&) {
+		thrown = true;
+	}
+	check(thrown, "exponent 0 is rejected");
+}
+} /* anonymous namespace */
+
+int main() {
+	checkVerify();
+	checkInvalidKeys();
+
+	if(failures > 0) {
+		std::cerr << failures << " check(s) failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
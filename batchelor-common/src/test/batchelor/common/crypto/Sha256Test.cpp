@@ -0,0 +1,110 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/crypto/Sha256.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+/* Checks SHA-256, HMAC-SHA256 and PBKDF2-HMAC-SHA256 against the test vectors of FIPS 180-2, RFC 4231 and RFC 7914. */
+
+namespace {
+using batchelor::common::crypto::Sha256;
+
+int failures = 0;
+
+void check(const std::string& description, const std::string& digest, const std::string& expectedHex) {
+	std::string hex = Sha256::toHex(digest);
+	if(hex != expectedHex) {
+		std::cerr << "FAILED: " << description << "\n  expected " << expectedHex << "\n  got      " << hex << "\n";
+		++failures;
+	}
+}
+
+void checkHash() {
+	check("SHA-256 of \"\"", Sha256::hash(""),
+			"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	check("SHA-256 of \"abc\"", Sha256::hash("abc"),
+			"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	check("SHA-256 of 448 bit message", Sha256::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+			"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	check("SHA-256 of 896 bit message", Sha256::hash("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"),
+			"cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+	check("SHA-256 of one million \"a\"", Sha256::hash(std::string(1000000, 'a')),
+			"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+	/* the same message in pieces that do not match the block size */
+	std::string message(1000000, 'a');
+	Sha256 sha256;
+	for(std::size_t pos = 0; pos < message.size(); pos += 997) {
+		sha256.update(message.data() + pos, std::min<std::size_t>(997, message.size() - pos));
+	}
+	check("SHA-256 of one million \"a\" in pieces", sha256.finish(),
+			"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+void checkHmac() {
+	check("HMAC-SHA256 RFC 4231 test case 1", Sha256::hmac(std::string(20, '\x0b'), "Hi There"),
+			"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+	check("HMAC-SHA256 RFC 4231 test case 2", Sha256::hmac("Jefe", "what do ya want for nothing?"),
+			"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+	check("HMAC-SHA256 RFC 4231 test case 3", Sha256::hmac(std::string(20, '\xaa'), std::string(50, '\xdd')),
+			"773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+	check("HMAC-SHA256 RFC 4231 test case 6", Sha256::hmac(std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First"),
+			"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+	check("HMAC-SHA256 RFC 4231 test case 7", Sha256::hmac(std::string(131, '\xaa'), "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm."),
+			"9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+}
+
+void checkPbkdf2() {
+	check("PBKDF2-HMAC-SHA256 RFC 7914 \"passwd\"", Sha256::pbkdf2("passwd", "salt", 1, 64),
+			"55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783");
+	check("PBKDF2-HMAC-SHA256 RFC 7914 \"Password\"", Sha256::pbkdf2("Password", "NaCl", 80000, 64),
+			"4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d");
+	check("PBKDF2-HMAC-SHA256 with default size", Sha256::pbkdf2("password", "salt", 4096),
+			"c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+}
+
+void checkHexAndEquals() {
+	if(Sha256::fromHex("00ff7f80") != std::string("\x00\xff\x7f\x80", 4) || Sha256::toHex(std::string("\x00\xff\x7f\x80", 4)) != "00ff7f80") {
+		std::cerr << "FAILED: hex conversion\n";
+		++failures;
+	}
+	if(!Sha256::equals("abc", "abc") || Sha256::equals("abc", "abd") || Sha256::equals("abc", "abcd")) {
+		std::cerr << "FAILED: equals\n";
+		++failures;
+	}
+}
+} /* anonymous namespace */
+
+int main() {
+	checkHash();
+	checkHmac();
+	checkPbkdf2();
+	checkHexAndEquals();
+
+	if(failures > 0) {
+		std::cerr << failures << " check(s) failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
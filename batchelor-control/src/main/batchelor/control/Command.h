@@ -25,7 +25,9 @@ namespace control {
 enum class Command {
 	//help,
 	sendEvent,
+	sendEvents,
 	waitTask,
+	waitTasks,
 	cancelTask,
 	signalTask,
 	showTask,
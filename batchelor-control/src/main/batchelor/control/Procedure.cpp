@@ -30,13 +30,34 @@
 #include <esl/plugin/Registry.h>
 #include <esl/system/Stacktrace.h>
 
+#include "sergut/JsonDeserializer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace batchelor {
 namespace control {
 namespace {
 Logger logger("batchelor::control::Procedure");
 
+constexpr std::size_t defaultBatchSize = 1000;
+
+/* Number of task ids per status query. It keeps the URL of the query small. */
+constexpr std::size_t statusQuerySize = 200;
+
+/* Interval to poll the status of tasks if the head has too many watchers to stream the changes. */
+constexpr std::chrono::milliseconds pollInterval(5000);
+
+bool isFinalState(const std::string& stateStr) {
+	common::types::State::Type state = common::types::State::toState(stateStr);
+	return state == common::types::State::done || state == common::types::State::signaled || state == common::types::State::zombie;
+}
+
 void printStatus(const service::schemas::TaskStatusHead& taskStatus) {
 	common::types::State::Type state = common::types::State::toState(taskStatus.state);
 
@@ -115,9 +136,15 @@ void Procedure::internalProcedureRun(esl::object::Context& context) {
 			case Command::sendEvent:
 				sendEvent();
 				break;
+			case Command::sendEvents:
+				sendEvents();
+				break;
 			case Command::waitTask:
 				waitTask(settings.taskId);
 				break;
+			case Command::waitTasks:
+				waitTasks();
+				break;
 			case Command::cancelTask:
 				signalTask(settings.taskId, "CANCEL");
 				break;
@@ -177,45 +204,238 @@ void Procedure::sendEvent() {
 	}
 }
 
-void Procedure::waitTask(const std::string& taskId) {
-	std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
-	service::schemas::TaskStatusHead oldTaskStatus;
+void Procedure::sendEvents() {
+	std::ifstream inputFile;
+	if(!settings.inputFile.empty() && settings.inputFile != "-") {
+		inputFile.open(settings.inputFile);
+		if(!inputFile.good()) {
+			throw std::runtime_error("Cannot open input file \"" + settings.inputFile + "\".");
+		}
+	}
+	std::istream& input = inputFile.is_open() ? static_cast<std::istream&>(inputFile) : std::cin;
 
-	{
-		auto httpConnection = createHTTPConnection();
-		service::client::Service client(*httpConnection);
+	const std::size_t batchSize = settings.batchSize == 0 ? defaultBatchSize : settings.batchSize;
+	std::vector<service::schemas::RunRequest> runRequests;
+	std::vector<std::size_t> lineNos;
+	std::size_t lineNo = 0;
+	std::string line;
+	std::vector<std::string> taskIds;
 
-		std::unique_ptr<service::schemas::TaskStatusHead> taskStatus = client.getTask(settings.namespaceId, taskId);
-		if(!taskStatus) {
-			return;
+	/* Requests are sent in batches while reading, so the input does not have to fit into memory
+	 * and the head does not have to process one huge transaction. */
+	while(true) {
+		bool eof = !std::getline(input, line);
+		if(!eof) {
+			++lineNo;
+			if(line.find_first_not_of(" \t\r") == std::string::npos) {
+				continue;
+			}
+
+			service::schemas::RunRequest runRequest;
+			try {
+				runRequest = sergut::JsonDeserializer(line).deserializeData<service::schemas::RunRequest>();
+			}
+			catch(const std::exception& e) {
+				throw std::runtime_error("Invalid run request in line " + std::to_string(lineNo) + ": " + e.what());
+			}
+			runRequests.push_back(std::move(runRequest));
+			lineNos.push_back(lineNo);
 		}
 
-		rc = taskStatus->returnCode;
+		if(runRequests.size() >= batchSize || (eof && !runRequests.empty())) {
+			std::vector<service::schemas::RunResponse> runResponses;
+
+			/* The input cannot be read twice if it is stdin, so a network error is handled here by trying
+			 * the next head with the same batch. Sending a batch twice is fine, because the head deduplicates. */
+			for(std::size_t tries = 1; true; ++tries) {
+				try {
+					auto httpConnection = createHTTPConnection();
+					service::client::Service client(*httpConnection);
+
+					runResponses = client.runTasks(settings.namespaceId, runRequests);
+					break;
+				}
+				catch(const esl::com::http::client::exception::NetworkError& e) {
+					logger.warn << "Network error: " << e.what() << "\n";
+					httpConnectionFactory = nullptr;
+					if(!initializedSettings || tries >= initializedSettings->connectionFactories.size()) {
+						rc = 1;
+						throw;
+					}
+				}
+			}
 
-		printStatus(*taskStatus);
+			for(std::size_t i = 0; i < runResponses.size(); ++i) {
+				if(runResponses[i].taskId.empty()) {
+					rc = 1;
+					logger.info << "Line " << lineNos[i] << ": Message: \"" << runResponses[i].message << "\"\n";
+				}
+				else {
+					logger.info << "Line " << lineNos[i] << ": Task ID: \"" << runResponses[i].taskId << "\"\n";
+					if(settings.wait) {
+						taskIds.push_back(runResponses[i].taskId);
+					}
+				}
+			}
+			runRequests.clear();
+			lineNos.clear();
+		}
 
-		oldTaskStatus = *taskStatus;
+		if(eof) {
+			break;
+		}
 	}
 
-	while(true) {
-		{
-			common::types::State::Type state = common::types::State::toState(oldTaskStatus.state);
-			if(state == common::types::State::done || state == common::types::State::signaled || state == common::types::State::zombie) {
-				break;
+	if(settings.wait && !taskIds.empty()) {
+		logger.info << "-----------------\n";
+		int sendRc = rc;
+		waitTasks(taskIds);
+		rc = std::max(rc, sendRc);
+	}
+}
+
+void Procedure::waitTasks() {
+	std::vector<std::string> taskIds;
+	if(!settings.taskId.empty()) {
+		taskIds.push_back(settings.taskId);
+	}
+	taskIds.insert(taskIds.end(), settings.taskIds.begin(), settings.taskIds.end());
+
+	if(!settings.inputFile.empty()) {
+		std::ifstream inputFile;
+		if(settings.inputFile != "-") {
+			inputFile.open(settings.inputFile);
+			if(!inputFile.good()) {
+				throw std::runtime_error("Cannot open input file \"" + settings.inputFile + "\".");
+			}
+		}
+		std::istream& input = inputFile.is_open() ? static_cast<std::istream&>(inputFile) : std::cin;
+
+		for(std::string line; std::getline(input, line);) {
+			std::size_t begin = line.find_first_not_of(" \t\r");
+			if(begin == std::string::npos) {
+				continue;
 			}
+			std::size_t end = line.find_last_not_of(" \t\r");
+			taskIds.push_back(line.substr(begin, end - begin + 1));
+		}
+	}
+
+	waitTasks(taskIds);
+}
+
+void Procedure::waitTasks(const std::vector<std::string>& taskIds) {
+	std::unordered_set<std::string> pendingTaskIds(taskIds.begin(), taskIds.end());
+	const std::size_t total = pendingTaskIds.size();
+	std::size_t countSucceeded = 0;
+	std::size_t countFailed = 0;
+	std::size_t countUnknown = 0;
+	bool stopWaiting = false;
+
+	auto finish = [&](const std::string& taskId, const service::schemas::TaskStatusHead* taskStatus) {
+		if(pendingTaskIds.erase(taskId) == 0) {
+			return;
 		}
 
-		//std::this_thread::sleep_for(std::chrono::milliseconds(5000));
-		notifyCV.wait_for(lockNotifyMutex, std::chrono::milliseconds(5000));
-		if(settings.waitCancel != -2 && signalsReceived > signalsProcessed) {
-			++signalsProcessed;
-			signalTask(taskId, "CANCEL");
+		std::size_t count = total - pendingTaskIds.size();
+		if(!taskStatus) {
+			++countUnknown;
+			logger.info << "[" << count << "/" << total << "] Task \"" << taskId << "\": unknown\n";
 		}
-		if((settings.waitCancel == -2 && signalsReceived > 0)
-		|| (settings.waitCancel >=  0 && signalsReceived > settings.waitCancel)) {
+		else {
+			if(common::types::State::toState(taskStatus->state) == common::types::State::done && taskStatus->returnCode == 0) {
+				++countSucceeded;
+			}
+			else {
+				++countFailed;
+			}
+			logger.info << "[" << count << "/" << total << "] Task \"" << taskId << "\": " << taskStatus->state << ", return code " << taskStatus->returnCode << "\n";
+		}
+	};
+
+	while(!pendingTaskIds.empty() && !stopWaiting) {
+		auto httpConnection = createHTTPConnection();
+		service::client::Service client(*httpConnection);
+
+		/* Current status of all pending tasks with a few queries of many task ids each.
+		 * Changes after the first query are received by the stream below, so nothing gets lost in between. */
+		std::uint64_t streamEventId = 0;
+		{
+			std::vector<std::string> pendingTaskIdList(pendingTaskIds.begin(), pendingTaskIds.end());
+			for(std::size_t begin = 0; begin < pendingTaskIdList.size(); begin += statusQuerySize) {
+				std::vector<std::string> queryTaskIds(pendingTaskIdList.begin() + begin, pendingTaskIdList.begin() + std::min(begin + statusQuerySize, pendingTaskIdList.size()));
+
+				std::uint64_t eventId = 0;
+				std::vector<service::schemas::TaskStatusHead> taskStatusList = client.watchTasks(settings.namespaceId, queryTaskIds, ""/*state*/, eventId, std::chrono::milliseconds(0));
+				if(begin == 0) {
+					streamEventId = eventId;
+				}
+
+				std::unordered_set<std::string> knownTaskIds;
+				for(const auto& taskStatus : taskStatusList) {
+					knownTaskIds.insert(taskStatus.runConfiguration.taskId);
+					if(isFinalState(taskStatus.state)) {
+						finish(taskStatus.runConfiguration.taskId, &taskStatus);
+					}
+				}
+				for(const auto& taskId : queryTaskIds) {
+					if(knownTaskIds.count(taskId) == 0) {
+						finish(taskId, nullptr);
+					}
+				}
+			}
+		}
+
+		if(pendingTaskIds.empty()) {
 			break;
 		}
+		logger.info << "Waiting for " << pendingTaskIds.size() << " of " << total << " tasks\n";
+
+		/* a few tasks are filtered by the head, otherwise the changes of all tasks are filtered here */
+		std::vector<std::string> streamTaskIds;
+		if(pendingTaskIds.size() <= statusQuerySize) {
+			streamTaskIds.assign(pendingTaskIds.begin(), pendingTaskIds.end());
+		}
 
+		bool streamed = client.streamTasks(settings.namespaceId, streamTaskIds, ""/*state*/, streamEventId, [&](const service::schemas::TaskStatusHead* taskStatus) {
+			{
+				std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
+				if(signalsReceived > 0) {
+					stopWaiting = true;
+					return false;
+				}
+			}
+
+			if(taskStatus && isFinalState(taskStatus->state)) {
+				finish(taskStatus->runConfiguration.taskId, taskStatus);
+			}
+			return !pendingTaskIds.empty();
+		});
+
+		if(!stopWaiting && !pendingTaskIds.empty()) {
+			/* the head has closed the connection, so reconnect after a short delay.
+			 * If the head has too many watchers, the status is polled by the queries above until a stream is possible. */
+			std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
+			notifyCV.wait_for(lockNotifyMutex, streamed ? std::chrono::milliseconds(1000) : pollInterval);
+			if(signalsReceived > 0) {
+				stopWaiting = true;
+			}
+		}
+	}
+
+	logger.info << "-----------------\n";
+	logger.info << "Succeeded  : " << countSucceeded << "\n";
+	logger.info << "Failed     : " << countFailed << "\n";
+	logger.info << "Unknown    : " << countUnknown << "\n";
+	logger.info << "Unfinished : " << pendingTaskIds.size() << "\n";
+
+	rc = (countFailed > 0 || countUnknown > 0 || !pendingTaskIds.empty()) ? 1 : 0;
+}
+
+void Procedure::waitTask(const std::string& taskId) {
+	service::schemas::TaskStatusHead oldTaskStatus;
+
+	{
 		auto httpConnection = createHTTPConnection();
 		service::client::Service client(*httpConnection);
 
@@ -224,17 +444,72 @@ void Procedure::waitTask(const std::string& taskId) {
 			return;
 		}
 
-		if(oldTaskStatus.state == taskStatus->state && oldTaskStatus.message == taskStatus->message) {
-			continue;
-		}
-
 		rc = taskStatus->returnCode;
 
-		logger.info << "-----------------\n";
 		printStatus(*taskStatus);
 
 		oldTaskStatus = *taskStatus;
 	}
+
+	/* The head pushes every change of the task over one connection, so there is no need to poll.
+	 * Heartbeats are used to check for received signals. */
+	bool stopWaiting = false;
+	auto isFinished = [&oldTaskStatus]() {
+		common::types::State::Type state = common::types::State::toState(oldTaskStatus.state);
+		return state == common::types::State::done || state == common::types::State::signaled || state == common::types::State::zombie;
+	};
+
+	while(!stopWaiting && !isFinished()) {
+		auto httpConnection = createHTTPConnection();
+		service::client::Service client(*httpConnection);
+
+		auto onTask = [&](const service::schemas::TaskStatusHead* taskStatus) {
+			{
+				std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
+				if(settings.waitCancel != -2 && signalsReceived > signalsProcessed) {
+					++signalsProcessed;
+					signalTask(taskId, "CANCEL");
+				}
+				if((settings.waitCancel == -2 && signalsReceived > 0)
+				|| (settings.waitCancel >=  0 && signalsReceived > settings.waitCancel)) {
+					stopWaiting = true;
+					return false;
+				}
+			}
+
+			if(!taskStatus || (oldTaskStatus.state == taskStatus->state && oldTaskStatus.message == taskStatus->message)) {
+				return true;
+			}
+
+			rc = taskStatus->returnCode;
+
+			logger.info << "-----------------\n";
+			printStatus(*taskStatus);
+
+			oldTaskStatus = *taskStatus;
+			return !isFinished();
+		};
+
+		if(client.streamTasks(settings.namespaceId, {taskId}, ""/*state*/, 0, onTask)) {
+			if(!stopWaiting && !isFinished()) {
+				/* the head has closed the connection, so reconnect after a short delay */
+				std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
+				notifyCV.wait_for(lockNotifyMutex, std::chrono::milliseconds(1000));
+			}
+		}
+		else {
+			/* the head has too many watchers, so poll the status until a stream is possible */
+			{
+				std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
+				notifyCV.wait_for(lockNotifyMutex, pollInterval);
+			}
+			std::unique_ptr<service::schemas::TaskStatusHead> taskStatus = client.getTask(settings.namespaceId, taskId);
+			if(!taskStatus) {
+				return;
+			}
+			onTask(taskStatus.get());
+		}
+	}
 }
 
 void Procedure::signalTask(const std::string& taskId, const std::string& signal) {
@@ -31,6 +31,7 @@
 #include <esl/object/Context.h>
 
 #include <condition_variable>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -59,10 +60,13 @@ public:
 		bool wait = false;
 		int waitCancel = -2;
 		std::string taskId;
+		std::vector<std::string> taskIds; // further task ids of command wait-tasks
 		std::string signal;
 		std::string state;
 		std::string eventNotAfter;
 		std::string eventNotBefore;
+		std::string inputFile;
+		std::size_t batchSize = 0;
 		std::set<std::string> connectionFactoryIds;
 	};
 
@@ -84,7 +88,10 @@ private:
 	};
 
 	void sendEvent();
+	void sendEvents();
 	void waitTask(const std::string& taskId);
+	void waitTasks();
+	void waitTasks(const std::vector<std::string>& taskIds);
 	void signalTask(const std::string& taskId, const std::string& signal);
 	void showTask();
 	void showTasks();
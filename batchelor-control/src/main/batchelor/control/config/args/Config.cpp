@@ -37,7 +37,9 @@ namespace {
 
 static const std::string commandStrHelp = "help";
 static const std::string commandStrSendEvent = "send-event";
+static const std::string commandStrSendEvents = "send-events";
 static const std::string commandStrWaitTask = "wait-task";
+static const std::string commandStrWaitTasks = "wait-tasks";
 static const std::string commandStrCancelTask = "cancel-task";
 static const std::string commandStrSignalTask = "signal-task";
 static const std::string commandStrShowTask = "show-task";
@@ -50,8 +52,12 @@ const std::string& commandToStr(Command command) noexcept {
 	switch(command) {
 	case Command::sendEvent:
 		return commandStrSendEvent;
+	case Command::sendEvents:
+		return commandStrSendEvents;
 	case Command::waitTask:
 		return commandStrWaitTask;
+	case Command::waitTasks:
+		return commandStrWaitTasks;
 	case Command::cancelTask:
 		return commandStrCancelTask;
 	case Command::signalTask:
@@ -73,9 +79,15 @@ Command strToCommand(const std::string& commandStr) {
 	if(commandStr == commandStrSendEvent) {
 		return Command::sendEvent;
 	}
+	if(commandStr == commandStrSendEvents) {
+		return Command::sendEvents;
+	}
 	if(commandStr == commandStrWaitTask) {
 		return Command::waitTask;
 	}
+	if(commandStr == commandStrWaitTasks) {
+		return Command::waitTasks;
+	}
 	if(commandStr == commandStrCancelTask) {
 		return Command::cancelTask;
 	}
@@ -106,7 +118,9 @@ void Config::printUsage() {
 	std::cout << "Usage:\n";
 	std::cout << "  batchelor-control help\n";
 	std::cout << "  batchelor-control send-event       [CONNECTION OPTIONS] --event-type <event-type> [--priority <priority>] [--setting <key> <value>] [--condition <condition>] [--wait | --wait-cancel <max-tries>]\n";
+	std::cout << "  batchelor-control send-events      [CONNECTION OPTIONS] [--input <file>] [--batch-size <batch-size>] [--wait]\n";
 	std::cout << "  batchelor-control wait-task        [CONNECTION OPTIONS] --task-id <task-id> [--wait-cancel <max-tries>]\n";
+	std::cout << "  batchelor-control wait-tasks       [CONNECTION OPTIONS] [--task-id <task-id>]... [--input <file>]\n";
 	std::cout << "  batchelor-control cancel-task      [CONNECTION OPTIONS] --task-id <task-id>\n";
 	std::cout << "  batchelor-control signal-task      [CONNECTION OPTIONS] --task-id <task-id> --signal <signal>\n";
 	std::cout << "  batchelor-control show-task        [CONNECTION OPTIONS] --task-id <task-id>\n";
@@ -116,7 +130,9 @@ void Config::printUsage() {
 	std::cout << "COMMANDS:\n";
 	std::cout << "  help              shows this help\n";
 	std::cout << "  send-event        adds a new event that will wait to get processed.\n";
+	std::cout << "  send-events       adds many events that are read from a file with one JSON run request per line.\n";
 	std::cout << "  wait-task         Wait for new messages of the given task and return with exit code of this task.\n";
+	std::cout << "  wait-tasks        Wait until all given tasks are finished. Exit code is 0 if all tasks are done with return code 0.\n";
 	std::cout << "  cancel-task       This is equal to command 'signal-task' with option '--signal CANCEL'.\n";
 	std::cout << "  signal-task       Send a signal to the given task. It must be exactly one signal specified as name or number.\n";
 	std::cout << "  show-task         Shows all details of the given task.\n";
@@ -138,6 +154,17 @@ void Config::printUsage() {
 	std::cout << "                                          signal is received, but control program does not abort until receiving this signal <max-tries> times.\n";
 	std::cout << "                                          If <max-tries> is set to -1 control program will never stop until task has been stopped.\n";
 	std::cout << "\n";
+	std::cout << "OPTIONS specific for command 'send-events':\n";
+	std::cout << "  -i, --input            <file>           Reads the run requests from <file> instead of stdin. Use \"-\" for stdin.\n";
+	std::cout << "                                          Each line contains one run request like\n";
+	std::cout << "                                          {\"eventType\":\"...\",\"priority\":0,\"settings\":[{\"key\":\"...\",\"value\":\"...\"}]}\n";
+	std::cout << "  -b, --batch-size       <batch-size>     Number of run requests that are sent to the head with one call. Default value is 1000.\n";
+	std::cout << "  -w, --wait                              Wait until all sent tasks are finished like command 'wait-tasks'.\n";
+	std::cout << "\n";
+	std::cout << "OPTIONS specific for command 'wait-tasks':\n";
+	std::cout << "  -t, --task-id          <task-id>        Specifies a task to wait for. This option can be used multiple times.\n";
+	std::cout << "  -i, --input            <file>           Reads task ids to wait for from <file>, one task id per line. Use \"-\" for stdin.\n";
+	std::cout << "\n";
 	std::cout << "OPTIONS specific for command 'wait-task', 'cancel-task', 'signal-task', 'show-task':\n";
 	std::cout << "  -t, --task-id          <task-id>        Specifies the task that the command is related to.\n";
 	std::cout << "\n";
@@ -243,6 +270,14 @@ Config::Config(esl::object::Context& aContext, Procedure::Settings& aSettings, i
 			setEventNotBefore(i+1 < argc ? argv[i+1] : nullptr);
 			++i;
 		}
+		else if(currentArg == "-i"  || currentArg == "--input") {
+			setInputFile(i+1 < argc ? argv[i+1] : nullptr);
+			++i;
+		}
+		else if(currentArg == "-b"  || currentArg == "--batch-size") {
+			setBatchSize(i+1 < argc ? argv[i+1] : nullptr);
+			++i;
+		}
 		else if(currentArg == "-f"  || currentArg == "--connection-file") {
 			addConnectionFile(i+1 < argc ? argv[i+1] : nullptr);
 			++i;
@@ -262,6 +297,15 @@ Config::Config(esl::object::Context& aContext, Procedure::Settings& aSettings, i
 		}
 	}
 
+	if(getCommand() == Command::waitTasks) {
+		if(settings.taskId.empty() && settings.inputFile.empty()) {
+			throw ArgumentsException("Option '--task-id' or '--input' is missing.");
+		}
+	}
+	else if(!settings.taskIds.empty()) {
+		throw ArgumentsException("Multiple specification of option \"--task-id\" is not allowed.");
+	}
+
 	switch(getCommand()) {
 	case Command::waitTask:
 	case Command::cancelTask:
@@ -291,6 +335,23 @@ void Config::setCommand(const std::string& commandStr) {
 
 	settings.command.reset(new Command(strToCommand(commandStr)));
 	switch(*settings.command) {
+	case Command::sendEvents:
+		if(!settings.eventType.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-type");
+		}
+		if(settings.priority >= 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--priority");
+		}
+		if(!settings.settings.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--setting");
+		}
+		if(!settings.condition.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--condition");
+		}
+		if(settings.waitCancel >= -1) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--wait-cancel");
+		}
+		// @suppress("No break at end of case")
 	case Command::sendEvent:
 		if(!settings.taskId.empty()) {
 			throw argumentsExceptionCommandOptionMismatch(commandStr, "--task-id");
@@ -307,6 +368,50 @@ void Config::setCommand(const std::string& commandStr) {
 		if(!settings.eventNotBefore.empty()) {
 			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-not-before");
 		}
+		if(*settings.command == Command::sendEvents) {
+			break;
+		}
+		if(!settings.inputFile.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--input");
+		}
+		if(settings.batchSize > 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--batch-size");
+		}
+		break;
+	case Command::waitTasks:
+		if(!settings.signal.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--signal");
+		}
+		if(!settings.eventType.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-type");
+		}
+		if(settings.priority >= 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--priority");
+		}
+		if(!settings.settings.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--setting");
+		}
+		if(!settings.condition.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--condition");
+		}
+		if(settings.wait) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--wait");
+		}
+		if(settings.waitCancel >= -1) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--wait-cancel");
+		}
+		if(!settings.state.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--state");
+		}
+		if(!settings.eventNotAfter.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-not-after");
+		}
+		if(!settings.eventNotBefore.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-not-before");
+		}
+		if(settings.batchSize > 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--batch-size");
+		}
 		break;
 	case Command::waitTask:
 	case Command::showTask:
@@ -340,6 +445,12 @@ void Config::setCommand(const std::string& commandStr) {
 		if(!settings.eventNotBefore.empty()) {
 			throw argumentsExceptionCommandOptionMismatch(commandStr, "--event-not-before");
 		}
+		if(!settings.inputFile.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--input");
+		}
+		if(settings.batchSize > 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--batch-size");
+		}
 		break;
 	case Command::showEventTypes:
 		if(!settings.state.empty()) {
@@ -374,6 +485,12 @@ void Config::setCommand(const std::string& commandStr) {
 		if(settings.wait) {
 			throw argumentsExceptionCommandOptionMismatch(commandStr, "--wait");
 		}
+		if(!settings.inputFile.empty()) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--input");
+		}
+		if(settings.batchSize > 0) {
+			throw argumentsExceptionCommandOptionMismatch(commandStr, "--batch-size");
+		}
 		break;
 	}
 }
@@ -525,7 +642,7 @@ void Config::setWait() {
 
 	settings.wait = true;
 
-	if(settings.command && *settings.command != Command::sendEvent) {
+	if(settings.command && *settings.command != Command::sendEvent && *settings.command != Command::sendEvents) {
 		throw ArgumentsException("Command \"" + commandToStr(*settings.command) + "\" does not allow to use option \"--wait\".");
 	}
 }
@@ -552,16 +669,22 @@ void Config::setWaitCancel(const char* aMaxTries) {
 }
 
 void Config::setTaskId(const char* value) {
-	if(!settings.taskId.empty()) {
-		throw ArgumentsException("Multiple specification of option \"--task-id\" is not allowed.");
-	}
 	if(!value) {
 		throw ArgumentsException("Value missing of option \"--task-id\".");
 	}
 
-	settings.taskId = value;
+	/* only command wait-tasks allows multiple task ids, but the command might be specified later */
+	if(settings.taskId.empty()) {
+		settings.taskId = value;
+	}
+	else if(!settings.command || *settings.command == Command::waitTasks) {
+		settings.taskIds.push_back(value);
+	}
+	else {
+		throw ArgumentsException("Multiple specification of option \"--task-id\" is not allowed.");
+	}
 
-	if(settings.command && *settings.command != Command::waitTask && *settings.command != Command::cancelTask && *settings.command != Command::signalTask && *settings.command != Command::showTask) {
+	if(settings.command && *settings.command != Command::waitTask && *settings.command != Command::waitTasks && *settings.command != Command::cancelTask && *settings.command != Command::signalTask && *settings.command != Command::showTask) {
 		throw ArgumentsException("Command \"" + commandToStr(*settings.command) + "\" does not allow to use option \"--task-id\".");
 	}
 }
@@ -631,6 +754,53 @@ void Config::setEventNotBefore(const char* value) {
 	}
 }
 
+void Config::setInputFile(const char* value) {
+	if(!settings.inputFile.empty()) {
+		throw ArgumentsException("Multiple specification of option \"--input\" is not allowed.");
+	}
+	if(!value) {
+		throw ArgumentsException("Value missing of option \"--input\".");
+	}
+
+	settings.inputFile = value;
+
+	if(settings.inputFile.empty()) {
+		throw ArgumentsException("Definition of invalid value \"\" for option \"--input\".");
+	}
+
+	if(settings.command && *settings.command != Command::sendEvents && *settings.command != Command::waitTasks) {
+		throw ArgumentsException("Command \"" + commandToStr(*settings.command) + "\" does not allow to use option \"--input\".");
+	}
+}
+
+void Config::setBatchSize(const char* value) {
+	if(settings.batchSize > 0) {
+		throw ArgumentsException("Multiple specification of option \"--batch-size\" is not allowed.");
+	}
+	if(!value) {
+		throw ArgumentsException("Value missing of option \"--batch-size\".");
+	}
+
+	int batchSize;
+	try {
+		batchSize = std::stoi(value);
+	}
+	catch(const std::invalid_argument& e) {
+		throw ArgumentsException("Invalid value '" + std::string(value) + "' of option \"--batch-size\".");
+	}
+	catch(const std::out_of_range& e) {
+		throw ArgumentsException("Value '" + std::string(value) + "' of option \"--batch-size\" is out of range.");
+	}
+	if(batchSize <= 0) {
+		throw ArgumentsException("Value '" + std::string(value) + "' of option \"--batch-size\" is out of range. The value must be greater than 0.");
+	}
+	settings.batchSize = static_cast<std::size_t>(batchSize);
+
+	if(settings.command && *settings.command != Command::sendEvents) {
+		throw ArgumentsException("Command \"" + commandToStr(*settings.command) + "\" does not allow to use option \"--batch-size\".");
+	}
+}
+
 void Config::addConnection(const char* plugin) {
 	if(!plugin) {
 		throw ArgumentsException("Plugin-value missing of option \"--connection\".");
@@ -76,6 +76,8 @@ private:
 	void setState(const char* state);
 	void setEventNotAfter(const char* eventNotAfter);
 	void setEventNotBefore(const char* eventNotBefore);
+	void setInputFile(const char* inputFile);
+	void setBatchSize(const char* batchSize);
 
 	void addConnection(const char* plugin);
 	void addConnectionFile(const char* value);
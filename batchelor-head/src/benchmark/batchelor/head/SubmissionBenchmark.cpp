@@ -0,0 +1,169 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/common/plugin/basic/ConnectionFactory.h>
+
+#include <batchelor/service/client/Service.h>
+#include <batchelor/service/schemas/EventTypeAvailable.h>
+#include <batchelor/service/schemas/FetchRequest.h>
+#include <batchelor/service/schemas/FetchResponse.h>
+#include <batchelor/service/schemas/RunRequest.h>
+#include <batchelor/service/schemas/RunResponse.h>
+#include <batchelor/service/schemas/Setting.h>
+
+#include <esl/com/http/client/Connection.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+/* Measures how many task submissions per second a running head accepts, once with one runTask request per
+ * submission and once with runTasks requests that submit a whole batch at once.
+ * The benchmark announces its own event type per run like a worker does, so the submissions are accepted, and
+ * every submission has different settings, so none of them is deduplicated. The submitted tasks stay queued,
+ * so use a head with an in-memory database or a namespace that can be cleaned up afterwards.
+ * Usage: batchelor-head-benchmark-submit <head-url> <namespace-id> [submissions] [batch-size] [connection-setting=value ...]
+ * e.g.   batchelor-head-benchmark-submit http://localhost:8080 default 10000 500 api-key=secret
+ */
+
+namespace {
+using namespace batchelor;
+
+service::schemas::RunRequest makeRunRequest(const std::string& eventType, std::size_t number) {
+	service::schemas::RunRequest runRequest;
+	runRequest.eventType = eventType;
+	runRequest.priority = 0;
+	runRequest.settings.push_back(service::schemas::Setting::make("args", "--submission=" + std::to_string(number)));
+	return runRequest;
+}
+
+/* the head accepts tasks only for event types that a worker has announced recently */
+void announceEventType(service::client::Service& client, const std::string& namespaceId, const std::string& eventType) {
+	service::schemas::FetchRequest fetchRequest;
+	fetchRequest.workerId = eventType;
+
+	service::schemas::EventTypeAvailable eventTypeAvailable;
+	eventTypeAvailable.eventType = eventType;
+	eventTypeAvailable.available = true;
+	fetchRequest.eventTypes.push_back(eventTypeAvailable);
+
+	client.fetchTask(namespaceId, fetchRequest);
+}
+
+void checkRunResponse(const service::schemas::RunResponse& runResponse) {
+	if(runResponse.taskId.empty()) {
+		throw std::runtime_error("submission has been rejected: " + runResponse.message);
+	}
+}
+
+void printThroughput(const std::string& label, std::size_t submissions, std::size_t requests, std::chrono::steady_clock::duration duration) {
+	double seconds = std::chrono::duration<double>(duration).count();
+
+	std::cout << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << submissions << " submissions in " << std::setw(6) << requests << " requests"
+			<< "   " << std::setw(9) << (seconds * 1000.0) << " ms"
+			<< "   " << std::setw(10) << (submissions / seconds) << " submissions/s\n";
+}
+
+void submitSingle(service::client::Service& client, const std::string& namespaceId, const std::string& eventType, std::size_t submissions) {
+	announceEventType(client, namespaceId, eventType);
+
+	auto startTS = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < submissions; ++i) {
+		checkRunResponse(client.runTask(namespaceId, makeRunRequest(eventType, i)));
+	}
+	printThroughput("runTask", submissions, submissions, std::chrono::steady_clock::now() - startTS);
+}
+
+void submitBatches(service::client::Service& client, const std::string& namespaceId, const std::string& eventType, std::size_t submissions, std::size_t batchSize) {
+	announceEventType(client, namespaceId, eventType);
+
+	/* requests are built before the clock starts, like for runTask */
+	std::vector<std::vector<service::schemas::RunRequest>> batches;
+	for(std::size_t i = 0; i < submissions; i += batchSize) {
+		batches.emplace_back();
+		for(std::size_t j = i; j < std::min(submissions, i + batchSize); ++j) {
+			batches.back().push_back(makeRunRequest(eventType, j));
+		}
+	}
+
+	auto startTS = std::chrono::steady_clock::now();
+	for(const auto& batch : batches) {
+		for(const auto& runResponse : client.runTasks(namespaceId, batch)) {
+			checkRunResponse(runResponse);
+		}
+	}
+	printThroughput("runTasks", submissions, batches.size(), std::chrono::steady_clock::now() - startTS);
+}
+} /* anonymous namespace */
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <head-url> <namespace-id> [submissions] [batch-size] [connection-setting=value ...]\n";
+		return 1;
+	}
+
+	std::string namespaceId = argv[2];
+	std::size_t submissions = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10000;
+	std::size_t batchSize = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 500;
+	if(submissions == 0 || batchSize == 0) {
+		std::cerr << "number of submissions and batch size must be greater than 0\n";
+		return 1;
+	}
+
+	std::vector<std::pair<std::string, std::string>> settings;
+	settings.emplace_back("url", argv[1]);
+	for(int i = 5; i < argc; ++i) {
+		std::string setting = argv[i];
+		std::size_t pos = setting.find('=');
+		if(pos == std::string::npos) {
+			std::cerr << "invalid connection setting \"" << setting << "\", expected key=value\n";
+			return 1;
+		}
+		settings.emplace_back(setting.substr(0, pos), setting.substr(pos + 1));
+	}
+
+	try {
+		std::unique_ptr<common::plugin::ConnectionFactory> connectionFactory = common::plugin::basic::ConnectionFactory::create(settings);
+		std::unique_ptr<esl::com::http::client::Connection> connection = connectionFactory->get().createConnection();
+		service::client::Service client(*connection);
+
+		/* each measurement gets its own event type, so it does not find the tasks of the other one */
+		std::string eventType = "benchmark-submit-" + std::to_string(getpid());
+
+		std::cout << submissions << " submissions to namespace \"" << namespaceId << "\" at \"" << argv[1] << "\", batches of " << batchSize << "\n";
+		submitSingle(client, namespaceId, eventType + "-single", submissions);
+		submitBatches(client, namespaceId, eventType + "-batch", submissions, batchSize);
+	}
+	catch(const std::exception& e) {
+		std::cerr << "submission failed: " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -106,10 +106,11 @@ unsigned int calculatedEffectivePriority(unsigned int priority, std::chrono::sys
 }
 }
 
-Dao::Dao(esl::database::Connection& aDbConnection)
+Dao::Dao(esl::database::Connection& aDbConnection, Metrics* aMetrics)
 : dbConnection(aDbConnection),
-  isSQLite(true)
+  isSQLite(true),
   //isSQLite(dbConnection.getImplementations().count("SQLite") > 0)
+  metrics(aMetrics)
 {
 	if(isSQLite) {
 		dbConnection.prepare(
@@ -135,6 +136,14 @@ Dao::Dao(esl::database::Connection& aDbConnection)
 			"CREATE TABLE IF NOT EXISTS AVAILABLE_EVENT_TYPES("
 		    "EVENT_TYPE TEXT, "
     	    "LAST_HEARTBEAT_TS INTEGER);").execute();
+
+		/* task lists are filtered and sorted by creation time by default */
+		dbConnection.prepare(
+			"CREATE INDEX IF NOT EXISTS TASKS_CREATED_TS ON TASKS(CREATED_TS);").execute();
+
+		/* runTask and runTasks look up the latest task with same event type and CRC32 to find duplicates */
+		dbConnection.prepare(
+			"CREATE INDEX IF NOT EXISTS TASKS_EVENT_TYPE_CRC32 ON TASKS(EVENT_TYPE, CRC32);").execute();
 		/*
 		dbConnection.prepare(
 			"CREATE TABLE IF NOT EXISTS WORKER_METRICS("
@@ -145,6 +154,33 @@ Dao::Dao(esl::database::Connection& aDbConnection)
 	}
 }
 
+Dao::Transaction::Transaction(Dao& aDao)
+: dao(aDao)
+{
+	dao.dbConnection.prepare("BEGIN TRANSACTION;").execute();
+}
+
+Dao::Transaction::~Transaction() {
+	if(committed) {
+		return;
+	}
+
+	try {
+		dao.dbConnection.prepare("ROLLBACK;").execute();
+	}
+	catch(const std::exception& e) {
+		logger.warn << "Rollback failed: " << e.what() << "\n";
+	}
+	catch(...) {
+		logger.warn << "Rollback failed.\n";
+	}
+}
+
+void Dao::Transaction::commit() {
+	dao.dbConnection.prepare("COMMIT;").execute();
+	committed = true;
+}
+
 void Dao::saveTask(const std::string& namespaceId, const Task& task) {
 	if(insertTask(namespaceId, task)) {
 		return;
@@ -155,6 +191,8 @@ void Dao::saveTask(const std::string& namespaceId, const Task& task) {
 }
 
 bool Dao::insertTask(const std::string& namespaceId, const Task& task) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::insertTask));
+
 	static const std::string sqlStr = "INSERT INTO TASKS ("
 			"TASK_ID, "
 			"CRC32, "
@@ -202,6 +240,8 @@ bool Dao::insertTask(const std::string& namespaceId, const Task& task) {
 }
 
 bool Dao::updateTask(const std::string& namespaceId, const Task& task) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::updateTask));
+
 	static const std::string sqlStr = "UPDATE TASKS SET "
 			"CRC32 = ?, "
 			"PRIORITY = ?, "
@@ -256,6 +296,8 @@ bool Dao::updateTask(const std::string& namespaceId, const Task& task) {
 }
 
 std::vector<Dao::Task> Dao::loadTasks(const std::string& namespaceId, const std::string& stateStr, const std::chrono::system_clock::time_point& eventNotAfterTS, const std::chrono::system_clock::time_point& eventNotBeforeTS) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadTasksByState));
+
     std::vector<Task> results;
 
 	static const std::string sqlStrWithState = "SELECT "
@@ -338,7 +380,95 @@ std::vector<Dao::Task> Dao::loadTasks(const std::string& namespaceId, const std:
     return results;
 }
 
+std::vector<Dao::Task> Dao::loadTasks(const std::string& namespaceId, const service::TaskQuery& query) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadTasksByQuery));
+
+    std::vector<Task> results;
+
+	std::string sqlStr = "SELECT "
+			"TASK_ID, "
+			"CRC32, "
+			"PRIORITY, "
+			"PRIORITY_TS, "
+			"EVENT_TYPE, "
+			"SETTINGS, "
+			"METRICS, "
+			"SIGNALS, "
+			"CONDITION, "
+			"CREATED_TS, "
+			"BEGIN_TS, "
+			"END_TS, "
+			"LAST_HEARTBEAT_TS, "
+			"RETURN_CODE, "
+			"MESSAGE, "
+			"STATE "
+			"FROM TASKS "
+			"WHERE CREATED_TS >= ? AND CREATED_TS <= ? AND (? = '' OR STATE = ?) AND (? = '' OR EVENT_TYPE = ?) "
+			"ORDER BY ";
+
+	/* column names cannot be bound as parameter, so they are taken from this fixed list only */
+	switch(query.sortBy) {
+	case service::TaskQuery::SortBy::taskId:
+		sqlStr += "TASK_ID";
+		break;
+	case service::TaskQuery::SortBy::eventType:
+		sqlStr += "EVENT_TYPE";
+		break;
+	case service::TaskQuery::SortBy::state:
+		sqlStr += "STATE";
+		break;
+	case service::TaskQuery::SortBy::returnCode:
+		sqlStr += "RETURN_CODE";
+		break;
+	default:
+		sqlStr += "CREATED_TS";
+		break;
+	}
+	sqlStr += query.descending ? " DESC, TASK_ID DESC " : " ASC, TASK_ID ASC ";
+	sqlStr += "LIMIT ? OFFSET ?;";
+
+    std::int64_t eventNotBefore = query.eventNotBefore.empty() ? std::numeric_limits<std::int64_t>::lowest() : std::chrono::time_point_cast<std::chrono::milliseconds>(common::Timestamp::fromJSON(query.eventNotBefore)).time_since_epoch().count();
+    std::int64_t eventNotAfter = query.eventNotAfter.empty() ? std::numeric_limits<std::int64_t>::max() : std::chrono::time_point_cast<std::chrono::milliseconds>(common::Timestamp::fromJSON(query.eventNotAfter)).time_since_epoch().count();
+
+	esl::database::PreparedStatement statement = dbConnection.prepare(sqlStr);
+	for(esl::database::ResultSet resultSet = statement.execute(eventNotBefore, eventNotAfter, query.state, query.state, query.eventType, query.eventType, checkedNumericConvert<std::int64_t>(query.limit), checkedNumericConvert<std::int64_t>(query.offset)); resultSet; resultSet.next()) {
+    	Task task;
+
+    	task.taskId = resultSet[0].isNull() ? "" : resultSet[0].asString();
+    	task.crc32 = resultSet[1].isNull() ? 0 : resultSet[1].asInteger();
+    	task.priority = resultSet[2].isNull() ? 0 : resultSet[2].asInteger();
+    	if(!resultSet[3].isNull()) {
+    	    task.priorityTS = std::chrono::time_point<std::chrono::system_clock>(std::chrono::milliseconds(resultSet[3].asInteger()));
+    	}
+    	task.effectivePriority = calculatedEffectivePriority(task.priority, task.priorityTS);
+    	task.eventType = resultSet[4].isNull() ? "" : resultSet[4].asString();
+    	task.settings = toSettings(resultSet[5].isNull() ? "" : resultSet[5].asString());
+    	task.metrics = toSettings(resultSet[6].isNull() ? "" : resultSet[6].asString());
+    	if(!resultSet[7].isNull()) {
+    		task.signals = esl::utility::String::split(resultSet[7].asString(), ',', true);
+    	}
+    	task.condition = resultSet[8].isNull() ? "" : resultSet[8].asString();
+    	if(!resultSet[9].isNull()) {
+    	    task.createdTS = std::chrono::time_point<std::chrono::system_clock>(std::chrono::milliseconds(resultSet[9].asInteger()));
+    	}
+    	task.startTS = common::Timestamp::fromString(resultSet[10].isNull() ? "" : resultSet[10].asString());
+    	task.endTS = common::Timestamp::fromString(resultSet[11].isNull() ? "" : resultSet[11].asString());
+    	if(!resultSet[12].isNull()) {
+    	    task.lastHeartbeatTS = std::chrono::time_point<std::chrono::system_clock>(std::chrono::milliseconds(resultSet[12].asInteger()));
+    	}
+    	task.returnCode = resultSet[13].isNull() ? 0 : resultSet[13].asInteger();
+    	task.message = resultSet[14].isNull() ? "" : resultSet[14].asString();
+	    task.state = resultSet[15].isNull() ? common::types::State::Type::done : common::types::State::toState(resultSet[15].asString());
+
+        results.push_back(task);
+    }
+
+    return results;
+}
+
 std::unique_ptr<Dao::Task> Dao::loadTaskByTaskId(const std::string& namespaceId, const std::string& taskId) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadTaskByTaskId));
+
     std::unique_ptr<Task> task;
 
 	static const std::string sqlStr = "SELECT "
@@ -396,6 +526,8 @@ std::unique_ptr<Dao::Task> Dao::loadTaskByTaskId(const std::string& namespaceId,
 }
 
 std::unique_ptr<Dao::Task> Dao::loadLatesTaskByEventTypeAndCrc32(const std::string& namespaceId, const std::string& eventType, std::uint32_t crc32) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadLatesTaskByEventTypeAndCrc32));
+
     std::unique_ptr<Task> task;
 
 	static const std::string sqlStr = "SELECT "
@@ -457,6 +589,8 @@ std::unique_ptr<Dao::Task> Dao::loadLatesTaskByEventTypeAndCrc32(const std::stri
 }
 
 std::vector<Dao::Task> Dao::loadTasksByEventTypeAndState(const std::string& namespaceId, const std::string& eventType, const common::types::State::Type& state) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadTasksByEventTypeAndState));
+
     std::vector<Task> tasks;
 
 	static const std::string sqlStr = "SELECT "
@@ -478,11 +612,11 @@ std::vector<Dao::Task> Dao::loadTasksByEventTypeAndState(const std::string& name
 			"WHERE EVENT_TYPE = ? AND STATE = ?;";
     esl::database::PreparedStatement statement = dbConnection.prepare(sqlStr);
 
-    for(esl::database::ResultSet resultSet = statement.execute(eventType, common::types::State::toString(common::types::State::queued)); resultSet; resultSet.next()) {
+    for(esl::database::ResultSet resultSet = statement.execute(eventType, common::types::State::toString(state)); resultSet; resultSet.next()) {
     	Task task;
 
     	task.eventType = eventType;
-    	task.state = common::types::State::queued;
+    	task.state = state;
     	task.crc32 = resultSet[0].isNull() ? 0 : resultSet[0].asInteger();
     	task.taskId = resultSet[1].isNull() ? "" : resultSet[1].asString();
     	task.priority = resultSet[2].isNull() ? 0 : resultSet[2].asInteger();
@@ -514,7 +648,34 @@ std::vector<Dao::Task> Dao::loadTasksByEventTypeAndState(const std::string& name
     return tasks;
 }
 
+std::vector<Dao::TaskCount> Dao::loadTaskCounts() {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadTaskCounts));
+
+	std::vector<TaskCount> results;
+
+	static const std::string sqlSelectStr = "SELECT "
+			"EVENT_TYPE, "
+			"STATE, "
+			"COUNT(*) "
+			"FROM TASKS "
+			"GROUP BY EVENT_TYPE, STATE;";
+	logger.trace << "Dao::loadTaskCounts statement: " << sqlSelectStr << "\n";
+
+    esl::database::PreparedStatement statement = dbConnection.prepare(sqlSelectStr);
+	for(esl::database::ResultSet resultSet = statement.execute(); resultSet; resultSet.next()) {
+		TaskCount taskCount;
+		taskCount.eventType = resultSet[0].isNull() ? "" : resultSet[0].asString();
+		taskCount.state = resultSet[1].isNull() ? "" : resultSet[1].asString();
+		taskCount.count = resultSet[2].isNull() ? 0 : resultSet[2].asInteger();
+		results.push_back(std::move(taskCount));
+    }
+
+    return results;
+}
+
 void Dao::updateEventTypes(const std::vector<std::pair<std::string, std::string>>& eventTypes) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::updateEventTypes));
+
 	/* ********************** *
 	 * delete old event types *
 	 * ********************** */
@@ -545,6 +706,8 @@ void Dao::updateEventTypes(const std::vector<std::pair<std::string, std::string>
 }
 
 std::vector<std::string> Dao::loadEventTypes(const std::string& namespaceId) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::loadEventTypes));
+
 	std::vector<std::string> results;
 
 	/* **************** *
@@ -565,16 +728,30 @@ std::vector<std::string> Dao::loadEventTypes(const std::string& namespaceId) {
     return results;
 }
 
-void Dao::cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::milliseconds timeoutCleanup) {
+Dao::CleanupResult Dao::cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::milliseconds timeoutCleanup) {
+	service::server::MetricRegistry::Timer timer(getStatementDuration(Metrics::Statement::cleanup));
+
+	CleanupResult result;
+
     std::int64_t cleanupTS = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - timeoutCleanup).time_since_epoch().count();
 
 	/* **************** *
 	 * delete old tasks *
 	 * **************** */
+	/* counted first, so callers know if cached task lists are outdated */
+	static const std::string sqlCountTasksStr = "SELECT COUNT(*) "
+			"FROM TASKS "
+			"WHERE LAST_HEARTBEAT_TS <= ?;";
+	esl::database::PreparedStatement countTasksStatement = dbConnection.prepare(sqlCountTasksStr);
+	esl::database::ResultSet countTasksResultSet = countTasksStatement.execute(cleanupTS);
+	result.tasksDeleted = countTasksResultSet && !countTasksResultSet[0].isNull() && countTasksResultSet[0].asInteger() > 0;
+
 	static const std::string sqlDeleteTasksStr = "DELETE "
 			"FROM TASKS "
 			"WHERE LAST_HEARTBEAT_TS <= ?;";
-	dbConnection.prepare(sqlDeleteTasksStr).execute(cleanupTS);
+	if(result.tasksDeleted) {
+		dbConnection.prepare(sqlDeleteTasksStr).execute(cleanupTS);
+	}
 
 
 	std::int64_t zombieTS = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - timeoutZombie).time_since_epoch().count();
@@ -582,6 +759,19 @@ void Dao::cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::millisec
 	/* *************************************** *
 	 * set state to zombie if task is outdated *
 	 * *************************************** */
+	static const std::string sqlSelectZombiesStr = "SELECT TASK_ID "
+			"FROM TASKS "
+			"WHERE LAST_HEARTBEAT_TS <= ? AND (STATE = ? OR STATE = ?);";
+	esl::database::PreparedStatement selectZombiesStatement = dbConnection.prepare(sqlSelectZombiesStr);
+    for(esl::database::ResultSet resultSet = selectZombiesStatement.execute(
+			zombieTS,
+			common::types::State::toString(common::types::State::queued),
+			common::types::State::toString(common::types::State::running)); resultSet; resultSet.next()) {
+    	if(!resultSet[0].isNull()) {
+    		result.zombieTaskIds.push_back(resultSet[0].asString());
+    	}
+    }
+
 	static const std::string sqlUpdateStr = "UPDATE TASKS SET "
 			"STATE = ? "
 			"WHERE LAST_HEARTBEAT_TS <= ? AND (STATE = ? OR STATE = ?);";
@@ -595,10 +785,25 @@ void Dao::cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::millisec
 	/* ********************** *
 	 * delete old event types *
 	 * ********************** */
+	static const std::string sqlCountAvailabelEventsStr = "SELECT COUNT(*) "
+			"FROM AVAILABLE_EVENT_TYPES "
+			"WHERE LAST_HEARTBEAT_TS <= ?;";
+	esl::database::PreparedStatement countEventsStatement = dbConnection.prepare(sqlCountAvailabelEventsStr);
+	esl::database::ResultSet countEventsResultSet = countEventsStatement.execute(zombieTS);
+	result.eventTypesDeleted = countEventsResultSet && !countEventsResultSet[0].isNull() && countEventsResultSet[0].asInteger() > 0;
+
 	static const std::string sqlDeleteAvailabelEventsStr = "DELETE "
 			"FROM AVAILABLE_EVENT_TYPES "
 			"WHERE LAST_HEARTBEAT_TS <= ?;";
-	dbConnection.prepare(sqlDeleteAvailabelEventsStr).execute(zombieTS);
+	if(result.eventTypesDeleted) {
+		dbConnection.prepare(sqlDeleteAvailabelEventsStr).execute(zombieTS);
+	}
+
+	return result;
+}
+
+service::server::MetricRegistry::Histogram* Dao::getStatementDuration(Metrics::Statement statement) const noexcept {
+	return metrics ? &metrics->getStatementDuration(statement) : nullptr;
 }
 
 } /* namespace head */
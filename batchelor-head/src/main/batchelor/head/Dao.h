@@ -21,7 +21,11 @@
 
 #include <batchelor/common/types/State.h>
 
+#include <batchelor/head/Metrics.h>
+
 #include <batchelor/service/schemas/Setting.h>
+#include <batchelor/service/server/MetricRegistry.h>
+#include <batchelor/service/TaskQuery.h>
 
 #include <esl/database/Connection.h>
 
@@ -58,29 +62,60 @@ public:
 		std::string message;
 	};
 
-	Dao(esl::database::Connection& dbConnection);
+	/* Groups all statements until "commit" is called into one transaction. Otherwise it is rolled back on destruction. */
+	class Transaction {
+	public:
+		Transaction(Dao& dao);
+		~Transaction();
+
+		void commit();
+
+	private:
+		Dao& dao;
+		bool committed = false;
+	};
+
+	/* Durations of the statements are measured if "metrics" is not nullptr */
+	Dao(esl::database::Connection& dbConnection, Metrics* metrics = nullptr);
 
 	void saveTask(const std::string& namespaceId, const Task& task);
 	bool insertTask(const std::string& namespaceId, const Task& task);
 	bool updateTask(const std::string& namespaceId, const Task& task);
 
 	std::vector<Task> loadTasks(const std::string& namespaceId, const std::string& state, const std::chrono::system_clock::time_point& eventNotAfter, const std::chrono::system_clock::time_point& eventNotBefore);
+	std::vector<Task> loadTasks(const std::string& namespaceId, const service::TaskQuery& query);
 	std::unique_ptr<Task> loadTaskByTaskId(const std::string& namespaceId, const std::string& taskId);
 	std::unique_ptr<Task> loadLatesTaskByEventTypeAndCrc32(const std::string& namespaceId, const std::string& eventType, std::uint32_t crc32);
 	std::vector<Task> loadTasksByEventTypeAndState(const std::string& namespaceId, const std::string& eventType, const batchelor::common::types::State::Type& state);
 
+	struct TaskCount {
+		std::string eventType;
+		std::string state;
+		std::int64_t count = 0;
+	};
+	// number of tasks by event type and state of all namespaces
+	std::vector<TaskCount> loadTaskCounts();
+
 	// insert or update given event types with current timestamp
 	void updateEventTypes(const std::vector<std::pair<std::string, std::string>>& eventTypes);
 
 	// load all event types, delete outdated event types and return remaining event types
 	std::vector<std::string> loadEventTypes(const std::string& namespaceId);
 
-	void cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::milliseconds timeoutCleanup);
+	struct CleanupResult {
+		std::vector<std::string> zombieTaskIds;
+		bool tasksDeleted = false;
+		bool eventTypesDeleted = false;
+	};
+	CleanupResult cleanup(std::chrono::milliseconds timeoutZombie, std::chrono::milliseconds timeoutCleanup);
 
 private:
 
 	esl::database::Connection& dbConnection;
 	const bool isSQLite;
+	Metrics* metrics;
+
+	service::server::MetricRegistry::Histogram* getStatementDuration(Metrics::Statement statement) const noexcept;
 };
 
 } /* namespace head */
@@ -20,18 +20,73 @@
 #define BATCHELOR_HEAD_ENGINE_H_
 
 #include <batchelor/head/Dao.h>
+#include <batchelor/head/Metrics.h>
+
+#include <batchelor/service/schemas/TaskStatusWorker.h>
 
 #include <esl/database/ConnectionFactory.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace batchelor {
 namespace head {
 
 class Engine {
 public:
+	/* Snapshot of the last fetch request of a worker session, used as baseline for delta heartbeats. */
+	struct WorkerSession {
+		int epoch = 0;
+		std::map<std::string, std::string> metrics;
+		std::map<std::string, service::schemas::TaskStatusWorker> tasks;
+		std::chrono::steady_clock::time_point lastSeen;
+	};
+
+	/* Last output of a running task. Workers are asked for the output of a task until "requestedUntil". */
+	struct TaskOutput {
+		std::string out;
+		std::string err;
+		std::chrono::steady_clock::time_point requestedUntil;
+	};
+
+	/* Change of a task. Events are numbered, so watchers can continue after the last event they have seen. */
+	struct TaskEvent {
+		std::uint64_t eventId = 0;
+		std::string taskId;
+	};
+
 	virtual ~Engine() = default;
 
 	virtual esl::database::ConnectionFactory& getDbConnectionFactory() const noexcept = 0;
-	virtual void onUpdateTask(const Dao::Task& task) = 0;
+	virtual void onUpdateTask(const std::string& namespaceId, const Dao::Task& task) = 0;
+
+	/* Called for a heartbeat of a worker that did not change state, return code or message of the task. */
+	virtual void onHeartbeatTask(const std::string& namespaceId, const Dao::Task& task) = 0;
+
+	/* Called with the event types of every fetch request, after they have been stored. */
+	virtual void onUpdateEventTypes(const std::string& namespaceId, const std::vector<std::pair<std::string, std::string>>& eventTypes) = 0;
+
+	/* Worker sessions by namespace and session id. Access is only allowed while holding the mutex of the service. */
+	virtual std::map<std::pair<std::string, std::string>, WorkerSession>& getWorkerSessions() noexcept = 0;
+
+	/* Output of tasks by namespace and task id. Access is only allowed while holding the mutex of the service. */
+	virtual std::map<std::pair<std::string, std::string>, TaskOutput>& getTaskOutputs() noexcept = 0;
+
+	/* Most recent task events, oldest first, and the id of the last event. Access is only allowed while holding the mutex of the service. */
+	virtual const std::deque<TaskEvent>& getTaskEvents() const noexcept = 0;
+	virtual std::uint64_t getLastTaskEventId() const noexcept = 0;
+
+	/* Notified for every new task event. Waiting is only allowed with the mutex of the service. */
+	virtual std::condition_variable& getTaskEventCV() noexcept = 0;
+
+	/* Metrics are lock-free, so they can be updated with or without holding the mutex of the service. */
+	virtual Metrics& getMetrics() noexcept = 0;
 
 };
 
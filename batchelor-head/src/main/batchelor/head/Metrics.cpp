@@ -0,0 +1,95 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/head/Metrics.h>
+
+#include <string>
+
+namespace batchelor {
+namespace head {
+
+namespace {
+const char* toString(Metrics::Statement statement) {
+	switch(statement) {
+	case Metrics::Statement::insertTask:
+		return "insertTask";
+	case Metrics::Statement::updateTask:
+		return "updateTask";
+	case Metrics::Statement::loadTasksByState:
+		return "loadTasksByState";
+	case Metrics::Statement::loadTasksByQuery:
+		return "loadTasksByQuery";
+	case Metrics::Statement::loadTaskByTaskId:
+		return "loadTaskByTaskId";
+	case Metrics::Statement::loadLatesTaskByEventTypeAndCrc32:
+		return "loadLatesTaskByEventTypeAndCrc32";
+	case Metrics::Statement::loadTasksByEventTypeAndState:
+		return "loadTasksByEventTypeAndState";
+	case Metrics::Statement::loadTaskCounts:
+		return "loadTaskCounts";
+	case Metrics::Statement::updateEventTypes:
+		return "updateEventTypes";
+	case Metrics::Statement::loadEventTypes:
+		return "loadEventTypes";
+	case Metrics::Statement::cleanup:
+		return "cleanup";
+	}
+	return "unknown";
+}
+
+/* tasks are waiting from less than a second up to hours */
+const std::vector<double> dispatchLatencyBounds{0.1, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 1800, 3600, 7200};
+} /* anonymous namespace */
+
+Metrics::Metrics()
+: dispatchLatency(registry.addHistogram("batchelor_task_dispatch_latency_seconds", "Time from creating a task until it is running on a worker.", {}, dispatchLatencyBounds)),
+  zombieTasks(registry.addCounter("batchelor_zombie_tasks_total", "Tasks that have been set to state zombie because of missing heartbeats.")),
+  cleanupDuration(registry.addHistogram("batchelor_cleanup_duration_seconds", "Duration of the periodic cleanup."))
+{
+	for(Statement statement = Statement::insertTask; statement <= Statement::cleanup; statement = static_cast<Statement>(static_cast<int>(statement) + 1)) {
+		statementDurations.push_back(&registry.addHistogram("batchelor_db_statement_duration_seconds", "Duration of database statements.", {{"statement", toString(statement)}}));
+	}
+}
+
+service::server::MetricRegistry& Metrics::getRegistry() noexcept {
+	return registry;
+}
+
+const service::server::MetricRegistry& Metrics::getRegistry() const noexcept {
+	return registry;
+}
+
+service::server::MetricRegistry::Histogram& Metrics::getStatementDuration(Statement statement) noexcept {
+	return *statementDurations[static_cast<std::size_t>(statement)];
+}
+
+service::server::MetricRegistry::Histogram& Metrics::getDispatchLatency() noexcept {
+	return dispatchLatency;
+}
+
+service::server::MetricRegistry::Counter& Metrics::getZombieTasks() noexcept {
+	return zombieTasks;
+}
+
+service::server::MetricRegistry::Histogram& Metrics::getCleanupDuration() noexcept {
+	return cleanupDuration;
+}
+
+} /* namespace head */
+} /* namespace batchelor */
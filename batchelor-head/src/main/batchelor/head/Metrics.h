@@ -0,0 +1,75 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_HEAD_METRICS_H_
+#define BATCHELOR_HEAD_METRICS_H_
+
+#include <batchelor/service/server/MetricRegistry.h>
+
+#include <vector>
+
+namespace batchelor {
+namespace head {
+
+/* Metrics of the head that are exported at "/metrics". Counters and histograms are registered once on construction. */
+class Metrics {
+public:
+	enum class Statement {
+		insertTask,
+		updateTask,
+		loadTasksByState,
+		loadTasksByQuery,
+		loadTaskByTaskId,
+		loadLatesTaskByEventTypeAndCrc32,
+		loadTasksByEventTypeAndState,
+		loadTaskCounts,
+		updateEventTypes,
+		loadEventTypes,
+		cleanup
+	};
+
+	Metrics();
+
+	service::server::MetricRegistry& getRegistry() noexcept;
+	const service::server::MetricRegistry& getRegistry() const noexcept;
+
+	// duration of a statement of the Dao
+	service::server::MetricRegistry::Histogram& getStatementDuration(Statement statement) noexcept;
+
+	// time a task has been waiting from creation until it has been assigned to a worker
+	service::server::MetricRegistry::Histogram& getDispatchLatency() noexcept;
+
+	// tasks that have been set to state zombie by the cleanup
+	service::server::MetricRegistry::Counter& getZombieTasks() noexcept;
+
+	service::server::MetricRegistry::Histogram& getCleanupDuration() noexcept;
+
+private:
+	service::server::MetricRegistry registry;
+
+	std::vector<service::server::MetricRegistry::Histogram*> statementDurations;
+	service::server::MetricRegistry::Histogram& dispatchLatency;
+	service::server::MetricRegistry::Counter& zombieTasks;
+	service::server::MetricRegistry::Histogram& cleanupDuration;
+};
+
+} /* namespace head */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_HEAD_METRICS_H_ */
@@ -25,17 +25,21 @@
 
 #include <batchelor/head/plugin/Observer.h>
 
+#include <batchelor/service/server/WatcherLimit.h>
+
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/object/Context.h>
 
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace batchelor {
@@ -49,7 +53,10 @@ public:
 		std::map<std::string, common::auth::UserData> users;
 
 		std::map<std::string, std::string> userByPlainApiKey;
+		std::map<std::string, std::string> userBySha256ApiKey;
 		std::map<std::string, std::string> plainBasicAuthByUser;
+		std::map<std::string, std::string> pbkdf2BasicAuthByUser;
+		std::vector<std::pair<std::string, std::string>> jwtSettings;
 
 		// after how many seconds do we handle a task or worker as zombie?
 		std::chrono::seconds timeoutZombie = std::chrono::minutes(5);
@@ -57,6 +64,12 @@ public:
 		// after how many seconds can we delete old stuff?
 		std::chrono::seconds timeoutCleanup = std::chrono::hours(1);
 
+		// how many long polls and streams of "watch" can wait for task events at the same time?
+		std::size_t maxWatchers = service::server::WatcherLimit::defaultMaxWatchers;
+
+		// "/metrics" is only available for users with role "read-only" or "execute" in this namespace. It is disabled if empty.
+		std::string metricsNamespaceId;
+
 		std::set<std::string> observerIds;
 		std::set<std::string> socketIds;
 		std::string databaseId = "batchelor-db";
@@ -16,6 +16,7 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <batchelor/common/auth/UserData.h>
 #include <batchelor/common/Timestamp.h>
 
 #include <batchelor/head/Logger.h>
@@ -23,21 +24,36 @@
 #include <batchelor/head/Service.h>
 
 #include <esl/com/http/server/exception/StatusCode.h>
+#include <esl/com/http/server/Response.h>
 #include <esl/database/SQLiteConnectionFactory.h>
+#include <esl/io/input/Closed.h>
+#include <esl/io/Output.h>
+#include <esl/io/output/String.h>
 #include <esl/object/Value.h>
 #include <esl/system/Stacktrace.h>
+#include <esl/utility/HttpMethod.h>
+#include <esl/utility/MIME.h>
 #include <esl/utility/String.h>
 
 #include <stdexcept>
+#include <string>
 
 namespace batchelor {
 namespace head {
 
 namespace {
 Logger logger("batchelor::head::RequestHandler");
+
+/* Watchers that have missed more events get the current status of the tasks they are watching */
+constexpr std::size_t maxTaskEvents = 65536;
+
+/* Lists of tasks in the response cache show heartbeats that are at most this old, plus the interval of the heartbeats */
+constexpr std::chrono::seconds heartbeatInvalidationInterval(5);
 } /* namespace */
 
 RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std::string>>& settings) {
+	bool hasMaxWatchers = false;
+
     for(const auto& setting : settings) {
         if(setting.first == "db-connection-factory") {
             if(!dbConnectionFactoryId.empty()) {
@@ -80,6 +96,28 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 	            throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" for attribute '" + setting.first + "'." + e.what()));
 			}
 		}
+		else if(setting.first == "max-watchers") {
+			if(hasMaxWatchers) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of attribute '" + setting.first + "'."));
+			}
+			hasMaxWatchers = true;
+
+			try {
+				maxWatchers = static_cast<std::size_t>(std::stoul(setting.second));
+			}
+			catch(const std::exception& e) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" for attribute '" + setting.first + "'." + e.what()));
+			}
+		}
+		else if(setting.first == "metrics-namespace") {
+			if(!metricsNamespaceId.empty()) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of attribute '" + setting.first + "'."));
+			}
+			metricsNamespaceId = setting.second;
+			if(metricsNamespaceId.empty()) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"\" for attribute '" + setting.first + "'."));
+			}
+		}
         else {
             throw esl::system::Stacktrace::add(std::runtime_error("unknown attribute '" + setting.first + "'."));
         }
@@ -97,7 +135,9 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 RequestHandler::Settings::Settings(const Procedure::Settings& settings)
 : timeoutZombie(settings.timeoutZombie.count() > 0 ? settings.timeoutZombie :std::chrono::minutes(5)),
   timeoutCleanup(settings.timeoutCleanup.count() > 0 ? settings.timeoutCleanup : std::chrono::hours(1)),
-  dbConnectionFactoryId(settings.databaseId)
+  dbConnectionFactoryId(settings.databaseId),
+  maxWatchers(settings.maxWatchers),
+  metricsNamespaceId(settings.metricsNamespaceId)
 { }
 
 RequestHandler::InitializedSettings::InitializedSettings(esl::object::Context& context, const Settings& settings)
@@ -119,9 +159,18 @@ RequestHandler::RequestHandler(const Settings& aSettings)
 : service::server::RequestHandler([this](const esl::object::Context& context)
 		{
 			return std::unique_ptr<service::Service>(new Service(context, *this, notifyMutex));
-		}),
-  settings(aSettings)
-{ }
+		}, &responseCache),
+  settings(aSettings),
+  responseCache([](const esl::object::Context& context, const std::string& namespaceId)
+		{
+			auto roles = common::auth::UserData::getRoles(context, namespaceId);
+			return roles.count(common::auth::UserData::Role::readOnly) > 0 || roles.count(common::auth::UserData::Role::execute) > 0;
+		})
+{
+	setMetricRegistry(metrics.getRegistry());
+	setMaxWatchers(settings.maxWatchers);
+	metrics.getRegistry().addCollector([this](std::string& str) { collectMetrics(str); });
+}
 
 RequestHandler::~RequestHandler() {
 	threadStop();
@@ -137,6 +186,24 @@ void RequestHandler::initializeContext(esl::object::Context& context) {
 	thread = std::thread(&RequestHandler::threadRun, this);
 }
 
+esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& requestContext) const {
+	if(!settings.metricsNamespaceId.empty() && requestContext.getPath() == "/metrics" && requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
+		/* metrics are counted over all namespaces, so they are only shown to users of the configured namespace */
+		auto roles = common::auth::UserData::getRoles(requestContext.getObjectContext(), settings.metricsNamespaceId);
+		if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+			throw esl::com::http::server::exception::StatusCode(401);
+		}
+
+		esl::com::http::server::Response response(200, esl::utility::MIME("text/plain; version=0.0.4"));
+		response.addHeader("Cache-Control", "no-cache");
+		requestContext.getConnection().send(response, esl::io::output::String::create(metrics.getRegistry().toString()));
+
+		return esl::io::input::Closed::create();
+	}
+
+	return service::server::RequestHandler::accept(requestContext);
+}
+
 esl::database::ConnectionFactory& RequestHandler::getDbConnectionFactory() const noexcept {
 	if(!initializedSettings) {
         throw esl::system::Stacktrace::add(std::runtime_error("Object not initialized."));
@@ -144,12 +211,66 @@ esl::database::ConnectionFactory& RequestHandler::getDbConnectionFactory() const
 	return initializedSettings->dbConnectionFactory;
 }
 
-void RequestHandler::onUpdateTask(const Dao::Task& task) {
+void RequestHandler::onUpdateTask(const std::string& namespaceId, const Dao::Task& task) {
 //	std::unique_lock<std::mutex> lockNotifyMutex(notifyMutex);
 
 	for(const auto& plugin : initializedSettings->plugins) {
 		plugin.get().onUpdateTask(task);
 	}
+
+	addTaskEvent(task.taskId);
+	responseCache.invalidate(namespaceId);
+}
+
+void RequestHandler::onHeartbeatTask(const std::string& namespaceId, const Dao::Task& task) {
+	/* plugins are still notified for every heartbeat, but watchers are only woken up for real changes */
+	for(const auto& plugin : initializedSettings->plugins) {
+		plugin.get().onUpdateTask(task);
+	}
+
+	std::chrono::steady_clock::time_point nowTS = std::chrono::steady_clock::now();
+	auto& lastInvalidationTS = heartbeatInvalidations[namespaceId];
+	if(nowTS - lastInvalidationTS >= heartbeatInvalidationInterval) {
+		lastInvalidationTS = nowTS;
+		responseCache.invalidate(namespaceId);
+	}
+}
+
+void RequestHandler::onUpdateEventTypes(const std::string& namespaceId, const std::vector<std::pair<std::string, std::string>>& eventTypes) {
+	bool hasNewEventType = false;
+	for(const auto& eventType : eventTypes) {
+		if(availableEventTypes[eventType.first].insert(eventType.second).second) {
+			hasNewEventType = true;
+		}
+	}
+
+	if(hasNewEventType) {
+		responseCache.invalidate(namespaceId);
+	}
+}
+
+std::map<std::pair<std::string, std::string>, Engine::WorkerSession>& RequestHandler::getWorkerSessions() noexcept {
+	return workerSessions;
+}
+
+std::map<std::pair<std::string, std::string>, Engine::TaskOutput>& RequestHandler::getTaskOutputs() noexcept {
+	return taskOutputs;
+}
+
+const std::deque<Engine::TaskEvent>& RequestHandler::getTaskEvents() const noexcept {
+	return taskEvents;
+}
+
+std::uint64_t RequestHandler::getLastTaskEventId() const noexcept {
+	return lastTaskEventId;
+}
+
+std::condition_variable& RequestHandler::getTaskEventCV() noexcept {
+	return taskEventCV;
+}
+
+Metrics& RequestHandler::getMetrics() noexcept {
+	return metrics;
 }
 
 void RequestHandler::threadRun() {
@@ -182,12 +303,105 @@ void RequestHandler::threadRun() {
 }
 
 void RequestHandler::cleanup() {
+	service::server::MetricRegistry::Timer timer(&metrics.getCleanupDuration());
+
 	auto dbConnection = getDbConnectionFactory().createConnection();
 	if(!dbConnection) {
 		throw esl::system::Stacktrace::add(std::runtime_error("no db connection available."));
 	}
 
-	Dao(*dbConnection).cleanup(settings.timeoutZombie, settings.timeoutCleanup);
+	Dao dao(*dbConnection, &metrics);
+	Dao::CleanupResult cleanupResult = dao.cleanup(settings.timeoutZombie, settings.timeoutCleanup);
+	metrics.getZombieTasks().add(cleanupResult.zombieTaskIds.size());
+	for(const auto& taskId : cleanupResult.zombieTaskIds) {
+		addTaskEvent(taskId);
+	}
+
+	/* cleanup does not know the namespaces of the tasks and event types */
+	if(cleanupResult.eventTypesDeleted) {
+		availableEventTypes.clear();
+	}
+	if(!cleanupResult.zombieTaskIds.empty() || cleanupResult.tasksDeleted || cleanupResult.eventTypesDeleted) {
+		responseCache.invalidateAll();
+	}
+
+	/* drop baselines of workers that did not send a heartbeat for a while */
+	std::chrono::steady_clock::time_point sessionTimeoutTS = std::chrono::steady_clock::now() - settings.timeoutZombie;
+	for(auto iter = workerSessions.begin(); iter != workerSessions.end();) {
+		if(iter->second.lastSeen < sessionTimeoutTS) {
+			iter = workerSessions.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	/* drop output of tasks nobody is watching anymore */
+	std::chrono::steady_clock::time_point nowTS = std::chrono::steady_clock::now();
+	for(auto iter = taskOutputs.begin(); iter != taskOutputs.end();) {
+		if(iter->second.requestedUntil < nowTS) {
+			iter = taskOutputs.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	if(!settings.metricsNamespaceId.empty()) {
+		updateMetrics(dao);
+	}
+}
+
+/* Called by the cleanup while holding the mutex of the service, so "/metrics" only reads this snapshot */
+void RequestHandler::updateMetrics(Dao& dao) {
+	/* the database has no namespace, so tasks are counted over all namespaces */
+	std::vector<Dao::TaskCount> newTaskCounts = dao.loadTaskCounts();
+
+	std::map<std::string, std::size_t> newWorkerSessionsByNamespace;
+	for(const auto& workerSession : workerSessions) {
+		++newWorkerSessionsByNamespace[workerSession.first.first];
+	}
+
+	std::lock_guard<std::mutex> lockMetricsMutex(metricsMutex);
+	taskCounts = std::move(newTaskCounts);
+	workerSessionsByNamespace = std::move(newWorkerSessionsByNamespace);
+}
+
+void RequestHandler::collectMetrics(std::string& str) {
+	std::vector<Dao::TaskCount> taskCountsSnapshot;
+	std::map<std::string, std::size_t> workerSessionsSnapshot;
+	{
+		std::lock_guard<std::mutex> lockMetricsMutex(metricsMutex);
+		taskCountsSnapshot = taskCounts;
+		workerSessionsSnapshot = workerSessionsByNamespace;
+	}
+
+	service::server::MetricRegistry::appendHeader(str, "batchelor_tasks", "Tasks by event type and state, state \"queued\" is the queue depth. Updated by the cleanup every few seconds.", "gauge");
+	for(const auto& taskCount : taskCountsSnapshot) {
+		service::server::MetricRegistry::appendSample(str, "batchelor_tasks", {{"event_type", taskCount.eventType}, {"state", taskCount.state}}, static_cast<double>(taskCount.count));
+	}
+
+	service::server::MetricRegistry::appendHeader(str, "batchelor_worker_sessions", "Workers that have sent a heartbeat recently by namespace. Updated by the cleanup every few seconds.", "gauge");
+	for(const auto& workerSessionCount : workerSessionsSnapshot) {
+		service::server::MetricRegistry::appendSample(str, "batchelor_worker_sessions", {{"namespace", workerSessionCount.first}}, static_cast<double>(workerSessionCount.second));
+	}
+
+	service::server::MetricRegistry::appendHeader(str, "batchelor_task_events", "Task events that are kept for watchers.", "gauge");
+	service::server::MetricRegistry::appendSample(str, "batchelor_task_events", {}, static_cast<double>(taskEventsCount.load(std::memory_order_relaxed)));
+}
+
+void RequestHandler::addTaskEvent(const std::string& taskId) {
+	TaskEvent taskEvent;
+	taskEvent.eventId = ++lastTaskEventId;
+	taskEvent.taskId = taskId;
+	taskEvents.push_back(std::move(taskEvent));
+
+	if(taskEvents.size() > maxTaskEvents) {
+		taskEvents.pop_front();
+	}
+	taskEventsCount.store(taskEvents.size(), std::memory_order_relaxed);
+
+	taskEventCV.notify_all();
 }
 
 void RequestHandler::threadStop() {
@@ -21,12 +21,16 @@
 
 #include <batchelor/head/Dao.h>
 #include <batchelor/head/Engine.h>
+#include <batchelor/head/Metrics.h>
 #include <batchelor/head/plugin/Observer.h>
 #include <batchelor/head/Procedure.h>
 
 #include <batchelor/service/server/RequestHandler.h>
+#include <batchelor/service/server/ResponseCache.h>
+#include <batchelor/service/server/WatcherLimit.h>
 
 #include <esl/com/http/server/Request.h>
+#include <esl/com/http/server/RequestContext.h>
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/database/Connection.h>
 #include <esl/database/ConnectionFactory.h>
@@ -34,8 +38,12 @@
 #include <esl/object/Context.h>
 #include <esl/object/InitializeContext.h>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -64,6 +72,12 @@ public:
 
 		std::string dbConnectionFactoryId;
 		std::set<std::string> pluginIds;
+
+		// how many long polls and streams of "watch" can wait for task events at the same time?
+		std::size_t maxWatchers = service::server::WatcherLimit::defaultMaxWatchers;
+
+		// "/metrics" is only available for users with role "read-only" or "execute" in this namespace. It is disabled if empty.
+		std::string metricsNamespaceId;
 	};
 
 	RequestHandler(const Settings& settings);
@@ -73,8 +87,19 @@ public:
 
 	void initializeContext(esl::object::Context& context) override;
 
+	/* Answers "GET /metrics" in the text format of Prometheus if it is enabled, all other requests are handled by the service */
+	esl::io::Input accept(esl::com::http::server::RequestContext& requestContext) const override;
+
 	esl::database::ConnectionFactory& getDbConnectionFactory() const noexcept override;
-	void onUpdateTask(const Dao::Task& task) override;
+	void onUpdateTask(const std::string& namespaceId, const Dao::Task& task) override;
+	void onHeartbeatTask(const std::string& namespaceId, const Dao::Task& task) override;
+	void onUpdateEventTypes(const std::string& namespaceId, const std::vector<std::pair<std::string, std::string>>& eventTypes) override;
+	std::map<std::pair<std::string, std::string>, WorkerSession>& getWorkerSessions() noexcept override;
+	std::map<std::pair<std::string, std::string>, TaskOutput>& getTaskOutputs() noexcept override;
+	const std::deque<TaskEvent>& getTaskEvents() const noexcept override;
+	std::uint64_t getLastTaskEventId() const noexcept override;
+	std::condition_variable& getTaskEventCV() noexcept override;
+	Metrics& getMetrics() noexcept override;
 
 private:
 	struct InitializedSettings {
@@ -91,6 +116,31 @@ private:
 	const Settings settings;
 	std::unique_ptr<InitializedSettings> initializedSettings;
 
+	/* Metrics of the head and of the requests of the service, exported at "/metrics" */
+	Metrics metrics;
+
+	std::map<std::pair<std::string, std::string>, WorkerSession> workerSessions;
+	std::map<std::pair<std::string, std::string>, TaskOutput> taskOutputs;
+
+	std::deque<TaskEvent> taskEvents;
+	std::uint64_t lastTaskEventId = 0; // the first event gets id 1
+	std::condition_variable taskEventCV;
+
+	/* Serialized responses of "getTasks" and "getEventTypes", invalidated for every change of a task.
+	 * Heartbeats invalidate them at most once per "heartbeatInvalidationInterval" and namespace, so the time of the last heartbeat may be a bit older. */
+	service::server::ResponseCache responseCache;
+	std::map<std::string, std::chrono::steady_clock::time_point> heartbeatInvalidations;
+
+	/* Event types by namespace that are stored as available, so only new event types invalidate the response cache */
+	std::map<std::string, std::set<std::string>> availableEventTypes;
+
+	/* Counts for "/metrics", so it does not need the mutex of the service.
+	 * They are updated by the cleanup and by new task events while holding the mutex of the service. */
+	std::mutex metricsMutex;
+	std::vector<Dao::TaskCount> taskCounts;
+	std::map<std::string, std::size_t> workerSessionsByNamespace;
+	std::atomic<std::size_t> taskEventsCount{0};
+
 	std::condition_variable notifyCV;
 	mutable std::mutex notifyMutex;
 	bool threadStopping = false;
@@ -99,6 +149,9 @@ private:
 	void threadRun();
 	void threadStop();
 	void cleanup();
+	void updateMetrics(Dao& dao);
+	void collectMetrics(std::string& str);
+	void addTaskEvent(const std::string& taskId);
 };
 
 } /* namespace head */
@@ -43,6 +43,10 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
@@ -52,6 +56,9 @@ namespace head {
 namespace {
 Logger logger("batchelor::head::Service");
 
+/* workers are asked for the output of a task as long as it has been requested within this time */
+constexpr std::chrono::seconds taskOutputTimeout{30};
+
 
 service::schemas::RunResponse makeRunResponse(const Dao::Task& task) {
 	service::schemas::RunResponse rv;
@@ -172,6 +179,50 @@ service::schemas::TaskStatusHead taskToTaskStatusHead(const Dao::Task& task) {
 	return rv;
 }
 
+/* returns an error message if the condition cannot be parsed */
+std::string checkCondition(const std::string& condition) {
+	condition::Compiler compiler;
+
+	std::stringstream str;
+	str << condition;
+	condition::Scanner scanner(str);
+
+	try {
+		compiler.parse(scanner);
+	}
+	catch(const std::exception& e) {
+		return "Exception occurred while parsing condition \"" + condition + "\": \"" + e.what();
+	}
+	catch(...) {
+		return "Exception occurred while parsing condition \"" + condition + "\".";
+	}
+
+	return "";
+}
+
+Dao::Task makeTask(const service::schemas::RunRequest& runRequest, std::uint32_t crc32) {
+	//boost::uuids::uuid taskIdUUID; // initialize uuid
+	static boost::uuids::random_generator rg;
+	boost::uuids::uuid taskIdUUID = rg();
+
+	Dao::Task task;
+	task.taskId = boost::uuids::to_string(taskIdUUID);
+	task.crc32 = crc32;
+	task.eventType = runRequest.eventType;
+	task.priority = runRequest.priority;
+	task.settings = runRequest.settings;
+	task.metrics = runRequest.metrics;
+	task.condition = runRequest.condition;
+#if 1
+	task.createdTS = std::chrono::system_clock::now();
+#else
+	task.createdTS = toJSONTimestamp(std::chrono::system_clock::now());
+#endif
+	task.state = batchelor::common::types::State::Type::queued;
+
+	return task;
+}
+
 void addOrReplaceMetric(std::vector<service::schemas::Setting>& metrics, const std::string& key, const std::string& value) {
 	for(auto& metric : metrics) {
 		if(metric.key == key) {
@@ -204,7 +255,53 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 
 	service::schemas::FetchResponse rv;
 
-	for(const auto& taskStatus : fetchRequest.tasks) {
+	/* Delta heartbeat: merge the request into the baseline of the worker session.
+	 * The merged request is processed as if the worker had sent a full snapshot. */
+	Engine::WorkerSession workerSession;
+	service::schemas::FetchRequest mergedFetchRequest;
+	if(!fetchRequest.sessionId.empty()) {
+		auto& workerSessions = engine.getWorkerSessions();
+		auto workerSessionIter = workerSessions.find(std::make_pair(namespaceId, fetchRequest.sessionId));
+
+		if(fetchRequest.baseEpoch != 0) {
+			if(workerSessionIter == workerSessions.end() || workerSessionIter->second.epoch != fetchRequest.baseEpoch) {
+				logger.debug << "Worker \"" << fetchRequest.workerId << "\" sent a delta to an unknown snapshot, request full snapshot.\n";
+				workerSessions.erase(std::make_pair(namespaceId, fetchRequest.sessionId));
+				return rv;
+			}
+			workerSession = workerSessionIter->second;
+		}
+
+		for(const auto& metric : fetchRequest.metrics) {
+			workerSession.metrics[metric.key] = metric.value;
+		}
+		for(const auto& taskStatus : fetchRequest.tasks) {
+			workerSession.tasks[taskStatus.taskId] = taskStatus;
+		}
+
+		mergedFetchRequest.workerId = fetchRequest.workerId;
+		mergedFetchRequest.eventTypes = fetchRequest.eventTypes;
+		for(const auto& metric : workerSession.metrics) {
+			mergedFetchRequest.metrics.push_back(service::schemas::Setting::make(metric.first, metric.second));
+		}
+		for(const auto& task : workerSession.tasks) {
+			mergedFetchRequest.tasks.push_back(task.second);
+		}
+	}
+	const service::schemas::FetchRequest& request = fetchRequest.sessionId.empty() ? fetchRequest : mergedFetchRequest;
+
+	/* output is only kept for tasks somebody is watching, so it cannot grow unbounded */
+	auto& taskOutputs = engine.getTaskOutputs();
+	for(const auto& output : fetchRequest.outputs) {
+		auto taskOutputIter = taskOutputs.find(std::make_pair(namespaceId, output.taskId));
+		if(taskOutputIter != taskOutputs.end()) {
+			taskOutputIter->second.out = output.out;
+			taskOutputIter->second.err = output.err;
+		}
+	}
+	std::chrono::steady_clock::time_point nowSteadyTS = std::chrono::steady_clock::now();
+
+	for(const auto& taskStatus : request.tasks) {
 		std::unique_ptr<Dao::Task> existingTask = getDao().loadTaskByTaskId(namespaceId, taskStatus.taskId);
 		if(!existingTask) {
 			logger.warn << "Worker sent an update for a non existing task \"" << taskStatus.taskId << "\"\n.";
@@ -215,7 +312,10 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 			continue;
 		}
 
-		existingTask->state = batchelor::common::types::State::toState(taskStatus.state);
+		batchelor::common::types::State::Type state = batchelor::common::types::State::toState(taskStatus.state);
+		bool changed = existingTask->state != state || existingTask->returnCode != taskStatus.returnCode || existingTask->message != taskStatus.message;
+
+		existingTask->state = state;
 		existingTask->returnCode = taskStatus.returnCode;
 		existingTask->message = taskStatus.message;
 		existingTask->lastHeartbeatTS = std::chrono::system_clock::now();
@@ -228,18 +328,28 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 				rv.signals.push_back(signal);
 			}
 			existingTask->signals.clear();
+
+			auto taskOutputIter = taskOutputs.find(std::make_pair(namespaceId, existingTask->taskId));
+			if(taskOutputIter != taskOutputs.end() && taskOutputIter->second.requestedUntil >= nowSteadyTS) {
+				rv.tailRequests.push_back(existingTask->taskId);
+			}
 		}
 		else {
 			existingTask->endTS = existingTask->lastHeartbeatTS;
 		}
 
 		getDao().updateTask(namespaceId, *existingTask);
-		engine.onUpdateTask(*existingTask);
+		if(changed) {
+			engine.onUpdateTask(namespaceId, *existingTask);
+		}
+		else {
+			engine.onHeartbeatTask(namespaceId, *existingTask);
+		}
 	}
 
 	std::vector<Dao::Task> tasks;
 	std::vector<std::pair<std::string, std::string>> eventTypes;
-	for(const auto eventType : fetchRequest.eventTypes) {
+	for(const auto eventType : request.eventTypes) {
 		if(eventType.available) {
 			std::vector<Dao::Task> eventTypeTasks = getDao().loadTasksByEventTypeAndState(namespaceId, eventType.eventType, batchelor::common::types::State::queued);
 			tasks.insert(tasks.end(), eventTypeTasks.begin(), eventTypeTasks.end());
@@ -250,13 +360,15 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 		return a.effectivePriority > b.effectivePriority || (a.effectivePriority == b.effectivePriority && a.createdTS < b.createdTS);
 	});
 	getDao().updateEventTypes(eventTypes);
+	engine.onUpdateEventTypes(namespaceId, eventTypes);
 
+	std::size_t tasksSkipped = 0;
 	for(auto& task : tasks) {
 		// Initialize 'metrics' with metrics set by batchelor control
 		std::vector<service::schemas::Setting> metrics = task.metrics;
 
 		// add or replace metrics with metrics provided by the worker
-		for(const auto& fetchRequestMetric : fetchRequest.metrics) {
+		for(const auto& fetchRequestMetric : request.metrics) {
 			addOrReplaceMetric(metrics, fetchRequestMetric.key, fetchRequestMetric.value);
 		}
 
@@ -276,6 +388,7 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 
 
 		if(!evaluateCondition(metrics, task.condition)) {
+			++tasksSkipped;
 			continue;
 		}
 
@@ -283,9 +396,10 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 		task.returnCode = 0;
 		task.startTS = task.lastHeartbeatTS = std::chrono::system_clock::now();
 		task.metrics = metrics;
+		engine.getMetrics().getDispatchLatency().observe(std::chrono::duration_cast<std::chrono::nanoseconds>(task.startTS - task.createdTS));
 
 		getDao().updateTask(namespaceId, task);
-		engine.onUpdateTask(task);
+		engine.onUpdateTask(namespaceId, task);
 
 		service::schemas::RunConfiguration runConfiguration;
 
@@ -298,6 +412,30 @@ service::schemas::FetchResponse Service::fetchTask(const std::string& namespaceI
 		break;
 	}
 
+	/* Poll hint: if a task has been dispatched and there are more queued tasks, then the worker should fetch again
+	 * immediately. Tasks with a condition that did not match are not a reason to hurry. */
+	rv.queueDepth = static_cast<int>(tasks.size() - rv.runConfigurations.size());
+	if(!rv.runConfigurations.empty() && tasks.size() > tasksSkipped + rv.runConfigurations.size()) {
+		rv.nextPollMs = 0;
+	}
+
+	if(!fetchRequest.sessionId.empty()) {
+		/* the worker removes tasks after reporting a final state, so keep only running tasks in the baseline */
+		for(auto iter = workerSession.tasks.begin(); iter != workerSession.tasks.end();) {
+			if(iter->second.state != batchelor::common::types::State::toString(batchelor::common::types::State::running)) {
+				iter = workerSession.tasks.erase(iter);
+			}
+			else {
+				++iter;
+			}
+		}
+
+		workerSession.epoch = workerSession.epoch == std::numeric_limits<int>::max() ? 1 : workerSession.epoch + 1;
+		workerSession.lastSeen = std::chrono::steady_clock::now();
+		rv.epoch = workerSession.epoch;
+		engine.getWorkerSessions()[std::make_pair(namespaceId, fetchRequest.sessionId)] = std::move(workerSession);
+	}
+
 	return rv;
 }
 
@@ -330,6 +468,25 @@ std::vector<service::schemas::TaskStatusHead> Service::getTasks(const std::strin
 }
 
 
+std::vector<service::schemas::TaskStatusHead> Service::queryTasks(const std::string& namespaceId, const service::TaskQuery& query) {
+	logger.trace << "Service call: \"queryTasks\"\n";
+
+	auto roles = common::auth::UserData::getRoles(context, namespaceId);
+	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	std::vector<service::schemas::TaskStatusHead> rv;
+
+	std::vector<Dao::Task> tasks = getDao().loadTasks(namespaceId, query);
+	rv.reserve(tasks.size());
+	for(const auto& task : tasks) {
+		rv.push_back(taskToTaskStatusHead(task));
+	}
+
+	return rv;
+}
+
 std::unique_ptr<service::schemas::TaskStatusHead> Service::getTask(const std::string& namespaceId, const std::string& taskId) {
 	logger.trace << "Service call: \"getTask\"\n";
 
@@ -358,20 +515,9 @@ service::schemas::RunResponse Service::runTask(const std::string& namespaceId, c
 	}
 
 	if(!runRequest.condition.empty()) {
-		condition::Compiler compiler;
-
-		std::stringstream str;
-		str << runRequest.condition;
-		condition::Scanner scanner(str);
-
-		try {
-			compiler.parse(scanner);
-		}
-		catch(const std::exception& e) {
-			return makeRunResponse("Exception occurred while parsing condition \"" + runRequest.condition + "\": \"" + e.what());
-		}
-		catch(...) {
-			return makeRunResponse("Exception occurred while parsing condition \"" + runRequest.condition + "\".");
+		std::string errorMessage = checkCondition(runRequest.condition);
+		if(!errorMessage.empty()) {
+			return makeRunResponse(errorMessage);
 		}
 	}
 
@@ -387,7 +533,7 @@ service::schemas::RunResponse Service::runTask(const std::string& namespaceId, c
 		//existingTask->metrics = runRequest.metrics;
 		existingTask->condition = runRequest.condition;
 		getDao().updateTask(namespaceId, *existingTask);
-		engine.onUpdateTask(*existingTask);
+		engine.onUpdateTask(namespaceId, *existingTask);
 
 		rv = makeRunResponse(*existingTask);
 	}
@@ -408,27 +554,9 @@ service::schemas::RunResponse Service::runTask(const std::string& namespaceId, c
 			}
 		}
 
-		//boost::uuids::uuid taskIdUUID; // initialize uuid
-		static boost::uuids::random_generator rg;
-		boost::uuids::uuid taskIdUUID = rg();
-
-		Dao::Task task;
-		task.taskId = boost::uuids::to_string(taskIdUUID);
-		task.crc32 = crc32;
-		task.eventType = runRequest.eventType;
-		task.priority = runRequest.priority;
-		task.settings = runRequest.settings;
-		task.metrics = runRequest.metrics;
-		task.condition = runRequest.condition;
-#if 1
-		task.createdTS = std::chrono::system_clock::now();
-#else
-		task.createdTS = toJSONTimestamp(std::chrono::system_clock::now());
-#endif
-		task.state = batchelor::common::types::State::Type::queued;
-
+		Dao::Task task = makeTask(runRequest, crc32);
 		getDao().saveTask(namespaceId, task);
-		engine.onUpdateTask(task);
+		engine.onUpdateTask(namespaceId, task);
 
 		rv = makeRunResponse(task);
 	}
@@ -436,6 +564,73 @@ service::schemas::RunResponse Service::runTask(const std::string& namespaceId, c
 	return rv;
 }
 
+std::vector<service::schemas::RunResponse> Service::runTasks(const std::string& namespaceId, const std::vector<service::schemas::RunRequest>& runRequests) {
+	logger.trace << "Service call: \"runTasks\"\n";
+
+	auto roles = common::auth::UserData::getRoles(context, namespaceId);
+	if(roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	std::vector<service::schemas::RunResponse> rv;
+	rv.reserve(runRequests.size());
+
+	/* Everything that is the same for many requests is done once per batch: conditions are parsed once,
+	 * available event types are loaded once and the latest task of an event type and CRC32 is loaded once,
+	 * including tasks created by this batch. Duplicates are found by the same rule as runTask uses:
+	 * the latest task with same event type and CRC32 is reused if it is still queued or running. */
+	std::map<std::string, std::string> conditionErrors;
+	std::set<std::string> availableEventTypes;
+	for(auto& eventType : getDao().loadEventTypes(namespaceId)) {
+		availableEventTypes.insert(std::move(eventType));
+	}
+	std::map<std::pair<std::string, std::uint32_t>, std::unique_ptr<Dao::Task>> latestTasks;
+
+	Dao::Transaction transaction(getDao());
+	for(const auto& runRequest : runRequests) {
+		if(!runRequest.condition.empty()) {
+			auto conditionErrorIter = conditionErrors.find(runRequest.condition);
+			if(conditionErrorIter == conditionErrors.end()) {
+				conditionErrorIter = conditionErrors.emplace(runRequest.condition, checkCondition(runRequest.condition)).first;
+			}
+			if(!conditionErrorIter->second.empty()) {
+				rv.push_back(makeRunResponse(conditionErrorIter->second));
+				continue;
+			}
+		}
+
+		std::uint32_t crc32 = makeCrc32(runRequest);
+		auto latestTaskIter = latestTasks.find(std::make_pair(runRequest.eventType, crc32));
+		if(latestTaskIter == latestTasks.end()) {
+			latestTaskIter = latestTasks.emplace(std::make_pair(runRequest.eventType, crc32), getDao().loadLatesTaskByEventTypeAndCrc32(namespaceId, runRequest.eventType, crc32)).first;
+		}
+
+		std::unique_ptr<Dao::Task>& existingTask = latestTaskIter->second;
+		if(existingTask && (existingTask->state == batchelor::common::types::State::queued || existingTask->state == batchelor::common::types::State::running)) {
+			existingTask->priority = runRequest.priority;
+			existingTask->condition = runRequest.condition;
+			getDao().updateTask(namespaceId, *existingTask);
+			engine.onUpdateTask(namespaceId, *existingTask);
+
+			rv.push_back(makeRunResponse(*existingTask));
+		}
+		else if(availableEventTypes.count(runRequest.eventType) == 0) {
+			rv.push_back(makeRunResponse("Event type is not available"));
+		}
+		else {
+			Dao::Task task = makeTask(runRequest, crc32);
+			getDao().saveTask(namespaceId, task);
+			engine.onUpdateTask(namespaceId, task);
+
+			rv.push_back(makeRunResponse(task));
+			existingTask.reset(new Dao::Task(std::move(task)));
+		}
+	}
+	transaction.commit();
+
+	return rv;
+}
+
 void Service::sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) {
 	logger.trace << "Service call: \"sendSignal\"\n";
 
@@ -460,7 +655,7 @@ void Service::sendSignal(const std::string& namespaceId, const std::string& task
 		}
 
 		getDao().updateTask(namespaceId, *task);
-		engine.onUpdateTask(*task);
+		engine.onUpdateTask(namespaceId, *task);
 	}
 }
 
@@ -475,6 +670,96 @@ std::vector<std::string> Service::getEventTypes(const std::string& namespaceId)
 	return getDao().loadEventTypes(namespaceId);
 }
 
+std::vector<service::schemas::TaskStatusHead> Service::watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) {
+	logger.trace << "Service call: \"watchTasks\"\n";
+
+	auto roles = common::auth::UserData::getRoles(context, namespaceId);
+	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	std::set<std::string> taskIdFilter(taskIds.begin(), taskIds.end());
+	std::set<std::string> changedTaskIds;
+
+	/* "eventId" of the watcher is the id of the last event it has seen plus 1, so it is not 0 even if there has been no event yet.
+	 * 0 is left for watchers that have not seen anything. */
+	const auto& taskEvents = engine.getTaskEvents();
+	bool eventsMissed = eventId == 0
+			|| eventId - 1 > engine.getLastTaskEventId()
+			|| (!taskEvents.empty() && eventId < taskEvents.front().eventId);
+
+	if(eventsMissed) {
+		/* without task ids the changed tasks are unknown, so the watcher has to reload the status of all tasks */
+		if(eventId != 0 && taskIdFilter.empty()) {
+			throw esl::com::http::server::exception::StatusCode(410, esl::utility::MIME::Type::textPlain, "task events have been missed, reload the status of the tasks");
+		}
+		changedTaskIds = taskIdFilter;
+		eventId = engine.getLastTaskEventId() + 1;
+	}
+	else {
+		std::chrono::steady_clock::time_point timeoutTS = std::chrono::steady_clock::now() + timeout;
+		while(true) {
+			for(auto iter = taskEvents.rbegin(); iter != taskEvents.rend() && iter->eventId >= eventId; ++iter) {
+				if(taskIdFilter.empty() || taskIdFilter.count(iter->taskId) > 0) {
+					changedTaskIds.insert(iter->taskId);
+				}
+			}
+			eventId = engine.getLastTaskEventId() + 1;
+
+			/* waiting releases the mutex of this service, so the head is not blocked by watchers */
+			if(!changedTaskIds.empty() || engine.getTaskEventCV().wait_until(lockMutex, timeoutTS) == std::cv_status::timeout) {
+				break;
+			}
+		}
+	}
+
+	std::vector<service::schemas::TaskStatusHead> rv;
+	for(const auto& taskId : changedTaskIds) {
+		std::unique_ptr<Dao::Task> task = getDao().loadTaskByTaskId(namespaceId, taskId);
+		if(!task) {
+			continue;
+		}
+		if(!state.empty() && common::types::State::toString(task->state) != state) {
+			continue;
+		}
+		rv.push_back(taskToTaskStatusHead(*task));
+	}
+
+	return rv;
+}
+
+std::unique_ptr<service::schemas::TaskOutput> Service::getTaskOutput(const std::string& namespaceId, const std::string& taskId) {
+	logger.trace << "Service call: \"getTaskOutput\"\n";
+
+	auto roles = common::auth::UserData::getRoles(context, namespaceId);
+	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	std::unique_ptr<service::schemas::TaskOutput> rv;
+	std::unique_ptr<Dao::Task> task = getDao().loadTaskByTaskId(namespaceId, taskId);
+	if(!task) {
+		return rv;
+	}
+
+	rv.reset(new service::schemas::TaskOutput);
+	rv->taskId = taskId;
+
+	auto& taskOutputs = engine.getTaskOutputs();
+	auto taskOutputIter = taskOutputs.find(std::make_pair(namespaceId, taskId));
+	if(taskOutputIter != taskOutputs.end()) {
+		rv->out = taskOutputIter->second.out;
+		rv->err = taskOutputIter->second.err;
+	}
+
+	/* the output of a running task is requested from its worker with the next fetch requests */
+	if(task->state == common::types::State::running) {
+		taskOutputs[std::make_pair(namespaceId, taskId)].requestedUntil = std::chrono::steady_clock::now() + taskOutputTimeout;
+	}
+
+	return rv;
+}
+
 esl::database::Connection& Service::getDBConnection() const {
 	if(!dbConnection) {
 		dbConnection = engine.getDbConnectionFactory().createConnection();
@@ -489,7 +774,7 @@ esl::database::Connection& Service::getDBConnection() const {
 
 Dao& Service::getDao() const {
 	if(!dao) {
-		dao.reset(new Dao(getDBConnection()));
+		dao.reset(new Dao(getDBConnection(), &engine.getMetrics()));
 	}
 
 	return *dao;
@@ -30,11 +30,14 @@
 #include <batchelor/service/schemas/RunRequest.h>
 #include <batchelor/service/schemas/RunResponse.h>
 #include <batchelor/service/schemas/Signal.h>
+#include <batchelor/service/schemas/TaskOutput.h>
 
 #include <esl/database/Connection.h>
 #include <esl/database/ConnectionFactory.h>
 #include <esl/object/Context.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -54,11 +57,17 @@ public:
 
 	std::vector<service::schemas::TaskStatusHead> getTasks(const std::string& namespaceId, const std::string& state, const std::string& eventNotAfter, const std::string& eventNotBefore) override;
 
+	// used by web frontend
+	std::vector<service::schemas::TaskStatusHead> queryTasks(const std::string& namespaceId, const service::TaskQuery& query) override;
+
 	// used by cli
 	std::unique_ptr<service::schemas::TaskStatusHead> getTask(const std::string& namespaceId, const std::string& taskId) override;
 	service::schemas::RunResponse runTask(const std::string& namespaceId, const service::schemas::RunRequest& runRequest) override;
+	std::vector<service::schemas::RunResponse> runTasks(const std::string& namespaceId, const std::vector<service::schemas::RunRequest>& runRequests) override;
 	void sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) override;
 	std::vector<std::string> getEventTypes(const std::string& namespaceId) override;
+	std::vector<service::schemas::TaskStatusHead> watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) override;
+	std::unique_ptr<service::schemas::TaskOutput> getTaskOutput(const std::string& namespaceId, const std::string& taskId) override;
 
 private:
 	esl::database::Connection& getDBConnection() const;
@@ -67,7 +76,7 @@ private:
 
 	const esl::object::Context& context;
 	Engine& engine;
-	std::lock_guard<std::mutex> lockMutex;
+	std::unique_lock<std::mutex> lockMutex;
 	mutable std::unique_ptr<esl::database::Connection> dbConnection;
 	mutable std::unique_ptr<Dao> dao;
 };
@@ -16,13 +16,17 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <batchelor/common/auth/PasswordHash.h>
 #include <batchelor/common/auth/UserData.h>
 #include <batchelor/common/config/args/ArgumentsException.h>
+#include <batchelor/common/crypto/Sha256.h>
 #include <batchelor/common/plugin/Socket.h>
 
 #include <batchelor/head/config/args/Config.h>
 #include <batchelor/head/plugin/Observer.h>
 
+#include <batchelor/service/server/WatcherLimit.h>
+
 #include <esl/crypto/KeyStore.h>
 #include <esl/database/ConnectionFactory.h>
 #include <esl/database/SQLiteConnectionFactory.h>
@@ -32,6 +36,7 @@
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 namespace batchelor {
 namespace head {
@@ -67,15 +72,39 @@ void Config::printUsage() {
 	std::cout << "                                            The API key is specified in <api-key> that has format \"<encryption>:<value>\".\n";
 	std::cout << "                                            There are several values available for <encryption>:\n";
 	std::cout << "                                            * plain:<value>      Defines the API key as plain text in <value>.\n";
+	std::cout << "                                            * sha256:<value>     Defines the API key by its SHA-256 as hex value in <value>.\n";
 	std::cout << "\n";
 	std::cout << "  -B, --basic-auth       <user> <pw>        Defines a password for a user <user> used if basic-authentication is used over https.\n";
 	std::cout << "                                            The password is specified in <pw> that has format \"<encryption>:<value>\".\n";
 	std::cout << "                                            There are several values available for <encryption>:\n";
 	std::cout << "                                            * plain:<value>      Defines the password as plain text in <value>.\n";
+	std::cout << "                                            * pbkdf2-sha256:<value>\n";
+	std::cout << "                                                                 Defines the password by its PBKDF2-HMAC-SHA256 hash in <value>\n";
+	std::cout << "                                                                 that has format \"<iterations>$<salt>$<hash>\" with hex values for\n";
+	std::cout << "                                                                 <salt> and <hash>. Verified passwords are cached for 5 minutes.\n";
+	std::cout << "\n";
+	std::cout << "  -J, --jwt              <key> <value>      Defines a setting to validate bearer tokens as JWT signed with RS256 by an identity provider.\n";
+	std::cout << "                                            The signature is checked locally with the keys of a JWKS. Following settings are available:\n";
+	std::cout << "                                            * jwks-url:      <url>         Defines the URL to load the JWKS from.\n";
+	std::cout << "                                            * jwks-file:     <file>        Defines a file to load the JWKS from, e.g. for a local identity provider.\n";
+	std::cout << "                                            * jwks-refresh:  <duration>    Defines how often the JWKS is reloaded. Default is 1 hour.\n";
+	std::cout << "                                            * jwt-issuer:    <issuer>      Defines the required value of claim \"iss\".\n";
+	std::cout << "                                            * jwt-audience:  <audience>    Defines the required value of claim \"aud\".\n";
+	std::cout << "                                            * jwt-roles-claim: <claim>     Defines the claim with the roles of the token, e.g. \"realm_access.roles\".\n";
+	std::cout << "                                                                           Default is \"roles\".\n";
+	std::cout << "                                            * jwt-role:      <value>:<user> Maps a value of the roles claim to the roles of user <user>.\n";
 	std::cout << "\n";
 //	std::cout << "  -D, --database         <plugin>           Defines a database to store status data.\n";
 //	std::cout << "                                            Subsequent settings specified by \"--setting\" are specific to the plugin.\n";
 //	std::cout << "\n";
+	std::cout << "  -W, --max-watchers     <number>           Defines how many long polls and streams of \"watch\" can wait for task events at the\n";
+	std::cout << "                                            same time. Each of them blocks a thread of the socket, so keep it below \"threads\".\n";
+	std::cout << "                                            Clients that exceed the limit fall back to polling. Default is " << service::server::WatcherLimit::defaultMaxWatchers << ".\n";
+	std::cout << "\n";
+	std::cout << "  -M, --metrics          <ns>               Enables \"/metrics\" in the text format of Prometheus for users that have role \"read-only\"\n";
+	std::cout << "                                            or \"execute\" at namespace <ns>. The metrics are counted over all namespaces.\n";
+	std::cout << "                                            \"/metrics\" is disabled by default.\n";
+	std::cout << "\n";
 	std::cout << "  -O, --observer         <plugin>           Defines an observer to listen on events.\n";
 	std::cout << "                                            Subsequent settings specified by \"--setting\" are specific to the plugin.\n";
 	std::cout << "\n";
@@ -119,6 +148,18 @@ Config::Config(esl::object::Context& aContext, Procedure::Settings& aSettings, i
 			addBasicAuth(i+1 < argc ? argv[i+1] : nullptr, i+2 < argc ? argv[i+2] : nullptr);
 			i = i+2;
 		}
+		else if(currentArg == "-J"  || currentArg == "--jwt") {
+			addJwtSetting(i+1 < argc ? argv[i+1] : nullptr, i+2 < argc ? argv[i+2] : nullptr);
+			i = i+2;
+		}
+		else if(currentArg == "-W"  || currentArg == "--max-watchers") {
+			setMaxWatchers(i+1 < argc ? argv[i+1] : nullptr);
+			++i;
+		}
+		else if(currentArg == "-M"  || currentArg == "--metrics") {
+			setMetricsNamespace(i+1 < argc ? argv[i+1] : nullptr);
+			++i;
+		}
 		else if(currentArg == "-D"  || currentArg == "--database") {
 			addDatabase(i+1 < argc ? argv[i+1] : nullptr);
 			++i;
@@ -266,6 +307,9 @@ void Config::addApiKey(const char* user, const char* apikey) {
 	if(apik.substr(0, 6) == "plain:") {
 		settings.userByPlainApiKey[apik.substr(6)] = user;
 	}
+	else if(apik.substr(0, 7) == "sha256:" && apik.size() == 7 + 2 * common::crypto::Sha256::digestSize) {
+		settings.userBySha256ApiKey[apik.substr(7)] = user;
+	}
 	else {
 	//if(userData.pw.empty()) {
 		throw ArgumentsException("Invalid value \"" + apik + "\" for api-key of option \"--api-key\".");
@@ -282,15 +326,37 @@ void Config::addBasicAuth(const char* user, const char* password) {
 	}
 
 	std::string pw = password;
-	if(pw.substr(0, 6) == "plain:") {
+	const std::string pbkdf2Prefix = common::auth::PasswordHash::type + ":";
+	if(pw.substr(0, 6) == "plain:" && pw.size() > 6) {
+		settings.pbkdf2BasicAuthByUser.erase(user);
 		settings.plainBasicAuthByUser[user] = pw.substr(6);
 	}
-
-	if(settings.plainBasicAuthByUser[user].empty()) {
+	else if(pw.substr(0, pbkdf2Prefix.size()) == pbkdf2Prefix) {
+		try {
+			common::auth::PasswordHash passwordHash(pw.substr(pbkdf2Prefix.size()));
+		}
+		catch(const std::exception& e) {
+			throw ArgumentsException("Invalid value \"" + pw + "\" for password of option \"--basic-auth\": " + e.what());
+		}
+		settings.plainBasicAuthByUser.erase(user);
+		settings.pbkdf2BasicAuthByUser[user] = pw.substr(pbkdf2Prefix.size());
+	}
+	else {
 		throw ArgumentsException("Invalid value \"" + pw + "\" for password of option \"--basic-auth\".");
 	}
 }
 
+void Config::addJwtSetting(const char* key, const char* value) {
+	if(!key) {
+		throw ArgumentsException("Key missing of option \"--jwt\".");
+	}
+	if(!value) {
+		throw ArgumentsException("Value missing of option \"--jwt\".");
+	}
+
+	settings.jwtSettings.emplace_back(key, value);
+}
+
 void Config::addUser(const char* user, const char* namespaceId, const char* roleStr) {
 	if(!user) {
 		throw ArgumentsException("User name missing of option \"--user\".");
@@ -308,6 +374,37 @@ void Config::addUser(const char* user, const char* namespaceId, const char* role
 	userData.rolesByNamespace[namespaceId].insert(common::auth::UserData::toRole(roleStr));
 }
 
+void Config::setMaxWatchers(const char* value) {
+	if(!value) {
+		throw ArgumentsException("Value missing of option \"--max-watchers\".");
+	}
+	if(hasMaxWatchers) {
+		throw ArgumentsException("Multiple definition of option \"--max-watchers\".");
+	}
+	hasMaxWatchers = true;
+
+	try {
+		settings.maxWatchers = static_cast<std::size_t>(std::stoul(value));
+	}
+	catch(...) {
+		throw ArgumentsException("Invalid value \"" + std::string(value) + "\" of option \"--max-watchers\".");
+	}
+}
+
+void Config::setMetricsNamespace(const char* namespaceId) {
+	if(!namespaceId) {
+		throw ArgumentsException("Namespace missing of option \"--metrics\".");
+	}
+	if(!settings.metricsNamespaceId.empty()) {
+		throw ArgumentsException("Multiple definition of option \"--metrics\".");
+	}
+
+	settings.metricsNamespaceId = namespaceId;
+	if(settings.metricsNamespaceId.empty()) {
+		throw ArgumentsException("Invalid value \"\" of option \"--metrics\".");
+	}
+}
+
 void Config::addDatabase(const char* implementation) {
 	if(!implementation) {
 		throw ArgumentsException("Plugin-value missing of option \"--database\".");
@@ -74,7 +74,13 @@ private:
 	void addCertificate(const char* hostName, const char* keyFile, const char* certFile);
 	void addApiKey(const char* user, const char* apik);
 	void addBasicAuth(const char* user, const char* password);
+	void addJwtSetting(const char* key, const char* value);
 	void addUser(const char* user, const char* namespaceId, const char* role);
+
+	bool hasMaxWatchers = false;
+	void setMaxWatchers(const char* value);
+	void setMetricsNamespace(const char* namespaceId);
+
 	void addDatabase(const char* implementation);
 	void addObserver(const char* implementation);
 	void addSocket(const char* implementation);
@@ -0,0 +1,148 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/BinaryCodec.h>
+#include <batchelor/service/schemas/FetchRequest.h>
+#include <batchelor/service/schemas/FetchResponse.h>
+
+#include "sergut/JsonDeserializer.h"
+#include "sergut/JsonSerializer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/* Compares encode/decode time and bytes on the wire of JSON and BinaryCodec for the heartbeat of a worker running 40 tasks.
+ * Usage: batchelor-service-benchmark-binarycodec [iterations]
+ */
+
+namespace {
+using namespace batchelor::service;
+
+schemas::FetchRequest makeFetchRequest() {
+	schemas::FetchRequest fetchRequest;
+
+	fetchRequest.workerId = "worker-7f3c9a2e";
+	fetchRequest.sessionId = "5d41402abc4b2a76b9719d911017c592";
+	for(int i = 0; i < 5; ++i) {
+		schemas::EventTypeAvailable eventTypeAvailable;
+		eventTypeAvailable.eventType = "event-type-" + std::to_string(i);
+		eventTypeAvailable.available = (i % 2) == 0;
+		fetchRequest.eventTypes.push_back(eventTypeAvailable);
+	}
+
+	fetchRequest.metrics.push_back(schemas::Setting::make("CPU_USAGE", "37.5"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("MEM_USAGE", "61.2"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("LOAD_AVG_1", "3.10"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("LOAD_AVG_5", "2.85"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("LOAD_AVG_15", "2.40"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("TASKS_RUNNING", "40"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("HOST_NAME", "batch-node-17.example.com"));
+	fetchRequest.metrics.push_back(schemas::Setting::make("cloudId", "OnPrem"));
+
+	for(int i = 0; i < 40; ++i) {
+		schemas::TaskStatusWorker task;
+		task.taskId = "3f2b8c1e-4d5a-4b6c-9e7f-" + std::to_string(100000000000 + i);
+		task.state = (i % 10) == 9 ? "done" : "running";
+		task.returnCode = 0;
+		fetchRequest.tasks.push_back(task);
+	}
+
+	return fetchRequest;
+}
+
+schemas::FetchResponse makeFetchResponse() {
+	schemas::FetchResponse fetchResponse;
+
+	schemas::RunConfiguration runConfiguration;
+	runConfiguration.taskId = "3f2b8c1e-4d5a-4b6c-9e7f-200000000000";
+	runConfiguration.eventType = "event-type-0";
+	runConfiguration.settings.push_back(schemas::Setting::make("args", "--propertyId=Bla --propertyFile=/etc/secret/test.pwd"));
+	runConfiguration.settings.push_back(schemas::Setting::make("env", "TMP_DIR=/tmp"));
+	runConfiguration.metrics.push_back(schemas::Setting::make("CPU_USAGE", "37.5"));
+	runConfiguration.metrics.push_back(schemas::Setting::make("SECONDS_WAITING", "12"));
+	fetchResponse.runConfigurations.push_back(runConfiguration);
+
+	fetchResponse.epoch = 42;
+	fetchResponse.queueDepth = 17;
+	fetchResponse.nextPollMs = 0;
+
+	return fetchResponse;
+}
+
+std::size_t size(const schemas::FetchRequest& fetchRequest) {
+	return fetchRequest.tasks.size();
+}
+
+std::size_t size(const schemas::FetchResponse& fetchResponse) {
+	return fetchResponse.runConfigurations.size();
+}
+
+template<typename T>
+std::string toJSON(const T& data) {
+	sergut::JsonSerializer serializer;
+	serializer.serializeData(data);
+	return serializer.str();
+}
+
+/* returns nanoseconds per call */
+double measure(unsigned long iterations, const std::function<void()>& function) {
+	std::chrono::steady_clock::time_point startTS = std::chrono::steady_clock::now();
+	for(unsigned long i = 0; i < iterations; ++i) {
+		function();
+	}
+	std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startTS;
+	return static_cast<double>(duration.count()) / iterations;
+}
+
+template<typename T>
+void run(const std::string& name, const T& data, unsigned long iterations, T (*decodeBinary)(const std::string&)) {
+	std::string json = toJSON(data);
+	std::string binary = BinaryCodec::encode(data);
+
+	/* results are kept in a volatile variable, so the compiler does not drop the calls */
+	volatile std::size_t sink = 0;
+	double jsonEncodeNs = measure(iterations, [&]() { sink = sink + toJSON(data).size(); });
+	double jsonDecodeNs = measure(iterations, [&]() { sink = sink + size(sergut::JsonDeserializer(json).deserializeData<T>()); });
+	double binaryEncodeNs = measure(iterations, [&]() { sink = sink + BinaryCodec::encode(data).size(); });
+	double binaryDecodeNs = measure(iterations, [&]() { sink = sink + size(decodeBinary(binary)); });
+
+	std::cout << name << "\n";
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "  json:   " << std::setw(6) << json.size() << " bytes, encode " << std::setw(8) << jsonEncodeNs << " ns, decode " << std::setw(8) << jsonDecodeNs << " ns\n";
+	std::cout << "  binary: " << std::setw(6) << binary.size() << " bytes, encode " << std::setw(8) << binaryEncodeNs << " ns, decode " << std::setw(8) << binaryDecodeNs << " ns\n";
+}
+} /* anonymous namespace */
+
+int main(int argc, const char* argv[]) {
+	unsigned long iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	if(iterations == 0) {
+		std::cerr << "Usage: " << argv[0] << " [iterations]\n";
+		return 1;
+	}
+
+	std::cout << "iterations: " << iterations << "\n";
+	run<schemas::FetchRequest>("FetchRequest with 40 tasks", makeFetchRequest(), iterations, &BinaryCodec::decodeFetchRequest);
+	run<schemas::FetchResponse>("FetchResponse with 1 run configuration", makeFetchResponse(), iterations, &BinaryCodec::decodeFetchResponse);
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/Compression.h>
+#include <batchelor/service/schemas/TaskStatusHead.h>
+
+#include "sergut/JsonSerializer.h"
+#include "sergut/XmlSerializer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Compares CPU time and bytes on the wire of uncompressed and gzip-compressed task listings of "GET /tasks".
+ * Usage: batchelor-service-benchmark-compression [tasks] [iterations]
+ */
+
+namespace {
+using namespace batchelor::service;
+
+std::vector<schemas::TaskStatusHead> makeTasks(unsigned long count) {
+	static const char* states[] = { "queued", "running", "running", "done", "done", "done", "done", "signaled", "zombie", "done" };
+	std::vector<schemas::TaskStatusHead> tasks;
+
+	for(unsigned long i = 0; i < count; ++i) {
+		schemas::TaskStatusHead task;
+		task.runConfiguration.taskId = "3f2b8c1e-4d5a-4b6c-9e7f-" + std::to_string(100000000000 + i);
+		task.runConfiguration.eventType = "event-type-" + std::to_string(i % 7);
+		task.runConfiguration.settings.push_back(schemas::Setting::make("args", "--propertyId=Bla" + std::to_string(i % 13) + " --propertyFile=/etc/secret/test.pwd"));
+		task.runConfiguration.settings.push_back(schemas::Setting::make("env", "TMP_DIR=/tmp"));
+		task.runConfiguration.metrics.push_back(schemas::Setting::make("CPU_USAGE", std::to_string(i % 100) + ".5"));
+		task.runConfiguration.metrics.push_back(schemas::Setting::make("HOST_NAME", "batch-node-" + std::to_string(i % 20) + ".example.com"));
+		task.state = states[i % 10];
+		task.returnCode = task.state == "done" && (i % 17) == 0 ? 1 : 0;
+		task.message = task.returnCode == 0 ? "" : "exit code 1";
+		task.tsCreated = "2024-05-17 12:" + std::to_string(10 + (i / 60) % 50) + ":" + std::to_string(10 + i % 50) + ".123";
+		task.tsRunning = task.state == "queued" ? "" : task.tsCreated;
+		task.tsFinished = task.state == "queued" || task.state == "running" ? "" : task.tsCreated;
+		task.tsLastHeartBeat = task.tsRunning;
+		tasks.push_back(task);
+	}
+
+	return tasks;
+}
+
+std::string toJSON(const std::vector<schemas::TaskStatusHead>& tasks) {
+	sergut::JsonSerializer serializer;
+	serializer.serializeData(tasks);
+	return serializer.str();
+}
+
+std::string toXML(const std::vector<schemas::TaskStatusHead>& tasks) {
+	sergut::XmlSerializer serializer;
+	serializer.serializeNestedData("tasks", "task", sergut::XmlValueType::Child, tasks);
+	return serializer.str();
+}
+
+/* returns microseconds per call */
+double measure(unsigned long iterations, const std::function<void()>& function) {
+	std::chrono::steady_clock::time_point startTS = std::chrono::steady_clock::now();
+	for(unsigned long i = 0; i < iterations; ++i) {
+		function();
+	}
+	std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - startTS;
+	return static_cast<double>(duration.count()) / iterations / 1000.0;
+}
+
+void run(const std::string& name, const std::vector<schemas::TaskStatusHead>& tasks, unsigned long iterations, std::string (*serialize)(const std::vector<schemas::TaskStatusHead>&)) {
+	std::string content = serialize(tasks);
+	std::string gzipped = Compression::gzip(content);
+
+	/* results are kept in a volatile variable, so the compiler does not drop the calls */
+	volatile std::size_t sink = 0;
+	double serializeUs = measure(iterations, [&]() { sink = sink + serialize(tasks).size(); });
+	double gzipUs = measure(iterations, [&]() { sink = sink + Compression::gzip(content).size(); });
+	double gunzipUs = measure(iterations, [&]() { sink = sink + Compression::gunzip(gzipped).size(); });
+
+	std::cout << name << "\n";
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "  plain: " << std::setw(9) << content.size() << " bytes, serialize " << std::setw(8) << serializeUs << " us\n";
+	std::cout << "  gzip:  " << std::setw(9) << gzipped.size() << " bytes, compress  " << std::setw(8) << gzipUs << " us, decompress " << std::setw(8) << gunzipUs << " us\n";
+	std::cout << std::setprecision(1);
+	std::cout << "  ratio: " << std::setw(9) << static_cast<double>(content.size()) / gzipped.size() << "\n";
+}
+} /* anonymous namespace */
+
+int main(int argc, const char* argv[]) {
+	unsigned long count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	unsigned long iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+	if(count == 0 || iterations == 0) {
+		std::cerr << "Usage: " << argv[0] << " [tasks] [iterations]\n";
+		return 1;
+	}
+
+	std::vector<schemas::TaskStatusHead> tasks = makeTasks(count);
+
+	std::cout << "tasks: " << count << ", iterations: " << iterations << "\n";
+	run("JSON listing", tasks, iterations, &toJSON);
+	run("XML listing", tasks, iterations, &toXML);
+
+	return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/BinaryCodec.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace batchelor {
+namespace service {
+
+namespace {
+const std::string binaryMIME = "application/x-batchelor-binary";
+constexpr std::uint8_t version = 1;
+
+class Encoder {
+public:
+	Encoder() {
+		data.push_back(static_cast<char>(version));
+	}
+
+	void writeVarint(std::uint64_t value) {
+		while(value >= 0x80) {
+			data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		data.push_back(static_cast<char>(value));
+	}
+
+	void writeInt(std::int64_t value) {
+		writeVarint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+	}
+
+	void writeBool(bool value) {
+		data.push_back(value ? 1 : 0);
+	}
+
+	void writeString(const std::string& value) {
+		writeVarint(value.size());
+		data.append(value);
+	}
+
+	void writeKey(const std::string& key) {
+		auto iter = keyIndexes.find(key);
+		if(iter != keyIndexes.end()) {
+			writeVarint(iter->second);
+			return;
+		}
+
+		writeVarint(0);
+		writeString(key);
+		keyIndexes.emplace(key, keyIndexes.size() + 1);
+	}
+
+	void writeSettings(const std::vector<schemas::Setting>& settings) {
+		writeVarint(settings.size());
+		for(const auto& setting : settings) {
+			writeKey(setting.key);
+			writeString(setting.value);
+		}
+	}
+
+	std::string&& release() {
+		return std::move(data);
+	}
+
+private:
+	std::string data;
+	std::map<std::string, std::uint64_t> keyIndexes;
+};
+
+class Decoder {
+public:
+	Decoder(const std::string& aData)
+	: data(aData)
+	{
+		if(readByte() != version) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Unsupported version of binary encoded message"));
+		}
+	}
+
+	std::uint64_t readVarint() {
+		std::uint64_t value = 0;
+		for(unsigned int shift = 0; shift < 64; shift += 7) {
+			std::uint8_t byte = readByte();
+			value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+			if((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid varint in binary encoded message"));
+	}
+
+	std::int64_t readInt() {
+		std::uint64_t value = readVarint();
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+	bool readBool() {
+		return readByte() != 0;
+	}
+
+	std::string readString() {
+		std::uint64_t size = readVarint();
+		if(size > data.size() - pos) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Unexpected end of binary encoded message"));
+		}
+		std::string value = data.substr(pos, size);
+		pos += size;
+		return value;
+	}
+
+	const std::string& readKey() {
+		std::uint64_t index = readVarint();
+		if(index == 0) {
+			keys.push_back(readString());
+			return keys.back();
+		}
+		if(index > keys.size()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid key index in binary encoded message"));
+		}
+		return keys[index - 1];
+	}
+
+	std::size_t readCount() {
+		std::uint64_t count = readVarint();
+		/* every element needs at least one byte, so this protects against huge allocations */
+		if(count > data.size() - pos) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid element count in binary encoded message"));
+		}
+		return static_cast<std::size_t>(count);
+	}
+
+	std::vector<schemas::Setting> readSettings() {
+		std::vector<schemas::Setting> settings(readCount());
+		for(auto& setting : settings) {
+			setting.key = readKey();
+			setting.value = readString();
+		}
+		return settings;
+	}
+
+	void checkEnd() const {
+		if(pos != data.size()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Unexpected trailing data in binary encoded message"));
+		}
+	}
+
+private:
+	const std::string& data;
+	std::size_t pos = 0;
+	std::vector<std::string> keys;
+
+	std::uint8_t readByte() {
+		if(pos >= data.size()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Unexpected end of binary encoded message"));
+		}
+		return static_cast<std::uint8_t>(data[pos++]);
+	}
+};
+} /* anonymous namespace */
+
+const std::string& BinaryCodec::getMIME() {
+	return binaryMIME;
+}
+
+std::string BinaryCodec::encode(const schemas::FetchRequest& fetchRequest) {
+	Encoder encoder;
+
+	encoder.writeString(fetchRequest.workerId);
+
+	encoder.writeVarint(fetchRequest.eventTypes.size());
+	for(const auto& eventType : fetchRequest.eventTypes) {
+		encoder.writeKey(eventType.eventType);
+		encoder.writeBool(eventType.available);
+	}
+
+	encoder.writeSettings(fetchRequest.metrics);
+
+	encoder.writeVarint(fetchRequest.tasks.size());
+	for(const auto& task : fetchRequest.tasks) {
+		encoder.writeString(task.taskId);
+		encoder.writeKey(task.state);
+		encoder.writeInt(task.returnCode);
+		encoder.writeString(task.message);
+	}
+
+	encoder.writeString(fetchRequest.sessionId);
+	encoder.writeInt(fetchRequest.baseEpoch);
+
+	encoder.writeVarint(fetchRequest.outputs.size());
+	for(const auto& output : fetchRequest.outputs) {
+		encoder.writeString(output.taskId);
+		encoder.writeString(output.out);
+		encoder.writeString(output.err);
+	}
+
+	return encoder.release();
+}
+
+std::string BinaryCodec::encode(const schemas::FetchResponse& fetchResponse) {
+	Encoder encoder;
+
+	encoder.writeVarint(fetchResponse.signals.size());
+	for(const auto& signal : fetchResponse.signals) {
+		encoder.writeString(signal.taskId);
+		encoder.writeKey(signal.signal);
+	}
+
+	encoder.writeVarint(fetchResponse.runConfigurations.size());
+	for(const auto& runConfiguration : fetchResponse.runConfigurations) {
+		encoder.writeString(runConfiguration.taskId);
+		encoder.writeKey(runConfiguration.eventType);
+		encoder.writeSettings(runConfiguration.settings);
+		encoder.writeSettings(runConfiguration.metrics);
+	}
+
+	encoder.writeInt(fetchResponse.epoch);
+	encoder.writeInt(fetchResponse.queueDepth);
+	encoder.writeInt(fetchResponse.nextPollMs);
+
+	encoder.writeVarint(fetchResponse.tailRequests.size());
+	for(const auto& taskId : fetchResponse.tailRequests) {
+		encoder.writeString(taskId);
+	}
+
+	return encoder.release();
+}
+
+schemas::FetchRequest BinaryCodec::decodeFetchRequest(const std::string& data) {
+	schemas::FetchRequest fetchRequest;
+	Decoder decoder(data);
+
+	fetchRequest.workerId = decoder.readString();
+
+	fetchRequest.eventTypes.resize(decoder.readCount());
+	for(auto& eventType : fetchRequest.eventTypes) {
+		eventType.eventType = decoder.readKey();
+		eventType.available = decoder.readBool();
+	}
+
+	fetchRequest.metrics = decoder.readSettings();
+
+	fetchRequest.tasks.resize(decoder.readCount());
+	for(auto& task : fetchRequest.tasks) {
+		task.taskId = decoder.readString();
+		task.state = decoder.readKey();
+		task.returnCode = static_cast<int>(decoder.readInt());
+		task.message = decoder.readString();
+	}
+
+	fetchRequest.sessionId = decoder.readString();
+	fetchRequest.baseEpoch = static_cast<int>(decoder.readInt());
+
+	fetchRequest.outputs.resize(decoder.readCount());
+	for(auto& output : fetchRequest.outputs) {
+		output.taskId = decoder.readString();
+		output.out = decoder.readString();
+		output.err = decoder.readString();
+	}
+
+	decoder.checkEnd();
+	return fetchRequest;
+}
+
+schemas::FetchResponse BinaryCodec::decodeFetchResponse(const std::string& data) {
+	schemas::FetchResponse fetchResponse;
+	Decoder decoder(data);
+
+	fetchResponse.signals.resize(decoder.readCount());
+	for(auto& signal : fetchResponse.signals) {
+		signal.taskId = decoder.readString();
+		signal.signal = decoder.readKey();
+	}
+
+	fetchResponse.runConfigurations.resize(decoder.readCount());
+	for(auto& runConfiguration : fetchResponse.runConfigurations) {
+		runConfiguration.taskId = decoder.readString();
+		runConfiguration.eventType = decoder.readKey();
+		runConfiguration.settings = decoder.readSettings();
+		runConfiguration.metrics = decoder.readSettings();
+	}
+
+	fetchResponse.epoch = static_cast<int>(decoder.readInt());
+	fetchResponse.queueDepth = static_cast<int>(decoder.readInt());
+	fetchResponse.nextPollMs = static_cast<int>(decoder.readInt());
+
+	fetchResponse.tailRequests.resize(decoder.readCount());
+	for(auto& taskId : fetchResponse.tailRequests) {
+		taskId = decoder.readString();
+	}
+
+	decoder.checkEnd();
+	return fetchResponse;
+}
+
+} /* namespace service */
+} /* namespace batchelor */
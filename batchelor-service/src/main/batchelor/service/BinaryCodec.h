@@ -0,0 +1,59 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_BINARYCODEC_H_
+#define BATCHELOR_SERVICE_BINARYCODEC_H_
+
+#include <batchelor/service/schemas/FetchRequest.h>
+#include <batchelor/service/schemas/FetchResponse.h>
+
+#include <string>
+
+namespace batchelor {
+namespace service {
+
+/* Compact binary encoding of FetchRequest and FetchResponse for worker <-> head traffic.
+ *
+ * Layout: a version byte followed by the message fields in declaration order.
+ * - integers are varint encoded (signed values use zig-zag encoding),
+ * - strings are length-prefixed with a varint,
+ * - lists are prefixed with a varint element count,
+ * - keys (metric keys, setting keys, event types and states) are interned per message:
+ *   the first occurrence is written as 0 followed by the string, every further occurrence
+ *   only as the 1-based index of the first occurrence.
+ *
+ * The encoding is only used if both sides negotiated it by MIME type, JSON stays the default.
+ */
+class BinaryCodec final {
+public:
+	BinaryCodec() = delete;
+
+	static const std::string& getMIME();
+
+	static std::string encode(const schemas::FetchRequest& fetchRequest);
+	static std::string encode(const schemas::FetchResponse& fetchResponse);
+
+	static schemas::FetchRequest decodeFetchRequest(const std::string& data);
+	static schemas::FetchResponse decodeFetchResponse(const std::string& data);
+};
+
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_BINARYCODEC_H_ */
@@ -0,0 +1,146 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/Compression.h>
+
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/String.h>
+
+#include <zlib.h>
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+namespace batchelor {
+namespace service {
+
+namespace {
+const std::string gzipEncoding = "gzip";
+
+/* windowBits 15 plus 16 selects the gzip format instead of the zlib format */
+constexpr int gzipWindowBits = 15 + 16;
+
+const std::string* findHeader(const std::map<std::string, std::string>& headers, const std::string& lowerName) {
+	for(const auto& header : headers) {
+		if(esl::utility::String::toLower(header.first) == lowerName) {
+			return &header.second;
+		}
+	}
+	return nullptr;
+}
+} /* anonymous namespace */
+
+const std::string& Compression::getGzipEncoding() {
+	return gzipEncoding;
+}
+
+bool Compression::acceptsGzip(const std::map<std::string, std::string>& headers) {
+	const std::string* acceptEncoding = findHeader(headers, "accept-encoding");
+	if(!acceptEncoding) {
+		return false;
+	}
+
+	std::vector<std::string> encodings = esl::utility::String::split(*acceptEncoding, ',');
+	for(const auto& encoding : encodings) {
+		std::vector<std::string> encodingSplit = esl::utility::String::split(encoding, ';');
+		if(encodingSplit.empty() || esl::utility::String::toLower(esl::utility::String::trim(encodingSplit[0])) != gzipEncoding) {
+			continue;
+		}
+
+		/* "gzip;q=0" means that gzip is not acceptable */
+		for(std::size_t i = 1; i < encodingSplit.size(); ++i) {
+			std::string parameter = esl::utility::String::trim(encodingSplit[i]);
+			if(parameter.size() > 2 && parameter.substr(0, 2) == "q=" && std::strtod(parameter.c_str() + 2, nullptr) <= 0.0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool Compression::isGzipEncoded(const std::map<std::string, std::string>& headers) {
+	const std::string* contentEncoding = findHeader(headers, "content-encoding");
+	return contentEncoding && esl::utility::String::toLower(esl::utility::String::trim(*contentEncoding)) == gzipEncoding;
+}
+
+std::string Compression::gzip(const std::string& data) {
+	z_stream stream{};
+	if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Initialization of gzip compression failed"));
+	}
+
+	std::string rv;
+	rv.resize(deflateBound(&stream, data.size()));
+
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	stream.avail_in = static_cast<uInt>(data.size());
+	stream.next_out = reinterpret_cast<Bytef*>(&rv[0]);
+	stream.avail_out = static_cast<uInt>(rv.size());
+
+	int result = deflate(&stream, Z_FINISH);
+	rv.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	if(result != Z_STREAM_END) {
+		throw esl::system::Stacktrace::add(std::runtime_error("gzip compression failed"));
+	}
+
+	return rv;
+}
+
+std::string Compression::gunzip(const std::string& data, std::size_t maxSize) {
+	z_stream stream{};
+	if(inflateInit2(&stream, gzipWindowBits) != Z_OK) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Initialization of gzip decompression failed"));
+	}
+
+	std::string rv;
+	char buffer[16384];
+
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	stream.avail_in = static_cast<uInt>(data.size());
+
+	int result = Z_OK;
+	while(result != Z_STREAM_END) {
+		stream.next_out = reinterpret_cast<Bytef*>(buffer);
+		stream.avail_out = sizeof(buffer);
+
+		result = inflate(&stream, Z_NO_FLUSH);
+		if(result != Z_OK && result != Z_STREAM_END) {
+			inflateEnd(&stream);
+			throw esl::system::Stacktrace::add(std::runtime_error("gzip decompression failed"));
+		}
+
+		std::size_t count = sizeof(buffer) - stream.avail_out;
+		if(count > maxSize - rv.size()) {
+			inflateEnd(&stream);
+			throw esl::system::Stacktrace::add(std::runtime_error("gzip decompressed data exceeds " + std::to_string(maxSize) + " bytes"));
+		}
+		rv.append(buffer, count);
+	}
+	inflateEnd(&stream);
+
+	return rv;
+}
+
+} /* namespace service */
+} /* namespace batchelor */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_COMPRESSION_H_
+#define BATCHELOR_SERVICE_COMPRESSION_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace batchelor {
+namespace service {
+
+/* gzip content encoding for large responses, like the task listing of GET /tasks,
+ * and for request bodies that are sent with "Content-Encoding: gzip" */
+class Compression final {
+public:
+	Compression() = delete;
+
+	static const std::string& getGzipEncoding();
+
+	/* responses smaller than this are not worth to get compressed */
+	static constexpr std::size_t minSize = 1024;
+
+	/* returns true if header "Accept-Encoding" contains "gzip" with a quality value greater than 0 */
+	static bool acceptsGzip(const std::map<std::string, std::string>& headers);
+
+	/* returns true if header "Content-Encoding" is "gzip" */
+	static bool isGzipEncoded(const std::map<std::string, std::string>& headers);
+
+	static std::string gzip(const std::string& data);
+
+	/* throws if the decompressed data would be larger than maxSize */
+	static std::string gunzip(const std::string& data, std::size_t maxSize = std::string::npos);
+};
+
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_COMPRESSION_H_ */
@@ -24,7 +24,11 @@
 #include <batchelor/service/schemas/TaskStatusHead.h>
 #include <batchelor/service/schemas/RunRequest.h>
 #include <batchelor/service/schemas/RunResponse.h>
+#include <batchelor/service/schemas/TaskOutput.h>
+#include <batchelor/service/TaskQuery.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -67,6 +71,11 @@ public:
 	 */
 	virtual std::vector<schemas::TaskStatusHead> getTasks(const std::string& namespaceId, const std::string& state, const std::string& eventNotAfter, const std::string& eventNotBefore) = 0;
 
+	/* This call is used by a web frontend to show a page of tasks.
+	 * Filters, sort order, offset and limit are applied by the head, so only one page is transferred.
+	 */
+	virtual std::vector<schemas::TaskStatusHead> queryTasks(const std::string& namespaceId, const TaskQuery& query) = 0;
+
 	/* This call is used by a controller-cli or a web frontend to get data of a specific task.
 	 * It is almost the same service as above, but now for a specific task id.
 	 */
@@ -75,11 +84,33 @@ public:
 	/* This call is used by a controller-cli or a web frontend */
 	virtual schemas::RunResponse runTask(const std::string& namespaceId, const schemas::RunRequest& runRequest) = 0;
 
+	/* This call is used by a controller-cli to submit many run requests at once.
+	 * The head processes all requests in one transaction and returns one response per request in the same order.
+	 */
+	virtual std::vector<schemas::RunResponse> runTasks(const std::string& namespaceId, const std::vector<schemas::RunRequest>& runRequests) = 0;
+
 	/* This call is used by a controller-cli or a web frontend to send a specific signal to a task or to cancel the task */
 	virtual void sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) = 0;
 
 	/* This call is used by a controller-cli or a web frontend to get a list of available event types */
 	virtual std::vector<std::string> getEventTypes(const std::string& namespaceId) = 0;
+
+	/* This call is used by a controller-cli or a web frontend to get informed about changed tasks instead of polling "getTask".
+	 * It returns the current status of all tasks matching "taskIds" (all tasks if empty) and "state" (all states if empty)
+	 * that have been changed after "eventId" and sets "eventId" to a value after the last change. "eventId" is opaque for the
+	 * caller and never 0 after the first call. If there is no such task, it waits up to "timeout" for a change.
+	 * If "eventId" is 0, the current status of all tasks in "taskIds" is returned immediately.
+	 * If events after "eventId" have been missed, e.g. after a restart of the head, the current status of all tasks in "taskIds"
+	 * is returned as well. Without "taskIds" it throws exception::StatusCode 410, so the caller has to reload the status of all tasks.
+	 * Endpoint "GET /watch/{namespaceId}" streams the result of repeated calls as server-sent events or NDJSON.
+	 */
+	virtual std::vector<schemas::TaskStatusHead> watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) = 0;
+
+	/* This call is used by a controller-cli or a web frontend to get the tail of stdout and stderr of a running task.
+	 * The head asks the worker for the output as long as this call is repeated, so the first call returns an empty output.
+	 * Returns nullptr if the task does not exist.
+	 */
+	virtual std::unique_ptr<schemas::TaskOutput> getTaskOutput(const std::string& namespaceId, const std::string& taskId) = 0;
 };
 
 } /* namespace service */
@@ -0,0 +1,78 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/TaskQuery.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <stdexcept>
+
+namespace batchelor {
+namespace service {
+
+namespace {
+const std::string sortByStrCreatedTS = "created";
+const std::string sortByStrTaskId = "task-id";
+const std::string sortByStrEventType = "event-type";
+const std::string sortByStrState = "state";
+const std::string sortByStrReturnCode = "return-code";
+}
+
+constexpr std::size_t TaskQuery::maxLimit;
+
+const std::string& TaskQuery::toString(SortBy sortBy) {
+	switch(sortBy) {
+	case SortBy::createdTS:
+		return sortByStrCreatedTS;
+	case SortBy::taskId:
+		return sortByStrTaskId;
+	case SortBy::eventType:
+		return sortByStrEventType;
+	case SortBy::state:
+		return sortByStrState;
+	case SortBy::returnCode:
+		return sortByStrReturnCode;
+	default:
+		break;
+	}
+	throw esl::system::Stacktrace::add(std::runtime_error("unknown sort column."));
+}
+
+TaskQuery::SortBy TaskQuery::toSortBy(const std::string& sortBy) {
+	if(sortBy == sortByStrCreatedTS) {
+		return SortBy::createdTS;
+	}
+	else if(sortBy == sortByStrTaskId) {
+		return SortBy::taskId;
+	}
+	else if(sortBy == sortByStrEventType) {
+		return SortBy::eventType;
+	}
+	else if(sortBy == sortByStrState) {
+		return SortBy::state;
+	}
+	else if(sortBy == sortByStrReturnCode) {
+		return SortBy::returnCode;
+	}
+
+	throw esl::system::Stacktrace::add(std::runtime_error("unknown sort column \"" + sortBy + "\"."));
+}
+
+} /* namespace service */
+} /* namespace batchelor */
@@ -0,0 +1,59 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_TASKQUERY_H_
+#define BATCHELOR_SERVICE_TASKQUERY_H_
+
+#include <cstddef>
+#include <string>
+
+namespace batchelor {
+namespace service {
+
+/* Filter, sort order and page of a "queryTasks" call. Empty strings mean "no filter". */
+struct TaskQuery {
+	enum class SortBy {
+		createdTS,
+		taskId,
+		eventType,
+		state,
+		returnCode
+	};
+
+	static constexpr std::size_t maxLimit = 1000;
+
+	static const std::string& toString(SortBy sortBy);
+	static SortBy toSortBy(const std::string& sortBy);
+
+	std::string state;
+	std::string eventType;
+	std::string eventNotAfter;
+	std::string eventNotBefore;
+
+	SortBy sortBy = SortBy::createdTS;
+	bool descending = true;
+
+	std::size_t offset = 0;
+	std::size_t limit = 100;
+};
+
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_TASKQUERY_H_ */
@@ -16,14 +16,18 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <batchelor/service/BinaryCodec.h>
 #include <batchelor/service/client/Service.h>
+#include <batchelor/service/Compression.h>
 #include <batchelor/service/Logger.h>
 #include <batchelor/service/schemas/Signal.h>
 
 #include <esl/com/http/client/Request.h>
 #include <esl/com/http/client/Response.h>
+#include <esl/com/http/server/exception/StatusCode.h>
 #include <esl/io/Input.h>
 #include <esl/io/input/String.h>
+#include <esl/io/Writer.h>
 #include <esl/io/Output.h>
 #include <esl/io/output/String.h>
 #include <esl/utility/String.h>
@@ -31,8 +35,10 @@
 #include <esl/utility/MIME.h>
 #include <esl/system/Stacktrace.h>
 
+#include <cctype>
 #include <map>
 #include <stdexcept>
+#include <thread>
 
 #include "sergut/JsonDeserializer.h"
 #include "sergut/XmlDeserializer.h"
@@ -45,6 +51,156 @@ namespace client {
 
 namespace {
 Logger logger("batchelor::service::client::Service");
+
+std::string urlEncode(const std::string& str) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	std::string rv;
+
+	for(unsigned char c : str) {
+		if(std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			rv += static_cast<char>(c);
+		}
+		else {
+			rv += '%';
+			rv += hexDigits[c >> 4];
+			rv += hexDigits[c & 0x0f];
+		}
+	}
+
+	return rv;
+}
+
+std::vector<schemas::TaskStatusHead> loadTasks(const esl::com::http::client::Connection& connection, const std::string& serviceUrl) {
+	std::vector<schemas::TaskStatusHead> tasks;
+
+    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
+    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
+    request.addHeader("Accept-Encoding", Compression::getGzipEncoding());
+
+	esl::io::input::String inputWriterString;
+	esl::io::Writer& inputWriter(inputWriterString);
+	esl::io::Input input(inputWriter);
+
+	esl::com::http::client::Response response = connection.send(std::move(request), esl::io::Output(), std::move(input));
+
+    if(response.getStatusCode() == 200) {
+    	std::string content;
+    	if(Compression::isGzipEncoded(response.getHeaders())) {
+    		content = Compression::gunzip(inputWriterString.getString());
+    	}
+    	const std::string& responseContent = content.empty() ? inputWriterString.getString() : content;
+
+        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
+        	if(!responseContent.empty()) {
+                sergut::JsonDeserializer deSerializer(responseContent);
+                tasks = deSerializer.deserializeData<std::vector<schemas::TaskStatusHead>>();
+        	}
+        }
+        else if(response.getContentType() == esl::utility::MIME::Type::applicationXml) {
+        	if(!responseContent.empty()) {
+                sergut::XmlDeserializer deSerializer(responseContent);
+                tasks = deSerializer.deserializeNestedData<std::vector<schemas::TaskStatusHead>>("tasks", "task");
+        	}
+        }
+        else {
+        	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported response content type \"" + response.getContentType().toString() + "\""));
+        }
+    }
+    else {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\""));
+    }
+
+    return tasks;
+}
+
+std::string makeWatchUrl(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t eventId) {
+	std::string serviceUrl = "watch/" + namespaceId;
+	std::string args;
+
+	if(!taskIds.empty()) {
+		args += args.empty() ? "?" : "&";
+		args += "taskIds=";
+		for(std::size_t i = 0; i < taskIds.size(); ++i) {
+			if(i > 0) {
+				args += ",";
+			}
+			args += urlEncode(taskIds[i]);
+		}
+	}
+	if(!state.empty()) {
+		args += args.empty() ? "?" : "&";
+		args += "state=" + urlEncode(state);
+	}
+	if(eventId > 0) {
+		args += args.empty() ? "?" : "&";
+		args += "after=" + std::to_string(eventId);
+	}
+
+	return serviceUrl + args;
+}
+
+/* Splits the NDJSON stream of "GET /watch/{namespaceId}" into lines while it is received.
+ * An empty line is a heartbeat of the head. */
+class WatchWriter : public esl::io::Writer {
+public:
+	WatchWriter(const std::function<bool(const schemas::TaskStatusHead*)>& aOnTask)
+	: onTask(aOnTask)
+	{ }
+
+	std::size_t write(const void* data, std::size_t size) override {
+		if(stopped) {
+			return esl::io::Writer::npos;
+		}
+		if(data == nullptr || size == 0) {
+			return esl::io::Writer::npos;
+		}
+
+		line.append(static_cast<const char*>(data), size);
+		std::size_t begin = 0;
+		for(std::size_t end = line.find('\n'); end != std::string::npos; end = line.find('\n', begin)) {
+			std::string content = esl::utility::String::trim(line.substr(begin, end - begin));
+			begin = end + 1;
+
+			if(content.empty()) {
+				stopped = !onTask(nullptr);
+			}
+			else if(content == "{\"resync\":true}") {
+				/* task events have been missed, so the caller has to reload the status of the tasks */
+				logger.debug << "Head requested to reload the status of the tasks\n";
+				stopped = true;
+			}
+			else if(content[0] != '{') {
+				/* body of an error response, e.g. status 503 */
+				continue;
+			}
+			else {
+				sergut::JsonDeserializer deSerializer(content);
+				schemas::TaskStatusHead taskStatus = deSerializer.deserializeData<schemas::TaskStatusHead>();
+				stopped = !onTask(&taskStatus);
+			}
+
+			if(stopped) {
+				return esl::io::Writer::npos;
+			}
+		}
+		line.erase(0, begin);
+
+		return size;
+	}
+
+	std::size_t getSizeWritable() const override {
+		return stopped ? 0 : esl::io::Writer::npos;
+	}
+
+	bool isStopped() const noexcept {
+		return stopped;
+	}
+
+private:
+	const std::function<bool(const schemas::TaskStatusHead*)>& onTask;
+	std::string line;
+	bool stopped = false;
+};
 }
 
 Service::Service(const esl::com::http::client::Connection& aConnection)
@@ -62,12 +218,19 @@ schemas::FetchResponse Service::fetchTask(const std::string& namespaceId, const
 	schemas::FetchResponse fetchResponse;
 
 	const std::string serviceUrl = "fetch-task/" + namespaceId;
-    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpPost, esl::utility::MIME::Type::applicationJson);
-    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
+    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpPost, binaryProtocol ? esl::utility::MIME(BinaryCodec::getMIME()) : esl::utility::MIME(esl::utility::MIME::Type::applicationJson));
+    request.addHeader("Accept", BinaryCodec::getMIME() + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
 
-    sergut::JsonSerializer serializer;
-    serializer.serializeData(fetchRequest);
-    esl::io::Output output(esl::io::output::String::create(serializer.str()));
+    std::string requestContent;
+    if(binaryProtocol) {
+    	requestContent = BinaryCodec::encode(fetchRequest);
+    }
+    else {
+        sergut::JsonSerializer serializer;
+        serializer.serializeData(fetchRequest);
+        requestContent = serializer.str();
+    }
+    esl::io::Output output(esl::io::output::String::create(std::move(requestContent)));
 
 	esl::io::input::String consumerString;
 	esl::io::Input input(static_cast<esl::io::Writer&>(consumerString));
@@ -75,7 +238,11 @@ schemas::FetchResponse Service::fetchTask(const std::string& namespaceId, const
 	esl::com::http::client::Response response = connection.send(std::move(request), std::move(output), std::move(input));
 
     if(response.getStatusCode() == 200) {
-        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
+        if(response.getContentType().toString() == BinaryCodec::getMIME()) {
+        	fetchResponse = BinaryCodec::decodeFetchResponse(consumerString.getString());
+        	binaryProtocol = true;
+        }
+        else if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
         	if(!consumerString.getString().empty()) {
                 sergut::JsonDeserializer deSerializer(consumerString.getString());
                 fetchResponse = deSerializer.deserializeData<schemas::FetchResponse>();
@@ -99,8 +266,6 @@ schemas::FetchResponse Service::fetchTask(const std::string& namespaceId, const
 }
 
 std::vector<schemas::TaskStatusHead> Service::getTasks(const std::string& namespaceId, const std::string& state, const std::string& eventNotAfter, const std::string& eventNotBefore) {
-	std::vector<schemas::TaskStatusHead> tasks;
-
 	std::string serviceUrl = "tasks/" + namespaceId;
 	{
 		std::string args;
@@ -113,7 +278,7 @@ std::vector<schemas::TaskStatusHead> Service::getTasks(const std::string& namesp
 			args += args.empty() ? "?" : "&";
 			args += "nafter=" + eventNotAfter;
 		}
-		if(eventNotBefore.empty()) {
+		if(!eventNotBefore.empty()) {
 			args += args.empty() ? "?" : "&";
 			args += "nbefore=" + eventNotBefore;
 		}
@@ -121,37 +286,30 @@ std::vector<schemas::TaskStatusHead> Service::getTasks(const std::string& namesp
 		serviceUrl += args;
 	}
 
-    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
-    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
-
-	esl::io::input::String inputWriterString;
-	esl::io::Writer& inputWriter(inputWriterString);
-	esl::io::Input input(inputWriter);
+	return loadTasks(connection, serviceUrl);
+}
 
-	esl::com::http::client::Response response = connection.send(std::move(request), esl::io::Output(), std::move(input));
+std::vector<schemas::TaskStatusHead> Service::queryTasks(const std::string& namespaceId, const TaskQuery& query) {
+	std::string serviceUrl = "tasks/" + namespaceId
+			+ "?sort=" + TaskQuery::toString(query.sortBy)
+			+ "&order=" + (query.descending ? "desc" : "asc")
+			+ "&offset=" + std::to_string(query.offset)
+			+ "&limit=" + std::to_string(query.limit);
 
-    if(response.getStatusCode() == 200) {
-        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
-        	if(!inputWriterString.getString().empty()) {
-                sergut::JsonDeserializer deSerializer(inputWriterString.getString());
-                tasks = deSerializer.deserializeData<std::vector<schemas::TaskStatusHead>>();
-        	}
-        }
-        else if(response.getContentType() == esl::utility::MIME::Type::applicationXml) {
-        	if(!inputWriterString.getString().empty()) {
-                sergut::XmlDeserializer deSerializer(inputWriterString.getString());
-                tasks = deSerializer.deserializeNestedData<std::vector<schemas::TaskStatusHead>>("tasks", "task");
-        	}
-        }
-        else {
-        	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported response content type \"" + response.getContentType().toString() + "\""));
-        }
-    }
-    else {
-    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\""));
-    }
+	if(!query.state.empty()) {
+		serviceUrl += "&state=" + urlEncode(query.state);
+	}
+	if(!query.eventType.empty()) {
+		serviceUrl += "&eventType=" + urlEncode(query.eventType);
+	}
+	if(!query.eventNotAfter.empty()) {
+		serviceUrl += "&nafter=" + urlEncode(query.eventNotAfter);
+	}
+	if(!query.eventNotBefore.empty()) {
+		serviceUrl += "&nbefore=" + urlEncode(query.eventNotBefore);
+	}
 
-    return tasks;
+	return loadTasks(connection, serviceUrl);
 }
 
 std::unique_ptr<schemas::TaskStatusHead> Service::getTask(const std::string& namespaceId, const std::string& taskId) {
@@ -246,6 +404,63 @@ schemas::RunResponse Service::runTask(const std::string& namespaceId, const sche
     return runResponse;
 }
 
+std::vector<schemas::RunResponse> Service::runTasks(const std::string& namespaceId, const std::vector<schemas::RunRequest>& runRequests) {
+	std::vector<schemas::RunResponse> runResponses;
+
+	const std::string serviceUrl = "tasks/" + namespaceId + "/batch";
+    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpPost, esl::utility::MIME("application/x-ndjson"));
+    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
+    request.addHeader("Accept-Encoding", Compression::getGzipEncoding());
+
+    /* one JSON document per line, so the head does not need to parse one big array */
+    std::string requestContent;
+    for(const auto& runRequest : runRequests) {
+        sergut::JsonSerializer serializer;
+        serializer.serializeData(runRequest);
+        requestContent += serializer.str();
+        requestContent += '\n';
+    }
+    esl::io::Output output(esl::io::output::String::create(std::move(requestContent)));
+
+	esl::io::input::String consumerString;
+	esl::io::Input input(static_cast<esl::io::Writer&>(consumerString));
+
+	esl::com::http::client::Response response = connection.send(std::move(request), std::move(output), std::move(input));
+
+    if(response.getStatusCode() == 200) {
+    	std::string content;
+    	if(Compression::isGzipEncoded(response.getHeaders())) {
+    		content = Compression::gunzip(consumerString.getString());
+    	}
+    	const std::string& responseContent = content.empty() ? consumerString.getString() : content;
+
+        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
+        	if(!responseContent.empty()) {
+                sergut::JsonDeserializer deSerializer(responseContent);
+                runResponses = deSerializer.deserializeData<std::vector<schemas::RunResponse>>();
+        	}
+        }
+        else if(response.getContentType() == esl::utility::MIME::Type::applicationXml) {
+        	if(!responseContent.empty()) {
+                sergut::XmlDeserializer deSerializer(responseContent);
+                runResponses = deSerializer.deserializeNestedData<std::vector<schemas::RunResponse>>("runResponses", "runResponse");
+        	}
+        }
+        else {
+        	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported response content type \"" + response.getContentType().toString() + "\""));
+        }
+    }
+    else {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\"\ncontent type: \"" + response.getContentType().toString() + "\"\ncontent: \"" + consumerString.getString() + "\""));
+    }
+
+    if(runResponses.size() != runRequests.size()) {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Received " + std::to_string(runResponses.size()) + " run responses for " + std::to_string(runRequests.size()) + " run requests"));
+    }
+
+    return runResponses;
+}
+
 void Service::sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) {
     const std::string serviceUrl = "signal/" + namespaceId + "/" + taskId + "/" + signal;
 
@@ -297,6 +512,139 @@ std::vector<std::string> Service::getEventTypes(const std::string& namespaceId)
     return eventTypes;
 }
 
+std::vector<schemas::TaskStatusHead> Service::watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) {
+	std::vector<schemas::TaskStatusHead> tasks;
+
+	std::string serviceUrl = makeWatchUrl(namespaceId, taskIds, state, eventId);
+	serviceUrl += serviceUrl.find('?') == std::string::npos ? "?" : "&";
+	serviceUrl += "timeout=" + std::to_string(timeout.count());
+
+    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
+    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson));
+    request.addHeader("Accept-Encoding", Compression::getGzipEncoding());
+
+	esl::io::input::String consumerString;
+	esl::io::Input input(static_cast<esl::io::Writer&>(consumerString));
+
+	esl::com::http::client::Response response = connection.send(std::move(request), esl::io::Output(), std::move(input));
+
+    if(response.getStatusCode() == 200) {
+    	std::string content;
+    	if(Compression::isGzipEncoded(response.getHeaders())) {
+    		content = Compression::gunzip(consumerString.getString());
+    	}
+    	const std::string& responseContent = content.empty() ? consumerString.getString() : content;
+
+        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
+        	if(!responseContent.empty()) {
+                sergut::JsonDeserializer deSerializer(responseContent);
+                tasks = deSerializer.deserializeData<std::vector<schemas::TaskStatusHead>>();
+        	}
+        }
+        else {
+        	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported response content type \"" + response.getContentType().toString() + "\""));
+        }
+
+        for(const auto& header : response.getHeaders()) {
+        	if(esl::utility::String::toLower(header.first) == "batchelor-event-id") {
+        		eventId = std::stoull(header.second);
+        	}
+        }
+    }
+    else if(response.getStatusCode() == 410) {
+    	throw esl::com::http::server::exception::StatusCode(410, esl::utility::MIME::Type::textPlain, "task events have been missed, reload the status of the tasks");
+    }
+    else if(response.getStatusCode() == 503) {
+    	/* the head has too many watchers, so this long poll just waits without the head */
+    	logger.debug << "Head has too many watchers\n";
+    	std::this_thread::sleep_for(timeout);
+    }
+    else {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\""));
+    }
+
+    return tasks;
+}
+
+bool Service::streamTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t eventId, const std::function<bool(const schemas::TaskStatusHead*)>& onTask) {
+    esl::com::http::client::Request request(makeWatchUrl(namespaceId, taskIds, state, eventId), esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
+    request.addHeader("Accept", "application/x-ndjson");
+
+	WatchWriter watchWriter(onTask);
+	esl::io::Input input(static_cast<esl::io::Writer&>(watchWriter));
+
+	try {
+		esl::com::http::client::Response response = connection.send(std::move(request), esl::io::Output(), std::move(input));
+	    if(response.getStatusCode() == 503) {
+	    	logger.debug << "Head has too many watchers\n";
+	    	return false;
+	    }
+	    if(response.getStatusCode() == 410) {
+	    	logger.debug << "Head requested to reload the status of the tasks\n";
+	    	return true;
+	    }
+	    if(response.getStatusCode() != 200) {
+	    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\""));
+	    }
+	}
+	catch(...) {
+		/* aborting the transfer from the writer is reported as error by the connection */
+		if(watchWriter.isStopped()) {
+			return true;
+		}
+		throw;
+	}
+
+	return true;
+}
+
+std::unique_ptr<schemas::TaskOutput> Service::getTaskOutput(const std::string& namespaceId, const std::string& taskId) {
+	std::unique_ptr<schemas::TaskOutput> output;
+
+	std::string serviceUrl = "task-output/" + namespaceId + "/" + taskId;
+    esl::com::http::client::Request request(serviceUrl, esl::utility::HttpMethod::Type::httpGet, esl::utility::MIME::Type::applicationJson);
+    request.addHeader("Accept", esl::utility::MIME::toString(esl::utility::MIME::Type::applicationJson) + "," + esl::utility::MIME::toString(esl::utility::MIME::Type::applicationXml));
+    request.addHeader("Accept-Encoding", Compression::getGzipEncoding());
+
+	esl::io::input::String consumerString;
+	esl::io::Input input(static_cast<esl::io::Writer&>(consumerString));
+
+	esl::com::http::client::Response response = connection.send(std::move(request), esl::io::Output(), std::move(input));
+
+    if(response.getStatusCode() == 200) {
+    	std::string content;
+    	if(Compression::isGzipEncoded(response.getHeaders())) {
+    		content = Compression::gunzip(consumerString.getString());
+    	}
+    	const std::string& responseContent = content.empty() ? consumerString.getString() : content;
+
+        if(response.getContentType() == esl::utility::MIME::Type::applicationJson) {
+        	if(!responseContent.empty()) {
+        		output.reset(new schemas::TaskOutput);
+                sergut::JsonDeserializer deSerializer(responseContent);
+                *output = deSerializer.deserializeData<schemas::TaskOutput>();
+        	}
+        }
+        else if(response.getContentType() == esl::utility::MIME::Type::applicationXml) {
+        	if(!responseContent.empty()) {
+        		output.reset(new schemas::TaskOutput);
+                sergut::XmlDeserializer deSerializer(responseContent);
+                *output = deSerializer.deserializeData<schemas::TaskOutput>("output");
+        	}
+        }
+        else {
+        	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported response content type \"" + response.getContentType().toString() + "\""));
+        }
+    }
+    else if(response.getStatusCode() == 404) {
+    }
+    else {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Received not supported status code \"" + std::to_string(response.getStatusCode()) + "\""));
+    }
+
+    return output;
+}
+
 } /* namespace client */
 } /* namespace service */
 } /* namespace batchelor */
@@ -26,9 +26,13 @@
 #include <batchelor/service/schemas/RunRequest.h>
 #include <batchelor/service/schemas/RunResponse.h>
 #include <batchelor/service/schemas/Signal.h>
+#include <batchelor/service/schemas/TaskOutput.h>
 
 #include <esl/com/http/client/Connection.h>
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -49,19 +53,45 @@ public:
 	// used by controller-cli
 	std::vector<schemas::TaskStatusHead> getTasks(const std::string& namespaceId, const std::string& state, const std::string& eventNotAfter, const std::string& eventNotBefore) override;
 
+	// used by web frontend
+	std::vector<schemas::TaskStatusHead> queryTasks(const std::string& namespaceId, const TaskQuery& query) override;
+
 	// used by controller-cli
 	std::unique_ptr<schemas::TaskStatusHead> getTask(const std::string& namespaceId, const std::string& taskId) override;
 
 	// used by controller-cli
 	schemas::RunResponse runTask(const std::string& namespaceId, const schemas::RunRequest& runRequest) override;
+	std::vector<schemas::RunResponse> runTasks(const std::string& namespaceId, const std::vector<schemas::RunRequest>& runRequests) override;
 
 	// used by controller-cli
 	void sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) override;
 
 	std::vector<std::string> getEventTypes(const std::string& namespaceId) override;
 
+	/* If the head has too many watchers (status 503), it waits for "timeout" and returns without changes like a long poll.
+	 * Status 410 of the head is thrown as exception::StatusCode 410, so a web frontend can pass it on to its watchers. */
+	// used by web frontend
+	std::vector<schemas::TaskStatusHead> watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) override;
+
+	/* Keeps one connection open to receive changed tasks as they happen, see "watchTasks".
+	 * If "eventId" is not 0, the stream starts with the changes after this event instead of the current status of "taskIds".
+	 * "onTask" is called with the status of a changed task or with nullptr as heartbeat if there was no change for a while.
+	 * Returns true if "onTask" returns false or if the head has closed the connection. The head closes it as well if task events
+	 * have been missed, so after reconnecting the caller has to reload the status of the tasks, see "watchTasks".
+	 * Returns false without calling "onTask" if the head has too many watchers (status 503), so the caller should back off and poll.
+	 */
+	// used by controller-cli
+	bool streamTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t eventId, const std::function<bool(const schemas::TaskStatusHead*)>& onTask);
+
+	// used by controller-cli
+	std::unique_ptr<schemas::TaskOutput> getTaskOutput(const std::string& namespaceId, const std::string& taskId) override;
+
 private:
     const esl::com::http::client::Connection& connection;
+
+    /* set to true after the head answered a fetch request with the binary encoding.
+     * Following fetch requests are sent binary encoded as well. */
+    bool binaryProtocol = false;
 };
 
 } /* namespace client */
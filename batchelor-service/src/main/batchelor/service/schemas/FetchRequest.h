@@ -20,6 +20,7 @@
 #define BATCHELOR_SERVICE_SCHEMAS_FETCHREQUEST_H_
 
 #include <batchelor/service/schemas/EventTypeAvailable.h>
+#include <batchelor/service/schemas/TaskOutput.h>
 #include <batchelor/service/schemas/TaskStatusWorker.h>
 #include <batchelor/service/schemas/Setting.h>
 
@@ -44,6 +45,7 @@ struct FetchRequest {
 	/* Metrics contains all metric variables and their values. These are built-in variables, like
 	 * - cpu usage               (CPU_USAGE),
 	 * - memory usage            (MEM_USAGE),
+	 * - load average            (LOAD_AVG_1, LOAD_AVG_5, LOAD_AVG_15),
 	 * - number of running tasks (TASKS_RUNNING),
 	 * - host name               (HOST_NAME)
 	 * But there are also user defined variables, like
@@ -55,13 +57,26 @@ struct FetchRequest {
 	std::vector<Setting> metrics;
 
 	std::vector<TaskStatusWorker> tasks;
+
+	/* Delta heartbeats: If "sessionId" is set and "baseEpoch" is not 0, then "metrics" and "tasks" contain only entries
+	 * that have changed since the snapshot the head acknowledged with "FetchResponse::epoch" equal to "baseEpoch".
+	 * Missing entries are taken from this snapshot by the head. If "baseEpoch" is 0 the request contains a full snapshot.
+	 */
+	std::string sessionId;
+	int baseEpoch = 0;
+
+	/* Output of the tasks the head asked for by "FetchResponse::tailRequests" with the previous response. */
+	std::vector<TaskOutput> outputs;
 };
 
 SERGUT_FUNCTION(FetchRequest, data, ar) {
     ar & SERGUT_MMEMBER(data, workerId)
        & SERGUT_NESTED_MMEMBER(data, eventTypes, eventTypes)
        & SERGUT_NESTED_MMEMBER(data, metrics, metric)
-       & SERGUT_NESTED_MMEMBER(data, tasks, tasks);
+       & SERGUT_NESTED_MMEMBER(data, tasks, tasks)
+       & SERGUT_OMEMBER(data, sessionId)
+       & SERGUT_OMEMBER(data, baseEpoch)
+       & SERGUT_NESTED_OMEMBER(data, outputs, output);
 }
 
 } /* namespace schemas */
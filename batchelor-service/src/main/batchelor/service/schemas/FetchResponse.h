@@ -24,6 +24,7 @@
 
 #include "sergut/Util.h"
 
+#include <string>
 #include <vector>
 
 namespace batchelor {
@@ -35,11 +36,31 @@ struct FetchResponse {
 
 	// only 0 or 1 runConfigurations.
 	std::vector<RunConfiguration> runConfigurations;
+
+	/* Epoch of the snapshot the head stored for the session of the fetch request. The worker uses it as "baseEpoch"
+	 * for the next delta. Value 0 means that the head has no snapshot and expects a full snapshot with the next request.
+	 */
+	int epoch = 0;
+
+	/* Number of queued tasks that are left for the available event types of the worker. */
+	int queueDepth = 0;
+
+	/* Delay in milliseconds the head suggests until the next fetch request. Value 0 means the worker should fetch
+	 * again immediately, because there are more queued tasks. A negative value means there is no suggestion.
+	 */
+	int nextPollMs = -1;
+
+	/* Task ids of running tasks someone is watching the output of. The worker sends their output with the next fetch request. */
+	std::vector<std::string> tailRequests;
 };
 
 SERGUT_FUNCTION(FetchResponse, data, ar) {
     ar & SERGUT_NESTED_MMEMBER(data, signals, signals)
-       & SERGUT_NESTED_MMEMBER(data, runConfigurations, runConfigurations);
+       & SERGUT_NESTED_MMEMBER(data, runConfigurations, runConfigurations)
+       & SERGUT_OMEMBER(data, epoch)
+       & SERGUT_OMEMBER(data, queueDepth)
+       & SERGUT_OMEMBER(data, nextPollMs)
+       & SERGUT_NESTED_OMEMBER(data, tailRequests, taskId);
 }
 
 } /* namespace schemas */
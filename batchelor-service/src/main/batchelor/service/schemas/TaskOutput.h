@@ -0,0 +1,48 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_SCHEMAS_TASKOUTPUT_H_
+#define BATCHELOR_SERVICE_SCHEMAS_TASKOUTPUT_H_
+
+#include "sergut/Util.h"
+
+#include <string>
+
+namespace batchelor {
+namespace service {
+namespace schemas {
+
+/* Tail of stdout and stderr of a running task, as far as the worker keeps it in memory */
+struct TaskOutput {
+	std::string taskId;
+	std::string out;
+	std::string err;
+};
+
+SERGUT_FUNCTION(TaskOutput, data, ar) {
+    ar & SERGUT_MMEMBER(data, taskId)
+       & SERGUT_MMEMBER(data, out)
+       & SERGUT_MMEMBER(data, err);
+}
+
+} /* namespace schemas */
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_SCHEMAS_TASKOUTPUT_H_ */
@@ -0,0 +1,270 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/server/MetricRegistry.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+namespace {
+std::size_t getShard() noexcept {
+	static std::atomic<std::size_t> nextShard{0};
+	thread_local const std::size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % MetricRegistry::shardCount;
+	return shard;
+}
+
+std::string formatValue(double value) {
+	if(std::isinf(value)) {
+		return value > 0 ? "+Inf" : "-Inf";
+	}
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+	return buffer;
+}
+
+void appendEscaped(std::string& str, const std::string& value) {
+	for(char c : value) {
+		switch(c) {
+		case '\\':
+			str += "\\\\";
+			break;
+		case '"':
+			str += "\\\"";
+			break;
+		case '\n':
+			str += "\\n";
+			break;
+		default:
+			str += c;
+			break;
+		}
+	}
+}
+
+/* labels without braces, so label "le" can be appended for buckets of histograms */
+std::string formatLabels(const MetricRegistry::Labels& labels) {
+	std::string str;
+	for(const auto& label : labels) {
+		if(!str.empty()) {
+			str += ',';
+		}
+		str += label.first;
+		str += "=\"";
+		appendEscaped(str, label.second);
+		str += '"';
+	}
+	return str;
+}
+
+void appendLine(std::string& str, const std::string& name, const std::string& labels, const std::string& value) {
+	str += name;
+	if(!labels.empty()) {
+		str += '{';
+		str += labels;
+		str += '}';
+	}
+	str += ' ';
+	str += value;
+	str += '\n';
+}
+
+std::vector<std::int64_t> toNanoseconds(const std::vector<double>& bounds) {
+	std::vector<std::int64_t> boundsNs;
+	for(double bound : bounds) {
+		if(!boundsNs.empty() && bound * 1e9 <= boundsNs.back()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Bounds of histogram are not in ascending order."));
+		}
+		boundsNs.push_back(static_cast<std::int64_t>(bound * 1e9));
+	}
+	return boundsNs;
+}
+} /* anonymous namespace */
+
+constexpr std::size_t MetricRegistry::shardCount;
+
+void MetricRegistry::Counter::add(std::uint64_t value) noexcept {
+	shards[getShard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+std::uint64_t MetricRegistry::Counter::get() const noexcept {
+	std::uint64_t value = 0;
+	for(const auto& shard : shards) {
+		value += shard.value.load(std::memory_order_relaxed);
+	}
+	return value;
+}
+
+MetricRegistry::Histogram::Histogram(std::vector<double> aBounds)
+: boundsNs(toNanoseconds(aBounds)),
+  bounds(std::move(aBounds)),
+  blocksPerShard((bounds.size() + 2 + 7) / 8),
+  blocks(new Block[shardCount * blocksPerShard]())
+{ }
+
+void MetricRegistry::Histogram::observe(std::chrono::nanoseconds duration) noexcept {
+	std::int64_t durationNs = duration.count() < 0 ? 0 : duration.count();
+	std::size_t bucket = std::lower_bound(boundsNs.begin(), boundsNs.end(), durationNs) - boundsNs.begin();
+	std::size_t shard = getShard();
+
+	getValue(shard, bucket).fetch_add(1, std::memory_order_relaxed);
+	getValue(shard, bounds.size() + 1).fetch_add(static_cast<std::uint64_t>(durationNs), std::memory_order_relaxed);
+}
+
+const std::vector<double>& MetricRegistry::Histogram::getBounds() const noexcept {
+	return bounds;
+}
+
+std::vector<std::uint64_t> MetricRegistry::Histogram::getCounts() const {
+	std::vector<std::uint64_t> counts(bounds.size() + 1, 0);
+	for(std::size_t shard = 0; shard < shardCount; ++shard) {
+		for(std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+			counts[bucket] += getValue(shard, bucket).load(std::memory_order_relaxed);
+		}
+	}
+	return counts;
+}
+
+std::chrono::nanoseconds MetricRegistry::Histogram::getSum() const noexcept {
+	std::uint64_t sum = 0;
+	for(std::size_t shard = 0; shard < shardCount; ++shard) {
+		sum += getValue(shard, bounds.size() + 1).load(std::memory_order_relaxed);
+	}
+	return std::chrono::nanoseconds(static_cast<std::int64_t>(sum));
+}
+
+std::atomic<std::uint64_t>& MetricRegistry::Histogram::getValue(std::size_t shard, std::size_t index) const noexcept {
+	return blocks[shard * blocksPerShard + index / 8].values[index % 8];
+}
+
+MetricRegistry::Timer::Timer(Histogram* aHistogram) noexcept
+: histogram(aHistogram),
+  startTS(histogram ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+{ }
+
+MetricRegistry::Timer::~Timer() {
+	if(histogram) {
+		histogram->observe(std::chrono::steady_clock::now() - startTS);
+	}
+}
+
+const std::vector<double>& MetricRegistry::getDefaultBounds() {
+	static const std::vector<double> bounds{0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+	return bounds;
+}
+
+MetricRegistry::Counter& MetricRegistry::addCounter(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unique_ptr<Counter>& counter = getFamily(name, help, "counter").counters[formatLabels(labels)];
+	if(!counter) {
+		counter.reset(new Counter);
+	}
+	return *counter;
+}
+
+MetricRegistry::Histogram& MetricRegistry::addHistogram(const std::string& name, const std::string& help, const Labels& labels, const std::vector<double>& bounds) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unique_ptr<Histogram>& histogram = getFamily(name, help, "histogram").histograms[formatLabels(labels)];
+	if(!histogram) {
+		histogram.reset(new Histogram(bounds));
+	}
+	return *histogram;
+}
+
+void MetricRegistry::addCollector(std::function<void(std::string&)> collector) {
+	std::lock_guard<std::mutex> lock(mutex);
+	collectors.push_back(std::move(collector));
+}
+
+std::string MetricRegistry::toString() const {
+	std::string str;
+	std::vector<std::function<void(std::string&)>> currentCollectors;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(const auto& family : families) {
+			const std::string& name = family.first;
+			appendHeader(str, name, family.second.help, family.second.type);
+
+			for(const auto& counter : family.second.counters) {
+				appendLine(str, name, counter.first, std::to_string(counter.second->get()));
+			}
+
+			for(const auto& histogram : family.second.histograms) {
+				const std::string& labels = histogram.first;
+				const std::vector<double>& bounds = histogram.second->getBounds();
+				std::vector<std::uint64_t> counts = histogram.second->getCounts();
+
+				/* buckets are cumulative and "_count" is taken from the buckets, so both are consistent */
+				std::uint64_t count = 0;
+				for(std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+					count += counts[bucket];
+					std::string le = "le=\"" + (bucket < bounds.size() ? formatValue(bounds[bucket]) : std::string("+Inf")) + "\"";
+					appendLine(str, name + "_bucket", labels.empty() ? le : labels + "," + le, std::to_string(count));
+				}
+				appendLine(str, name + "_sum", labels, formatValue(std::chrono::duration<double>(histogram.second->getSum()).count()));
+				appendLine(str, name + "_count", labels, std::to_string(count));
+			}
+		}
+
+		currentCollectors = collectors;
+	}
+
+	/* called without lock, so collectors are allowed to register metrics */
+	for(const auto& collector : currentCollectors) {
+		collector(str);
+	}
+
+	return str;
+}
+
+void MetricRegistry::appendHeader(std::string& str, const std::string& name, const std::string& help, const std::string& type) {
+	str += "# HELP " + name + " " + help + "\n";
+	str += "# TYPE " + name + " " + type + "\n";
+}
+
+void MetricRegistry::appendSample(std::string& str, const std::string& name, const Labels& labels, double value) {
+	appendLine(str, name, formatLabels(labels), formatValue(value));
+}
+
+MetricRegistry::Family& MetricRegistry::getFamily(const std::string& name, const std::string& help, const std::string& type) {
+	Family& family = families[name];
+	if(family.type.empty()) {
+		family.help = help;
+		family.type = type;
+	}
+	else if(family.type != type) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Metric \"" + name + "\" has already been registered as " + family.type + "."));
+	}
+	return family;
+}
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
@@ -0,0 +1,143 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_SERVER_METRICREGISTRY_H_
+#define BATCHELOR_SERVICE_SERVER_METRICREGISTRY_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+/* Counters and histograms that are exported in the text format of Prometheus.
+ * Metrics are registered once, e.g. in a constructor, and the returned references are used on the hot path.
+ * Updates are lock-free: every thread writes to its own shard of relaxed atomics and shards are summed up on export only.
+ * Values that are read from elsewhere on export, e.g. from the database, are written by collectors.
+ */
+class MetricRegistry {
+public:
+	using Labels = std::vector<std::pair<std::string, std::string>>;
+
+	/* number of shards per counter and histogram, threads are assigned round robin */
+	static constexpr std::size_t shardCount = 16;
+
+	class Counter {
+	public:
+		void add(std::uint64_t value = 1) noexcept;
+		std::uint64_t get() const noexcept;
+
+	private:
+		struct alignas(64) Shard {
+			std::atomic<std::uint64_t> value{0};
+		};
+		std::array<Shard, shardCount> shards;
+	};
+
+	class Histogram {
+	public:
+		/* "bounds" are the upper bounds of the buckets in seconds in ascending order, bucket "+Inf" is added implicitly */
+		explicit Histogram(std::vector<double> bounds);
+
+		void observe(std::chrono::nanoseconds duration) noexcept;
+
+		const std::vector<double>& getBounds() const noexcept;
+
+		/* number of observations per bucket, not cumulative, the last one is bucket "+Inf" */
+		std::vector<std::uint64_t> getCounts() const;
+
+		std::chrono::nanoseconds getSum() const noexcept;
+
+	private:
+		struct alignas(64) Block {
+			std::array<std::atomic<std::uint64_t>, 8> values;
+		};
+
+		const std::vector<std::int64_t> boundsNs;
+		const std::vector<double> bounds;
+
+		/* per shard the counts of all buckets followed by the sum of nanoseconds */
+		const std::size_t blocksPerShard;
+		std::unique_ptr<Block[]> blocks;
+
+		std::atomic<std::uint64_t>& getValue(std::size_t shard, std::size_t index) const noexcept;
+	};
+
+	/* Measures the time from construction to destruction. Nothing is measured if "histogram" is nullptr. */
+	class Timer {
+	public:
+		explicit Timer(Histogram* histogram) noexcept;
+		Timer(const Timer&) = delete;
+		~Timer();
+
+		Timer& operator=(const Timer&) = delete;
+
+	private:
+		Histogram* histogram;
+		std::chrono::steady_clock::time_point startTS;
+	};
+
+	/* 0.5ms to 10s, suitable for requests and statements */
+	static const std::vector<double>& getDefaultBounds();
+
+	/* Returns the existing metric if name and labels have been registered before. */
+	Counter& addCounter(const std::string& name, const std::string& help, const Labels& labels = {});
+	Histogram& addHistogram(const std::string& name, const std::string& help, const Labels& labels = {}, const std::vector<double>& bounds = getDefaultBounds());
+
+	/* Collectors are called on every export and append complete metric families, see appendHeader and appendSample. */
+	void addCollector(std::function<void(std::string&)> collector);
+
+	std::string toString() const;
+
+	static void appendHeader(std::string& str, const std::string& name, const std::string& help, const std::string& type);
+	static void appendSample(std::string& str, const std::string& name, const Labels& labels, double value);
+
+private:
+	struct Family {
+		std::string help;
+		std::string type;
+
+		// metrics by formatted labels
+		std::map<std::string, std::unique_ptr<Counter>> counters;
+		std::map<std::string, std::unique_ptr<Histogram>> histograms;
+	};
+
+	mutable std::mutex mutex;
+	std::map<std::string, Family> families;
+	std::vector<std::function<void(std::string&)>> collectors;
+
+	Family& getFamily(const std::string& name, const std::string& help, const std::string& type);
+};
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_SERVER_METRICREGISTRY_H_ */
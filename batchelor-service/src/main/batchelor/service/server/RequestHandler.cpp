@@ -16,14 +16,21 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <batchelor/service/BinaryCodec.h>
+#include <batchelor/service/Compression.h>
 #include <batchelor/service/Logger.h>
+#include <batchelor/service/server/MetricRegistry.h>
 #include <batchelor/service/server/RequestHandler.h>
+#include <batchelor/service/server/ResponseCache.h>
+#include <batchelor/service/server/WatchReader.h>
 
 #include <esl/com/http/server/exception/StatusCode.h>
 #include <esl/com/http/server/Response.h>
-#include <esl/io/input/String.h>
+#include <esl/io/Output.h>
+#include <esl/io/Writer.h>
 #include <esl/io/output/Memory.h>
 #include <esl/io/output/String.h>
+#include <esl/io/Reader.h>
 #include <esl/utility/HttpMethod.h>
 #include <esl/utility/MIME.h>
 #include <esl/utility/String.h>
@@ -33,8 +40,17 @@
 #include "sergut/JsonSerializer.h"
 #include "sergut/XmlSerializer.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace batchelor {
@@ -45,6 +61,39 @@ Logger logger("batchelor::service::server::RequestHandler");
 
 const std::string emptyResponse = "{}";
 
+/* Content type of a request body with one JSON document per line */
+const std::string ndjsonMIME = "application/x-ndjson";
+
+/* Content type of server-sent events */
+const std::string sseMIME = "text/event-stream";
+
+/* Upper limit for a single long poll of "GET /watch/{namespaceId}" */
+constexpr std::chrono::milliseconds maxWatchTimeout(60000);
+
+/* Upper limit for preallocating the request body from the "Content-Length" header.
+ * Larger bodies are still accepted, they just grow the buffer on demand. */
+constexpr std::size_t maxContentLengthReserve = 16 * 1024 * 1024;
+
+/* Upper limit for a request body with "Content-Encoding: gzip" after decompression */
+constexpr std::size_t maxGunzipSize = 64 * 1024 * 1024;
+
+std::size_t exctractContentLength(const std::map<std::string, std::string>& headers) {
+    for(const auto& entry : headers) {
+    	if(esl::utility::String::toLower(entry.first) != "content-length") {
+    		continue;
+    	}
+
+    	char* end = nullptr;
+    	unsigned long long contentLength = std::strtoull(entry.second.c_str(), &end, 10);
+    	if(end == entry.second.c_str() || contentLength > maxContentLengthReserve) {
+    		return 0;
+    	}
+    	return static_cast<std::size_t>(contentLength);
+    }
+
+	return 0;
+}
+
 std::vector<std::string> exctractAccepts(const std::map<std::string, std::string>& headers) {
 	std::vector<std::string> accepts;
 
@@ -79,42 +128,134 @@ std::vector<esl::utility::MIME> exctractAcceptMIMEs(const std::map<std::string,
 }
 
 
-class InputHandler : public esl::io::input::String {
+std::string stripWeak(const std::string& eTag) {
+	return eTag.compare(0, 2, "W/") == 0 ? eTag.substr(2) : eTag;
+}
+
+/* Response body that shares the content of a cached response instead of copying it */
+class CachedReader : public esl::io::Reader {
+public:
+	CachedReader(std::shared_ptr<const ResponseCache::Entry> aEntry)
+	: entry(std::move(aEntry))
+	{ }
+
+	std::size_t read(void* data, std::size_t size) override {
+		if(pos >= entry->content.size()) {
+			return esl::io::Reader::npos;
+		}
+
+		std::size_t count = std::min(size, entry->content.size() - pos);
+		std::memcpy(data, entry->content.data() + pos, count);
+		pos += count;
+		return count;
+	}
+
+	std::size_t getSizeReadable() const override {
+		return entry->content.size() - pos;
+	}
+
+	bool hasSize() const override {
+		return true;
+	}
+
+	std::size_t getSize() const override {
+		return entry->content.size();
+	}
+
+private:
+	std::shared_ptr<const ResponseCache::Entry> entry;
+	std::size_t pos = 0;
+};
+
+/* InputHandler is the writer for the request body that MHD hands over chunk by chunk.
+ * Chunks are appended directly into a single buffer that is reserved once from the
+ * "Content-Length" header, so fetch-task bodies of large workers do not reallocate
+ * the buffer for every chunk and do not create a temporary string per chunk. */
+class InputHandler : public esl::io::Writer {
 public:
 	using ProcessHandler = void (InputHandler::*)();
 
-	InputHandler(esl::com::http::server::RequestContext& aRequestContext, ProcessHandler aProcessHandler, std::unique_ptr<Service> aService, std::vector<std::string>&& aPathList)
+	InputHandler(esl::com::http::server::RequestContext& aRequestContext, ProcessHandler aProcessHandler, std::function<std::unique_ptr<Service>()> aCreateService, ResponseCache* aResponseCache, WatcherLimit& aWatcherLimit, std::vector<std::string>&& aPathList, MetricRegistry::Histogram* aDuration, MetricRegistry::Counter* aErrors)
 	: requestContext(aRequestContext),
 	  processHandler(aProcessHandler),
-	  service(std::move(aService)),
+	  createService(std::move(aCreateService)),
+	  responseCache(aResponseCache),
+	  watcherLimit(aWatcherLimit),
 	  pathList(std::move(aPathList)),
-	  acceptMIMEs(exctractAcceptMIMEs(requestContext.getRequest().getHeaders()))
-	  //acceptEncodings(exctractAccepts(requestContext.getRequest().getHeaders())),
+	  duration(aDuration),
+	  errors(aErrors),
+	  startTS(duration ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
 	{
 		if(processHandler == nullptr) {
 	        //throw esl::com::http::server::exception::StatusCode(500, "processHandler is nullptr");
 			throw esl::system::Stacktrace::add(std::runtime_error("processHandler is nullptr"));
 		}
+
+		std::size_t contentLength = exctractContentLength(requestContext.getRequest().getHeaders());
+		if(contentLength > 0) {
+			body.reserve(contentLength);
+		}
+	}
+
+	std::size_t write(const void* data, std::size_t size) override {
+		if(data == nullptr || size == 0) {
+			if(!processed) {
+				processed = true;
+				process();
+			}
+			return esl::io::Writer::npos;
+		}
+
+		body.append(static_cast<const char*>(data), size);
+		return size;
 	}
 
-	void process() override {
+	std::size_t getSizeWritable() const override {
+		return esl::io::Writer::npos;
+	}
+
+	const std::string& getString() const noexcept {
+		return body;
+	}
+
+	/* The compressed body has been received completely before it gets decompressed,
+	 * so both the compressed and the decompressed body are held in memory for a moment. */
+	void gunzipBody() {
+		try {
+			body = Compression::gunzip(body, maxGunzipSize);
+		}
+		catch(const std::exception& e) {
+			throw esl::com::http::server::exception::StatusCode(400, esl::utility::MIME::Type::textPlain, e.what());
+		}
+	}
+
+	/* The duration is measured from accepting the request until the response has been handed over,
+	 * so it includes receiving the body. Streaming responses of "/watch" are measured until the stream starts. */
+	void process() {
 		try {
+			if(Compression::isGzipEncoded(requestContext.getRequest().getHeaders())) {
+				gunzipBody();
+			}
 			(this->*processHandler)();
+			observeDuration();
 		}
 		catch(const esl::com::http::server::exception::StatusCode& e) {
+			observeError();
 			throw;
 		}
 		catch(const std::exception& e) {
+			observeError();
 	        throw esl::com::http::server::exception::StatusCode(500, esl::utility::MIME::Type::textPlain, e.what());
 		}
 		catch(...) {
+			observeError();
 	        throw esl::com::http::server::exception::StatusCode(500, esl::utility::MIME::Type::textPlain, "unknown error");
 		}
 	}
 
 	// GET: "/alive"
 	void process_1() {
-		service->alive();
+		getService().alive();
 
 		esl::utility::MIME responseMIME = esl::utility::MIME::Type::applicationJson;
 		esl::com::http::server::Response response(200, responseMIME);
@@ -125,13 +266,22 @@ public:
 	// POST: "/fetch-task/{namespaceId}"
 	void process_2() {
 		const std::string& namespaceId = pathList[1];
-		schemas::FetchRequest fetchRequest = sergut::JsonDeserializer(getString()).deserializeData<schemas::FetchRequest>();
-		schemas::FetchResponse fetchResponse = service->fetchTask(namespaceId, fetchRequest);
+		schemas::FetchRequest fetchRequest;
+		if(requestContext.getRequest().getContentType().toString() == BinaryCodec::getMIME()) {
+			fetchRequest = BinaryCodec::decodeFetchRequest(getString());
+		}
+		else {
+			fetchRequest = sergut::JsonDeserializer(getString()).deserializeData<schemas::FetchRequest>();
+		}
+		schemas::FetchResponse fetchResponse = getService().fetchTask(namespaceId, fetchRequest);
 
 		std::string responseContent;
-		esl::utility::MIME responseMIME = getResponseMIME();
+		esl::utility::MIME responseMIME = acceptsBinary() ? esl::utility::MIME(BinaryCodec::getMIME()) : getResponseMIME();
 
-		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
+		if(responseMIME.toString() == BinaryCodec::getMIME()) {
+			responseContent = BinaryCodec::encode(fetchResponse);
+		}
+		else if(responseMIME == esl::utility::MIME::Type::applicationXml) {
 			sergut::XmlSerializer ser;
 			ser.serializeData("fetchResponse", fetchResponse);
 		    responseContent = ser.str();
@@ -151,6 +301,7 @@ public:
 	}
 
 	// GET: "/tasks/{namespaceId}[?[state={state}][&][nafter={eventNotAfter}][&][nbefore={eventNotBefore}]]"
+	// GET: "/tasks/{namespaceId}?limit={limit}[&offset={offset}][&sort={column}][&order={asc|desc}][&eventType={eventType}][&state=...][&nafter=...][&nbefore=...]"
 	void process_3() {
 		const std::string& namespaceId = pathList[1];
 		std::string state;
@@ -168,67 +319,108 @@ public:
 			eventNotBefore = requestContext.getRequest().getArgument("nbefore");
 		}
 
-		std::vector<schemas::TaskStatusHead> taskStatus = service->getTasks(namespaceId, state, eventNotAfter, eventNotBefore);
-
-		std::string responseContent;
 		esl::utility::MIME responseMIME = getResponseMIME();
+		if(!isSerializable(responseMIME)) {
+			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
+		}
+
+		std::string cacheKey = "tasks\n" + state + "\n" + eventNotAfter + "\n" + eventNotBefore;
+		for(const char* argument : {"limit", "offset", "sort", "order", "eventType"}) {
+			cacheKey += "\n";
+			if(requestContext.getRequest().hasArgument(argument)) {
+				cacheKey += requestContext.getRequest().getArgument(argument);
+			}
+		}
+		std::uint64_t cacheVersion;
+		if(sendFromCache(namespaceId, cacheKey, responseMIME, cacheVersion)) {
+			return;
+		}
+
+		std::vector<schemas::TaskStatusHead> taskStatus;
+		if(requestContext.getRequest().hasArgument("limit")) {
+			TaskQuery query;
+			query.state = state;
+			query.eventNotAfter = eventNotAfter;
+			query.eventNotBefore = eventNotBefore;
+			if(requestContext.getRequest().hasArgument("eventType")) {
+				query.eventType = requestContext.getRequest().getArgument("eventType");
+			}
+			if(requestContext.getRequest().hasArgument("sort")) {
+				try {
+					query.sortBy = TaskQuery::toSortBy(requestContext.getRequest().getArgument("sort"));
+				}
+				catch(const std::exception& e) {
+					throw esl::com::http::server::exception::StatusCode(400, esl::utility::MIME::Type::textPlain, e.what());
+				}
+			}
+			if(requestContext.getRequest().hasArgument("order")) {
+				query.descending = requestContext.getRequest().getArgument("order") != "asc";
+			}
+			if(requestContext.getRequest().hasArgument("offset")) {
+				query.offset = std::strtoull(requestContext.getRequest().getArgument("offset").c_str(), nullptr, 10);
+			}
+			query.limit = std::min<std::size_t>(std::strtoull(requestContext.getRequest().getArgument("limit").c_str(), nullptr, 10), TaskQuery::maxLimit);
 
+			taskStatus = getService().queryTasks(namespaceId, query);
+		}
+		else {
+			taskStatus = getService().getTasks(namespaceId, state, eventNotAfter, eventNotBefore);
+		}
+		service.reset();
+
+		std::string responseContent;
 		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
 			sergut::XmlSerializer ser;
 			ser.serializeNestedData("tasks", "task", sergut::XmlValueType::Child, taskStatus);
 		    responseContent = ser.str();
 		}
-		else if(responseMIME == esl::utility::MIME::Type::applicationJson) {
+		else {
 			sergut::JsonSerializer ser;
 			ser.serializeData(taskStatus);
 		    responseContent = ser.str();
 		}
-		else {
-			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
-		}
 
-		esl::com::http::server::Response response(200, responseMIME);
-		esl::io::Output output = esl::io::output::String::create(std::move(responseContent));
-		requestContext.getConnection().send(response, std::move(output));
+		sendAndCache(namespaceId, cacheKey, cacheVersion, responseMIME, std::move(responseContent));
 	}
 
 	// GET: "/task/{namespaceId}/{taskId}"
 	void process_4() {
 		const std::string& namespaceId = pathList[1];
 		const std::string& taskId = pathList[2];
-		std::unique_ptr<schemas::TaskStatusHead> status = service->getTask(namespaceId, taskId);
+
+		esl::utility::MIME responseMIME = getResponseMIME();
+		if(!isSerializable(responseMIME)) {
+			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
+		}
+
+		/* not cached, because the status of a single task contains the time of the last heartbeat */
+		std::unique_ptr<schemas::TaskStatusHead> status = getService().getTask(namespaceId, taskId);
+		service.reset();
 
 		if(!status) {
 			throw esl::com::http::server::exception::StatusCode(404, "{}");
 		}
 
 		std::string responseContent;
-		esl::utility::MIME responseMIME = getResponseMIME();
-
 		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
 			sergut::XmlSerializer ser;
 			ser.serializeData("status", *status);
 		    responseContent = ser.str();
 		}
-		else if(responseMIME == esl::utility::MIME::Type::applicationJson) {
+		else {
 			sergut::JsonSerializer ser;
 			ser.serializeData(*status);
 		    responseContent = ser.str();
 		}
-		else {
-			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
-		}
 
-		esl::com::http::server::Response response(200, responseMIME);
-		esl::io::Output output = esl::io::output::String::create(std::move(responseContent));
-		requestContext.getConnection().send(response, std::move(output));
+		sendAndCache(namespaceId, "", 0, responseMIME, std::move(responseContent));
 	}
 
 	// POST: "/task/{namespaceId}"
 	void process_5() {
 		const std::string& namespaceId = pathList[1];
 		schemas::RunRequest runRequest = sergut::JsonDeserializer(getString()).deserializeData<schemas::RunRequest>();
-		schemas::RunResponse runResponse = service->runTask(namespaceId, runRequest);
+		schemas::RunResponse runResponse = getService().runTask(namespaceId, runRequest);
 
 		std::string responseContent;
 		esl::utility::MIME responseMIME = getResponseMIME();
@@ -258,7 +450,7 @@ public:
 		const std::string& namespaceId = pathList[1];
 		const std::string& taskId = pathList[2];
 		const std::string& signal = pathList[3];
-		service->sendSignal(namespaceId, taskId, signal);
+		getService().sendSignal(namespaceId, taskId, signal);
 
 		//throw esl::com::http::server::exception::StatusCode(200, "{}");
 		esl::utility::MIME responseMIME = esl::utility::MIME::Type::applicationJson;
@@ -271,19 +463,56 @@ public:
 	void process_7() {
 		const std::string& namespaceId = pathList[1];
 
-		std::vector<std::string> eventTypes = service->getEventTypes(namespaceId);
+		esl::utility::MIME responseMIME = getResponseMIME();
+		if(!isSerializable(responseMIME)) {
+			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
+		}
+
+		std::string cacheKey = "event-types";
+		std::uint64_t cacheVersion;
+		if(sendFromCache(namespaceId, cacheKey, responseMIME, cacheVersion)) {
+			return;
+		}
+
+		std::vector<std::string> eventTypes = getService().getEventTypes(namespaceId);
+		service.reset();
+
+		std::string responseContent;
+		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
+			sergut::XmlSerializer ser;
+			ser.serializeNestedData("event-types", "event-type", sergut::XmlValueType::Child, eventTypes);
+		    responseContent = ser.str();
+		}
+		else {
+			sergut::JsonSerializer ser;
+			ser.serializeData(eventTypes);
+		    responseContent = ser.str();
+		}
+
+		sendAndCache(namespaceId, cacheKey, cacheVersion, responseMIME, std::move(responseContent));
+	}
+
+	// GET: "/task-output/{namespaceId}/{taskId}"
+	void process_8() {
+		const std::string& namespaceId = pathList[1];
+		const std::string& taskId = pathList[2];
+		std::unique_ptr<schemas::TaskOutput> taskOutput = getService().getTaskOutput(namespaceId, taskId);
+
+		if(!taskOutput) {
+			throw esl::com::http::server::exception::StatusCode(404, "{}");
+		}
 
 		std::string responseContent;
 		esl::utility::MIME responseMIME = getResponseMIME();
 
 		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
 			sergut::XmlSerializer ser;
-			ser.serializeNestedData("event-types", "event-type", sergut::XmlValueType::Child, eventTypes);
+			ser.serializeData("output", *taskOutput);
 		    responseContent = ser.str();
 		}
 		else if(responseMIME == esl::utility::MIME::Type::applicationJson) {
 			sergut::JsonSerializer ser;
-			ser.serializeData(eventTypes);
+			ser.serializeData(*taskOutput);
 		    responseContent = ser.str();
 		}
 		else {
@@ -291,19 +520,310 @@ public:
 		}
 
 		esl::com::http::server::Response response(200, responseMIME);
+		response.addHeader("Vary", "Accept-Encoding");
+		if(responseContent.size() >= Compression::minSize && Compression::acceptsGzip(requestContext.getRequest().getHeaders())) {
+			responseContent = Compression::gzip(responseContent);
+			response.addHeader("Content-Encoding", Compression::getGzipEncoding());
+		}
 		esl::io::Output output = esl::io::output::String::create(std::move(responseContent));
 		requestContext.getConnection().send(response, std::move(output));
 	}
 
+	// POST: "/tasks/{namespaceId}/batch"
+	void process_9() {
+		const std::string& namespaceId = pathList[1];
+		if(pathList[2] != "batch") {
+			throw esl::com::http::server::exception::StatusCode(404, "{}");
+		}
+
+		std::vector<schemas::RunRequest> runRequests;
+		if(requestContext.getRequest().getContentType().toString() == ndjsonMIME) {
+			std::string_view content(getString());
+			while(!content.empty()) {
+				std::size_t pos = content.find('\n');
+				std::string line = esl::utility::String::trim(std::string(content.substr(0, pos)));
+				content.remove_prefix(pos == std::string_view::npos ? content.size() : pos + 1);
+
+				if(!line.empty()) {
+					runRequests.push_back(sergut::JsonDeserializer(line).deserializeData<schemas::RunRequest>());
+				}
+			}
+		}
+		else {
+			runRequests = sergut::JsonDeserializer(getString()).deserializeData<std::vector<schemas::RunRequest>>();
+		}
+		std::vector<schemas::RunResponse> runResponses = getService().runTasks(namespaceId, runRequests);
+
+		std::string responseContent;
+		esl::utility::MIME responseMIME = getResponseMIME();
+
+		if(responseMIME == esl::utility::MIME::Type::applicationXml) {
+			sergut::XmlSerializer ser;
+			ser.serializeNestedData("runResponses", "runResponse", sergut::XmlValueType::Child, runResponses);
+		    responseContent = ser.str();
+		}
+		else if(responseMIME == esl::utility::MIME::Type::applicationJson) {
+		    sergut::JsonSerializer ser;
+		    ser.serializeData(runResponses);
+		    responseContent = ser.str();
+		}
+		else {
+			throw esl::com::http::server::exception::StatusCode(415, "accept header requires \"application/xml\" or \"application/json\"");
+		}
+
+		esl::com::http::server::Response response(200, responseMIME);
+		response.addHeader("Vary", "Accept-Encoding");
+		if(responseContent.size() >= Compression::minSize && Compression::acceptsGzip(requestContext.getRequest().getHeaders())) {
+			responseContent = Compression::gzip(responseContent);
+			response.addHeader("Content-Encoding", Compression::getGzipEncoding());
+		}
+		esl::io::Output output = esl::io::output::String::create(std::move(responseContent));
+		requestContext.getConnection().send(response, std::move(output));
+	}
+
+	// GET: "/watch/{namespaceId}[?[taskIds={taskId},...][&][state={state}][&][after={eventId}][&][timeout={ms}]]"
+	void process_10() {
+		const std::string& namespaceId = pathList[1];
+
+		std::vector<std::string> taskIds;
+		if(requestContext.getRequest().hasArgument("taskIds")) {
+			taskIds = esl::utility::String::split(requestContext.getRequest().getArgument("taskIds"), ',', false);
+		}
+
+		std::string state;
+		if(requestContext.getRequest().hasArgument("state")) {
+			state = requestContext.getRequest().getArgument("state");
+		}
+
+		std::uint64_t eventId = 0;
+		if(requestContext.getRequest().hasArgument("after")) {
+			eventId = std::strtoull(requestContext.getRequest().getArgument("after").c_str(), nullptr, 10);
+		}
+		else {
+			/* browsers send the id of the last received event when they reconnect */
+			for(const auto& entry : requestContext.getRequest().getHeaders()) {
+				if(esl::utility::String::toLower(entry.first) == "last-event-id") {
+					eventId = std::strtoull(entry.second.c_str(), nullptr, 10);
+				}
+			}
+		}
+
+		/* with a timeout it is a single long poll, otherwise the response is streamed */
+		if(requestContext.getRequest().hasArgument("timeout")) {
+			unsigned long long timeoutMs = std::strtoull(requestContext.getRequest().getArgument("timeout").c_str(), nullptr, 10);
+			std::chrono::milliseconds timeout(std::min<unsigned long long>(timeoutMs, maxWatchTimeout.count()));
+
+			/* a long poll without timeout answers immediately, so it does not need a slot */
+			std::unique_ptr<WatcherLimit::Slot> watcherSlot;
+			if(timeout.count() > 0) {
+				watcherSlot = acquireWatcherSlot();
+			}
+
+			std::vector<schemas::TaskStatusHead> tasks = getService().watchTasks(namespaceId, taskIds, state, eventId, timeout);
+			service.reset();
+
+			sergut::JsonSerializer ser;
+			ser.serializeData(tasks);
+			std::string responseContent = ser.str();
+
+			esl::com::http::server::Response response(200, esl::utility::MIME::Type::applicationJson);
+			response.addHeader("Batchelor-Event-Id", std::to_string(eventId));
+			response.addHeader("Cache-Control", "no-cache");
+			response.addHeader("Vary", "Accept-Encoding");
+			if(responseContent.size() >= Compression::minSize && Compression::acceptsGzip(requestContext.getRequest().getHeaders())) {
+				responseContent = Compression::gzip(responseContent);
+				response.addHeader("Content-Encoding", Compression::getGzipEncoding());
+			}
+			esl::io::Output output = esl::io::output::String::create(std::move(responseContent));
+			requestContext.getConnection().send(response, std::move(output));
+			return;
+		}
+
+		/* the slot is kept until the stream has been closed */
+		std::unique_ptr<WatcherLimit::Slot> watcherSlot = acquireWatcherSlot();
+
+		WatchReader::Format format = WatchReader::Format::ndjson;
+		for(const auto& acceptMIME : getAcceptMIMEs()) {
+			if(acceptMIME.toString() == sseMIME) {
+				format = WatchReader::Format::sse;
+				break;
+			}
+			if(acceptMIME.toString() == ndjsonMIME) {
+				break;
+			}
+		}
+
+		/* first call is done here to fail with the right status code, e.g. if the user is not authorized.
+		 * Missed events are reported in the stream, because browsers do not show the status code of an event stream. */
+		std::vector<schemas::TaskStatusHead> initialTasks;
+		bool eventsMissed = false;
+		try {
+			initialTasks = getService().watchTasks(namespaceId, taskIds, state, eventId, std::chrono::milliseconds(0));
+		}
+		catch(const esl::com::http::server::exception::StatusCode& e) {
+			if(e.getStatusCode() != 410) {
+				throw;
+			}
+			eventsMissed = true;
+		}
+		service.reset();
+
+		std::unique_ptr<WatchReader> watchReader(new WatchReader(createService, std::move(watcherSlot), namespaceId, taskIds, state, eventId, format, initialTasks));
+		if(eventsMissed) {
+			watchReader->resync();
+		}
+
+		esl::com::http::server::Response response(200, esl::utility::MIME(format == WatchReader::Format::sse ? sseMIME : ndjsonMIME));
+		response.addHeader("Cache-Control", "no-cache");
+		esl::io::Output output(std::unique_ptr<esl::io::Reader>(watchReader.release()));
+		requestContext.getConnection().send(response, std::move(output));
+	}
+
 private:
     esl::com::http::server::RequestContext& requestContext;
     ProcessHandler processHandler;
+    std::function<std::unique_ptr<Service>()> createService;
     std::unique_ptr<Service> service;
+    ResponseCache* responseCache;
+    WatcherLimit& watcherLimit;
 	const std::vector<std::string> pathList;
-	const std::vector<esl::utility::MIME> acceptMIMEs;
+
+	MetricRegistry::Histogram* duration;
+	MetricRegistry::Counter* errors;
+	const std::chrono::steady_clock::time_point startTS;
+
+	/* The service is created on first use, because a service of the head locks the head while it exists.
+	 * Responses that are sent from the response cache do not need a service at all. */
+	Service& getService() {
+		if(!service) {
+			service = createService();
+		}
+		return *service;
+	}
+
+	/* Clients get status 503 if there are too many watchers, so they back off and poll instead. */
+	std::unique_ptr<WatcherLimit::Slot> acquireWatcherSlot() {
+		std::unique_ptr<WatcherLimit::Slot> watcherSlot = watcherLimit.tryAcquire();
+		if(!watcherSlot) {
+			throw esl::com::http::server::exception::StatusCode(503, esl::utility::MIME::Type::textPlain, "too many watchers");
+		}
+		return watcherSlot;
+	}
+
+	void observeDuration() noexcept {
+		if(duration) {
+			duration->observe(std::chrono::steady_clock::now() - startTS);
+		}
+	}
+
+	void observeError() noexcept {
+		if(errors) {
+			errors->add();
+		}
+		observeDuration();
+	}
+
+	/* Sends "304 Not Modified" or the cached response if the response for "key" is cached for the current version of the namespace.
+	 * Otherwise "cacheVersion" is set to the version the new response has to be cached for, or to 0 if it must not be cached. */
+	bool sendFromCache(const std::string& namespaceId, const std::string& key, const esl::utility::MIME& responseMIME, std::uint64_t& cacheVersion) {
+		cacheVersion = 0;
+		if(!responseCache || !responseCache->isReadable(requestContext.getObjectContext(), namespaceId)) {
+			return false;
+		}
+
+		cacheVersion = responseCache->getVersion(namespaceId);
+		std::string eTag = responseCache->getETag(cacheVersion, responseMIME.toString());
+
+		if(matchesETag(eTag)) {
+			esl::com::http::server::Response response(304, responseMIME);
+			response.addHeader("ETag", eTag);
+			response.addHeader("Vary", "Accept, Accept-Encoding");
+			requestContext.getConnection().send(response, esl::io::output::String::create(std::string()));
+			return true;
+		}
+
+		std::shared_ptr<const ResponseCache::Entry> entry = responseCache->get(namespaceId, makeCacheKey(key), cacheVersion);
+		if(!entry) {
+			return false;
+		}
+
+		esl::com::http::server::Response response(200, esl::utility::MIME(entry->mime));
+		response.addHeader("ETag", eTag);
+		response.addHeader("Vary", "Accept, Accept-Encoding");
+		if(entry->gzipped) {
+			response.addHeader("Content-Encoding", Compression::getGzipEncoding());
+		}
+		esl::io::Output output(std::unique_ptr<esl::io::Reader>(new CachedReader(std::move(entry))));
+		requestContext.getConnection().send(response, std::move(output));
+		return true;
+	}
+
+	/* Sends the response, compressed if the client accepts it, and stores it in the response cache if "cacheVersion" is not 0. */
+	void sendAndCache(const std::string& namespaceId, const std::string& key, std::uint64_t cacheVersion, const esl::utility::MIME& responseMIME, std::string responseContent) {
+		/* The serialized and the compressed body exist in full at the same time while compressing.
+		 * The compressed body is not streamed, because it is kept in the response cache. */
+		bool gzipped = responseContent.size() >= Compression::minSize && Compression::acceptsGzip(requestContext.getRequest().getHeaders());
+		if(gzipped) {
+			responseContent = Compression::gzip(responseContent);
+		}
+
+		esl::com::http::server::Response response(200, responseMIME);
+		response.addHeader("Vary", "Accept, Accept-Encoding");
+		if(gzipped) {
+			response.addHeader("Content-Encoding", Compression::getGzipEncoding());
+		}
+
+		if(cacheVersion == 0) {
+			requestContext.getConnection().send(response, esl::io::output::String::create(std::move(responseContent)));
+			return;
+		}
+
+		std::shared_ptr<ResponseCache::Entry> entry(new ResponseCache::Entry);
+		entry->mime = responseMIME.toString();
+		entry->content = std::move(responseContent);
+		entry->gzipped = gzipped;
+		responseCache->put(namespaceId, makeCacheKey(key), cacheVersion, entry);
+
+		response.addHeader("ETag", responseCache->getETag(cacheVersion, responseMIME.toString()));
+		esl::io::Output output(std::unique_ptr<esl::io::Reader>(new CachedReader(std::move(entry))));
+		requestContext.getConnection().send(response, std::move(output));
+	}
+
+	/* the same request is cached separately for every content type and encoding */
+	std::string makeCacheKey(const std::string& key) const {
+		return key + "\n" + getResponseMIME().toString() + (Compression::acceptsGzip(requestContext.getRequest().getHeaders()) ? "\ngzip" : "");
+	}
+
+	bool matchesETag(const std::string& eTag) const {
+		for(const auto& entry : requestContext.getRequest().getHeaders()) {
+			if(esl::utility::String::toLower(entry.first) != "if-none-match") {
+				continue;
+			}
+			for(const auto& value : esl::utility::String::split(entry.second, ',', true)) {
+				std::string trimmedValue = esl::utility::String::trim(value);
+				/* If-None-Match uses the weak comparison */
+				if(trimmedValue == "*" || stripWeak(trimmedValue) == stripWeak(eTag)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/* Accept header gets parsed on first use, because not every route needs content negotiation */
+	mutable std::unique_ptr<const std::vector<esl::utility::MIME>> acceptMIMEs;
+	std::string body;
+	bool processed = false;
+
+	const std::vector<esl::utility::MIME>& getAcceptMIMEs() const {
+		if(!acceptMIMEs) {
+			acceptMIMEs.reset(new std::vector<esl::utility::MIME>(exctractAcceptMIMEs(requestContext.getRequest().getHeaders())));
+		}
+		return *acceptMIMEs;
+	}
 
 	esl::utility::MIME getResponseMIME() const {
-		for(const auto& acceptMIME : acceptMIMEs) {
+		for(const auto& acceptMIME : getAcceptMIMEs()) {
 			if(acceptMIME == esl::utility::MIME::Type::applicationXml) {
 				return esl::utility::MIME::Type::applicationXml;
 			}
@@ -314,13 +834,126 @@ private:
 
 		return esl::utility::MIME();
 	}
+
+	static bool isSerializable(const esl::utility::MIME& mime) {
+		return mime == esl::utility::MIME::Type::applicationXml || mime == esl::utility::MIME::Type::applicationJson;
+	}
+
+	bool acceptsBinary() const {
+		for(const auto& acceptMIME : getAcceptMIMEs()) {
+			if(acceptMIME.toString() == BinaryCodec::getMIME()) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+struct Route {
+	esl::utility::HttpMethod::Type method;
+	std::string_view name;
+	std::size_t segments;
+	InputHandler::ProcessHandler processHandler;
+
+	// used as label of metrics
+	std::string_view pattern;
+};
+
+const Route routes[] = {
+	// GET: "/alive"
+	{ esl::utility::HttpMethod::Type::httpGet, "alive", 1, &InputHandler::process_1, "/alive" },
+	// POST: "/fetch-task/{namespaceId}"
+	{ esl::utility::HttpMethod::Type::httpPost, "fetch-task", 2, &InputHandler::process_2, "/fetch-task/{namespaceId}" },
+	// GET: "/tasks/{namespaceId}[?state={state}]"
+	{ esl::utility::HttpMethod::Type::httpGet, "tasks", 2, &InputHandler::process_3, "/tasks/{namespaceId}" },
+	// GET: "/task/{namespaceId}/{taskId}"
+	{ esl::utility::HttpMethod::Type::httpGet, "task", 3, &InputHandler::process_4, "/task/{namespaceId}/{taskId}" },
+	// POST: "/task/{namespaceId}"
+	{ esl::utility::HttpMethod::Type::httpPost, "task", 2, &InputHandler::process_5, "/task/{namespaceId}" },
+	// POST: "/signal/{namespaceId}/{taskId}/{signal}"
+	{ esl::utility::HttpMethod::Type::httpPost, "signal", 4, &InputHandler::process_6, "/signal/{namespaceId}/{taskId}/{signal}" },
+	// GET: "/event-types/{namespaceId}"
+	{ esl::utility::HttpMethod::Type::httpGet, "event-types", 2, &InputHandler::process_7, "/event-types/{namespaceId}" },
+	// GET: "/task-output/{namespaceId}/{taskId}"
+	{ esl::utility::HttpMethod::Type::httpGet, "task-output", 3, &InputHandler::process_8, "/task-output/{namespaceId}/{taskId}" },
+	// POST: "/tasks/{namespaceId}/batch"
+	{ esl::utility::HttpMethod::Type::httpPost, "tasks", 3, &InputHandler::process_9, "/tasks/{namespaceId}/batch" },
+	// GET: "/watch/{namespaceId}"
+	{ esl::utility::HttpMethod::Type::httpGet, "watch", 2, &InputHandler::process_10, "/watch/{namespaceId}" }
 };
+
+constexpr std::size_t maxSegments = 4;
+
+/* Splits the path without allocating strings. Returns maxSegments+1 if there are more segments than any route has. */
+std::size_t splitPath(std::string_view path, std::array<std::string_view, maxSegments>& segments) {
+	while(!path.empty() && path.front() == '/') {
+		path.remove_prefix(1);
+	}
+	while(!path.empty() && path.back() == '/') {
+		path.remove_suffix(1);
+	}
+	if(path.empty()) {
+		return 0;
+	}
+
+	std::size_t count = 0;
+	while(true) {
+		if(count == maxSegments) {
+			return maxSegments + 1;
+		}
+
+		std::size_t pos = path.find('/');
+		segments[count++] = path.substr(0, pos);
+		if(pos == std::string_view::npos) {
+			return count;
+		}
+		path.remove_prefix(pos + 1);
+	}
 }
 
-RequestHandler::RequestHandler(std::function<std::unique_ptr<Service>(const esl::object::Context&)> aCreateService)
-: createService(aCreateService)
+const Route* findRoute(const esl::utility::HttpMethod& method, const std::array<std::string_view, maxSegments>& segments, std::size_t segmentCount) {
+	esl::utility::HttpMethod::Type methodType;
+	if(method == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
+		methodType = esl::utility::HttpMethod::Type::httpGet;
+	}
+	else if(method == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpPost)) {
+		methodType = esl::utility::HttpMethod::Type::httpPost;
+	}
+	else {
+		return nullptr;
+	}
+
+	for(const auto& route : routes) {
+		if(route.method == methodType && route.segments == segmentCount && route.name == segments[0]) {
+			return &route;
+		}
+	}
+
+	return nullptr;
+}
+} /* anonymous namespace */
+
+RequestHandler::RequestHandler(std::function<std::unique_ptr<Service>(const esl::object::Context&)> aCreateService, ResponseCache* aResponseCache)
+: createService(aCreateService),
+  responseCache(aResponseCache)
 { }
 
+void RequestHandler::setMaxWatchers(std::size_t maxWatchers) noexcept {
+	watcherLimit.setMaxWatchers(maxWatchers);
+}
+
+void RequestHandler::setMetricRegistry(MetricRegistry& metricRegistry) {
+	routeDurations.clear();
+	routeErrors.clear();
+
+	for(const auto& route : routes) {
+		MetricRegistry::Labels labels{{"method", esl::utility::HttpMethod::toString(route.method)}, {"route", std::string(route.pattern)}};
+		routeDurations.push_back(&metricRegistry.addHistogram("batchelor_http_request_duration_seconds", "Duration of HTTP requests per route.", labels));
+		routeErrors.push_back(&metricRegistry.addCounter("batchelor_http_request_errors_total", "HTTP requests per route that failed with an error status.", labels));
+	}
+}
+
 esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& requestContext) const {
 	std::unique_ptr<esl::io::Writer> writer;
 
@@ -329,51 +962,24 @@ esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& re
 	logger.trace << "- getMethod():      \"" << requestContext.getRequest().getMethod().toString() << "\"\n";
 	logger.trace << "- getContentType(): \"" << requestContext.getRequest().getContentType().toString() << "\"\n";
 
-	std::vector<std::string> pathList =  esl::utility::String::split(esl::utility::String::trim(requestContext.getPath(), '/'), '/');
-	if(pathList.size() == 1 && pathList[0].empty()) {
-		pathList.clear();
-	}
-
-	if(pathList.size() == 0) {
+	const std::string& path = requestContext.getPath();
+	std::array<std::string_view, maxSegments> segments;
+	std::size_t segmentCount = splitPath(path, segments);
+	if(segmentCount == 0 || segmentCount > maxSegments) {
 		return esl::io::Input();
 	}
 
-	esl::object::Context& objectContext = requestContext.getObjectContext();
-
-	// GET: "/alive"
-	if(pathList.size() == 1 && pathList[0] == "alive"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_1, makeService(objectContext), std::move(pathList)));
-	}
-	// POST: "/fetch-task/{namespaceId}"
-	else if(pathList.size() == 2 && pathList[0] == "fetch-task"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpPost)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_2, makeService(objectContext), std::move(pathList)));
-	}
-	// GET: "/tasks/{namespaceId}[?state={state}]"
-	else if(pathList.size() == 2 && pathList[0] == "tasks"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_3, makeService(objectContext), std::move(pathList)));
-	}
-	// GET: "/task/{namespaceId}/{taskId}"
-	else if(pathList.size() == 3 && pathList[0] == "task"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_4, makeService(objectContext), std::move(pathList)));
-	}
-	// POST: "/task/{namespaceId}"
-	else if(pathList.size() == 2 && pathList[0] == "task"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpPost)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_5, makeService(objectContext), std::move(pathList)));
-	}
-	// POST: "/signal/{namespaceId}/{taskId}/{signal}"
-	else if(pathList.size() == 4 && pathList[0] == "signal"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpPost)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_6, makeService(objectContext), std::move(pathList)));
-	}
-	// GET: "/event-types/{namespaceId}"
-	else if(pathList.size() == 2 && pathList[0] == "event-types"
-	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
-		writer.reset(new InputHandler(requestContext, &InputHandler::process_7, makeService(objectContext), std::move(pathList)));
+	const Route* route = findRoute(requestContext.getRequest().getMethod(), segments, segmentCount);
+	if(route) {
+		std::vector<std::string> pathList(segments.begin(), segments.begin() + segmentCount);
+		std::size_t routeIndex = route - routes;
+		MetricRegistry::Histogram* duration = routeIndex < routeDurations.size() ? routeDurations[routeIndex] : nullptr;
+		MetricRegistry::Counter* errors = routeIndex < routeErrors.size() ? routeErrors[routeIndex] : nullptr;
+
+		/* The function is used by the watch reader after accept has returned, so nothing of this stack frame is captured by reference.
+		 * The object context belongs to the request and lives as long as the response, i.e. as long as the watch reader. */
+		esl::object::Context* objectContext = &requestContext.getObjectContext();
+		writer.reset(new InputHandler(requestContext, route->processHandler, [this, objectContext]() { return makeService(*objectContext); }, responseCache, watcherLimit, std::move(pathList), duration, errors));
 	}
 
 	if(writer == nullptr) {
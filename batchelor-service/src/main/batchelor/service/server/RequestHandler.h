@@ -20,14 +20,19 @@
 #define BATCHELOR_SERVICE_SERVER_REQUESTHANDLER_H_
 
 #include <batchelor/service/Service.h>
+#include <batchelor/service/server/MetricRegistry.h>
+#include <batchelor/service/server/ResponseCache.h>
+#include <batchelor/service/server/WatcherLimit.h>
 
 #include <esl/com/http/server/RequestContext.h>
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/io/Input.h>
 #include <esl/object/Context.h>
 
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace batchelor {
 namespace service {
@@ -38,10 +43,25 @@ public:
 	esl::io::Input accept(esl::com::http::server::RequestContext& requestContext) const override;
 
 protected:
-	RequestHandler(std::function<std::unique_ptr<Service>(const esl::object::Context&)> createService);
+	/* GET requests of tasks and event types are answered from "responseCache" if it is not nullptr. */
+	RequestHandler(std::function<std::unique_ptr<Service>(const esl::object::Context&)> createService, ResponseCache* responseCache = nullptr);
+
+	/* Registers request durations and errors per route. It has to be called before the first request is accepted. */
+	void setMetricRegistry(MetricRegistry& metricRegistry);
+
+	/* Watch requests above this number are answered with "503 Service Unavailable", see WatcherLimit. */
+	void setMaxWatchers(std::size_t maxWatchers) noexcept;
 
 private:
     std::function<std::unique_ptr<Service>(const esl::object::Context&)> createService;
+    ResponseCache* responseCache;
+
+    /* acquired by watch requests of const "accept" */
+    mutable WatcherLimit watcherLimit;
+
+    /* by index of the route, empty if there is no metric registry */
+    std::vector<MetricRegistry::Histogram*> routeDurations;
+    std::vector<MetricRegistry::Counter*> routeErrors;
 
     std::unique_ptr<Service> makeService(esl::object::Context& context) const;
 };
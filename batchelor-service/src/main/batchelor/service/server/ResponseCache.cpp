@@ -0,0 +1,114 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/server/ResponseCache.h>
+
+#include <chrono>
+#include <cstdio>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+namespace {
+std::string makeInstanceId() {
+	char buffer[17];
+	std::snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count()));
+	return buffer;
+}
+} /* anonymous namespace */
+
+constexpr std::size_t ResponseCache::maxEntries;
+
+ResponseCache::ResponseCache(std::function<bool(const esl::object::Context&, const std::string&)> isReadable)
+: isReadableFunction(std::move(isReadable)),
+  instanceId(makeInstanceId())
+{ }
+
+bool ResponseCache::isReadable(const esl::object::Context& context, const std::string& namespaceId) const {
+	return isReadableFunction && isReadableFunction(context, namespaceId);
+}
+
+std::uint64_t ResponseCache::getVersion(const std::string& namespaceId) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return getVersionUnlocked(namespaceId);
+}
+
+std::string ResponseCache::getETag(std::uint64_t version, const std::string& variant) const {
+	/* weak, because the same ETag is used with and without gzip encoding */
+	return "W/\"" + instanceId + "-" + std::to_string(version) + "-" + variant + "\"";
+}
+
+std::shared_ptr<const ResponseCache::Entry> ResponseCache::get(const std::string& namespaceId, const std::string& key, std::uint64_t version) const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = entries.find(std::make_pair(namespaceId, key));
+	if(iter == entries.end() || iter->second.version != version) {
+		return nullptr;
+	}
+	return iter->second.entry;
+}
+
+void ResponseCache::put(const std::string& namespaceId, const std::string& key, std::uint64_t version, std::shared_ptr<const Entry> entry) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	/* data has been changed while the response was created */
+	if(version != getVersionUnlocked(namespaceId)) {
+		return;
+	}
+
+	if(entries.size() >= maxEntries) {
+		entries.clear();
+	}
+
+	VersionedEntry& versionedEntry = entries[std::make_pair(namespaceId, key)];
+	versionedEntry.version = version;
+	versionedEntry.entry = std::move(entry);
+}
+
+void ResponseCache::invalidate(const std::string& namespaceId) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	versions[namespaceId] = ++lastVersion;
+
+	auto iter = entries.lower_bound(std::make_pair(namespaceId, std::string()));
+	while(iter != entries.end() && iter->first.first == namespaceId) {
+		iter = entries.erase(iter);
+	}
+}
+
+void ResponseCache::invalidateAll() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	versionAll = ++lastVersion;
+	versions.clear();
+	entries.clear();
+}
+
+std::uint64_t ResponseCache::getVersionUnlocked(const std::string& namespaceId) const {
+	auto iter = versions.find(namespaceId);
+	if(iter == versions.end() || iter->second < versionAll) {
+		return versionAll;
+	}
+	return iter->second;
+}
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
@@ -0,0 +1,93 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_SERVER_RESPONSECACHE_H_
+#define BATCHELOR_SERVICE_SERVER_RESPONSECACHE_H_
+
+#include <esl/object/Context.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+/* Serialized responses of read-only calls, so identical polls neither create a service nor touch the database.
+ * Every namespace has a version that changes with each call of "invalidate". ETags and cached responses are only
+ * valid for the version they have been created for. The implementation of the service is responsible to invalidate
+ * the namespace whenever its data changes.
+ */
+class ResponseCache {
+public:
+	struct Entry {
+		std::string mime;
+		std::string content;
+		bool gzipped = false;
+	};
+
+	/* the cache is dropped completely if it gets full, it is meant for a few hot polls only */
+	static constexpr std::size_t maxEntries = 1024;
+
+	/* "isReadable" decides if the user of the context is allowed to read data of the namespace.
+	 * Requests of other users are not answered from the cache, so they get the error of the service. */
+	ResponseCache(std::function<bool(const esl::object::Context&, const std::string&)> isReadable);
+
+	bool isReadable(const esl::object::Context& context, const std::string& namespaceId) const;
+
+	std::uint64_t getVersion(const std::string& namespaceId) const;
+	std::string getETag(std::uint64_t version, const std::string& variant) const;
+
+	std::shared_ptr<const Entry> get(const std::string& namespaceId, const std::string& key, std::uint64_t version) const;
+	void put(const std::string& namespaceId, const std::string& key, std::uint64_t version, std::shared_ptr<const Entry> entry);
+
+	void invalidate(const std::string& namespaceId);
+	void invalidateAll();
+
+private:
+	struct VersionedEntry {
+		std::uint64_t version = 0;
+		std::shared_ptr<const Entry> entry;
+	};
+
+	std::function<bool(const esl::object::Context&, const std::string&)> isReadableFunction;
+
+	/* ETags of a previous process must not match, because versions start again */
+	const std::string instanceId;
+
+	mutable std::mutex mutex;
+	std::uint64_t lastVersion = 1;
+	std::uint64_t versionAll = 1;
+	std::map<std::string, std::uint64_t> versions;
+	std::map<std::pair<std::string, std::string>, VersionedEntry> entries;
+
+	std::uint64_t getVersionUnlocked(const std::string& namespaceId) const;
+};
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_SERVER_RESPONSECACHE_H_ */
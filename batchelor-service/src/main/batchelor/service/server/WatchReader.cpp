@@ -0,0 +1,135 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/Logger.h>
+#include <batchelor/service/server/WatchReader.h>
+
+#include <esl/com/http/server/exception/StatusCode.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#include "sergut/JsonSerializer.h"
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+namespace {
+Logger logger("batchelor::service::server::WatchReader");
+}
+
+constexpr std::chrono::milliseconds WatchReader::heartbeatInterval;
+
+WatchReader::WatchReader(std::function<std::unique_ptr<Service>()> aCreateService, std::unique_ptr<WatcherLimit::Slot> aWatcherSlot, const std::string& aNamespaceId, const std::vector<std::string>& aTaskIds, const std::string& aState, std::uint64_t aEventId, Format aFormat, const std::vector<schemas::TaskStatusHead>& initialTasks)
+: createService(std::move(aCreateService)),
+  watcherSlot(std::move(aWatcherSlot)),
+  namespaceId(aNamespaceId),
+  taskIds(aTaskIds),
+  state(aState),
+  eventId(aEventId),
+  format(aFormat)
+{
+	if(format == Format::sse) {
+		/* tells the browser how long to wait before reconnecting */
+		buffer += "retry: " + std::to_string(heartbeatInterval.count()) + "\n\n";
+	}
+	append(initialTasks);
+}
+
+std::size_t WatchReader::read(void* data, std::size_t size) {
+	while(bufferPos >= buffer.size()) {
+		if(closed) {
+			watcherSlot.reset();
+			return esl::io::Reader::npos;
+		}
+
+		buffer.clear();
+		bufferPos = 0;
+
+		try {
+			std::unique_ptr<Service> service = createService();
+			append(service->watchTasks(namespaceId, taskIds, state, eventId, heartbeatInterval));
+		}
+		catch(const esl::com::http::server::exception::StatusCode& e) {
+			if(e.getStatusCode() == 410) {
+				resync();
+			}
+			else {
+				logger.warn << "Watch closed with status code " << e.getStatusCode() << "\n";
+				closed = true;
+			}
+		}
+		catch(const std::exception& e) {
+			logger.warn << "Watch closed: " << e.what() << "\n";
+			closed = true;
+		}
+		catch(...) {
+			logger.warn << "Watch closed because of unknown exception.\n";
+			closed = true;
+		}
+	}
+
+	std::size_t count = std::min(size, buffer.size() - bufferPos);
+	std::memcpy(data, buffer.data() + bufferPos, count);
+	bufferPos += count;
+
+	return count;
+}
+
+std::size_t WatchReader::getSizeReadable() const {
+	return buffer.size() - bufferPos;
+}
+
+bool WatchReader::hasSize() const {
+	return false;
+}
+
+std::size_t WatchReader::getSize() const {
+	return esl::io::Reader::npos;
+}
+
+void WatchReader::resync() {
+	buffer += format == Format::sse ? "event: resync\ndata: \n\n" : "{\"resync\":true}\n";
+	closed = true;
+}
+
+void WatchReader::append(const std::vector<schemas::TaskStatusHead>& tasks) {
+	if(tasks.empty()) {
+		buffer += format == Format::sse ? ": heartbeat\n\n" : "\n";
+		return;
+	}
+
+	for(const auto& task : tasks) {
+		sergut::JsonSerializer ser;
+		ser.serializeData(task);
+
+		if(format == Format::sse) {
+			buffer += "id: " + std::to_string(eventId) + "\nevent: task\ndata: " + ser.str() + "\n\n";
+		}
+		else {
+			buffer += ser.str() + "\n";
+		}
+	}
+}
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
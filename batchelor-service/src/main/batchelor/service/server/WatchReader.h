@@ -0,0 +1,87 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_SERVER_WATCHREADER_H_
+#define BATCHELOR_SERVICE_SERVER_WATCHREADER_H_
+
+#include <batchelor/service/Service.h>
+#include <batchelor/service/schemas/TaskStatusHead.h>
+#include <batchelor/service/server/WatcherLimit.h>
+
+#include <esl/io/Reader.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+/* Response body of "GET /watch/{namespaceId}" that never ends.
+ * Every read blocks in "Service::watchTasks" until a task has been changed, so a client costs one idle connection
+ * instead of one request per poll. A heartbeat is sent if nothing has changed for "heartbeatInterval".
+ * A new service is created for every call, because a service of the head locks the head while it exists.
+ * The reader holds a slot of the watcher limit, so it is released when the stream is closed.
+ * If the watcher has missed task events (status 410 of "watchTasks"), the stream ends with a resync event.
+ * It is "event: resync" for server-sent events and the line {"resync":true} for NDJSON, so the client reloads the status of all tasks.
+ */
+class WatchReader : public esl::io::Reader {
+public:
+	enum class Format {
+		sse,   // text/event-stream
+		ndjson // application/x-ndjson
+	};
+
+	static constexpr std::chrono::milliseconds heartbeatInterval{5000};
+
+	WatchReader(std::function<std::unique_ptr<Service>()> createService, std::unique_ptr<WatcherLimit::Slot> watcherSlot, const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t eventId, Format format, const std::vector<schemas::TaskStatusHead>& initialTasks);
+
+	std::size_t read(void* data, std::size_t size) override;
+	std::size_t getSizeReadable() const override;
+	bool hasSize() const override;
+	std::size_t getSize() const override;
+
+	/* Ends the stream with a resync event after the data that has been appended so far. */
+	void resync();
+
+private:
+	std::function<std::unique_ptr<Service>()> createService;
+	std::unique_ptr<WatcherLimit::Slot> watcherSlot;
+	const std::string namespaceId;
+	const std::vector<std::string> taskIds;
+	const std::string state;
+	std::uint64_t eventId;
+	const Format format;
+
+	std::string buffer;
+	std::size_t bufferPos = 0;
+	bool closed = false;
+
+	void append(const std::vector<schemas::TaskStatusHead>& tasks);
+};
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_SERVER_WATCHREADER_H_ */
@@ -0,0 +1,53 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/service/server/WatcherLimit.h>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+constexpr std::size_t WatcherLimit::defaultMaxWatchers;
+
+WatcherLimit::Slot::Slot(std::atomic<std::size_t>& aWatchers)
+: watchers(aWatchers)
+{ }
+
+WatcherLimit::Slot::~Slot() {
+	--watchers;
+}
+
+void WatcherLimit::setMaxWatchers(std::size_t aMaxWatchers) noexcept {
+	maxWatchers = aMaxWatchers;
+}
+
+std::unique_ptr<WatcherLimit::Slot> WatcherLimit::tryAcquire() {
+	std::size_t current = watchers.load();
+	do {
+		if(current >= maxWatchers) {
+			return nullptr;
+		}
+	} while(!watchers.compare_exchange_weak(current, current + 1));
+
+	return std::unique_ptr<Slot>(new Slot(watchers));
+}
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
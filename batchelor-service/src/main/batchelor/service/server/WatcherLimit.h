@@ -0,0 +1,71 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_SERVICE_SERVER_WATCHERLIMIT_H_
+#define BATCHELOR_SERVICE_SERVER_WATCHERLIMIT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace batchelor {
+namespace service {
+namespace server {
+
+/* Number of "watch" requests that may wait for task events at the same time.
+ * Long polls and streams block a thread of the HTTP server while they are waiting, so without a limit
+ * watchers could take all threads and other requests, e.g. "fetch-task" of the workers, would starve.
+ */
+class WatcherLimit {
+public:
+	/* A watcher holds its slot until the long poll has been answered or the stream has been closed. */
+	class Slot {
+	public:
+		Slot(const Slot&) = delete;
+		~Slot();
+
+		Slot& operator=(const Slot&) = delete;
+
+	private:
+		friend class WatcherLimit;
+
+		Slot(std::atomic<std::size_t>& watchers);
+
+		std::atomic<std::size_t>& watchers;
+	};
+
+	/* Large enough for a few UI pages and "wait-task" commands at the same time, so it has to be lowered
+	 * for HTTP servers with fewer threads. Clients back off and poll if they get status 503. */
+	static constexpr std::size_t defaultMaxWatchers = 64;
+
+	void setMaxWatchers(std::size_t maxWatchers) noexcept;
+
+	/* returns nullptr if there are already "maxWatchers" watchers */
+	std::unique_ptr<Slot> tryAcquire();
+
+private:
+	std::size_t maxWatchers = defaultMaxWatchers;
+	std::atomic<std::size_t> watchers{0};
+};
+
+} /* namespace server */
+} /* namespace service */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_SERVICE_SERVER_WATCHERLIMIT_H_ */
@@ -53,7 +53,7 @@ private:
 };
 
 MyRequestHandler::MyRequestHandler(const Procedure::Settings& settings)
-: requestHandlerAuth(common::auth::RequestHandler::Settings(settings.users, settings.userByPlainApiKey, settings.plainBasicAuthByUser)),
+: requestHandlerAuth(common::auth::RequestHandler::Settings(settings.users, settings.userByPlainApiKey, settings.userBySha256ApiKey, settings.plainBasicAuthByUser, settings.pbkdf2BasicAuthByUser, {})),
   requestHandlerEngine(ui::RequestHandler::Settings(settings))
 { }
 
@@ -24,10 +24,13 @@
 #include <batchelor/common/plugin/Socket.h>
 #include <batchelor/common/Procedure.h>
 
+#include <batchelor/service/server/WatcherLimit.h>
+
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/object/Context.h>
 
 #include <atomic>
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
@@ -47,11 +50,16 @@ public:
 		std::map<std::string, common::auth::UserData> users;
 
 		std::map<std::string, std::string> userByPlainApiKey;
+		std::map<std::string, std::string> userBySha256ApiKey;
 		std::map<std::string, std::string> plainBasicAuthByUser;
+		std::map<std::string, std::string> pbkdf2BasicAuthByUser;
 
 		std::string namespaceId = "default";
 		std::set<std::string> socketIds;
 		std::set<std::string> connectionFactoryIds;
+
+		// how many streams of "watch-task" and "watch-tasks" can wait for task events at the same time?
+		std::size_t maxWatchers = service::server::WatcherLimit::defaultMaxWatchers;
 	};
 
 	Procedure(const Settings& settings);
@@ -21,6 +21,8 @@
 #include <batchelor/service/schemas/RunRequest.h>
 #include <batchelor/service/schemas/RunResponse.h>
 #include <batchelor/service/schemas/TaskStatusHead.h>
+#include <batchelor/service/server/WatchReader.h>
+#include <batchelor/service/TaskQuery.h>
 
 #include <batchelor/ui/RequestHandler.h>
 #include <batchelor/ui/Service.h>
@@ -33,13 +35,20 @@
 #include <esl/io/input/String.h>
 #include <esl/io/Output.h>
 #include <esl/io/output/String.h>
+#include <esl/io/Reader.h>
 #include <esl/system/Stacktrace.h>
 #include <esl/utility/HttpMethod.h>
 #include <esl/utility/MIME.h>
 #include <esl/utility/String.h>
 
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 //#define USE_API_KEY_IN_HTML
 
@@ -101,6 +110,154 @@ R"V0G0N(    </div>
 .then(data => console.log(data))
  */
 
+std::string escapeHtml(const std::string& str) {
+	std::string rv;
+	rv.reserve(str.size());
+
+	for(char c : str) {
+		switch(c) {
+		case '&':
+			rv += "&amp;";
+			break;
+		case '<':
+			rv += "&lt;";
+			break;
+		case '>':
+			rv += "&gt;";
+			break;
+		case '"':
+			rv += "&quot;";
+			break;
+		case '\'':
+			rv += "&#39;";
+			break;
+		default:
+			rv += c;
+			break;
+		}
+	}
+
+	return rv;
+}
+
+std::string urlEncode(const std::string& str) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	std::string rv;
+
+	for(unsigned char c : str) {
+		if(std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			rv += static_cast<char>(c);
+		}
+		else {
+			rv += '%';
+			rv += hexDigits[c >> 4];
+			rv += hexDigits[c & 0x0f];
+		}
+	}
+
+	return rv;
+}
+
+std::string makeShowTasksUrl(const service::TaskQuery& query, service::TaskQuery::SortBy sortBy, bool descending, std::size_t offset) {
+	std::string url = "./show-tasks?sort=" + service::TaskQuery::toString(sortBy)
+			+ "&order=" + (descending ? "desc" : "asc")
+			+ "&offset=" + std::to_string(offset)
+			+ "&limit=" + std::to_string(query.limit);
+
+	if(!query.state.empty()) {
+		url += "&state=" + urlEncode(query.state);
+	}
+	if(!query.eventType.empty()) {
+		url += "&eventType=" + urlEncode(query.eventType);
+	}
+	if(!query.eventNotAfter.empty()) {
+		url += "&nafter=" + urlEncode(query.eventNotAfter);
+	}
+	if(!query.eventNotBefore.empty()) {
+		url += "&nbefore=" + urlEncode(query.eventNotBefore);
+	}
+
+	return escapeHtml(url);
+}
+
+/* Response body of "GET /show-tasks" that renders the rows of the task table while they are sent,
+ * instead of building the whole page as one string first.
+ */
+class TaskTableReader : public esl::io::Reader {
+public:
+	static constexpr std::size_t rowsPerChunk = 50;
+
+	TaskTableReader(std::string aHead, std::vector<service::schemas::TaskStatusHead> aTasks, std::string aTail)
+	: buffer(std::move(aHead)),
+	  tasks(std::move(aTasks)),
+	  tail(std::move(aTail))
+	{ }
+
+	std::size_t read(void* data, std::size_t size) override {
+		while(bufferPos >= buffer.size()) {
+			buffer.clear();
+			bufferPos = 0;
+
+			if(nextTask < tasks.size()) {
+				for(std::size_t end = std::min(tasks.size(), nextTask + rowsPerChunk); nextTask < end; ++nextTask) {
+					appendRow(tasks[nextTask]);
+				}
+			}
+			else if(!tailDone) {
+				buffer = std::move(tail);
+				tailDone = true;
+			}
+			else {
+				return esl::io::Reader::npos;
+			}
+		}
+
+		std::size_t count = std::min(size, buffer.size() - bufferPos);
+		std::memcpy(data, buffer.data() + bufferPos, count);
+		bufferPos += count;
+
+		return count;
+	}
+
+	std::size_t getSizeReadable() const override {
+		return buffer.size() - bufferPos;
+	}
+
+	bool hasSize() const override {
+		return false;
+	}
+
+	std::size_t getSize() const override {
+		return esl::io::Reader::npos;
+	}
+
+private:
+	std::string buffer;
+	std::size_t bufferPos = 0;
+
+	std::vector<service::schemas::TaskStatusHead> tasks;
+	std::size_t nextTask = 0;
+
+	std::string tail;
+	bool tailDone = false;
+
+	void appendRow(const service::schemas::TaskStatusHead& taskStatus) {
+		const std::string taskId = escapeHtml(taskStatus.runConfiguration.taskId);
+
+		buffer +=
+				"      <tr id=\"task-" + taskId + "\">\n"
+				"        <td align=left><a href=\"./show-task/" + taskId + "\">" + taskId + "</a></td>\n"
+				"        <td align=left>" + escapeHtml(taskStatus.runConfiguration.eventType) + "</td>\n"
+				"        <td align=left>" + escapeHtml(taskStatus.tsCreated) + "</td>\n"
+				"        <td align=left>" + escapeHtml(taskStatus.state) + "</td>\n"
+				"        <td align=left>" + std::to_string(taskStatus.returnCode) + "</td>\n"
+				"        <td align=left>" + escapeHtml(taskStatus.message) + "</td>\n"
+				"      </tr>\n";
+	}
+};
+
+constexpr std::size_t TaskTableReader::rowsPerChunk;
+
 class InputHandler : public esl::io::input::String {
 public:
 	using ProcessHandler = void (InputHandler::*)();
@@ -271,6 +428,8 @@ private:
 }
 
 RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std::string>>& settings) {
+	bool hasMaxWatchers = false;
+
     for(const auto& setting : settings) {
         if(setting.first == "http-connection-factory") {
             if(setting.second.empty()) {
@@ -280,6 +439,19 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
                 throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of attribute '" + setting.first + "'."));
             }
         }
+        else if(setting.first == "max-watchers") {
+            if(hasMaxWatchers) {
+                throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of attribute '" + setting.first + "'."));
+            }
+            hasMaxWatchers = true;
+
+            try {
+                maxWatchers = static_cast<std::size_t>(std::stoul(setting.second));
+            }
+            catch(const std::exception& e) {
+                throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" for attribute '" + setting.first + "'." + e.what()));
+            }
+        }
         else {
             throw esl::system::Stacktrace::add(std::runtime_error("unknown attribute '" + setting.first + "'."));
         }
@@ -292,7 +464,8 @@ RequestHandler::Settings::Settings(const std::vector<std::pair<std::string, std:
 
 RequestHandler::Settings::Settings(const Procedure::Settings& settings)
 : namespaceId(settings.namespaceId),
-  connectionFactoryIds(settings.connectionFactoryIds)
+  connectionFactoryIds(settings.connectionFactoryIds),
+  maxWatchers(settings.maxWatchers)
 { }
 
 RequestHandler::InitializedSettings::InitializedSettings(esl::object::Context& context, const Settings& settings)
@@ -305,7 +478,9 @@ RequestHandler::InitializedSettings::InitializedSettings(esl::object::Context& c
 
 RequestHandler::RequestHandler(const Settings& aSettings)
 : settings(aSettings)
-{ }
+{
+	watcherLimit.setMaxWatchers(settings.maxWatchers);
+}
 
 std::unique_ptr<esl::com::http::server::RequestHandler> RequestHandler::create(const std::vector<std::pair<std::string, std::string>>& settings) {
 	return std::unique_ptr<esl::com::http::server::RequestHandler>(new RequestHandler(Settings(settings)));
@@ -328,11 +503,21 @@ esl::io::Input RequestHandler::accept(esl::com::http::server::RequestContext& re
 	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
 		return responseShowTask(requestContext, *client, roles, pathList[1]);
 	}
-	// GET: "/show-tasks[?state={state}][&eventNotAfter={eventNotAfter}][&eventNotBefore={eventNotBefore}]"
+	// GET: "/watch-task/{taskId}"
+	else if(pathList.size() == 2 && pathList[0] == "watch-task"
+	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
+		return responseWatchTask(requestContext, *client, roles, pathList[1]);
+	}
+	// GET: "/show-tasks[?[state={state}][&eventType={eventType}][&nafter={eventNotAfter}][&nbefore={eventNotBefore}][&sort={column}][&order={asc|desc}][&offset={offset}][&limit={limit}]]"
 	else if(pathList.size() == 1 && pathList[0] == "show-tasks"
 	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
 		return responseShowTasks(requestContext, *client, roles);
 	}
+	// GET: "/watch-tasks[?after={eventId}]"
+	else if(pathList.size() == 1 && pathList[0] == "watch-tasks"
+	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
+		return responseWatchTasks(requestContext, *client, roles);
+	}
 	// GET: "/send-event[?eventType={event-type}]"
 	else if(pathList.size() == 1 && pathList[0] == "send-event"
 	&& requestContext.getRequest().getMethod() == esl::utility::HttpMethod::toString(esl::utility::HttpMethod::Type::httpGet)) {
@@ -403,7 +588,7 @@ std::unique_ptr<esl::com::http::client::Connection> RequestHandler::createHTTPCo
 	return httpConnection;
 }
 
-esl::io::Input RequestHandler::responseShowTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles, const std::string& taskId) const {
+esl::io::Input RequestHandler::responseShowTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& taskId) const {
 	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
 		throw esl::com::http::server::exception::StatusCode(401);
 	}
@@ -516,8 +701,29 @@ esl::io::Input RequestHandler::responseShowTask(esl::com::http::server::RequestC
 			}
 		}
 
-		str +=  "    </form>\n"
-		        + htmlFooter;
+		str +=  "    </form>\n";
+
+		/* reload the page as soon as the head reports a new state instead of having the user to refresh it.
+		 * If the stream has been refused, e.g. because there are too many watchers, the page is reloaded after a while. */
+		if(tasksStatus->state == "running" || tasksStatus->state == "queued") {
+			str +=
+					"    <script>\n"
+					"      const watchSource = new EventSource('../watch-task/" + taskId + "');\n"
+					"      watchSource.addEventListener('task', function(event) {\n"
+					"        if(JSON.parse(event.data).state !== '" + tasksStatus->state + "') {\n"
+					"          watchSource.close();\n"
+					"          location.reload();\n"
+					"        }\n"
+					"      });\n"
+					"      watchSource.onerror = function() {\n"
+					"        if(watchSource.readyState === EventSource.CLOSED) {\n"
+					"          setTimeout(function() { location.reload(); }, 5000);\n"
+					"        }\n"
+					"      };\n"
+					"    </script>\n";
+		}
+
+		str +=  htmlFooter;
 
 		esl::io::Output output = esl::io::output::String::create(str);
 		esl::com::http::server::Response response(200, esl::utility::MIME::Type::textHtml);
@@ -537,52 +743,233 @@ esl::io::Input RequestHandler::responseShowTask(esl::com::http::server::RequestC
 	return esl::io::input::Closed::create();
 }
 
-esl::io::Input RequestHandler::responseShowTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles) const {
+esl::io::Input RequestHandler::responseWatchTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& taskId) const {
 	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
 		throw esl::com::http::server::exception::StatusCode(401);
 	}
 
-	std::vector<service::schemas::TaskStatusHead> tasksStatus = service.getTasks(settings.namespaceId, ""/*state*/, ""/*eventNotAfter*/, ""/*eventNotBefore*/);
-	std::sort(tasksStatus.begin(), tasksStatus.end(), [](const service::schemas::TaskStatusHead& a, const service::schemas::TaskStatusHead& b)
-            {
-                return a.tsCreated > b.tsCreated;
-            });
-	std::string str =
+	/* every stream blocks a thread of this server, see WatcherLimit */
+	std::unique_ptr<service::server::WatcherLimit::Slot> watcherSlot = watcherLimit.tryAcquire();
+	if(!watcherSlot) {
+		throw esl::com::http::server::exception::StatusCode(503, esl::utility::MIME::Type::textPlain, "too many watchers");
+	}
+
+	std::vector<std::string> taskIds{taskId};
+	std::uint64_t eventId = 0;
+	std::vector<service::schemas::TaskStatusHead> initialTasks = service.watchTasks(settings.namespaceId, taskIds, ""/*state*/, eventId, std::chrono::milliseconds(0));
+
+	/* every read of the stream is a long poll to the head */
+	esl::io::Output output(std::unique_ptr<esl::io::Reader>(new service::server::WatchReader(
+			[this]() { return std::unique_ptr<service::Service>(new Service(*this)); }, std::move(watcherSlot),
+			settings.namespaceId, taskIds, ""/*state*/, eventId, service::server::WatchReader::Format::sse, initialTasks)));
+	esl::com::http::server::Response response(200, esl::utility::MIME("text/event-stream"));
+	response.addHeader("Cache-Control", "no-cache");
+	requestContext.getConnection().send(response, std::move(output));
+
+	return esl::io::input::Closed::create();
+}
+
+esl::io::Input RequestHandler::responseWatchTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const {
+	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	/* every stream blocks a thread of this server, see WatcherLimit */
+	std::unique_ptr<service::server::WatcherLimit::Slot> watcherSlot = watcherLimit.tryAcquire();
+	if(!watcherSlot) {
+		throw esl::com::http::server::exception::StatusCode(503, esl::utility::MIME::Type::textPlain, "too many watchers");
+	}
+
+	std::uint64_t eventId = 0;
+	if(requestContext.getRequest().hasArgument("after")) {
+		eventId = std::strtoull(requestContext.getRequest().getArgument("after").c_str(), nullptr, 10);
+	}
+	/* browsers send the id of the last received event when they reconnect, this is newer than the id of the URL */
+	for(const auto& entry : requestContext.getRequest().getHeaders()) {
+		if(esl::utility::String::toLower(entry.first) == "last-event-id") {
+			eventId = std::strtoull(entry.second.c_str(), nullptr, 10);
+		}
+	}
+	if(eventId == 0) {
+		service.watchTasks(settings.namespaceId, {}, ""/*state*/, eventId, std::chrono::milliseconds(0));
+	}
+
+	/* changes of all tasks are sent, the page decides which rows are affected */
+	esl::io::Output output(std::unique_ptr<esl::io::Reader>(new service::server::WatchReader(
+			[this]() { return std::unique_ptr<service::Service>(new Service(*this)); }, std::move(watcherSlot),
+			settings.namespaceId, {}, ""/*state*/, eventId, service::server::WatchReader::Format::sse, {})));
+	esl::com::http::server::Response response(200, esl::utility::MIME("text/event-stream"));
+	response.addHeader("Cache-Control", "no-cache");
+	requestContext.getConnection().send(response, std::move(output));
+
+	return esl::io::input::Closed::create();
+}
+
+esl::io::Input RequestHandler::responseShowTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const {
+	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
+		throw esl::com::http::server::exception::StatusCode(401);
+	}
+
+	const esl::com::http::server::Request& request = requestContext.getRequest();
+
+	service::TaskQuery query;
+	if(request.hasArgument("state")) {
+		query.state = request.getArgument("state");
+	}
+	if(request.hasArgument("eventType")) {
+		query.eventType = request.getArgument("eventType");
+	}
+	if(request.hasArgument("nafter")) {
+		query.eventNotAfter = request.getArgument("nafter");
+	}
+	if(request.hasArgument("nbefore")) {
+		query.eventNotBefore = request.getArgument("nbefore");
+	}
+	if(request.hasArgument("sort")) {
+		try {
+			query.sortBy = service::TaskQuery::toSortBy(request.getArgument("sort"));
+		}
+		catch(const std::exception& e) {
+			throw esl::com::http::server::exception::StatusCode(400, esl::utility::MIME::Type::textPlain, e.what());
+		}
+	}
+	if(request.hasArgument("order")) {
+		query.descending = request.getArgument("order") != "asc";
+	}
+	if(request.hasArgument("offset")) {
+		query.offset = std::strtoull(request.getArgument("offset").c_str(), nullptr, 10);
+	}
+	if(request.hasArgument("limit")) {
+		query.limit = std::strtoull(request.getArgument("limit").c_str(), nullptr, 10);
+	}
+	query.limit = std::max<std::size_t>(1, std::min(query.limit, service::TaskQuery::maxLimit));
+
+	/* the event id is taken before the tasks are loaded, so the page misses no change that happens in between */
+	std::uint64_t eventId = 0;
+	service.watchTasks(settings.namespaceId, {}, ""/*state*/, eventId, std::chrono::milliseconds(0));
+
+	/* one more task than shown tells if there is a next page */
+	service::TaskQuery pageQuery = query;
+	++pageQuery.limit;
+	std::vector<service::schemas::TaskStatusHead> tasksStatus = service.queryTasks(settings.namespaceId, pageQuery);
+	bool hasNextPage = tasksStatus.size() > query.limit;
+	if(hasNextPage) {
+		tasksStatus.resize(query.limit);
+	}
+
+	std::string head =
 			htmlHeader +
 			"<a href=\"..\">Home</a>\n"
+			"    <form method=\"get\" action=\"./show-tasks\" class=\"row g-2 my-2\">\n"
+			"      <div class=\"col-auto\">\n"
+			"        <select name=\"state\" class=\"form-select\">\n";
+	for(const char* state : {"", "queued", "running", "zombie", "done", "signaled"}) {
+		head += std::string("          <option value=\"") + state + "\"" + (query.state == state ? " selected" : "") + ">" + (*state ? state : "all states") + "</option>\n";
+	}
+	head +=
+			"        </select>\n"
+			"      </div>\n"
+			"      <div class=\"col-auto\">\n"
+			"        <input type=\"text\" name=\"eventType\" class=\"form-control\" placeholder=\"event type\" value=\"" + escapeHtml(query.eventType) + "\">\n"
+			"      </div>\n"
+			"      <div class=\"col-auto\">\n"
+			"        <input type=\"text\" name=\"nbefore\" class=\"form-control\" placeholder=\"created not before\" value=\"" + escapeHtml(query.eventNotBefore) + "\">\n"
+			"      </div>\n"
+			"      <div class=\"col-auto\">\n"
+			"        <input type=\"text\" name=\"nafter\" class=\"form-control\" placeholder=\"created not after\" value=\"" + escapeHtml(query.eventNotAfter) + "\">\n"
+			"      </div>\n"
+			"      <input type=\"hidden\" name=\"sort\" value=\"" + service::TaskQuery::toString(query.sortBy) + "\">\n"
+			"      <input type=\"hidden\" name=\"order\" value=\"" + (query.descending ? "desc" : "asc") + "\">\n"
+			"      <input type=\"hidden\" name=\"limit\" value=\"" + std::to_string(query.limit) + "\">\n"
+			"      <div class=\"col-auto\">\n"
+			"        <button class=\"btn btn-primary\" type=\"submit\">Filter</button>\n"
+			"      </div>\n"
+			"    </form>\n"
+			"    <div id=\"newTasks\" class=\"alert alert-info\" style=\"display:none\" data-event-type=\"" + escapeHtml(query.eventType) + "\"><a href=\"" + makeShowTasksUrl(query, query.sortBy, query.descending, 0) + "\">New tasks are available.</a></div>\n"
 			"    <table class=\"table table-striped table-material\">\n"
 			"      <thead>\n"
-			"      <tr>\n"
-			"        <th align=left>Task ID</th>\n"
-			"        <th align=left>Event</th>\n"
-			"        <th align=left>State</th>\n"
-			"        <th align=left>Return code</th>\n"
+			"      <tr>\n";
+	const std::pair<service::TaskQuery::SortBy, const char*> columns[] = {
+			{ service::TaskQuery::SortBy::taskId, "Task ID" },
+			{ service::TaskQuery::SortBy::eventType, "Event" },
+			{ service::TaskQuery::SortBy::createdTS, "Created" },
+			{ service::TaskQuery::SortBy::state, "State" },
+			{ service::TaskQuery::SortBy::returnCode, "Return code" }
+	};
+	for(const auto& column : columns) {
+		/* clicking the sorted column again reverses the order */
+		bool descending = column.first == query.sortBy ? !query.descending : column.first == service::TaskQuery::SortBy::createdTS;
+		std::string arrow = column.first != query.sortBy ? "" : query.descending ? " &darr;" : " &uarr;";
+		head += "        <th align=left><a href=\"" + makeShowTasksUrl(query, column.first, descending, 0) + "\">" + column.second + arrow + "</a></th>\n";
+	}
+	head +=
 			"        <th align=left>Message</th>\n"
 			"      </tr>\n"
 			"      </thead>\n"
 			"      <tbody>\n";
-	for(const auto& taskStatus : tasksStatus) {
-		str +=
-				"      <tr>\n"
-				"        <td align=left><a href=\"./show-task/" + taskStatus.runConfiguration.taskId + "\">" + taskStatus.runConfiguration.taskId + "</a></td>\n"
-				"        <td align=left>" + taskStatus.runConfiguration.eventType + "</td>\n"
-				"        <td align=left>" + taskStatus.state + "</td>\n"
-				"        <td align=left>" + std::to_string(taskStatus.returnCode) + "</td>\n"
-				"        <td align=left>" + taskStatus.message + "</td>\n"
-				"      </tr>\n";
-	}
-	str +=
+
+	std::string tail =
 			"    </tbody>\n"
 			"    </table>\n"
+			"    <nav>\n"
+			"      <ul class=\"pagination\">\n";
+	if(query.offset > 0) {
+		tail += "        <li class=\"page-item\"><a class=\"page-link\" href=\"" + makeShowTasksUrl(query, query.sortBy, query.descending, query.offset > query.limit ? query.offset - query.limit : 0) + "\">Previous</a></li>\n";
+	}
+	else {
+		tail += "        <li class=\"page-item disabled\"><span class=\"page-link\">Previous</span></li>\n";
+	}
+	tail += "        <li class=\"page-item disabled\"><span class=\"page-link\">" + (tasksStatus.empty() ? std::string("0") : std::to_string(query.offset + 1) + " - " + std::to_string(query.offset + tasksStatus.size())) + "</span></li>\n";
+	if(hasNextPage) {
+		tail += "        <li class=\"page-item\"><a class=\"page-link\" href=\"" + makeShowTasksUrl(query, query.sortBy, query.descending, query.offset + query.limit) + "\">Next</a></li>\n";
+	}
+	else {
+		tail += "        <li class=\"page-item disabled\"><span class=\"page-link\">Next</span></li>\n";
+	}
+
+	/* rows are updated in place when the head reports a change instead of reloading the page.
+	 * New tasks are only announced on the first page of the default order, because only there they would show up. */
+	bool showsNewTasks = query.offset == 0 && query.sortBy == service::TaskQuery::SortBy::createdTS && query.descending
+			&& (query.state.empty() || query.state == "queued") && query.eventNotAfter.empty();
+	tail +=
+			"      </ul>\n"
+			"    </nav>\n"
+			"    <script>\n"
+			"      const showsNewTasks = " + std::string(showsNewTasks ? "true" : "false") + ";\n"
+			"      const eventTypeFilter = document.getElementById('newTasks').dataset.eventType;\n"
+			"      const watchSource = new EventSource('./watch-tasks?after=" + std::to_string(eventId) + "');\n"
+			"      watchSource.addEventListener('task', function(event) {\n"
+			"        const task = JSON.parse(event.data);\n"
+			"        const row = document.getElementById('task-' + task.runConfiguration.taskId);\n"
+			"        if(row) {\n"
+			"          row.cells[3].textContent = task.state;\n"
+			"          row.cells[4].textContent = task.returnCode;\n"
+			"          row.cells[5].textContent = task.message;\n"
+			"        }\n"
+			"        else if(showsNewTasks && task.state === 'queued' && (eventTypeFilter === '' || eventTypeFilter === task.runConfiguration.eventType)) {\n"
+			"          document.getElementById('newTasks').style.display = '';\n"
+			"        }\n"
+			"      });\n"
+			"      watchSource.addEventListener('resync', function() {\n"
+			"        watchSource.close();\n"
+			"        location.reload();\n"
+			"      });\n"
+			"      watchSource.onerror = function() {\n"
+			"        if(watchSource.readyState === EventSource.CLOSED) {\n"
+			"          setTimeout(function() { location.reload(); }, 30000);\n"
+			"        }\n"
+			"      };\n"
+			"    </script>\n"
 			+ htmlFooter;
-	esl::io::Output output = esl::io::output::String::create(str);
+
+	esl::io::Output output(std::unique_ptr<esl::io::Reader>(new TaskTableReader(std::move(head), std::move(tasksStatus), std::move(tail))));
 	esl::com::http::server::Response response(200, esl::utility::MIME::Type::textHtml);
 	requestContext.getConnection().send(response, std::move(output));
 
 	return esl::io::input::Closed::create();
 }
 
-esl::io::Input RequestHandler::responseSendEvent(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles, const std::string& eventType) const {
+esl::io::Input RequestHandler::responseSendEvent(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& eventType) const {
 	if(roles.count(common::auth::UserData::Role::execute) == 0) {
 		throw esl::com::http::server::exception::StatusCode(401);
 	}
@@ -759,7 +1146,7 @@ esl::io::Input RequestHandler::responseSendEvent(esl::com::http::server::Request
 	return esl::io::input::Closed::create();
 }
 
-esl::io::Input RequestHandler::responseShowEventTypes(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles) const {
+esl::io::Input RequestHandler::responseShowEventTypes(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const {
 	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
 		throw esl::com::http::server::exception::StatusCode(401);
 	}
@@ -802,7 +1189,7 @@ esl::io::Input RequestHandler::responseShowEventTypes(esl::com::http::server::Re
 	return esl::io::input::Closed::create();
 }
 
-esl::io::Input RequestHandler::responseMainPage(esl::com::http::server::RequestContext& requestContext, const std::set<common::auth::UserData::Role>& roles) const {
+esl::io::Input RequestHandler::responseMainPage(esl::com::http::server::RequestContext& requestContext, const common::auth::UserData::Roles& roles) const {
 	if(roles.count(common::auth::UserData::Role::readOnly) == 0 && roles.count(common::auth::UserData::Role::execute) == 0) {
 		throw esl::com::http::server::exception::StatusCode(401);
 	}
@@ -23,6 +23,7 @@
 #include <batchelor/common/plugin/ConnectionFactory.h>
 
 #include <batchelor/service/Service.h>
+#include <batchelor/service/server/WatcherLimit.h>
 
 #include <batchelor/ui/Procedure.h>
 
@@ -34,6 +35,7 @@
 #include <esl/object/Context.h>
 #include <esl/object/InitializeContext.h>
 
+#include <cstddef>
 #include <memory>
 #include <set>
 #include <string>
@@ -51,6 +53,9 @@ public:
 
 		std::string namespaceId = "default";
 		std::set<std::string> connectionFactoryIds;
+
+		// how many streams of "watch-task" and "watch-tasks" can wait for task events at the same time?
+		std::size_t maxWatchers = service::server::WatcherLimit::defaultMaxWatchers;
 	};
 
 	RequestHandler(const Settings& settings);
@@ -70,16 +75,21 @@ private:
 		std::vector<std::pair<std::string, std::reference_wrapper<common::plugin::ConnectionFactory>>> connectionFactories;
 	};
 
-	esl::io::Input responseShowTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles, const std::string& taskId) const;
-	esl::io::Input responseShowTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles) const;
-	esl::io::Input responseSendEvent(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles, const std::string& eventType) const;
-	esl::io::Input responseSendSignal(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles) const;
-	esl::io::Input responseShowEventTypes(esl::com::http::server::RequestContext& requestContext, service::Service& service, const std::set<common::auth::UserData::Role>& roles) const;
-	esl::io::Input responseMainPage(esl::com::http::server::RequestContext& requestContext, const std::set<common::auth::UserData::Role>& roles) const;
+	esl::io::Input responseShowTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& taskId) const;
+	esl::io::Input responseWatchTask(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& taskId) const;
+	esl::io::Input responseShowTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const;
+	esl::io::Input responseWatchTasks(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const;
+	esl::io::Input responseSendEvent(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles, const std::string& eventType) const;
+	esl::io::Input responseSendSignal(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const;
+	esl::io::Input responseShowEventTypes(esl::com::http::server::RequestContext& requestContext, service::Service& service, const common::auth::UserData::Roles& roles) const;
+	esl::io::Input responseMainPage(esl::com::http::server::RequestContext& requestContext, const common::auth::UserData::Roles& roles) const;
 
 	const Settings settings;
 	std::unique_ptr<InitializedSettings> initializedSettings;
 
+	/* acquired by watch requests of const "accept" */
+	mutable service::server::WatcherLimit watcherLimit;
+
 	mutable std::size_t nextConnectionFactory = 0;
 	mutable common::plugin::ConnectionFactory* httpConnectionFactory = nullptr;
 };
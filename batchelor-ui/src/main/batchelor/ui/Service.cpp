@@ -42,6 +42,11 @@ std::vector<service::schemas::TaskStatusHead> Service::getTasks(const std::strin
 	return service::client::Service(*httpConnection).getTasks(namespaceId, state, eventNotAfter, eventNotBefore);
 }
 
+std::vector<service::schemas::TaskStatusHead> Service::queryTasks(const std::string& namespaceId, const service::TaskQuery& query) {
+	auto httpConnection = requestHandler.createHTTPConnection();
+	return service::client::Service(*httpConnection).queryTasks(namespaceId, query);
+}
+
 std::unique_ptr<service::schemas::TaskStatusHead> Service::getTask(const std::string& namespaceId, const std::string& taskId) {
 	auto httpConnection = requestHandler.createHTTPConnection();
 	return service::client::Service(*httpConnection).getTask(namespaceId, taskId);
@@ -52,6 +57,11 @@ service::schemas::RunResponse Service::runTask(const std::string& namespaceId, c
 	return service::client::Service(*httpConnection).runTask(namespaceId, runRequest);
 }
 
+std::vector<service::schemas::RunResponse> Service::runTasks(const std::string& namespaceId, const std::vector<service::schemas::RunRequest>& runRequests) {
+	auto httpConnection = requestHandler.createHTTPConnection();
+	return service::client::Service(*httpConnection).runTasks(namespaceId, runRequests);
+}
+
 void Service::sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) {
 	auto httpConnection = requestHandler.createHTTPConnection();
 	return service::client::Service(*httpConnection).sendSignal(namespaceId, taskId, signal);
@@ -62,5 +72,15 @@ std::vector<std::string> Service::getEventTypes(const std::string& namespaceId)
 	return service::client::Service(*httpConnection).getEventTypes(namespaceId);
 }
 
+std::vector<service::schemas::TaskStatusHead> Service::watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) {
+	auto httpConnection = requestHandler.createHTTPConnection();
+	return service::client::Service(*httpConnection).watchTasks(namespaceId, taskIds, state, eventId, timeout);
+}
+
+std::unique_ptr<service::schemas::TaskOutput> Service::getTaskOutput(const std::string& namespaceId, const std::string& taskId) {
+	auto httpConnection = requestHandler.createHTTPConnection();
+	return service::client::Service(*httpConnection).getTaskOutput(namespaceId, taskId);
+}
+
 } /* namespace ui */
 } /* namespace batchelor */
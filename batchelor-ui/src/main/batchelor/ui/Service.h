@@ -24,11 +24,14 @@
 #include <batchelor/service/schemas/TaskStatusHead.h>
 #include <batchelor/service/schemas/RunRequest.h>
 #include <batchelor/service/schemas/RunResponse.h>
+#include <batchelor/service/schemas/TaskOutput.h>
 
 #include <batchelor/service/Service.h>
 
 #include <batchelor/ui/RequestHandler.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -48,11 +51,15 @@ public:
 	// used by controller-cli
 	std::vector<service::schemas::TaskStatusHead> getTasks(const std::string& namespaceId, const std::string& state, const std::string& eventNotAfter, const std::string& eventNotBefore) override;
 
+	// used by web frontend
+	std::vector<service::schemas::TaskStatusHead> queryTasks(const std::string& namespaceId, const service::TaskQuery& query) override;
+
 	// used by controller-cli
 	std::unique_ptr<service::schemas::TaskStatusHead> getTask(const std::string& namespaceId, const std::string& taskId) override;
 
 	// used by controller-cli
 	service::schemas::RunResponse runTask(const std::string& namespaceId, const service::schemas::RunRequest& runRequest) override;
+	std::vector<service::schemas::RunResponse> runTasks(const std::string& namespaceId, const std::vector<service::schemas::RunRequest>& runRequests) override;
 
 	// used by controller-cli
 	void sendSignal(const std::string& namespaceId, const std::string& taskId, const std::string& signal) override;
@@ -60,6 +67,12 @@ public:
 	// used by controller-cli
 	std::vector<std::string> getEventTypes(const std::string& namespaceId) override;
 
+	// used by web frontend
+	std::vector<service::schemas::TaskStatusHead> watchTasks(const std::string& namespaceId, const std::vector<std::string>& taskIds, const std::string& state, std::uint64_t& eventId, std::chrono::milliseconds timeout) override;
+
+	// used by controller-cli
+	std::unique_ptr<service::schemas::TaskOutput> getTaskOutput(const std::string& namespaceId, const std::string& taskId) override;
+
 private:
 	const RequestHandler& requestHandler;
 };
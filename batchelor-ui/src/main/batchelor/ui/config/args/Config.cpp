@@ -16,11 +16,15 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <batchelor/common/auth/PasswordHash.h>
 #include <batchelor/common/config/args/ArgumentsException.h>
+#include <batchelor/common/crypto/Sha256.h>
 #include <batchelor/common/plugin/ConnectionFactory.h>
 #include <batchelor/common/plugin/Socket.h>
 #include <batchelor/common/types/State.h>
 
+#include <batchelor/service/server/WatcherLimit.h>
+
 #include <batchelor/ui/config/args/Config.h>
 
 #include <esl/crypto/KeyStore.h>
@@ -29,6 +33,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 namespace batchelor {
 namespace ui {
@@ -71,11 +77,20 @@ void Config::printUsage() {
 	std::cout << "                                            The API key is specified in <api-key> that has format \"<encryption>:<value>\".\n";
 	std::cout << "                                            There are several values available for <encryption>:\n";
 	std::cout << "                                            * plain:<value>      Defines the API key as plain text in <value>.\n";
+	std::cout << "                                            * sha256:<value>     Defines the API key by its SHA-256 as hex value in <value>.\n";
 	std::cout << "\n";
 	std::cout << "  -B, --basic-auth       <user> <pw>        Defines a password for a user <user> used if basic-authentication is used over https.\n";
 	std::cout << "                                            The password is specified in <pw> that has format \"<encryption>:<value>\".\n";
 	std::cout << "                                            There are several values available for <encryption>:\n";
 	std::cout << "                                            * plain:<value>      Defines the password as plain text in <value>.\n";
+	std::cout << "                                            * pbkdf2-sha256:<value>\n";
+	std::cout << "                                                                 Defines the password by its PBKDF2-HMAC-SHA256 hash in <value>\n";
+	std::cout << "                                                                 that has format \"<iterations>$<salt>$<hash>\" with hex values for\n";
+	std::cout << "                                                                 <salt> and <hash>. Verified passwords are cached for 5 minutes.\n";
+	std::cout << "\n";
+	std::cout << "  -W, --max-watchers     <number>           Defines how many pages can receive changes of tasks at the same time.\n";
+	std::cout << "                                            Each of them blocks a thread of the socket, so keep it below \"threads\".\n";
+	std::cout << "                                            Pages that exceed the limit are reloaded after a while. Default is " << service::server::WatcherLimit::defaultMaxWatchers << ".\n";
 	std::cout << "\n";
 	std::cout << "  -S, --socket           <plugin>           Defines a socket to listen for requests.\n";
 	std::cout << "                                            Subsequent settings specified by \"--setting\" are specific to the plugin.\n";
@@ -125,6 +140,10 @@ Config::Config(esl::object::Context& aContext, Procedure::Settings& aSettings, i
 			addBasicAuth(i+1 < argc ? argv[i+1] : nullptr, i+2 < argc ? argv[i+2] : nullptr);
 			i = i+2;
 		}
+		else if(currentArg == "-W"  || currentArg == "--max-watchers") {
+			setMaxWatchers(i+1 < argc ? argv[i+1] : nullptr);
+			++i;
+		}
 		else if(currentArg == "-S"  || currentArg == "--socket") {
 			addSocket(i+1 < argc ? argv[i+1] : nullptr);
 			++i;
@@ -254,6 +273,9 @@ void Config::addApiKey(const char* user, const char* apikey) {
 	if(apik.substr(0, 6) == "plain:") {
 		settings.userByPlainApiKey[apik.substr(6)] = user;
 	}
+	else if(apik.substr(0, 7) == "sha256:" && apik.size() == 7 + 2 * common::crypto::Sha256::digestSize) {
+		settings.userBySha256ApiKey[apik.substr(7)] = user;
+	}
 	else {
 	//if(userData.pw.empty()) {
 		throw ArgumentsException("Invalid value \"" + apik + "\" for api-key of option \"--api-key\".");
@@ -270,11 +292,22 @@ void Config::addBasicAuth(const char* user, const char* password) {
 	}
 
 	std::string pw = password;
-	if(pw.substr(0, 6) == "plain:") {
+	const std::string pbkdf2Prefix = common::auth::PasswordHash::type + ":";
+	if(pw.substr(0, 6) == "plain:" && pw.size() > 6) {
+		settings.pbkdf2BasicAuthByUser.erase(user);
 		settings.plainBasicAuthByUser[user] = pw.substr(6);
 	}
-
-	if(settings.plainBasicAuthByUser[user].empty()) {
+	else if(pw.substr(0, pbkdf2Prefix.size()) == pbkdf2Prefix) {
+		try {
+			common::auth::PasswordHash passwordHash(pw.substr(pbkdf2Prefix.size()));
+		}
+		catch(const std::exception& e) {
+			throw ArgumentsException("Invalid value \"" + pw + "\" for password of option \"--basic-auth\": " + e.what());
+		}
+		settings.plainBasicAuthByUser.erase(user);
+		settings.pbkdf2BasicAuthByUser[user] = pw.substr(pbkdf2Prefix.size());
+	}
+	else {
 		throw ArgumentsException("Invalid value \"" + pw + "\" for password of option \"--basic-auth\".");
 	}
 }
@@ -296,6 +329,23 @@ void Config::addUser(const char* user, const char* namespaceId, const char* role
 	userData.rolesByNamespace[namespaceId].insert(common::auth::UserData::toRole(roleStr));
 }
 
+void Config::setMaxWatchers(const char* value) {
+	if(!value) {
+		throw ArgumentsException("Value missing of option \"--max-watchers\".");
+	}
+	if(hasMaxWatchers) {
+		throw ArgumentsException("Multiple definition of option \"--max-watchers\".");
+	}
+	hasMaxWatchers = true;
+
+	try {
+		settings.maxWatchers = static_cast<std::size_t>(std::stoul(value));
+	}
+	catch(...) {
+		throw ArgumentsException("Invalid value \"" + std::string(value) + "\" of option \"--max-watchers\".");
+	}
+}
+
 void Config::addSocket(const char* implementation) {
 	if(!implementation) {
 		throw ArgumentsException("Plugin-value missing of option \"--socket\".");
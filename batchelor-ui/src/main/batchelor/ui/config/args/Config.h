@@ -73,6 +73,10 @@ private:
 	void addApiKey(const char* user, const char* apik);
 	void addBasicAuth(const char* user, const char* password);
 	void addUser(const char* user, const char* namespaceId, const char* role);
+
+	bool hasMaxWatchers = false;
+	void setMaxWatchers(const char* value);
+
 	void addSocket(const char* implementation);
 	void addConnection(const char* plugin);
 };
@@ -0,0 +1,151 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/common/plugin/basic/ConnectionFactory.h>
+
+#include <batchelor/service/client/Service.h>
+#include <batchelor/service/schemas/FetchRequest.h>
+#include <batchelor/service/schemas/FetchResponse.h>
+
+#include <esl/com/http/client/Connection.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+/* Measures the latency of the fetch-task poll of a worker against a running head, once with a new connection
+ * and client per poll, like the worker did before, and once with one connection that is reused for all polls.
+ * The worker announces no event types, so the head does not hand out tasks.
+ * Usage: batchelor-worker-benchmark-poll <head-url> <namespace-id> [polls] [connection-setting=value ...]
+ * e.g.   batchelor-worker-benchmark-poll http://localhost:8080 default 2000 api-key=secret
+ */
+
+namespace {
+using namespace batchelor;
+
+constexpr std::size_t warmupPolls = 20;
+
+void printStatistics(const std::string& label, std::vector<double> micros) {
+	std::sort(micros.begin(), micros.end());
+
+	double sum = 0;
+	for(double value : micros) {
+		sum += value;
+	}
+	auto percentile = [&micros](double p) {
+		return micros[std::min(micros.size() - 1, static_cast<std::size_t>(p * micros.size()))];
+	};
+
+	std::cout << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(1)
+			<< " mean " << std::setw(9) << (sum / micros.size()) << " us"
+			<< "   p50 " << std::setw(9) << percentile(0.50) << " us"
+			<< "   p90 " << std::setw(9) << percentile(0.90) << " us"
+			<< "   p99 " << std::setw(9) << percentile(0.99) << " us"
+			<< "   max " << std::setw(9) << micros.back() << " us\n";
+}
+
+double poll(service::client::Service& client, const std::string& namespaceId, const service::schemas::FetchRequest& fetchRequest) {
+	auto startTS = std::chrono::steady_clock::now();
+	client.fetchTask(namespaceId, fetchRequest);
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTS).count();
+}
+
+std::vector<double> pollWithNewConnections(common::plugin::ConnectionFactory& connectionFactory, const std::string& namespaceId, const service::schemas::FetchRequest& fetchRequest, std::size_t polls) {
+	std::vector<double> micros;
+
+	for(std::size_t i = 0; i < warmupPolls + polls; ++i) {
+		/* creating the connection and the client is part of the poll */
+		auto startTS = std::chrono::steady_clock::now();
+		std::unique_ptr<esl::com::http::client::Connection> connection = connectionFactory.get().createConnection();
+		service::client::Service client(*connection);
+		double duration = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTS).count() + poll(client, namespaceId, fetchRequest);
+
+		if(i >= warmupPolls) {
+			micros.push_back(duration);
+		}
+	}
+
+	return micros;
+}
+
+std::vector<double> pollWithReusedConnection(common::plugin::ConnectionFactory& connectionFactory, const std::string& namespaceId, const service::schemas::FetchRequest& fetchRequest, std::size_t polls) {
+	std::vector<double> micros;
+
+	std::unique_ptr<esl::com::http::client::Connection> connection = connectionFactory.get().createConnection();
+	service::client::Service client(*connection);
+	for(std::size_t i = 0; i < warmupPolls + polls; ++i) {
+		double duration = poll(client, namespaceId, fetchRequest);
+		if(i >= warmupPolls) {
+			micros.push_back(duration);
+		}
+	}
+
+	return micros;
+}
+} /* anonymous namespace */
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <head-url> <namespace-id> [polls] [connection-setting=value ...]\n";
+		return 1;
+	}
+
+	std::string namespaceId = argv[2];
+	std::size_t polls = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+	if(polls == 0) {
+		std::cerr << "number of polls must be greater than 0\n";
+		return 1;
+	}
+
+	std::vector<std::pair<std::string, std::string>> settings;
+	settings.emplace_back("url", argv[1]);
+	for(int i = 4; i < argc; ++i) {
+		std::string setting = argv[i];
+		std::size_t pos = setting.find('=');
+		if(pos == std::string::npos) {
+			std::cerr << "invalid connection setting \"" << setting << "\", expected key=value\n";
+			return 1;
+		}
+		settings.emplace_back(setting.substr(0, pos), setting.substr(pos + 1));
+	}
+
+	try {
+		std::unique_ptr<common::plugin::ConnectionFactory> connectionFactory = common::plugin::basic::ConnectionFactory::create(settings);
+
+		service::schemas::FetchRequest fetchRequest;
+		fetchRequest.workerId = "benchmark-" + std::to_string(getpid());
+
+		std::cout << polls << " fetch-task polls of namespace \"" << namespaceId << "\" at \"" << argv[1] << "\" after " << warmupPolls << " warm-up polls\n";
+		printStatistics("new connection", pollWithNewConnections(*connectionFactory, namespaceId, fetchRequest, polls));
+		printStatistics("reused", pollWithReusedConnection(*connectionFactory, namespaceId, fetchRequest, polls));
+	}
+	catch(const std::exception& e) {
+		std::cerr << "poll failed: " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/worker/plugin/exec/Supervisor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Launches /bin/true through the supervisor of the exec plugin and reports the spawn rate and the RSS of the process.
+ * At most "max-running" processes are running at the same time, like tasks of a worker with limited resources.
+ * Usage: batchelor-worker-benchmark-supervisor [count] [max-running]
+ */
+
+namespace {
+using batchelor::worker::plugin::exec::Supervisor;
+
+/* value of a line of /proc/self/status, e.g. "VmRSS" in kB or "Threads" */
+std::string getProcStatus(const std::string& key) {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line)) {
+		if(line.compare(0, key.size() + 1, key + ":") == 0) {
+			std::size_t pos = line.find_first_not_of(" \t", key.size() + 1);
+			return pos == std::string::npos ? "" : line.substr(pos);
+		}
+	}
+	return "n/a";
+}
+
+void printProcStatus(const std::string& label) {
+	std::cout << std::left << std::setw(8) << label
+			<< " VmRSS " << std::setw(12) << getProcStatus("VmRSS")
+			<< " VmHWM " << std::setw(12) << getProcStatus("VmHWM")
+			<< " threads " << getProcStatus("Threads") << "\n";
+}
+} /* anonymous namespace */
+
+int main(int argc, char** argv) {
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	std::size_t maxRunning = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500;
+	if(count == 0 || maxRunning == 0) {
+		std::cerr << "usage: " << argv[0] << " [count] [max-running]\n";
+		return 1;
+	}
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t running = 0;
+	std::size_t maxRunningSeen = 0;
+	std::size_t finished = 0;
+	std::size_t failed = 0;
+
+	char executable[] = "/bin/true";
+	char* args[] = {executable, nullptr};
+
+	Supervisor::SpawnSettings spawnSettings;
+	spawnSettings.argv = args;
+
+	Supervisor supervisor;
+	printProcStatus("start");
+
+	std::chrono::steady_clock::duration spawnDuration{};
+	auto startTS = std::chrono::steady_clock::now();
+
+	for(std::size_t i = 0; i < count; ++i) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return running < maxRunning; });
+			++running;
+			maxRunningSeen = std::max(maxRunningSeen, running);
+		}
+
+		auto spawnTS = std::chrono::steady_clock::now();
+		supervisor.spawn(spawnSettings, [&](int returnCode) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--running;
+				++finished;
+				if(returnCode != 0) {
+					++failed;
+				}
+			}
+			cv.notify_all();
+		});
+		spawnDuration += std::chrono::steady_clock::now() - spawnTS;
+
+		if(i + 1 == count / 2) {
+			printProcStatus("half");
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&] { return finished == count; });
+	}
+	auto totalDuration = std::chrono::steady_clock::now() - startTS;
+	printProcStatus("end");
+
+	double totalSeconds = std::chrono::duration<double>(totalDuration).count();
+	double spawnMicros = std::chrono::duration<double, std::micro>(spawnDuration).count() / count;
+
+	std::cout << "processes  " << count << " (max. " << maxRunningSeen << " running, " << failed << " failed)\n";
+	std::cout << "total      " << std::fixed << std::setprecision(3) << totalSeconds << " s\n";
+	std::cout << "rate       " << std::setprecision(0) << (count / totalSeconds) << " processes/s\n";
+	std::cout << "spawn      " << std::setprecision(1) << spawnMicros << " us per call\n";
+
+	return failed == 0 ? 0 : 1;
+}
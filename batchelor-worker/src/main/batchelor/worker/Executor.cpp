@@ -0,0 +1,88 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/worker/Executor.h>
+#include <batchelor/worker/Logger.h>
+
+#include <exception>
+#include <utility>
+
+namespace batchelor {
+namespace worker {
+namespace {
+Logger logger("batchelor::worker::Executor");
+}
+
+Executor::Executor(std::size_t threadCount) {
+	for(std::size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&Executor::run, this);
+	}
+}
+
+Executor::~Executor() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+
+	for(auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void Executor::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	cv.notify_one();
+}
+
+void Executor::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		cv.wait(lock, [this] {
+			return stopping || !jobs.empty();
+		});
+		if(jobs.empty()) {
+			/* stopping and nothing left to do */
+			break;
+		}
+
+		std::function<void()> job = std::move(jobs.front());
+		jobs.pop_front();
+		lock.unlock();
+
+		try {
+			job();
+		}
+		catch(const std::exception& e) {
+			logger.warn << "Job failed because of exception: \"" << e.what() << "\"\n";
+		}
+		catch(...) {
+			logger.warn << "Job failed because of unknown exception.\n";
+		}
+
+		lock.lock();
+	}
+}
+
+} /* namespace worker */
+} /* namespace batchelor */
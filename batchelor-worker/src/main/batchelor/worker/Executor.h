@@ -0,0 +1,54 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHELOR_WORKER_EXECUTOR_H_
+#define BATCHELOR_WORKER_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace batchelor {
+namespace worker {
+
+/* Executor runs submitted jobs on a fixed number of threads.
+ * The destructor waits until all submitted jobs are done. */
+class Executor {
+public:
+	Executor(std::size_t threads);
+	~Executor();
+
+	void submit(std::function<void()> job);
+
+private:
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::function<void()>> jobs;
+	bool stopping = false;
+	std::vector<std::thread> threads;
+
+	void run();
+};
+
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_EXECUTOR_H_ */
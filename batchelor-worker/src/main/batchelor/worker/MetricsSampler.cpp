@@ -0,0 +1,162 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/worker/Logger.h>
+#include <batchelor/worker/MetricsSampler.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits.h>
+#include <sstream>
+
+namespace batchelor {
+namespace worker {
+namespace {
+Logger logger("batchelor::worker::MetricsSampler");
+
+std::string getHostName() {
+	char buffer[HOST_NAME_MAX + 1];
+	if(gethostname(buffer, sizeof(buffer)) != 0) {
+		return "";
+	}
+	buffer[HOST_NAME_MAX] = 0;
+	return buffer;
+}
+
+std::string toString(double value) {
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+	return buffer;
+}
+}
+
+MetricsSampler::MetricsSampler(std::chrono::milliseconds aInterval)
+: interval(aInterval),
+  hostName(getHostName())
+{
+	sample();
+	thread = std::thread(&MetricsSampler::run, this);
+}
+
+MetricsSampler::~MetricsSampler() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+	thread.join();
+}
+
+std::shared_ptr<const MetricsSampler::Metrics> MetricsSampler::getMetrics() const {
+	return std::atomic_load(&metrics);
+}
+
+void MetricsSampler::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(!cv.wait_for(lock, interval, [this] { return stopping; })) {
+		lock.unlock();
+		sample();
+		lock.lock();
+	}
+}
+
+void MetricsSampler::sample() {
+	std::shared_ptr<Metrics> newMetrics = std::make_shared<Metrics>();
+
+	/* cpu  user nice system idle iowait irq softirq steal guest guest_nice */
+	{
+		std::ifstream file("/proc/stat");
+		std::string cpu;
+		unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+
+		if(file >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal && cpu == "cpu") {
+			unsigned long long cpuIdle = idle + iowait;
+			unsigned long long cpuTotal = user + nice + system + idle + iowait + irq + softirq + steal;
+
+			if(cpuTotal > cpuTotalPrevious && cpuTotalPrevious > 0) {
+				unsigned long long totalDelta = cpuTotal - cpuTotalPrevious;
+				unsigned long long idleDelta = cpuIdle >= cpuIdlePrevious ? cpuIdle - cpuIdlePrevious : 0;
+				newMetrics->emplace_back("CPU_USAGE", std::to_string(100 - std::min(100ULL, idleDelta * 100 / totalDelta)));
+			}
+			cpuIdlePrevious = cpuIdle;
+			cpuTotalPrevious = cpuTotal;
+		}
+	}
+
+	/* MemTotal:       16314372 kB
+	 * MemAvailable:    9561244 kB */
+	{
+		std::ifstream file("/proc/meminfo");
+		std::string line;
+		unsigned long long memTotal = 0;
+		unsigned long long memAvailable = 0;
+		bool hasMemAvailable = false;
+
+		while(std::getline(file, line)) {
+			std::istringstream lineStream(line);
+			std::string key;
+			unsigned long long value = 0;
+			if(!(lineStream >> key >> value)) {
+				continue;
+			}
+			if(key == "MemTotal:") {
+				memTotal = value;
+			}
+			else if(key == "MemAvailable:") {
+				memAvailable = value;
+				hasMemAvailable = true;
+			}
+			if(memTotal > 0 && hasMemAvailable) {
+				break;
+			}
+		}
+
+		if(memTotal > 0 && hasMemAvailable) {
+			newMetrics->emplace_back("MEM_USAGE", std::to_string((memTotal - std::min(memTotal, memAvailable)) * 100 / memTotal));
+		}
+	}
+
+	/* 0.52 0.58 0.59 1/467 12345 */
+	{
+		std::ifstream file("/proc/loadavg");
+		double load1 = 0.0, load5 = 0.0, load15 = 0.0;
+
+		if(file >> load1 >> load5 >> load15) {
+			newMetrics->emplace_back("LOAD_AVG_1", toString(load1));
+			newMetrics->emplace_back("LOAD_AVG_5", toString(load5));
+			newMetrics->emplace_back("LOAD_AVG_15", toString(load15));
+		}
+	}
+
+	if(!hostName.empty()) {
+		newMetrics->emplace_back("HOST_NAME", hostName);
+	}
+
+	if(newMetrics->empty()) {
+		logger.debug << "No metrics available from /proc\n";
+	}
+
+	std::atomic_store(&metrics, std::shared_ptr<const Metrics>(std::move(newMetrics)));
+}
+
+} /* namespace worker */
+} /* namespace batchelor */
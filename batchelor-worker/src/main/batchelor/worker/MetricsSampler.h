@@ -0,0 +1,71 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHELOR_WORKER_METRICSSAMPLER_H_
+#define BATCHELOR_WORKER_METRICSSAMPLER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace worker {
+
+/* MetricsSampler reads the built-in metrics of the host periodically in its own thread:
+ * - CPU_USAGE   cpu usage in percent since the last sample (/proc/stat)
+ * - MEM_USAGE   used memory in percent (/proc/meminfo)
+ * - LOAD_AVG_1, LOAD_AVG_5, LOAD_AVG_15 (/proc/loadavg)
+ * - HOST_NAME
+ * The latest sample is published as an immutable snapshot, so readers never wait for the sampler.
+ */
+class MetricsSampler {
+public:
+	using Metrics = std::vector<std::pair<std::string, std::string>>;
+
+	MetricsSampler(std::chrono::milliseconds interval);
+	~MetricsSampler();
+
+	std::shared_ptr<const Metrics> getMetrics() const;
+
+private:
+	const std::chrono::milliseconds interval;
+	const std::string hostName;
+
+	unsigned long long cpuIdlePrevious = 0;
+	unsigned long long cpuTotalPrevious = 0;
+
+	std::shared_ptr<const Metrics> metrics;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping = false;
+	std::thread thread;
+
+	void run();
+	void sample();
+};
+
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_METRICSSAMPLER_H_ */
@@ -20,6 +20,7 @@
 #include <batchelor/worker/Logger.h>
 #include <batchelor/worker/plugin/Task.h>
 #include <batchelor/worker/Procedure.h>
+#include <batchelor/worker/TaskCreating.h>
 #include <batchelor/worker/TaskFailed.h>
 
 #include <batchelor/common/Timestamp.h>
@@ -104,6 +105,18 @@ void addOrReplaceMetric(std::vector<std::pair<std::string, std::string>>& metric
 	metrics.emplace_back(key, value);
 }
 
+/* parameters of the head selection */
+constexpr double headEwmaAlpha = 0.2;
+constexpr double headErrorPenalty = 4.0;
+constexpr double headSpreadFactor = 1.5;
+constexpr double headSwitchFactor = 3.0;
+constexpr std::chrono::milliseconds headBackoffBase(500);
+constexpr std::chrono::milliseconds headBackoffMax(30000);
+
+bool isEqual(const service::schemas::TaskStatusWorker& a, const service::schemas::TaskStatusWorker& b) {
+	return a.state == b.state && a.returnCode == b.returnCode && a.message == b.message;
+}
+
 std::map<std::string, int> substractResources(std::map<std::string, int> resourcesAvailable, const std::map<std::string, int>& resourcesAllocated) {
 	for(const auto& resourceAllocated : resourcesAllocated) {
 		auto availableIter = resourcesAvailable.insert(std::make_pair(resourceAllocated.first, 0));
@@ -175,6 +188,22 @@ Procedure::Settings::Settings(const std::vector<std::pair<std::string, std::stri
 			}
 		}
 
+		else if(setting.first == "task-create-threads") {
+			try {
+				int value = std::stoi(setting.second);
+				if(value <= 0) {
+		            throw esl::system::Stacktrace::add(std::runtime_error("Value for attribute '" + setting.first + "' must be greater than 0 but it is \"" + setting.second + "\"."));
+				}
+				taskCreateThreads = static_cast<std::size_t>(value);
+			}
+			catch(const std::invalid_argument& e) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Invalid value \"" + setting.second + "\" for attribute '" + setting.first + "'."));
+			}
+			catch(const std::out_of_range& e) {
+	            throw esl::system::Stacktrace::add(std::runtime_error("Value \"" + setting.second + "\" for attribute '" + setting.first + "' is out of range."));
+			}
+		}
+
 		else if(setting.first == "task-factory-id") {
 			if(taskFactoryIds.insert(setting.second).second == false) {
 	            throw esl::system::Stacktrace::add(std::runtime_error("Multiple definition of attribute \"" + setting.first + "\"='" + setting.second + "'."));
@@ -262,7 +291,11 @@ std::unique_ptr<esl::object::Procedure> Procedure::create(const std::vector<std:
 }
 
 Procedure::Procedure(const Settings& aSettings)
-: settings(aSettings)
+: settings(aSettings),
+  metricsSampler(std::chrono::seconds(1)),
+  taskCreator(settings.taskCreateThreads),
+  sessionId(boost::uuids::to_string(rg())),
+  pollInterval(settings.requestIntervalMin)
 {
 	if(settings.connectionFactoryIds.empty()) {
 		throw std::runtime_error("No connections defined");
@@ -312,7 +345,7 @@ void Procedure::internalProcedureRun(esl::object::Context& context) {
 	bool doWait = false;
 	while(true) {
 		if(doWait) {
-			notifyCV.wait_for(lockNotifyMutex, settings.requestInterval);
+			notifyCV.wait_for(lockNotifyMutex, pollInterval);
 		}
 		if(signalsReceived > signalsProcessed) {
 			++signalsProcessed;
@@ -325,7 +358,7 @@ void Procedure::internalProcedureRun(esl::object::Context& context) {
 				signalTasks("kill");
 			}
 		}
-		doWait = !runResilient();
+		doWait = !runResilient(lockNotifyMutex);
 
 		if(settings.idleTimeout.count() > 0 && std::chrono::steady_clock::now() > idleTimeAt) {
 			logger.info << "Idle timeout occurred.\n";
@@ -356,6 +389,7 @@ void Procedure::procedureCancel() {
 
 void Procedure::initializeContext(esl::object::Context& context) {
 	initializedSettings.reset(new InitializedSettings(context, settings));
+	headHealth.assign(initializedSettings->connectionFactories.size(), HeadHealth());
 }
 
 std::map<std::string, int> Procedure::getResourcesAvailable() const {
@@ -388,6 +422,14 @@ std::vector<std::pair<std::string, std::string>> Procedure::getCurrentMetrics(co
 	/* put original metrics to the inital list of current metrics */
 	std::vector<std::pair<std::string, std::string>> rv = settings.metrics;
 
+	/* add sampled metrics of the host, if they are not defined by the settings */
+	std::shared_ptr<const MetricsSampler::Metrics> sampledMetrics = metricsSampler.getMetrics();
+	for(const auto& sampledMetric : *sampledMetrics) {
+		if(std::find_if(rv.begin(), rv.end(), [&sampledMetric](const std::pair<std::string, std::string>& metric) { return metric.first == sampledMetric.first; }) == rv.end()) {
+			rv.push_back(sampledMetric);
+		}
+	}
+
 	/* add or replace available resources to the list of current metrics */
 	for(const auto& resourceAvailable : resourcesAvailable) {
 		addOrReplaceMetric(rv, resourceAvailable.first, std::to_string(resourceAvailable.second));
@@ -412,32 +454,54 @@ void Procedure::signalTasks(const std::string& signal) {
 	}
 }
 
-bool Procedure::runResilient() {
-	std::size_t firstConnectionFactory = nextConnectionFactory;
-	do {
+bool Procedure::runResilient(std::unique_lock<std::mutex>& lockNotifyMutex) {
+	if(!initializedSettings) {
+		logger.warn << "InizializeContext has not been called.\n";
+		throw esl::system::Stacktrace::add(std::runtime_error("cannot create http connection factory."));
+	}
+
+	/* stay with the current head as long as it is not much worse than the best one */
+	if(client) {
+		std::size_t bestHead = selectHead();
+		if(bestHead != currentHead && bestHead < headHealth.size() && headHealth[bestHead].sampled
+		&& headHealth[currentHead].getScore() > headSwitchFactor * headHealth[bestHead].getScore()) {
+			logger.info << "Switching to head \"" << initializedSettings->connectionFactories[bestHead].first << "\" because it responds faster.\n";
+			disconnectHead();
+			connectHead(bestHead);
+		}
+	}
+
+	for(std::size_t attempt = 0; attempt < headHealth.size(); ++attempt) {
+		if(!client) {
+			std::size_t head = selectHead();
+			if(head >= headHealth.size()) {
+				break;
+			}
+			connectHead(head);
+		}
+
 		/* It is intended to stop the application, if an exception occurs.
 		 * (maybe there is a DB error, serialization error or other std::runtime_error)
 		 *
-		 * Only network errors are caught and we will retry with another connection factory
+		 * Only network errors are caught and we will retry with another head
 		 */
 		try {
-			return run();
+			return run(lockNotifyMutex);
 		}
 		catch(const esl::com::http::client::exception::NetworkError& e) {
 	        std::cerr << "NetworkError occurred: " << e.what() << "\n";
-			httpConnectionFactory = nullptr;
+			onHeadFailure();
+			disconnectHead();
 		}
-	} while(firstConnectionFactory != nextConnectionFactory);
+	}
 
     logger.debug << "Sleep...\n";
 
 	return false;
 }
 
-bool Procedure::run() {
+bool Procedure::run(std::unique_lock<std::mutex>& lockNotifyMutex) {
 	bool actionReceived = false;
-	auto httpConnection = createHTTPConnection();
-	service::client::Service client(*httpConnection);
 
 	/********************************************************
 	 * prepare data to send on performing request fetchTask *
@@ -445,9 +509,24 @@ bool Procedure::run() {
 
 	service::schemas::FetchRequest fetchRequest;
 
+	/* calculate allocated resources and get current metrics */
+	std::map<std::string, int> resourcesAvailable = getResourcesAvailable();
+	std::vector<std::pair<std::string, std::string>> metrics = getCurrentMetrics(resourcesAvailable, nullptr);
+
+	/* send a full snapshot if the head has not acknowledged one or if a metric has been removed since then */
+	fetchRequest.sessionId = sessionId;
+	fetchRequest.baseEpoch = ackedEpoch;
+	for(const auto& ackedMetric : ackedMetrics) {
+		if(std::find_if(metrics.begin(), metrics.end(), [&ackedMetric](const std::pair<std::string, std::string>& metric) { return metric.first == ackedMetric.first; }) == metrics.end()) {
+			fetchRequest.baseEpoch = 0;
+			break;
+		}
+	}
+
 	/* prepare task status list and count running threads */
 	std::vector<std::string> notRunningTaskIDs;
 	std::size_t tasksRunning = 0;
+	std::map<std::string, service::schemas::TaskStatusWorker> currentTasks;
 
 	for(const auto& task : taskByTaskId) {
 		service::schemas::TaskStatusWorker taskStatusWorker;
@@ -458,10 +537,14 @@ bool Procedure::run() {
 		taskStatusWorker.returnCode = taskStatus.returnCode;
 		taskStatusWorker.message = taskStatus.message;
 
-		fetchRequest.tasks.push_back(taskStatusWorker);
+		auto ackedTaskIter = ackedTasks.find(task.first);
+		if(fetchRequest.baseEpoch == 0 || ackedTaskIter == ackedTasks.end() || !isEqual(ackedTaskIter->second, taskStatusWorker)) {
+			fetchRequest.tasks.push_back(taskStatusWorker);
+		}
 
 		if(taskStatus.state == common::types::State::running) {
 			++tasksRunning;
+			currentTasks.emplace(task.first, std::move(taskStatusWorker));
 		}
 		else {
 			notRunningTaskIDs.push_back(task.first);
@@ -470,13 +553,22 @@ bool Procedure::run() {
 
 	fetchRequest.workerId = settings.workerId;
 
-	/* calculate allocated resources and get current metrics */
-	std::map<std::string, int> resourcesAvailable = getResourcesAvailable();
-	std::vector<std::pair<std::string, std::string>> metrics = getCurrentMetrics(resourcesAvailable, nullptr);
+	/* send output of the tasks that are watched at the head */
+	for(const auto& taskId : tailRequests) {
+		auto iter = taskByTaskId.find(taskId);
+		service::schemas::TaskOutput taskOutput;
+		if(iter != taskByTaskId.end() && iter->second->getOutput(taskOutput.out, taskOutput.err)) {
+			taskOutput.taskId = taskId;
+			fetchRequest.outputs.push_back(std::move(taskOutput));
+		}
+	}
 
 	/* prepare list of metrics for transmission */
 	for(const auto& metric : metrics) {
-		fetchRequest.metrics.push_back(service::schemas::Setting::make(metric.first, metric.second));
+		auto ackedMetricIter = ackedMetrics.find(metric.first);
+		if(fetchRequest.baseEpoch == 0 || ackedMetricIter == ackedMetrics.end() || ackedMetricIter->second != metric.second) {
+			fetchRequest.metrics.push_back(service::schemas::Setting::make(metric.first, metric.second));
+		}
 	}
 
 
@@ -499,7 +591,31 @@ bool Procedure::run() {
 	/*********************************
 	 * Perform the fetchTask request *
 	 *********************************/
-	service::schemas::FetchResponse fetchResponse = client.fetchTask(settings.namespaceId, fetchRequest);
+	service::schemas::FetchResponse fetchResponse;
+	{
+		/* tasks can update their status while we are waiting for the head */
+		lockNotifyMutex.unlock();
+		ScopeGuard scopeGuard([&lockNotifyMutex]() {
+			lockNotifyMutex.lock();
+		});
+		auto fetchStart = std::chrono::steady_clock::now();
+		fetchResponse = client->fetchTask(settings.namespaceId, fetchRequest);
+		onHeadSuccess(std::chrono::steady_clock::now() - fetchStart);
+	}
+
+	tailRequests = std::move(fetchResponse.tailRequests);
+
+	ackedEpoch = fetchResponse.epoch;
+	ackedMetrics.clear();
+	ackedTasks.clear();
+	if(ackedEpoch != 0) {
+		ackedMetrics.insert(metrics.begin(), metrics.end());
+		ackedTasks = std::move(currentTasks);
+	}
+	else if(fetchRequest.baseEpoch != 0) {
+		/* head did not know our snapshot and ignored the request, so send a full snapshot immediately */
+		return true;
+	}
 
 
 	/* send signals to tasks */
@@ -535,61 +651,160 @@ bool Procedure::run() {
 			continue;
 		}
 
-		std::unique_ptr<plugin::Task> task;
-		try {
-			task = iter->second.get().createTask(notifyCV, notifyMutex, getCurrentMetrics(resourcesAvailable, &runConfiguration), runConfiguration);
-		}
-		catch(const std::exception& e) {
-			logger.warn << "Could not create task " << runConfiguration.taskId << " for event type \"" << runConfiguration.eventType << "\" because exception occured with message \"" << e.what() << "\".\n";
-			plugin::Task::Status taskStatus;
+		/* the task is created by the executor and a placeholder is used until then */
+		TaskCreating* taskCreating = new TaskCreating(iter->second.get().getResourcesRequired());
+		taskByTaskId.insert(std::make_pair(runConfiguration.taskId, std::unique_ptr<plugin::Task>(taskCreating)));
 
-			taskStatus.state = common::types::State::Type::signaled;
-			taskStatus.returnCode = -1;
-			taskStatus.message = e.what();
+		plugin::TaskFactory& taskFactory = iter->second.get();
+		std::vector<std::pair<std::string, std::string>> taskMetrics = getCurrentMetrics(resourcesAvailable, &runConfiguration);
+		taskCreator.submit([this, &taskFactory, taskCreating, taskMetrics, runConfiguration]() {
+			std::unique_ptr<plugin::Task> task = createTask(taskFactory, taskMetrics, runConfiguration);
+			{
+				std::lock_guard<std::mutex> lockNotifyMutex(notifyMutex);
+				taskCreating->setTask(std::move(task));
+			}
+			notifyCV.notify_all();
+		});
+		actionReceived = true;
+	}
 
-			task.reset(new TaskFailed(std::move(taskStatus)));
+	/* a task that has finished while we were waiting for the head is reported without waiting for the next interval */
+	for(const auto& task : taskByTaskId) {
+		if(task.second->getStatus().state != common::types::State::running) {
+			actionReceived = true;
+			break;
 		}
-		catch(...) { }
+	}
 
-		if(!task) {
-			logger.warn << "Could not create task " << runConfiguration.taskId << " for event type \"" << runConfiguration.eventType << "\".\n";
-			plugin::Task::Status taskStatus;
+	if(tasksRunning > 0 || actionReceived) {
+	    idleTimeAt = std::chrono::steady_clock::now() + settings.idleTimeout;
+	}
 
-			taskStatus.state = common::types::State::Type::signaled;
-			taskStatus.returnCode = -1;
-			taskStatus.message = "creating task failed";
+	/* poll fast while work is flowing or output is watched and back off exponentially while idle, unless the head suggests a delay */
+	if(actionReceived || !tailRequests.empty()) {
+		pollInterval = settings.requestIntervalMin;
+	}
+	else {
+		pollInterval = std::min(settings.requestInterval, pollInterval * 2);
+	}
+	if(fetchResponse.nextPollMs == 0) {
+		return true;
+	}
+	if(fetchResponse.nextPollMs > 0) {
+		pollInterval = std::min(settings.requestInterval, std::chrono::milliseconds(fetchResponse.nextPollMs));
+	}
 
-			task.reset(new TaskFailed(std::move(taskStatus)));
-		}
+	return actionReceived;
+}
 
-		taskByTaskId.insert(std::make_pair(runConfiguration.taskId, std::move(task)));
-		actionReceived = true;
+std::unique_ptr<plugin::Task> Procedure::createTask(plugin::TaskFactory& taskFactory, const std::vector<std::pair<std::string, std::string>>& metrics, const service::schemas::RunConfiguration& runConfiguration) {
+	std::unique_ptr<plugin::Task> task;
+	try {
+		task = taskFactory.createTask(notifyCV, notifyMutex, metrics, runConfiguration);
 	}
+	catch(const std::exception& e) {
+		logger.warn << "Could not create task " << runConfiguration.taskId << " for event type \"" << runConfiguration.eventType << "\" because exception occured with message \"" << e.what() << "\".\n";
+		plugin::Task::Status taskStatus;
 
-	if(tasksRunning > 0 || actionReceived) {
-	    idleTimeAt = std::chrono::steady_clock::now() + settings.idleTimeout;
+		taskStatus.state = common::types::State::Type::signaled;
+		taskStatus.returnCode = -1;
+		taskStatus.message = e.what();
+
+		task.reset(new TaskFailed(std::move(taskStatus)));
 	}
+	catch(...) { }
 
-	return actionReceived;
+	if(!task) {
+		logger.warn << "Could not create task " << runConfiguration.taskId << " for event type \"" << runConfiguration.eventType << "\".\n";
+		plugin::Task::Status taskStatus;
+
+		taskStatus.state = common::types::State::Type::signaled;
+		taskStatus.returnCode = -1;
+		taskStatus.message = "creating task failed";
+
+		task.reset(new TaskFailed(std::move(taskStatus)));
+	}
+
+	return task;
 }
 
-std::unique_ptr<esl::com::http::client::Connection> Procedure::createHTTPConnection() const {
-	if(!httpConnectionFactory && initializedSettings && nextConnectionFactory < initializedSettings->connectionFactories.size()) {
-		httpConnectionFactory = &initializedSettings->connectionFactories[nextConnectionFactory].second.get();
-		nextConnectionFactory = (nextConnectionFactory + 1) % initializedSettings->connectionFactories.size();
+double Procedure::HeadHealth::getScore() const noexcept {
+	return latencyMs * (1.0 + headErrorPenalty * errorRate);
+}
+
+std::size_t Procedure::selectHead() {
+	auto now = std::chrono::steady_clock::now();
+
+	/* find the best score of all heads that are not backing off */
+	bool hasBestScore = false;
+	double bestScore = 0.0;
+	for(const auto& health : headHealth) {
+		if(health.retryAt <= now && health.sampled && (!hasBestScore || health.getScore() < bestScore)) {
+			hasBestScore = true;
+			bestScore = health.getScore();
+		}
 	}
-	if(!httpConnectionFactory) {
-		if(!initializedSettings) {
-			logger.warn << "InizializeContext has not been called.\n";
+
+	/* spread across all heads that are close to the best one, heads without samples are given a chance too */
+	std::vector<std::size_t> healthyHeads;
+	for(std::size_t head = 0; head < headHealth.size(); ++head) {
+		const HeadHealth& health = headHealth[head];
+		if(health.retryAt > now) {
+			continue;
+		}
+		if(!health.sampled || !hasBestScore || health.getScore() <= headSpreadFactor * bestScore) {
+			healthyHeads.push_back(head);
 		}
-		throw esl::system::Stacktrace::add(std::runtime_error("cannot create http connection factory."));
 	}
 
-	auto httpConnection = httpConnectionFactory->get().createConnection();
-	if(!httpConnection) {
+	if(healthyHeads.empty()) {
+		return std::string::npos;
+	}
+	return healthyHeads[std::uniform_int_distribution<std::size_t>(0, healthyHeads.size() - 1)(random)];
+}
+
+void Procedure::connectHead(std::size_t head) {
+	auto newHttpConnection = initializedSettings->connectionFactories[head].second.get().get().createConnection();
+	if(!newHttpConnection) {
 		throw esl::system::Stacktrace::add(std::runtime_error("cannot create http connection."));
 	}
-	return httpConnection;
+
+	currentHead = head;
+	httpConnection = std::move(newHttpConnection);
+	client.reset(new service::client::Service(*httpConnection));
+
+	/* next head does not know our snapshot */
+	ackedEpoch = 0;
+}
+
+void Procedure::disconnectHead() {
+	client.reset();
+	httpConnection.reset();
+}
+
+void Procedure::onHeadSuccess(std::chrono::steady_clock::duration latency) {
+	HeadHealth& health = headHealth[currentHead];
+	double latencyMs = std::chrono::duration<double, std::milli>(latency).count();
+
+	health.latencyMs = health.sampled ? health.latencyMs + headEwmaAlpha * (latencyMs - health.latencyMs) : latencyMs;
+	health.errorRate -= headEwmaAlpha * health.errorRate;
+	health.sampled = true;
+	health.failures = 0;
+}
+
+void Procedure::onHeadFailure() {
+	HeadHealth& health = headHealth[currentHead];
+
+	health.errorRate += headEwmaAlpha * (1.0 - health.errorRate);
+	++health.failures;
+
+	/* exponential backoff with jitter: a random delay between half and full backoff time */
+	std::chrono::milliseconds backoff = headBackoffMax;
+	if(health.failures < 16) {
+		backoff = std::min(headBackoffMax, headBackoffBase * (1 << (health.failures - 1)));
+	}
+	std::uniform_int_distribution<long> jitter(backoff.count() / 2, backoff.count());
+	health.retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(jitter(random));
 }
 
 } /* namespace worker */
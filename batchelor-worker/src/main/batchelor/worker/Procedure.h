@@ -22,9 +22,13 @@
 #include <batchelor/common/Procedure.h>
 #include <batchelor/common/plugin/ConnectionFactory.h>
 
+#include <batchelor/service/client/Service.h>
 #include <batchelor/service/schemas/RunConfiguration.h>
+#include <batchelor/service/schemas/TaskStatusWorker.h>
 #include <batchelor/service/Service.h>
 
+#include <batchelor/worker/Executor.h>
+#include <batchelor/worker/MetricsSampler.h>
 #include <batchelor/worker/plugin/Task.h>
 #include <batchelor/worker/plugin/TaskFactory.h>
 
@@ -39,6 +43,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <set>
 #include <string>
 #include <utility>
@@ -57,9 +62,11 @@ public:
 		std::string workerId;
 
 		std::vector<std::pair<std::string, std::string>> metrics;
-		std::chrono::milliseconds requestInterval{5000};
+		std::chrono::milliseconds requestInterval{5000}; // longest interval between two requests while idle
+		std::chrono::milliseconds requestIntervalMin{500}; // interval after work has been received
 		std::chrono::milliseconds idleTimeout{0};
 		std::chrono::milliseconds availableTimeout{0};
+		std::size_t taskCreateThreads = 4;
 		std::set<std::string> taskFactoryIds;
 		std::set<std::string> connectionFactoryIds;
 		std::uint16_t alivePort = 0;
@@ -91,10 +98,27 @@ private:
 
 	void signalTasks(const std::string& signal);
 
-	bool runResilient();
-	bool run();
+	bool runResilient(std::unique_lock<std::mutex>& lockNotifyMutex);
+	bool run(std::unique_lock<std::mutex>& lockNotifyMutex);
 
-	std::unique_ptr<esl::com::http::client::Connection> createHTTPConnection() const;
+	std::unique_ptr<plugin::Task> createTask(plugin::TaskFactory& taskFactory, const std::vector<std::pair<std::string, std::string>>& metrics, const service::schemas::RunConfiguration& runConfiguration);
+
+	/* health of a head, tracked per connection factory */
+	struct HeadHealth {
+		bool sampled = false;
+		double latencyMs = 0.0; // EWMA of the fetch latency
+		double errorRate = 0.0; // EWMA of failed requests
+		unsigned int failures = 0; // consecutive failures, used for the backoff
+		std::chrono::steady_clock::time_point retryAt;
+
+		double getScore() const noexcept;
+	};
+
+	std::size_t selectHead();
+	void connectHead(std::size_t head);
+	void disconnectHead();
+	void onHeadSuccess(std::chrono::steady_clock::duration latency);
+	void onHeadFailure();
 
 	const Settings settings;
 	std::unique_ptr<InitializedSettings> initializedSettings;
@@ -102,8 +126,14 @@ private:
 	std::unique_ptr<esl::com::http::server::Socket> socket;
 	std::mutex socketMutex;
 
-	mutable std::size_t nextConnectionFactory = 0;
-	mutable common::plugin::ConnectionFactory* httpConnectionFactory = nullptr;
+	/* same index as connectionFactories of initialized settings */
+	std::vector<HeadHealth> headHealth;
+	std::size_t currentHead = 0;
+	std::mt19937 random{std::random_device{}()};
+
+	/* kept open across requests and only recreated after a network error */
+	std::unique_ptr<esl::com::http::client::Connection> httpConnection;
+	std::unique_ptr<service::client::Service> client;
 
 	std::condition_variable notifyCV;
 	std::mutex notifyMutex;
@@ -111,7 +141,25 @@ private:
 	std::size_t signalsProcessed = 0;
 	std::size_t signalsReceivedMax = 3;
 
+	MetricsSampler metricsSampler;
+
 	std::map<std::string, std::unique_ptr<plugin::Task>> taskByTaskId;
+
+	/* creates tasks in the background, so a slow task factory does not delay the requests to the head */
+	Executor taskCreator;
+
+	/* snapshot acknowledged by the head, used to send only changed metrics and task states */
+	const std::string sessionId;
+	int ackedEpoch = 0;
+	std::map<std::string, std::string> ackedMetrics;
+	std::map<std::string, service::schemas::TaskStatusWorker> ackedTasks;
+
+	/* current interval between two requests, it grows while there is nothing to do */
+	std::chrono::milliseconds pollInterval;
+
+	/* ids of the tasks the head asked for the output of with the last response */
+	std::vector<std::string> tailRequests;
+
 	std::chrono::time_point<std::chrono::steady_clock> idleTimeAt;
 	std::chrono::time_point<std::chrono::steady_clock> unavailableTimeAt;
 	bool availableTimeoutOccurred = false;
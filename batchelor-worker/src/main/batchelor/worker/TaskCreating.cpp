@@ -0,0 +1,66 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/common/types/State.h>
+
+#include <batchelor/worker/TaskCreating.h>
+
+#include <utility>
+
+namespace batchelor {
+namespace worker {
+
+TaskCreating::TaskCreating(const std::map<std::string, int>& resources)
+: plugin::Task(resources)
+{ }
+
+plugin::Task::Status TaskCreating::getStatus() const {
+	if(task) {
+		return task->getStatus();
+	}
+
+	plugin::Task::Status status;
+	status.state = common::types::State::Type::running;
+	status.returnCode = 0;
+	return status;
+}
+
+void TaskCreating::sendSignal(const std::string& signal) {
+	if(task) {
+		task->sendSignal(signal);
+	}
+	else {
+		signals.push_back(signal);
+	}
+}
+
+bool TaskCreating::getOutput(std::string& out, std::string& err) const {
+	return task && task->getOutput(out, err);
+}
+
+void TaskCreating::setTask(std::unique_ptr<plugin::Task> aTask) {
+	task = std::move(aTask);
+
+	for(const auto& signal : signals) {
+		task->sendSignal(signal);
+	}
+	signals.clear();
+}
+
+} /* namespace worker */
+} /* namespace batchelor */
@@ -0,0 +1,53 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHELOR_WORKER_TASKCREATING_H_
+#define BATCHELOR_WORKER_TASKCREATING_H_
+
+#include <batchelor/worker/plugin/Task.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace batchelor {
+namespace worker {
+
+/* TaskCreating stands for a task while the task factory is still creating it.
+ * It reports state "running" and keeps signals until the task has been set.
+ * All methods must be called with the notify mutex of the procedure locked. */
+class TaskCreating : public plugin::Task {
+public:
+	TaskCreating(const std::map<std::string, int>& resources);
+
+	plugin::Task::Status getStatus() const override;
+	void sendSignal(const std::string& signal) override;
+	bool getOutput(std::string& out, std::string& err) const override;
+
+	void setTask(std::unique_ptr<plugin::Task> task);
+
+private:
+	std::unique_ptr<plugin::Task> task;
+	std::vector<std::string> signals;
+};
+
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_TASKCREATING_H_ */
@@ -30,6 +30,10 @@ const std::map<std::string, int>& Task::getResources() const noexcept {
 	return resources;
 }
 
+bool Task::getOutput(std::string& out, std::string& err) const {
+	return false;
+}
+
 } /* namespace plugin */
 } /* namespace worker */
 } /* namespace batchelor */
@@ -44,6 +44,9 @@ public:
 	virtual Status getStatus() const = 0;
 	virtual void sendSignal(const std::string& signal) = 0;
 
+	/* Returns the last output of the task on stdout and stderr, or false if the task does not buffer its output. */
+	virtual bool getOutput(std::string& out, std::string& err) const;
+
 private:
 	const std::map<std::string, int> resources;
 };
@@ -0,0 +1,136 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/worker/Logger.h>
+#include <batchelor/worker/plugin/exec/CGroup.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+namespace {
+Logger logger("batchelor::worker::plugin::exec::CGroup");
+
+bool writeFile(const std::string& filename, const std::string& value) {
+	std::ofstream file(filename);
+	file << value;
+	file.flush();
+	return static_cast<bool>(file);
+}
+}
+
+CGroup::CGroup(const std::string& parent, const std::string& name, const Limits& limits)
+: path(parent + "/" + name)
+{
+	if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot create cgroup \"" + path + "\": " + std::strerror(errno)));
+	}
+
+	if(!limits.cpuMax.empty() && !writeFile(path + "/cpu.max", limits.cpuMax)) {
+		logger.warn << "Cannot set cpu.max of cgroup \"" << path << "\" to \"" << limits.cpuMax << "\"\n";
+	}
+	if(!limits.memoryMax.empty() && !writeFile(path + "/memory.max", limits.memoryMax)) {
+		logger.warn << "Cannot set memory.max of cgroup \"" << path << "\" to \"" << limits.memoryMax << "\"\n";
+	}
+	if(!limits.ioMax.empty() && !writeFile(path + "/io.max", limits.ioMax)) {
+		logger.warn << "Cannot set io.max of cgroup \"" << path << "\" to \"" << limits.ioMax << "\"\n";
+	}
+}
+
+CGroup::~CGroup() {
+	if(!tryRemove()) {
+		logger.warn << "Cannot remove cgroup \"" << path << "\": " << std::strerror(EBUSY) << "\n";
+	}
+}
+
+const std::string& CGroup::getPath() const noexcept {
+	return path;
+}
+
+bool CGroup::tryRemove() noexcept {
+	if(removed) {
+		return true;
+	}
+
+	/* processes forked by the task might still be alive */
+	if(!killed) {
+		killed = true;
+		writeFile(path + "/cgroup.kill", "1");
+	}
+
+	if(rmdir(path.c_str()) != 0) {
+		if(errno == EBUSY) {
+			return false;
+		}
+		logger.warn << "Cannot remove cgroup \"" << path << "\": " << std::strerror(errno) << "\n";
+	}
+
+	removed = true;
+	return true;
+}
+
+CGroup::Usage CGroup::getUsage() const {
+	Usage usage;
+
+	/* usage_usec 123456
+	 * user_usec 100000
+	 * ... */
+	std::ifstream cpuStat(path + "/cpu.stat");
+	std::string key;
+	unsigned long long value = 0;
+	while(cpuStat >> key >> value) {
+		if(key == "usage_usec") {
+			usage.hasCpuUsage = true;
+			usage.cpuUsage = std::chrono::microseconds(value);
+			break;
+		}
+	}
+
+	/* memory.peak is available since Linux 5.19 */
+	std::ifstream memoryPeak(path + "/memory.peak");
+	if(memoryPeak >> value) {
+		usage.hasMemoryPeak = true;
+		usage.memoryPeak = value;
+	}
+
+	return usage;
+}
+
+void CGroup::enableControllers(const std::string& parent) {
+	/* one by one, because writing fails completely if one controller is not available */
+	for(const char* controller : { "cpu", "memory", "io" }) {
+		if(!writeFile(parent + "/cgroup.subtree_control", std::string("+") + controller)) {
+			logger.warn << "Cannot enable controller " << controller << " for cgroup \"" << parent << "\"\n";
+		}
+	}
+}
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
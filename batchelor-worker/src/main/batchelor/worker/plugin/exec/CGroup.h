@@ -0,0 +1,73 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHELOR_WORKER_PLUGIN_EXEC_CGROUP_H_
+#define BATCHELOR_WORKER_PLUGIN_EXEC_CGROUP_H_
+
+#include <chrono>
+#include <string>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+
+/* CGroup creates a cgroup v2 for a single task below a parent cgroup and applies its limits.
+ * Remaining processes of the cgroup are killed before it is removed. Killing is asynchronous, so the cgroup
+ * might still be busy right after. Removal is retried by tryRemove() without blocking, see Supervisor::removeCGroup.
+ * The destructor tries it only once. */
+class CGroup {
+public:
+	struct Limits {
+		std::string cpuMax;    // value of cpu.max, e.g. "200000 100000" for 2 CPUs
+		std::string memoryMax; // value of memory.max in bytes
+		std::string ioMax;     // value of io.max, e.g. "8:0 rbps=1048576 wbps=1048576"
+	};
+
+	struct Usage {
+		bool hasCpuUsage = false;
+		std::chrono::microseconds cpuUsage{0};
+		bool hasMemoryPeak = false;
+		unsigned long long memoryPeak = 0; // bytes
+	};
+
+	CGroup(const std::string& parent, const std::string& name, const Limits& limits);
+	~CGroup();
+
+	const std::string& getPath() const noexcept;
+	Usage getUsage() const;
+
+	/* Kills remaining processes on the first call and tries to remove the cgroup.
+	 * Returns false if the cgroup is still busy and removal should be tried again later. */
+	bool tryRemove() noexcept;
+
+	/* enables the cpu, memory and io controller for the children of the parent cgroup */
+	static void enableControllers(const std::string& parent);
+
+private:
+	std::string path;
+	bool killed = false;
+	bool removed = false;
+};
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_PLUGIN_EXEC_CGROUP_H_ */
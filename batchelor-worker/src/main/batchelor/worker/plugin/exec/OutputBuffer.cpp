@@ -0,0 +1,90 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/worker/plugin/exec/OutputBuffer.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+
+OutputBuffer::OutputBuffer(std::size_t aCapacity)
+: capacity(aCapacity),
+  data(new char[aCapacity])
+{
+	if(capacity == 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Capacity of output buffer must be greater than 0."));
+	}
+}
+
+ssize_t OutputBuffer::readFrom(int fd, std::size_t size) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	/* no need to read more than the ring can hold, the remaining bytes are read by the next call */
+	size = std::min(size, capacity);
+
+	/* the free space behind the write position and the space at the beginning of the ring */
+	iovec iov[2];
+	iov[0].iov_base = data.get() + position;
+	iov[0].iov_len = std::min(size, capacity - position);
+	iov[1].iov_base = data.get();
+	iov[1].iov_len = size - iov[0].iov_len;
+
+	ssize_t count = readv(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+	if(count > 0) {
+		position = (position + static_cast<std::size_t>(count)) % capacity;
+		total += static_cast<std::uint64_t>(count);
+	}
+	return count;
+}
+
+std::string OutputBuffer::getTail() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::size_t size = total < capacity ? static_cast<std::size_t>(total) : capacity;
+	std::size_t begin = (position + capacity - size) % capacity;
+
+	std::string tail;
+	tail.reserve(size);
+	if(begin + size <= capacity) {
+		tail.append(data.get() + begin, size);
+	}
+	else {
+		tail.append(data.get() + begin, capacity - begin);
+		tail.append(data.get(), size - (capacity - begin));
+	}
+	return tail;
+}
+
+std::uint64_t OutputBuffer::getTotal() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return total;
+}
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
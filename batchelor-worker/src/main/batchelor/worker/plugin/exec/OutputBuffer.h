@@ -0,0 +1,63 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_WORKER_PLUGIN_EXEC_OUTPUTBUFFER_H_
+#define BATCHELOR_WORKER_PLUGIN_EXEC_OUTPUTBUFFER_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+
+/* OutputBuffer keeps the last bytes a process has written to stdout or stderr in a ring of fixed size.
+ * The supervisor reads from the pipe of the process directly into the ring, older bytes are overwritten. */
+class OutputBuffer {
+public:
+	OutputBuffer(std::size_t capacity);
+
+	/* Reads at most "size" bytes from "fd" into the ring. Returns the result of readv. */
+	ssize_t readFrom(int fd, std::size_t size);
+
+	/* Returns the last bytes of the output, at most "capacity" bytes. */
+	std::string getTail() const;
+
+	/* Returns the number of bytes written to the buffer so far, including overwritten bytes. */
+	std::uint64_t getTotal() const;
+
+private:
+	mutable std::mutex mutex;
+	const std::size_t capacity;
+	std::unique_ptr<char[]> data;
+	std::size_t position = 0;
+	std::uint64_t total = 0;
+};
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_PLUGIN_EXEC_OUTPUTBUFFER_H_ */
@@ -0,0 +1,737 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <batchelor/worker/Logger.h>
+#include <batchelor/worker/plugin/exec/Supervisor.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+
+namespace {
+Logger logger("batchelor::worker::plugin::exec::Supervisor");
+
+/* interval to check processes with waitpid if there is no pidfd available */
+constexpr int pollIntervalMs = 100;
+
+/* interval and time limit to retry the removal of a cgroup that is busy while its processes are killed */
+constexpr int cgroupRetryIntervalMs = 10;
+constexpr std::chrono::milliseconds cgroupRemoveTimeout(500);
+
+/* epoll data of the wakeup fd, events of streams carry the stream id with this flag, all other events carry the pid of the process */
+constexpr std::uint64_t wakeupEventData = static_cast<std::uint64_t>(-1);
+constexpr std::uint64_t streamEventFlag = static_cast<std::uint64_t>(1) << 62;
+
+/* maximum number of bytes transferred from a pipe at once, so a chatty process cannot starve the others */
+constexpr std::size_t chunkSize = 65536;
+
+/* maximum number of chunks transferred from a pipe when its process has exited */
+constexpr std::size_t maxDrainChunks = 16;
+
+int openPidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+	return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+std::runtime_error makeSystemError(const std::string& message, int errorNumber) {
+	return std::runtime_error(message + ": " + std::strerror(errorNumber));
+}
+
+class FileActions {
+public:
+	FileActions() {
+		posix_spawn_file_actions_init(&fileActions);
+	}
+	~FileActions() {
+		posix_spawn_file_actions_destroy(&fileActions);
+	}
+
+	posix_spawn_file_actions_t fileActions;
+};
+
+class Pipe {
+public:
+	~Pipe() {
+		for(int fd : fds) {
+			if(fd >= 0) {
+				close(fd);
+			}
+		}
+	}
+
+	void open() {
+		if(pipe2(fds, O_CLOEXEC) != 0) {
+			throw esl::system::Stacktrace::add(makeSystemError("pipe2 failed", errno));
+		}
+	}
+
+	int release(int index) {
+		int fd = fds[index];
+		fds[index] = -1;
+		return fd;
+	}
+
+	int fds[2] = {-1, -1};
+};
+
+class SpawnAttributes {
+public:
+	SpawnAttributes() {
+		posix_spawnattr_init(&spawnAttributes);
+	}
+	~SpawnAttributes() {
+		posix_spawnattr_destroy(&spawnAttributes);
+		if(cgroupFd >= 0) {
+			close(cgroupFd);
+		}
+	}
+
+	posix_spawnattr_t spawnAttributes;
+	int cgroupFd = -1;
+};
+
+const std::map<std::string, int>& getSignalNumbers() {
+	static const std::map<std::string, int> signalNumbers = {
+		{"SIGHUP", SIGHUP}, {"hangup", SIGHUP},
+		{"SIGINT", SIGINT}, {"interrupt", SIGINT},
+		{"SIGQUIT", SIGQUIT}, {"quit", SIGQUIT},
+		{"SIGILL", SIGILL}, {"ill", SIGILL},
+		{"SIGTRAP", SIGTRAP}, {"trap", SIGTRAP},
+		{"SIGABRT", SIGABRT}, {"abort", SIGABRT},
+		{"SIGBUS", SIGBUS}, {"bus", SIGBUS},
+		{"SIGFPE", SIGFPE}, {"fpe", SIGFPE},
+		{"SIGKILL", SIGKILL}, {"kill", SIGKILL},
+		{"SIGUSR1", SIGUSR1}, {"user1", SIGUSR1},
+		{"SIGSEGV", SIGSEGV}, {"segv", SIGSEGV},
+		{"SIGUSR2", SIGUSR2}, {"user2", SIGUSR2},
+		{"SIGPIPE", SIGPIPE}, {"pipe", SIGPIPE},
+		{"SIGALRM", SIGALRM}, {"alarm", SIGALRM},
+		{"SIGTERM", SIGTERM}, {"terminate", SIGTERM},
+#ifdef SIGSTKFLT
+		{"SIGSTKFLT", SIGSTKFLT},
+#endif
+		{"SIGCHLD", SIGCHLD}, {"child", SIGCHLD},
+		{"SIGCONT", SIGCONT}, {"continue", SIGCONT},
+		{"SIGSTOP", SIGSTOP}, {"stop", SIGSTOP},
+		{"SIGTSTP", SIGTSTP},
+		{"SIGTTIN", SIGTTIN},
+		{"SIGTTOU", SIGTTOU},
+		{"SIGURG", SIGURG},
+		{"SIGXCPU", SIGXCPU},
+		{"SIGXFSZ", SIGXFSZ},
+		{"SIGVTALRM", SIGVTALRM},
+		{"SIGPROF", SIGPROF},
+		{"SIGWINCH", SIGWINCH},
+		{"SIGIO", SIGIO},
+#ifdef SIGPWR
+		{"SIGPWR", SIGPWR},
+#endif
+		{"SIGSYS", SIGSYS}
+	};
+	return signalNumbers;
+}
+
+/* files are opened by the supervisor and not by the process, so relative paths have to be resolved to the working directory */
+std::string resolvePath(const std::string& cd, const std::string& filename) {
+	if(cd.empty() || filename.empty() || filename.front() == '/') {
+		return filename;
+	}
+	return cd + "/" + filename;
+}
+
+/* Output files are truncated when the process is started, but not if writing continues after a failed rotation.
+ * No O_APPEND, because splice does not support it. */
+int openFile(const std::string& filename, bool truncate) {
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+	if(fd < 0) {
+		logger.warn << "Cannot open file \"" << filename << "\": " << std::strerror(errno) << "\n";
+	}
+	return fd;
+}
+} /* anonymous namespace */
+
+Supervisor::Supervisor() {
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if(epollFd < 0) {
+		throw esl::system::Stacktrace::add(makeSystemError("epoll_create1 failed", errno));
+	}
+
+	wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(wakeupFd < 0) {
+		int errorNumber = errno;
+		close(epollFd);
+		throw esl::system::Stacktrace::add(makeSystemError("eventfd failed", errorNumber));
+	}
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = wakeupEventData;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &event);
+
+	thread = std::thread(&Supervisor::run, this);
+}
+
+Supervisor::~Supervisor() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	std::uint64_t value = 1;
+	if(write(wakeupFd, &value, sizeof(value)) < 0) {
+		logger.warn << "Cannot wake up supervisor thread.\n";
+	}
+	thread.join();
+
+	for(auto& process : processes) {
+		if(process.second.pidfd >= 0) {
+			close(process.second.pidfd);
+		}
+	}
+	while(!streams.empty()) {
+		closeStream(streams.begin()->first);
+	}
+	close(wakeupFd);
+	close(epollFd);
+}
+
+pid_t Supervisor::spawn(const SpawnSettings& spawnSettings, OnExit onExit) {
+	if(spawnSettings.argv == nullptr || spawnSettings.argv[0] == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("No executable defined to create a process."));
+	}
+
+	FileActions fileActions;
+	if(!spawnSettings.cd.empty()) {
+		posix_spawn_file_actions_addchdir_np(&fileActions.fileActions, spawnSettings.cd.c_str());
+	}
+
+	/* stdout and stderr are connected to a pipe if they are buffered or if their file is rotated.
+	 * If both are written to the same file, then they share one pipe or one file descriptor,
+	 * because the file is not opened with O_APPEND. */
+	bool outPiped = spawnSettings.outBuffer || (spawnSettings.maxFileSize > 0 && !spawnSettings.outfile.empty());
+	bool errPiped = spawnSettings.errBuffer || (spawnSettings.maxFileSize > 0 && !spawnSettings.errfile.empty());
+	bool sameFile = !spawnSettings.outfile.empty() && spawnSettings.outfile == spawnSettings.errfile;
+	if(sameFile && (outPiped || errPiped)) {
+		outPiped = true;
+		errPiped = false;
+	}
+
+	Pipe outPipe;
+	if(outPiped) {
+		outPipe.open();
+		posix_spawn_file_actions_adddup2(&fileActions.fileActions, outPipe.fds[1], STDOUT_FILENO);
+		if(sameFile) {
+			posix_spawn_file_actions_adddup2(&fileActions.fileActions, outPipe.fds[1], STDERR_FILENO);
+		}
+	}
+	else if(!spawnSettings.outfile.empty()) {
+		posix_spawn_file_actions_addopen(&fileActions.fileActions, STDOUT_FILENO, spawnSettings.outfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(sameFile) {
+			posix_spawn_file_actions_adddup2(&fileActions.fileActions, STDOUT_FILENO, STDERR_FILENO);
+		}
+	}
+
+	Pipe errPipe;
+	if(errPiped) {
+		errPipe.open();
+		posix_spawn_file_actions_adddup2(&fileActions.fileActions, errPipe.fds[1], STDERR_FILENO);
+	}
+	else if(!spawnSettings.errfile.empty() && !sameFile) {
+		posix_spawn_file_actions_addopen(&fileActions.fileActions, STDERR_FILENO, spawnSettings.errfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+
+	std::vector<std::string> envStrings;
+	std::vector<char*> envp;
+	for(const auto& env : spawnSettings.envs) {
+		envStrings.push_back(env.first + "=" + env.second);
+	}
+	for(auto& envString : envStrings) {
+		envp.push_back(&envString[0]);
+	}
+	envp.push_back(nullptr);
+
+	SpawnAttributes spawnAttributes;
+	bool startedInCGroup = false;
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 39)
+	/* start the process directly in its cgroup (CLONE_INTO_CGROUP) */
+	if(!spawnSettings.cgroup.empty()) {
+		spawnAttributes.cgroupFd = open(spawnSettings.cgroup.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(spawnAttributes.cgroupFd >= 0) {
+			posix_spawnattr_setcgroup_np(&spawnAttributes.spawnAttributes, spawnAttributes.cgroupFd);
+			posix_spawnattr_setflags(&spawnAttributes.spawnAttributes, POSIX_SPAWN_SETCGROUP);
+			startedInCGroup = true;
+		}
+	}
+#endif
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	pid_t pid = 0;
+	int result = posix_spawnp(&pid, spawnSettings.argv[0], &fileActions.fileActions, &spawnAttributes.spawnAttributes, spawnSettings.argv, envp.data());
+	if(result != 0) {
+		throw esl::system::Stacktrace::add(makeSystemError("Cannot execute \"" + std::string(spawnSettings.argv[0]) + "\"", result));
+	}
+
+	/* Without CLONE_INTO_CGROUP the process is moved right after it has been started.
+	 * Processes it forks before are not part of the cgroup. */
+	if(!spawnSettings.cgroup.empty() && !startedInCGroup) {
+		int procsFd = open((spawnSettings.cgroup + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+		std::string pidStr = std::to_string(pid);
+		if(procsFd < 0 || write(procsFd, pidStr.data(), pidStr.size()) < 0) {
+			logger.warn << "Cannot move process " << pid << " into cgroup \"" << spawnSettings.cgroup << "\"\n";
+		}
+		if(procsFd >= 0) {
+			close(procsFd);
+		}
+	}
+
+	Process process;
+	process.pid = pid;
+	process.pidfd = openPidfd(pid);
+	process.onExit = std::move(onExit);
+
+	if(process.pidfd >= 0) {
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u64 = static_cast<std::uint64_t>(pid);
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, process.pidfd, &event);
+	}
+	else {
+		++processesWithoutPidfd;
+
+		/* wake up the thread to switch to polling */
+		std::uint64_t value = 1;
+		if(write(wakeupFd, &value, sizeof(value)) < 0) {
+			logger.warn << "Cannot wake up supervisor thread.\n";
+		}
+	}
+
+	processes.emplace(pid, std::move(process));
+	logger.debug << "Process " << pid << " started.\n";
+
+	if(outPiped) {
+		addStream(pid, outPipe.release(0), resolvePath(spawnSettings.cd, spawnSettings.outfile), spawnSettings.maxFileSize, spawnSettings.outBuffer);
+	}
+	if(errPiped) {
+		addStream(pid, errPipe.release(0), resolvePath(spawnSettings.cd, spawnSettings.errfile), spawnSettings.maxFileSize, spawnSettings.errBuffer);
+	}
+
+	return pid;
+}
+
+void Supervisor::removeCGroup(std::unique_ptr<CGroup> cgroup) {
+	if(!cgroup) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		PendingCGroup pendingCGroup;
+		pendingCGroup.cgroup = std::move(cgroup);
+		pendingCGroup.deadline = std::chrono::steady_clock::now() + cgroupRemoveTimeout;
+		pendingCGroups.push_back(std::move(pendingCGroup));
+	}
+
+	/* the first attempt is done by the supervisor thread as well, it might be busy in epoll_wait without timeout */
+	std::uint64_t value = 1;
+	if(write(wakeupFd, &value, sizeof(value)) < 0) {
+		logger.warn << "Cannot wake up supervisor thread.\n";
+	}
+}
+
+void Supervisor::sendSignal(pid_t pid, const std::string& signal) {
+	int signalNumber = toSignalNumber(signal);
+
+	/* the process is not reaped as long as it is registered, so the pid cannot be reused meanwhile */
+	std::lock_guard<std::mutex> lock(mutex);
+	if(processes.count(pid) > 0) {
+		kill(pid, signalNumber);
+	}
+}
+
+int Supervisor::toSignalNumber(const std::string& signal) {
+	const auto& signalNumbers = getSignalNumbers();
+	auto iter = signalNumbers.find(signal);
+	if(iter != signalNumbers.end()) {
+		return iter->second;
+	}
+
+	if(signal.size() > 8 && (signal.compare(0, 8, "SIGRTMIN") == 0 || signal.compare(0, 8, "SIGRTMAX") == 0)) {
+		int offset = std::stoi(signal.substr(8));
+		int signalNumber = (signal.compare(0, 8, "SIGRTMIN") == 0 ? SIGRTMIN : SIGRTMAX) + offset;
+		if(signalNumber >= SIGRTMIN && signalNumber <= SIGRTMAX) {
+			return signalNumber;
+		}
+	}
+	else if(signal == "SIGRTMIN") {
+		return SIGRTMIN;
+	}
+	else if(signal == "SIGRTMAX") {
+		return SIGRTMAX;
+	}
+	else if(!signal.empty() && signal.find_first_not_of("0123456789") == std::string::npos) {
+		int signalNumber = std::stoi(signal);
+		if(signalNumber > 0 && signalNumber <= SIGRTMAX) {
+			return signalNumber;
+		}
+	}
+
+	throw esl::system::Stacktrace::add(std::runtime_error("Unknown signal \"" + signal + "\"."));
+}
+
+void Supervisor::run() {
+	std::vector<epoll_event> events(64);
+
+	while(true) {
+		int timeout = -1;
+		bool polling;
+		bool removing;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(stopping) {
+				break;
+			}
+			polling = processesWithoutPidfd > 0;
+			removing = !pendingCGroups.empty();
+		}
+		if(polling) {
+			timeout = pollIntervalMs;
+		}
+		if(removing) {
+			timeout = cgroupRetryIntervalMs;
+		}
+
+		int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeout);
+		if(count < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			logger.error << "epoll_wait failed: " << std::strerror(errno) << "\n";
+			break;
+		}
+
+		for(int i = 0; i < count; ++i) {
+			if(events[i].data.u64 == wakeupEventData) {
+				std::uint64_t value;
+				if(read(wakeupFd, &value, sizeof(value)) < 0) {
+					logger.debug << "Nothing to read from wakeup fd.\n";
+				}
+				continue;
+			}
+			if(events[i].data.u64 & streamEventFlag) {
+				std::uint64_t streamId = events[i].data.u64 & ~streamEventFlag;
+				Stream* stream = findStream(streamId);
+				if(stream && transfer(*stream) < 0) {
+					closeStream(streamId);
+				}
+				continue;
+			}
+			reap(static_cast<pid_t>(events[i].data.u64));
+		}
+
+		if(polling) {
+			std::vector<pid_t> pids;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for(const auto& process : processes) {
+					if(process.second.pidfd < 0) {
+						pids.push_back(process.first);
+					}
+				}
+			}
+			for(pid_t pid : pids) {
+				reap(pid);
+			}
+		}
+
+		removePendingCGroups();
+	}
+}
+
+void Supervisor::reap(pid_t pid) {
+	OnExit onExit;
+	int returnCode = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iter = processes.find(pid);
+		if(iter == processes.end()) {
+			return;
+		}
+
+		int status = 0;
+		pid_t result = waitpid(pid, &status, WNOHANG);
+		if(result == 0) {
+			return;
+		}
+		if(result < 0) {
+			logger.warn << "waitpid failed for process " << pid << ": " << std::strerror(errno) << "\n";
+			returnCode = -1;
+		}
+		else if(WIFEXITED(status)) {
+			returnCode = WEXITSTATUS(status);
+		}
+		else if(WIFSIGNALED(status)) {
+			returnCode = 128 + WTERMSIG(status);
+		}
+
+		if(iter->second.pidfd >= 0) {
+			epoll_ctl(epollFd, EPOLL_CTL_DEL, iter->second.pidfd, nullptr);
+			close(iter->second.pidfd);
+		}
+		else {
+			--processesWithoutPidfd;
+		}
+
+		onExit = std::move(iter->second.onExit);
+		processes.erase(iter);
+	}
+
+	logger.debug << "Process " << pid << " finished, rc=" << returnCode << "\n";
+
+	/* the output written by the process before it exited is available in the buffers when the callback is called */
+	drainStreams(pid);
+
+	/* callback is called without holding the lock, because it locks the notify mutex of the worker */
+	if(onExit) {
+		onExit(returnCode);
+	}
+}
+
+void Supervisor::removePendingCGroups() {
+	std::list<PendingCGroup> cgroups;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cgroups.swap(pendingCGroups);
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	for(auto iter = cgroups.begin(); iter != cgroups.end();) {
+		if(iter->cgroup->tryRemove() || now >= iter->deadline) {
+			/* the destructor tries it a last time and reports the cgroup if it is still busy */
+			iter = cgroups.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	/* keep the cgroups that are still busy for the next round, removeCGroup might have added others meanwhile */
+	std::lock_guard<std::mutex> lock(mutex);
+	pendingCGroups.splice(pendingCGroups.end(), cgroups);
+}
+
+void Supervisor::addStream(pid_t pid, int pipeFd, const std::string& filename, off_t maxFileSize, std::shared_ptr<OutputBuffer> buffer) {
+	Stream stream;
+	stream.pid = pid;
+	stream.pipeFd = pipeFd;
+	stream.filename = filename;
+	stream.maxFileSize = maxFileSize;
+	stream.buffer = std::move(buffer);
+
+	fcntl(pipeFd, F_SETFL, fcntl(pipeFd, F_GETFL) | O_NONBLOCK);
+
+	if(!stream.filename.empty()) {
+		stream.fileFd = openFile(stream.filename, true);
+		if(stream.fileFd >= 0) {
+			stream.fileSize = std::max<off_t>(lseek(stream.fileFd, 0, SEEK_END), 0);
+		}
+	}
+	if(stream.fileFd >= 0 && stream.buffer && pipe2(stream.teeFd, O_CLOEXEC) != 0) {
+		logger.warn << "Cannot create pipe to buffer output of process " << pid << ": " << std::strerror(errno) << "\n";
+		stream.teeFd[0] = -1;
+		stream.teeFd[1] = -1;
+		stream.buffer.reset();
+	}
+
+	std::uint64_t streamId = nextStreamId++;
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = streamEventFlag | streamId;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, pipeFd, &event);
+
+	streams.emplace(streamId, std::move(stream));
+}
+
+Supervisor::Stream* Supervisor::findStream(std::uint64_t streamId) {
+	/* map entries keep their address if other streams are added, and only this thread removes them */
+	std::lock_guard<std::mutex> lock(mutex);
+	auto iter = streams.find(streamId);
+	return iter == streams.end() ? nullptr : &iter->second;
+}
+
+int Supervisor::transfer(Stream& stream) {
+	ssize_t count;
+
+	if(stream.buffer && stream.fileFd >= 0) {
+		/* duplicate the data into the tee pipe without consuming it. The data of the pipe is moved to the file
+		 * and only the duplicate is copied into the buffer. */
+		count = tee(stream.pipeFd, stream.teeFd[1], chunkSize, SPLICE_F_NONBLOCK);
+		if(count > 0) {
+			for(std::size_t remaining = static_cast<std::size_t>(count); remaining > 0;) {
+				ssize_t result = writeFile(stream, remaining);
+				if(result <= 0) {
+					break;
+				}
+				remaining -= static_cast<std::size_t>(result);
+			}
+			for(std::size_t remaining = static_cast<std::size_t>(count); remaining > 0;) {
+				ssize_t result = stream.buffer->readFrom(stream.teeFd[0], remaining);
+				if(result <= 0) {
+					break;
+				}
+				remaining -= static_cast<std::size_t>(result);
+			}
+		}
+	}
+	else if(stream.buffer) {
+		count = stream.buffer->readFrom(stream.pipeFd, chunkSize);
+	}
+	else {
+		count = writeFile(stream, chunkSize);
+	}
+
+	if(count > 0) {
+		return 1;
+	}
+	if(count < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return 0;
+	}
+	return -1;
+}
+
+ssize_t Supervisor::writeFile(Stream& stream, std::size_t size) {
+	ssize_t count = -1;
+
+	if(stream.fileFd >= 0 && stream.splice) {
+		count = splice(stream.pipeFd, nullptr, stream.fileFd, nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if(count < 0 && errno == EINVAL) {
+			/* file system does not support splice */
+			stream.splice = false;
+		}
+		else if(count < 0 && errno != EAGAIN && errno != EINTR) {
+			logger.warn << "Cannot write to file \"" << stream.filename << "\": " << std::strerror(errno) << "\n";
+			close(stream.fileFd);
+			stream.fileFd = -1;
+		}
+	}
+
+	/* without splice the data is read and written. If there is no file, then it is read and discarded */
+	if(stream.fileFd < 0 || !stream.splice) {
+		char buffer[4096];
+		count = read(stream.pipeFd, buffer, std::min(size, sizeof(buffer)));
+		if(count > 0 && stream.fileFd >= 0 && write(stream.fileFd, buffer, static_cast<std::size_t>(count)) != count) {
+			logger.warn << "Cannot write to file \"" << stream.filename << "\": " << std::strerror(errno) << "\n";
+			close(stream.fileFd);
+			stream.fileFd = -1;
+		}
+	}
+
+	if(count > 0 && stream.fileFd >= 0) {
+		stream.fileSize += count;
+		if(stream.maxFileSize > 0 && stream.fileSize >= stream.maxFileSize) {
+			rotate(stream);
+		}
+	}
+
+	return count;
+}
+
+void Supervisor::rotate(Stream& stream) {
+	close(stream.fileFd);
+
+	std::string rotatedFilename = stream.filename + ".1";
+	if(rename(stream.filename.c_str(), rotatedFilename.c_str()) != 0) {
+		logger.warn << "Cannot rename file \"" << stream.filename << "\" to \"" << rotatedFilename << "\": " << std::strerror(errno) << "\n";
+	}
+
+	/* if renaming failed, then writing continues at the end of the file */
+	stream.fileFd = openFile(stream.filename, false);
+	stream.fileSize = stream.fileFd >= 0 ? std::max<off_t>(lseek(stream.fileFd, 0, SEEK_END), 0) : 0;
+}
+
+void Supervisor::closeStream(std::uint64_t streamId) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = streams.find(streamId);
+	if(iter == streams.end()) {
+		return;
+	}
+
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, iter->second.pipeFd, nullptr);
+	for(int fd : {iter->second.pipeFd, iter->second.teeFd[0], iter->second.teeFd[1], iter->second.fileFd}) {
+		if(fd >= 0) {
+			close(fd);
+		}
+	}
+	streams.erase(iter);
+}
+
+void Supervisor::drainStreams(pid_t pid) {
+	std::vector<std::uint64_t> streamIds;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(const auto& stream : streams) {
+			if(stream.second.pid == pid) {
+				streamIds.push_back(stream.first);
+			}
+		}
+	}
+
+	/* Streams that are still open by child processes of the process are kept */
+	for(std::uint64_t streamId : streamIds) {
+		Stream* stream = findStream(streamId);
+		int result = 1;
+		for(std::size_t i = 0; stream && result > 0 && i < maxDrainChunks; ++i) {
+			result = transfer(*stream);
+		}
+		if(result < 0) {
+			closeStream(streamId);
+		}
+	}
+}
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
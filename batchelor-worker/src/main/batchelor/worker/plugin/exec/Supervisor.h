@@ -0,0 +1,153 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHELOR_WORKER_PLUGIN_EXEC_SUPERVISOR_H_
+#define BATCHELOR_WORKER_PLUGIN_EXEC_SUPERVISOR_H_
+
+#include <batchelor/worker/plugin/exec/CGroup.h>
+#include <batchelor/worker/plugin/exec/OutputBuffer.h>
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace exec {
+
+/* Supervisor launches processes with posix_spawn and reaps them asynchronously in a single thread.
+ * The thread waits with epoll on a pidfd per process. If the kernel does not support pidfd_open,
+ * processes are polled with waitpid instead.
+ *
+ * If an output buffer or a maximum file size is set, stdout and stderr of the process are connected to pipes
+ * that are served by the same thread. Data is spliced from the pipe into the file without copying it to user
+ * space and only the output buffer gets its own copy. Otherwise the files are opened directly for the process.
+ *
+ * Cgroups of finished processes are removed by the same thread as well. If a cgroup is still busy, removal is
+ * retried on a timer of the thread instead of waiting for it.
+ */
+class Supervisor {
+public:
+	struct SpawnSettings {
+		char** argv = nullptr;
+		std::vector<std::pair<std::string, std::string>> envs;
+		std::string cd;
+		std::string outfile;
+		std::string errfile;
+		std::string cgroup; // directory of a cgroup v2 the process is started in
+
+		/* optional buffers that keep the tail of stdout and stderr */
+		std::shared_ptr<OutputBuffer> outBuffer;
+		std::shared_ptr<OutputBuffer> errBuffer;
+
+		/* if greater than 0, then "outfile" and "errfile" are rotated to "<file>.1" if they exceed this size */
+		off_t maxFileSize = 0;
+	};
+
+	/* Called from the supervisor thread with the exit code of the process.
+	 * If the process has been terminated by a signal, the exit code is 128 + signal number. */
+	using OnExit = std::function<void(int)>;
+
+	Supervisor();
+	~Supervisor();
+
+	pid_t spawn(const SpawnSettings& spawnSettings, OnExit onExit);
+	void sendSignal(pid_t pid, const std::string& signal);
+
+	/* kills remaining processes of the cgroup and removes it without blocking the caller */
+	void removeCGroup(std::unique_ptr<CGroup> cgroup);
+
+	static int toSignalNumber(const std::string& signal);
+
+private:
+	struct Process {
+		pid_t pid;
+		int pidfd;
+		OnExit onExit;
+	};
+
+	struct PendingCGroup {
+		std::unique_ptr<CGroup> cgroup;
+		std::chrono::steady_clock::time_point deadline;
+	};
+
+	/* pipe of stdout or stderr of a process */
+	struct Stream {
+		pid_t pid;
+		int pipeFd;
+		int teeFd[2] = {-1, -1}; // pipe to duplicate the data for the output buffer if it is written to a file as well
+		int fileFd = -1;
+		std::string filename;
+		off_t fileSize = 0;
+		off_t maxFileSize = 0;
+		bool splice = true;
+		std::shared_ptr<OutputBuffer> buffer;
+	};
+
+	int epollFd = -1;
+	int wakeupFd = -1;
+
+	std::mutex mutex;
+	std::map<pid_t, Process> processes;
+	std::size_t processesWithoutPidfd = 0;
+
+	/* cgroups that are still busy, only the supervisor thread removes them */
+	std::list<PendingCGroup> pendingCGroups;
+
+	/* streams are added by spawn, but only the supervisor thread reads or removes them */
+	std::map<std::uint64_t, Stream> streams;
+	std::uint64_t nextStreamId = 0;
+
+	bool stopping = false;
+	std::thread thread;
+
+	void run();
+	void reap(pid_t pid);
+	void removePendingCGroups();
+
+	void addStream(pid_t pid, int pipeFd, const std::string& filename, off_t maxFileSize, std::shared_ptr<OutputBuffer> buffer);
+	Stream* findStream(std::uint64_t streamId);
+
+	/* Transfers available data of the pipe to the file and the output buffer.
+	 * Returns 1 if data has been transferred, 0 if there is no data available
+	 * and -1 if the pipe has been closed by the process or on an error. */
+	int transfer(Stream& stream);
+	ssize_t writeFile(Stream& stream, std::size_t size);
+	void rotate(Stream& stream);
+	void closeStream(std::uint64_t streamId);
+	void drainStreams(pid_t pid);
+};
+
+} /* namespace exec */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_PLUGIN_EXEC_SUPERVISOR_H_ */
@@ -24,14 +24,13 @@
 
 #include <batchelor/service/schemas/Setting.h>
 
-#include <esl/system/ZSProcess.h>
-#include <esl/system/Environment.h>
 #include <esl/system/Stacktrace.h>
-#include <esl/system/Signal.h>
 #include <esl/utility/String.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
 #include <mutex>
 #include <stdexcept>
 
@@ -41,18 +40,40 @@ namespace plugin {
 namespace exec {
 namespace {
 Logger logger("batchelor::worker::plugin::exec::Task");
+
+/* e.g. "cpu time 12.345 s, peak memory 512.0 MiB" */
+std::string toMessage(const CGroup::Usage& usage) {
+	std::string message;
+	char buffer[64];
+
+	if(usage.hasCpuUsage) {
+		std::snprintf(buffer, sizeof(buffer), "cpu time %.3f s", usage.cpuUsage.count() / 1000000.0);
+		message = buffer;
+	}
+	if(usage.hasMemoryPeak) {
+		std::snprintf(buffer, sizeof(buffer), "peak memory %.1f MiB", usage.memoryPeak / 1048576.0);
+		message += (message.empty() ? "" : ", ") + std::string(buffer);
+	}
+
+	return message;
+}
+}
+
+Task::SharedStatus::SharedStatus(std::condition_variable& aNotifyCV, std::mutex& aTaskStatusMutex)
+: notifyCV(aNotifyCV),
+  taskStatusMutex(aTaskStatusMutex)
+{
+	status.state = common::types::State::Type::running;
+	status.returnCode = 0;
 }
 
 Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, std::mutex& notifyMutex, const std::vector<std::pair<std::string, std::string>>& aMetrics, const TaskFactory::Settings& factorySettings, const service::schemas::RunConfiguration& runConfiguration)
 : plugin::Task(factorySettings.resourcesRequired),
   taskFactory(aTaskFactoryExec),
-  notifyCV(aNotifyCV),
-  taskStatusMutex(notifyMutex)
+  sharedStatus(std::make_shared<SharedStatus>(aNotifyCV, notifyMutex))
 {
 	bool hasArgs = false;
 
-	status.state = common::types::State::Type::running;
-
 	for(const auto& setting : runConfiguration.settings) {
 		if(setting.key == "args") {
 		    //<setting key="args" value="--propertyId=Bla --propertyFile=/etc/secret/test.pwd"/>
@@ -158,88 +179,114 @@ Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, st
 	}
 
 	arguments = esl::system::Arguments(settings.args.empty() ? settings.cmd : settings.cmd + " " + settings.args);
-	std::vector<std::pair<std::string, std::string>> envs;
+
+	Supervisor::SpawnSettings spawnSettings;
+	spawnSettings.argv = arguments.getArgv();
 	for(const auto& env : settings.envs) {
-		envs.push_back(env);
+		spawnSettings.envs.push_back(env);
 	}
-
-	process = esl::system::ZSProcess::createNative();
-	if(!process) {
-		throw std::runtime_error("No process instance available to execute a process.");
+	spawnSettings.cd = settings.cd;
+	spawnSettings.outfile = outfile;
+	spawnSettings.errfile = errfile;
+	spawnSettings.maxFileSize = static_cast<off_t>(factorySettings.maxFileSize);
+	if(factorySettings.outputBufferSize > 0) {
+		outBuffer = std::make_shared<OutputBuffer>(factorySettings.outputBufferSize);
+		errBuffer = std::make_shared<OutputBuffer>(factorySettings.outputBufferSize);
+		spawnSettings.outBuffer = outBuffer;
+		spawnSettings.errBuffer = errBuffer;
 	}
 
-//	if(!envs.empty()) {
-	process->setEnvironment(std::unique_ptr<esl::system::Environment>(new esl::system::Environment(std::move(envs))));
-//	}
-
 	std::filesystem::create_directories(settings.cd);
-	process->setWorkingDir(settings.cd);
 
-#if 0
-	(*process)[esl::system::FileDescriptor::getOut()] >> (settings.cd + "/out.log");
-	(*process)[esl::system::FileDescriptor::getErr()] >> (settings.cd + "/err.log");
-#else
-	if(!outfile.empty()) {
-		(*process)[esl::system::FileDescriptor::getOut()] >> outfile;
+	if(!factorySettings.cgroup.empty()) {
+		CGroup::Limits limits;
+		if(!factorySettings.cgroupCpuResource.empty()) {
+			limits.cpuMax = std::to_string(100000LL * factorySettings.resourcesRequired.at(factorySettings.cgroupCpuResource)) + " 100000";
+		}
+		if(!factorySettings.cgroupMemoryResource.empty()) {
+			limits.memoryMax = std::to_string(1048576LL * factorySettings.resourcesRequired.at(factorySettings.cgroupMemoryResource));
+		}
+		limits.ioMax = factorySettings.cgroupIoMax;
+
+		sharedStatus->cgroup.reset(new CGroup(factorySettings.cgroup, "task-" + runConfiguration.taskId, limits));
+		spawnSettings.cgroup = sharedStatus->cgroup->getPath();
 	}
-	if(!errfile.empty()) {
-		(*process)[esl::system::FileDescriptor::getErr()] >> errfile;
+
+	/* the callback holds its own reference to the status, so it stays valid even if the task has been destroyed */
+	std::shared_ptr<SharedStatus> status = sharedStatus;
+	Supervisor& supervisor = taskFactory.getSupervisor();
+	logger.debug << "execute ...\n";
+	try {
+		pid = supervisor.spawn(spawnSettings, [status, &supervisor](int returnCode) {
+			/* the callback is called by the supervisor thread, which removes the cgroup later if it is still busy */
+			std::string message;
+			if(status->cgroup) {
+				message = toMessage(status->cgroup->getUsage());
+				supervisor.removeCGroup(std::move(status->cgroup));
+			}
+
+			{
+				std::lock_guard<std::mutex> taskStatusLock(status->taskStatusMutex);
+				status->status.state = common::types::State::Type::done;
+				status->status.returnCode = returnCode;
+				status->status.message = std::move(message);
+				status->finished = true;
+			}
+
+			logger.debug << "execution done, rc=" << returnCode << "\n";
+			status->notifyCV.notify_all();
+		});
 	}
-#endif
+	catch(const std::exception& e) {
+		/* a process that cannot be executed is reported as signaled task and does not fail the creation of the task */
+		supervisor.removeCGroup(std::move(sharedStatus->cgroup));
+		sharedStatus->status.state = common::types::State::Type::signaled;
+		sharedStatus->status.message = e.what();
+		sharedStatus->finished = true;
 
-	thread = std::thread(&Task::run, this);
+		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
+	}
 }
 
 Task::~Task() {
-	thread.join();
+	/* Tasks are only removed after they are done. If the worker is shutting down and the process is still running, then
+	 * we wait for it, because the callback uses the notify mutex and condition variable of the worker. */
+	if(!sharedStatus->finished) {
+		std::unique_lock<std::mutex> taskStatusLock(sharedStatus->taskStatusMutex);
+		sharedStatus->notifyCV.wait(taskStatusLock, [this] {
+			return sharedStatus->finished.load();
+		});
+	}
 }
 
 Task::Status Task::getStatus() const {
-	return status;
+	return sharedStatus->status;
 }
 
-void Task::sendSignal(const std::string& signal) {
-	if(signal == "CANCEL") {
-		process->sendSignal(esl::system::Signal("interrupt"));
-		process->sendSignal(esl::system::Signal("terminate"));
-		process->sendSignal(esl::system::Signal("pipe"));
-	}
-	else {
-		process->sendSignal(esl::system::Signal(signal));
+bool Task::getOutput(std::string& out, std::string& err) const {
+	if(!outBuffer) {
+		return false;
 	}
+
+	out = outBuffer->getTail();
+	err = errBuffer->getTail();
+	return true;
 }
 
-void Task::run() {
+void Task::sendSignal(const std::string& signal) {
 	try {
-		logger.debug << "execute ...\n";
-		auto returnCode = process->execute(arguments);
-
-		{
-			std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-			status.state = common::types::State::Type::done;
-			status.returnCode = returnCode;
+		if(signal == "CANCEL") {
+			taskFactory.getSupervisor().sendSignal(pid, "interrupt");
+			taskFactory.getSupervisor().sendSignal(pid, "terminate");
+			taskFactory.getSupervisor().sendSignal(pid, "pipe");
+		}
+		else {
+			taskFactory.getSupervisor().sendSignal(pid, signal);
 		}
-
-		logger.debug << "execution done, rc=" << returnCode << "\n";
 	}
 	catch(const std::exception& e) {
-		std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-
-		status.state = common::types::State::Type::signaled;
-		status.message = e.what();
-
-		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
+		logger.warn << "Cannot send signal \"" << signal << "\" to process " << pid << ": " << e.what() << "\n";
 	}
-	catch(...) {
-		std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-
-		status.state = common::types::State::Type::signaled;
-		status.message = "Execution failed because of unknown exception.";
-
-		logger.warn << "Execution failed because of unknown exception.\n";
-	}
-
-	notifyCV.notify_all();
 }
 
 } /* namespace exec */
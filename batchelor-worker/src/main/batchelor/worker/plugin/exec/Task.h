@@ -21,17 +21,20 @@
 
 #include <batchelor/service/schemas/RunConfiguration.h>
 
+#include <batchelor/worker/plugin/exec/CGroup.h>
+#include <batchelor/worker/plugin/exec/OutputBuffer.h>
 #include <batchelor/worker/plugin/exec/TaskFactory.h>
 #include <batchelor/worker/plugin/Task.h>
 
 #include <esl/system/Arguments.h>
-#include <esl/system/Process.h>
 
+#include <sys/types.h>
+
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 
@@ -55,22 +58,34 @@ public:
 	Status getStatus() const override;
 
 	void sendSignal(const std::string& signal) override;
+	bool getOutput(std::string& out, std::string& err) const override;
 
 private:
+	/* state shared with the exit callback of the supervisor */
+	struct SharedStatus {
+		SharedStatus(std::condition_variable& notifyCV, std::mutex& taskStatusMutex);
+
+		std::condition_variable& notifyCV;
+		std::mutex& taskStatusMutex;
+		Status status;
+		std::atomic<bool> finished{false};
+
+		/* cgroup of the process, handed over to the supervisor for removal after the process has exited */
+		std::unique_ptr<CGroup> cgroup;
+	};
+
 	TaskFactory& taskFactory;
 
-	std::condition_variable& notifyCV;
-	std::mutex& taskStatusMutex;
-	Status status;
+	std::shared_ptr<SharedStatus> sharedStatus;
+
+	/* tail of stdout and stderr, filled by the supervisor */
+	std::shared_ptr<OutputBuffer> outBuffer;
+	std::shared_ptr<OutputBuffer> errBuffer;
 
 	Settings settings;
 
-	std::unique_ptr<esl::system::Process> process;
 	esl::system::Arguments arguments;
-
-	std::thread thread;
-
-	void run();
+	pid_t pid = 0;
 };
 
 } /* namespace exec */
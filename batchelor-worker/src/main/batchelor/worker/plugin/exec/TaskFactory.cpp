@@ -17,6 +17,7 @@
  */
 
 #include <batchelor/worker/Logger.h>
+#include <batchelor/worker/plugin/exec/CGroup.h>
 #include <batchelor/worker/plugin/exec/Task.h>
 #include <batchelor/worker/plugin/exec/TaskFactory.h>
 
@@ -44,6 +45,9 @@ TaskFactory::TaskFactory(Settings aSettings)
 	if(settings.cd == "") {
 		logger.warn << "No working directory is specified.\n";
 	}
+	if(!settings.cgroup.empty()) {
+		CGroup::enableControllers(settings.cgroup);
+	}
 }
 
 std::unique_ptr<plugin::TaskFactory> TaskFactory::create(const std::vector<std::pair<std::string, std::string>>& aSettings) {
@@ -54,6 +58,8 @@ std::unique_ptr<plugin::TaskFactory> TaskFactory::create(const std::vector<std::
 	bool hasEnvFlagGlobal = false;
 	bool hasEnvFlag = false;
 	bool hasCdFlag = false;
+	bool hasOutputBufferSize = false;
+	bool hasMaxFileSize = false;
 
 	for(const auto& setting : aSettings) {
 		if(setting.first.size() > 18 && setting.first.substr(0, 18) == "resource-required.") {
@@ -198,6 +204,53 @@ std::unique_ptr<plugin::TaskFactory> TaskFactory::create(const std::vector<std::
 				throw std::runtime_error("Invalid value \"" + setting.second + "\" for parameter \"" + setting.first + "\"");
 			}
 		}
+		else if(setting.first == "cgroup" || setting.first == "cgroup-cpu-resource" || setting.first == "cgroup-memory-resource" || setting.first == "cgroup-io-max") {
+		    //<setting key="cgroup" value="/sys/fs/cgroup/batchelor.slice"/>
+		    //<setting key="cgroup-cpu-resource" value="CPU"/>
+		    //<setting key="cgroup-memory-resource" value="MEMORY_MB"/>
+		    //<setting key="cgroup-io-max" value="8:0 rbps=104857600 wbps=104857600"/>
+			std::string& value = setting.first == "cgroup" ? settings.cgroup
+					: setting.first == "cgroup-cpu-resource" ? settings.cgroupCpuResource
+					: setting.first == "cgroup-memory-resource" ? settings.cgroupMemoryResource
+					: settings.cgroupIoMax;
+			if(!value.empty()) {
+				throw std::runtime_error("Multiple definition of parameter \"" + setting.first + "\".");
+			}
+			value = setting.second;
+			if(value.empty()) {
+				throw std::runtime_error("Invalid value \"" + setting.second + "\" for parameter \"" + setting.first + "\"");
+			}
+		}
+		else if(setting.first == "output-buffer-size" || setting.first == "max-file-size") {
+		    //<setting key="output-buffer-size" value="65536"/>
+		    //<setting key="max-file-size" value="104857600"/>
+			bool& hasValue = setting.first == "output-buffer-size" ? hasOutputBufferSize : hasMaxFileSize;
+			if(hasValue) {
+				throw std::runtime_error("Multiple definition of parameter \"" + setting.first + "\".");
+			}
+			hasValue = true;
+
+			unsigned long long value = 0;
+			try {
+				if(setting.second.empty() || setting.second.find_first_not_of("0123456789") != std::string::npos) {
+					throw std::invalid_argument(setting.second);
+				}
+				value = std::stoull(setting.second);
+			}
+			catch(const std::invalid_argument& e) {
+				throw std::runtime_error("Invalid value \"" + setting.second + "\" for parameter \"" + setting.first + "\"");
+			}
+			catch(const std::out_of_range& e) {
+				throw std::runtime_error("Value \"" + setting.second + "\" for parameter \"" + setting.first + "\" is out of range.");
+			}
+
+			if(setting.first == "output-buffer-size") {
+				settings.outputBufferSize = static_cast<std::size_t>(value);
+			}
+			else {
+				settings.maxFileSize = value;
+			}
+		}
 		else if(setting.first == "cmd" || setting.first == "executable") {
 		    //<setting key="cmd" value="/opt/bin/true"/>
 			if(!settings.cmd.empty()) {
@@ -221,6 +274,20 @@ std::unique_ptr<plugin::TaskFactory> TaskFactory::create(const std::vector<std::
 		throw std::runtime_error("Definition of parameter \"cmd\" is required.");
 	}
 
+	if(settings.maxFileSize > 0 && settings.outfile.empty() && settings.errfile.empty()) {
+		throw std::runtime_error("Definition of parameter \"outfile\" or \"errfile\" is required to rotate files.");
+	}
+
+	if(settings.cgroup.empty() && (!settings.cgroupCpuResource.empty() || !settings.cgroupMemoryResource.empty() || !settings.cgroupIoMax.empty())) {
+		throw std::runtime_error("Definition of parameter \"cgroup\" is required to limit resources.");
+	}
+	if(!settings.cgroupCpuResource.empty() && settings.resourcesRequired.count(settings.cgroupCpuResource) == 0) {
+		throw std::runtime_error("Resource \"" + settings.cgroupCpuResource + "\" of parameter \"cgroup-cpu-resource\" is not required by this task factory.");
+	}
+	if(!settings.cgroupMemoryResource.empty() && settings.resourcesRequired.count(settings.cgroupMemoryResource) == 0) {
+		throw std::runtime_error("Resource \"" + settings.cgroupMemoryResource + "\" of parameter \"cgroup-memory-resource\" is not required by this task factory.");
+	}
+
 	for(char **s = environ; *s; s++) {
 		std::string env(*s);
 
@@ -266,6 +333,10 @@ std::unique_ptr<plugin::Task> TaskFactory::createTask(std::condition_variable& n
 	return std::unique_ptr<Task>(new Task(*this, notifyCV, notifyMutex, metrics, settings, runConfiguration));
 }
 
+Supervisor& TaskFactory::getSupervisor() noexcept {
+	return supervisor;
+}
+
 } /* namespace exec */
 } /* namespace plugin */
 } /* namespace worker */
@@ -21,6 +21,7 @@
 
 #include <batchelor/service/schemas/RunConfiguration.h>
 
+#include <batchelor/worker/plugin/exec/Supervisor.h>
 #include <batchelor/worker/plugin/Task.h>
 #include <batchelor/worker/plugin/TaskFactory.h>
 
@@ -66,6 +67,22 @@ public:
 		Flag cdFlag = Flag::fixed; // override|fixed
 
 		std::string cmd;
+
+		/* Parent directory of a cgroup v2. If it is set, every task runs in its own cgroup below, limited by
+		 * its required resources: the value of resource "cgroupCpuResource" is the number of CPUs and the value
+		 * of resource "cgroupMemoryResource" is the memory in MiB. */
+		std::string cgroup;
+		std::string cgroupCpuResource;
+		std::string cgroupMemoryResource;
+		std::string cgroupIoMax;
+
+		/* Size in bytes of the buffers that keep the tail of stdout and stderr of every task, 0 disables them.
+		 * Buffered output is not written to the output of the worker if there is no "outfile" or "errfile". */
+		std::size_t outputBufferSize = 0;
+
+		/* If greater than 0, then "outfile" and "errfile" are rotated to "<file>.1" if they exceed this size in bytes.
+		 * Rotated files are written by the worker without O_APPEND, so they must not be shared by running tasks. */
+		unsigned long long maxFileSize = 0;
 	};
 
 	TaskFactory(Settings settings);
@@ -97,6 +114,12 @@ public:
 	 * - settings[ 8] = { 'cd-flag' ;           'override|fixed' }
 	 * - settings[ 9] = { 'cmd' ;               '/opt/bin/true' }
 	 * - settings[10] = { 'cmd-flag' ;          'override|fixed' }
+	 * - settings[11] = { 'cgroup' ;                 '/sys/fs/cgroup/batchelor.slice' }
+	 * - settings[12] = { 'cgroup-cpu-resource' ;    'CPU' }
+	 * - settings[13] = { 'cgroup-memory-resource' ; 'MEMORY_MB' }
+	 * - settings[14] = { 'cgroup-io-max' ;          '8:0 rbps=104857600 wbps=104857600' }
+	 * - settings[15] = { 'output-buffer-size' ;     '65536' }
+	 * - settings[16] = { 'max-file-size' ;          '104857600' }
 	 */
 	static std::unique_ptr<plugin::TaskFactory> create(const std::vector<std::pair<std::string, std::string>>& settings);
 
@@ -116,8 +139,13 @@ public:
 	 */
 	std::unique_ptr<plugin::Task> createTask(std::condition_variable& notifyCV, std::mutex& notifyMutex, const std::vector<std::pair<std::string, std::string>>& metrics, const service::schemas::RunConfiguration& runConfiguration) override;
 
+	Supervisor& getSupervisor() noexcept;
+
 private:
 	Settings settings;
+
+	/* launches and reaps the processes of all tasks of this factory */
+	Supervisor supervisor;
 };
 
 } /* namespace exec */
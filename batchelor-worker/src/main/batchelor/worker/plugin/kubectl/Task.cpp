@@ -16,69 +16,36 @@
  * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#define MY_CONSUMER
-
 #include <batchelor/common/config/xml/Setting.h>
 #include <batchelor/common/types/State.h>
 
 #include <batchelor/worker/Logger.h>
 #include <batchelor/worker/plugin/kubectl/Task.h>
+#include <batchelor/worker/plugin/kubectl/Watcher.h>
 
 #include <batchelor/service/schemas/Setting.h>
 
-#include <esl/io/Consumer.h>
-#include <esl/io/Input.h>
-#ifndef MY_CONSUMER
-#include <esl/io/input/String.h>
-#endif
-#include <esl/io/output/Memory.h>
-#include <esl/io/Reader.h>
-#include <esl/system/ZSProcess.h>
-#include <esl/system/Environment.h>
 #include <esl/system/Stacktrace.h>
-#include <esl/utility/String.h>
-
-#include <boost/filesystem.hpp>
 
 #include <fstream>
 #include <mutex>
 #include <sstream>
 #include <stdexcept>
 
-#include <iostream>
 namespace batchelor {
 namespace worker {
 namespace plugin {
 namespace kubectl {
 namespace {
 Logger logger("batchelor::worker::plugin::kubectl::Task");
+}
 
-#ifdef MY_CONSUMER
-class MyConsumer : public esl::io::Consumer {
-public:
-	MyConsumer() = default;
-
-	bool consume(esl::io::Reader& reader) override {
-		char buffer[4096];
-		std::size_t count = reader.read(buffer, sizeof(buffer));
-
-		if(count == esl::io::Reader::npos) {
-			return false;
-		}
-
-		str << std::string(buffer, count);
-
-		return true;
-	}
-
-	std::stringstream& getStringStream() noexcept {
-		return str;
-	}
-
-private:
-	std::stringstream str;
-};
-#endif
+Task::SharedStatus::SharedStatus(std::condition_variable& aNotifyCV, std::mutex& aTaskStatusMutex)
+: notifyCV(aNotifyCV),
+  taskStatusMutex(aTaskStatusMutex)
+{
+	status.state = common::types::State::Type::running;
+	status.returnCode = 0;
 }
 
 Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, std::mutex& notifyMutex, const std::vector<std::pair<std::string, std::string>>& aMetrics, const TaskFactory::Settings& factorySettings, const service::schemas::RunConfiguration& runConfiguration)
@@ -86,14 +53,10 @@ Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, st
   taskId(runConfiguration.taskId),
   eventType(runConfiguration.eventType),
   taskFactory(aTaskFactoryExec),
-  notifyCV(aNotifyCV),
-  taskStatusMutex(notifyMutex)
+  sharedStatus(std::make_shared<SharedStatus>(aNotifyCV, notifyMutex))
 {
 	settings.yamlFile = factorySettings.yamlFile;
-	settings.kubectlCmd = factorySettings.kubectlCmd;
-	settings.kubectlConfig = factorySettings.kubectlConfig;
 	settings.image = factorySettings.image;
-	settings.metaNamespace = factorySettings.metaNamespace;
 	settings.backoffLimit = factorySettings.backoffLimit;
 	settings.serviceAccountName = factorySettings.serviceAccountName;
 	settings.imagePullSecrets = factorySettings.imagePullSecrets;
@@ -106,8 +69,6 @@ Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, st
 
 	bool hasArgs = false;
 
-	status.state = common::types::State::Type::running;
-
 	for(const auto& setting : runConfiguration.settings) {
 		if(setting.key == "args") {
 			if(hasArgs) {
@@ -216,142 +177,46 @@ Task::Task(TaskFactory& aTaskFactoryExec, std::condition_variable& aNotifyCV, st
 		throw std::runtime_error("No container image defined.");
 	}
 
-	thread = std::thread(&Task::run, this);
-}
-
-Task::~Task() {
-	thread.join();
-}
-
-Task::Status Task::getStatus() const {
-	return status;
-}
-
-void Task::sendSignal(const std::string& signal) {
-	if(signal == "CANCEL") {
-		sendCancel();
+	std::string deploymentYAML = getDeploymentYAML();
+	if(!settings.yamlFile.empty()) {
+		std::ofstream(settings.yamlFile) << deploymentYAML;
 	}
-}
 
-void Task::run() {
-	try {
-		logger.debug << "execute ...\n";
-		Status podStatus = runBatch();
-		while(true) {
-			{
-				std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-				status = podStatus;
-			}
+	/* the callback holds its own reference to the status, so it stays valid even if the task has been destroyed */
+	std::shared_ptr<SharedStatus> status = sharedStatus;
+	logger.debug << "execute ...\n";
+	taskFactory.getWatcher().add(taskId, std::move(deploymentYAML), [status](const Status& podStatus) {
+		{
+			std::lock_guard<std::mutex> taskStatusLock(status->taskStatusMutex);
+			status->status = podStatus;
 			if(podStatus.state != common::types::State::Type::running) {
-				break;
+				status->finished = true;
 			}
-
-			std::this_thread::sleep_for(std::chrono::seconds(settings.checkPodStatusIntervalSec));
-			podStatus = getPodStatus();
 		}
 
-		logger.debug << "execution done\n";
-	}
-	catch(const std::exception& e) {
-		std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-
-		status.state = common::types::State::Type::zombie;
-		status.message = e.what();
-
-		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
-	}
-	catch(...) {
-		std::lock_guard<std::mutex> taskStatusLock(taskStatusMutex);
-
-		status.state = common::types::State::Type::zombie;
-		status.message = "Execution failed because of unknown exception.";
-
-		logger.warn << "Execution failed because of unknown exception.\n";
-	}
-
-	notifyCV.notify_all();
+		logger.debug << "job status changed, message=\"" << podStatus.message << "\"\n";
+		status->notifyCV.notify_all();
+	});
 }
 
-std::string Task::getCmd() const noexcept {
-	std::string kubectlCmd = settings.kubectlCmd;
-	if(!settings.kubectlConfig.empty()) {
-		kubectlCmd += " --kubeconfig " + settings.kubectlConfig;
-	}
-	if(!settings.metaNamespace.empty()) {
-		kubectlCmd += " -n " + settings.metaNamespace;
+Task::~Task() {
+	/* Tasks are only removed after they are done. If the worker is shutting down and the job is still running, then
+	 * we wait for it, because the callback uses the notify mutex and condition variable of the worker. */
+	if(!sharedStatus->finished) {
+		std::unique_lock<std::mutex> taskStatusLock(sharedStatus->taskStatusMutex);
+		sharedStatus->notifyCV.wait(taskStatusLock, [this] {
+			return sharedStatus->finished.load();
+		});
 	}
-	return kubectlCmd;
 }
 
-Task::Status Task::runBatch() const noexcept {
-	Status podStatus;
-
-	try {
-		std::string deploymentYAML = getDeploymentYAML();
-		if(!settings.yamlFile.empty()) {
-			std::ofstream(settings.yamlFile) << deploymentYAML;
-		}
-
-		esl::io::output::Memory deploymentYamlProducer(deploymentYAML.data(), deploymentYAML.size());
-
-		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
-
-#ifdef MY_CONSUMER
-		MyConsumer kubectlOutput;
-#else
-		esl::io::input::String kubectlOutput;
-#endif
-		(*process)[esl::system::FileDescriptor::getIn()] << esl::io::Output(deploymentYamlProducer);
-		(*process)[esl::system::FileDescriptor::getErr()] >> esl::io::Input(kubectlOutput);
-
-		auto returnCode = process->execute(esl::system::Arguments(getCmd() + " apply -f -"));
-
-		if(returnCode == 0) {
-			podStatus.state = common::types::State::Type::running;
-			podStatus.returnCode = 0;
-		}
-		else {
-			podStatus.state = common::types::State::Type::signaled;
-			podStatus.returnCode = 1;
-#ifdef MY_CONSUMER
-			podStatus.message =  "Applying batch config failed: " + kubectlOutput.getStringStream().str();
-#else
-			podStatus.message =  "Applying batch config failed: " + kubectlOutput.getString();
-#endif
-		}
-
-		logger.debug << "execution done, rc=" << returnCode << "\n";
-	}
-	catch(const std::exception& e) {
-		podStatus.state = common::types::State::Type::signaled;
-		podStatus.returnCode = 1;
-		podStatus.message = "Execution failed because of exception: \"" + std::string(e.what()) + "\"";
-
-		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
-	}
-	catch(...) {
-		podStatus.state = common::types::State::Type::signaled;
-		podStatus.returnCode = 1;
-		podStatus.message = "Execution failed because of exception.";
-
-		logger.warn << "Execution failed because of unknown exception.\n";
-	}
-
-	return podStatus;
+Task::Status Task::getStatus() const {
+	return sharedStatus->status;
 }
 
-void Task::sendCancel() const noexcept {
-	try {
-		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
-		auto returnCode = process->execute(esl::system::Arguments(getCmd() + " delete job " + taskId));
-		taskCanceled = true;
-		logger.debug << "canceled task id " << taskId << " and received return code " << returnCode << "\n";
-	}
-	catch(const std::exception& e) {
-		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
-	}
-	catch(...) {
-		logger.warn << "Execution failed because of unknown exception.\n";
+void Task::sendSignal(const std::string& signal) {
+	if(signal == "CANCEL") {
+		taskFactory.getWatcher().cancel(taskId);
 	}
 }
 
@@ -362,6 +227,8 @@ std::string Task::getDeploymentYAML() const noexcept {
 	<< "kind: Job\n"
 	<< "metadata:\n"
 	<< "  name: " << taskId << "\n"
+	<< "  labels:\n"
+	<< "    " << Watcher::taskIdLabel << ": \"" << taskId << "\"\n"
 	<< "spec:\n";
 	if(!settings.serviceAccountName.empty()) {
 		deploymentYaml
@@ -465,285 +332,6 @@ std::string Task::getDeploymentYAML() const noexcept {
 	return deploymentYaml.str();
 }
 
-Task::Status Task::getPodStatus() {
-	Task::Status podStatus;
-
-	/* ******************************************************
-	 * First lets check  kubectl [...] descibe job ${TASK_ID}
-	 * ******************************************************/
-	podStatus = getJobStatus();
-
-
-	if(podStatus.state == common::types::State::Type::running) {
-		std::string message = podStatus.message;
-
-		podStatus = getEventStatus();
-
-		if(podStatus.message.empty()) {
-			podStatus.message = message;
-		}
-	}
-	else if(podStatus.message.empty()) {
-		podStatus.message = getEventStatus().message;
-	}
-
-	return podStatus;
-}
-
-Task::Status Task::getJobStatus() {
-	/* ******************************************************
-	 * First lets check  kubectl [...] descibe job ${TASK_ID}
-	 * ******************************************************/
-
-	std::string line;
-	std::size_t pos;
-	std::string activeStr;
-	std::string succeededStr;
-	std::string failedStr;
-
-	try {
-		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
-
-#ifdef MY_CONSUMER
-		MyConsumer kubectlOutput;
-#else
-		esl::io::input::String kubectlOutput;
-#endif
-
-		(*process)[esl::system::FileDescriptor::getOut()] >> esl::io::Input(kubectlOutput);
-
-		auto returnCode = process->execute(esl::system::Arguments(getCmd() + " describe job " + taskId));
-		if(returnCode != 0) {
-			Status podStatus;
-
-			if(taskCanceled) {
-				podStatus.state = common::types::State::Type::signaled;
-				podStatus.returnCode = 0;
-				podStatus.message = "Cancel executed";
-			}
-			else {
-				podStatus.state = common::types::State::Type::zombie;
-				podStatus.returnCode = 0;
-				podStatus.message = "Could not get description of job";
-			}
-
-			return podStatus;
-		}
-
-#ifdef MY_CONSUMER
-		std::stringstream& ss(kubectlOutput.getStringStream());
-#else
-		std::stringstream ss(kubectlOutput.getString());
-#endif
-
-		bool statusFound = false;
-		while(std::getline(ss, line, '\n')) {
-			line = esl::utility::String::ltrim(line);
-
-			// Pods Statuses:    1 Active / 0 Succeeded / 0 Failed
-			pos = line.find(':');
-			if(pos == std::string::npos || line.substr(0, pos) != "Pods Statuses") {
-				continue;
-			}
-
-			statusFound = true;
-
-			break;
-		}
-
-		if(statusFound == false) {
-			Status podStatus;
-
-			podStatus.state = common::types::State::Type::zombie;
-			podStatus.returnCode = 1;
-			podStatus.message = "Could not get status of pod because there is no such line in description";
-
-			return podStatus;
-		}
-
-		// 1 Active / 0 Succeeded / 0 Failed
-		std::vector<std::string> values = esl::utility::String::split(esl::utility::String::ltrim(line.substr(pos+1)), ' ', true);
-
-		for(std::size_t index = 1; index < values.size(); ++index) {
-			if(esl::utility::String::toLower(values[index]) == "active") {
-				if(!activeStr.empty()) {
-					Status podStatus;
-
-					podStatus.state = common::types::State::Type::zombie;
-					podStatus.message = "Multiple definition of 'Succeeded': " + esl::utility::String::ltrim(line.substr(pos+1));
-					podStatus.returnCode = 1;
-
-					return podStatus;
-				}
-				activeStr = values[index-1];
-			}
-			if(esl::utility::String::toLower(values[index]) == "succeeded") {
-				if(!succeededStr.empty()) {
-					Status podStatus;
-
-					podStatus.state = common::types::State::Type::zombie;
-					podStatus.message = "Multiple definition of 'Succeeded': " + esl::utility::String::ltrim(line.substr(pos+1));
-					podStatus.returnCode = 1;
-
-					return podStatus;
-				}
-				succeededStr = values[index-1];
-			}
-			if(esl::utility::String::toLower(values[index]) == "failed") {
-				if(!failedStr.empty()) {
-					Status podStatus;
-
-					podStatus.state = common::types::State::Type::zombie;
-					podStatus.message = "Multiple definition of 'Failed': " + esl::utility::String::ltrim(line.substr(pos+1));
-					podStatus.returnCode = 1;
-
-					return podStatus;
-				}
-				failedStr = values[index-1];
-			}
-		}
-
-		// ... 1 Succeeded / . Failed
-		if(succeededStr.empty() == false && std::stoi(succeededStr) > 0) {
-			Status podStatus;
-
-			//podStatus.message = esl::utility::String::ltrim(line.substr(pos+1));
-			podStatus.state = common::types::State::Type::done;
-			podStatus.returnCode = 0;
-
-			return podStatus;
-		}
-
-		// ... 7 Failed
-		if(failedStr.empty() == false && std::stoi(failedStr) > 0) {
-			Status podStatus;
-
-			// 1 Active / 0 Succeeded / 7 Failed
-			if(activeStr.empty() == false && std::stoi(activeStr) > 0) {
-				podStatus.message = failedStr + " failures";
-				podStatus.state = common::types::State::Type::running;
-				podStatus.returnCode = 0;
-			}
-			// 0 Active / 0 Succeeded / 7 Failed
-			else {
-				podStatus.state = common::types::State::Type::done;
-				podStatus.returnCode = 1;
-			}
-
-			return podStatus;
-		}
-	}
-	catch(const std::invalid_argument& e) {
-		Status podStatus;
-
-		podStatus.state = common::types::State::Type::zombie;
-		podStatus.message = "Cannot conversion value '" + succeededStr + "' or '" + failedStr + "', because argument is invalid: " + line;
-		podStatus.returnCode = 1;
-
-		return podStatus;
-	}
-	catch(const std::out_of_range& e) {
-		Status podStatus;
-
-		podStatus.state = common::types::State::Type::zombie;
-		podStatus.message = "Cannot conversion value '" + succeededStr + "' or '" + failedStr + "', because argument is out of range: " + line;
-		podStatus.returnCode = 1;
-
-		return podStatus;
-	}
-	catch(...) {
-		logger.warn << "Execution failed.\n";
-
-		Status podStatus;
-
-		podStatus.state = common::types::State::Type::zombie;
-		podStatus.returnCode = 1;
-		podStatus.message = "Could not get description of job because process threw an exception";
-
-		return podStatus;
-	}
-
-	Status podStatus;
-
-	//podStatus.message = esl::utility::String::ltrim(line.substr(pos+1));
-	podStatus.state = common::types::State::Type::running;
-	podStatus.returnCode = 0;
-
-	return podStatus;
-}
-
-Task::Status Task::getEventStatus() {
-	/* *****************************************************
-	 * Next lets check  kubectl [...] get events --field-selector type=Warning | grep 187923ba-08c0-4530-8705-4636ec602a14 for "Warning"
-	 * ******************************************************/
-
-	try {
-		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
-
-#ifdef MY_CONSUMER
-		MyConsumer kubectlOutput;
-#else
-		esl::io::input::String kubectlOutput;
-#endif
-
-		(*process)[esl::system::FileDescriptor::getOut()] >> esl::io::Input(kubectlOutput);
-
-		auto returnCode = process->execute(esl::system::Arguments(getCmd() + " get events --field-selector type=Warning"));
-		if(returnCode != 0) {
-			Status podStatus;
-
-			podStatus.state = common::types::State::Type::zombie;
-			podStatus.returnCode = 0;
-			podStatus.message = "Could not events";
-
-			return podStatus;
-		}
-
-#ifdef MY_CONSUMER
-		std::stringstream& ss(kubectlOutput.getStringStream());
-#else
-		std::stringstream ss(kubectlOutput.getString());
-#endif
-		std::string line;
-
-		while(std::getline(ss, line, '\n')) {
- 			line = esl::utility::String::ltrim(line);
-			// 3s  Warning  FailedMount  pod/${TASK_ID}-d6z6q  MountVolume.SetUp failed for volume "secret-mounts" : secret "k8s-batch" not found
-			std::size_t pos = line.find(taskId);
-			if(pos == std::string::npos) {
-				continue;
-			}
-			sendCancel();
-
-			Status podStatus;
-
-			podStatus.state = common::types::State::Type::zombie;
-			podStatus.returnCode = 1;
-			podStatus.message = line;
-
-			return podStatus;
-		}
-	}
-	catch(...) {
-		logger.warn << "Execution failed.\n";
-
-		Status podStatus;
-
-		podStatus.state = common::types::State::Type::zombie;
-		podStatus.returnCode = 1;
-		podStatus.message = "Could not get events because process threw an exception";
-
-		return podStatus;
-	}
-
-	Status podStatus;
-
-	podStatus.state = common::types::State::Type::running;
-	podStatus.returnCode = 0;
-
-	return podStatus;
-}
-
 } /* namespace kubectl */
 } /* namespace plugin */
 } /* namespace worker */
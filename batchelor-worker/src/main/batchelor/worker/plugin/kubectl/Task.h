@@ -25,13 +25,12 @@
 #include <batchelor/worker/plugin/Task.h>
 
 #include <esl/system/Arguments.h>
-#include <esl/system/Process.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 
@@ -43,18 +42,13 @@ namespace kubectl {
 class Task : public plugin::Task {
 public:
 	struct Settings {
-		unsigned int checkPodStatusIntervalSec = 2;
-
 		std::string cd;
 		std::string cmd;
 		std::string args;
 		std::map<std::string, std::string> envs;
 
 		std::string yamlFile;
-		std::string kubectlCmd;
-		std::string kubectlConfig;
 		std::string image;
-		std::string metaNamespace;
 		int backoffLimit = 0;
 		std::string serviceAccountName;
 		std::set<std::string> imagePullSecrets;
@@ -75,29 +69,26 @@ public:
 	void sendSignal(const std::string& signal) override;
 
 private:
+	/* state shared with the status callback of the watcher */
+	struct SharedStatus {
+		SharedStatus(std::condition_variable& notifyCV, std::mutex& taskStatusMutex);
+
+		std::condition_variable& notifyCV;
+		std::mutex& taskStatusMutex;
+		Status status;
+		std::atomic<bool> finished{false};
+	};
+
 	std::string taskId;
 	std::string eventType;
-	mutable bool taskCanceled = false;
 
 	TaskFactory& taskFactory;
 
-	std::condition_variable& notifyCV;
-	std::mutex& taskStatusMutex;
-	Status status;
+	std::shared_ptr<SharedStatus> sharedStatus;
 
 	Settings settings;
 
-	std::thread thread;
-
-	void run();
-
-	std::string getCmd() const noexcept;
-	Status runBatch() const noexcept;
-	void sendCancel() const noexcept;
 	std::string getDeploymentYAML() const noexcept;
-	Status getPodStatus();
-	Status getJobStatus();
-	Status getEventStatus();
 };
 
 } /* namespace kubectl */
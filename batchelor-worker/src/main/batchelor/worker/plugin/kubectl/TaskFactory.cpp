@@ -23,6 +23,7 @@
 #include <esl/system/Stacktrace.h>
 #include <esl/utility/String.h>
 
+#include <chrono>
 #include <stdexcept>
 
 namespace batchelor {
@@ -31,11 +32,23 @@ namespace plugin {
 namespace kubectl {
 namespace {
 Logger logger("batchelor::worker::plugin::kubectl::TaskFactory");
+
+std::string getKubectlCmd(const TaskFactory::Settings& settings) {
+	std::string kubectlCmd = settings.kubectlCmd;
+	if(!settings.kubectlConfig.empty()) {
+		kubectlCmd += " --kubeconfig " + settings.kubectlConfig;
+	}
+	if(!settings.metaNamespace.empty()) {
+		kubectlCmd += " -n " + settings.metaNamespace;
+	}
+	return kubectlCmd;
+}
 }
 
 
 TaskFactory::TaskFactory(Settings aSettings)
-: settings(std::move(aSettings))
+: settings(std::move(aSettings)),
+  watcher(getKubectlCmd(settings), std::chrono::seconds(settings.checkPodStatusIntervalSec))
 {
 	if(settings.cmd == "") {
 		throw esl::system::Stacktrace::add(std::runtime_error("Parameter \"executable\" is required"));
@@ -501,6 +514,10 @@ std::unique_ptr<plugin::Task> TaskFactory::createTask(std::condition_variable& n
 	return std::unique_ptr<Task>(new Task(*this, notifyCV, notifyMutex, metrics, settings, runConfiguration));
 }
 
+Watcher& TaskFactory::getWatcher() noexcept {
+	return watcher;
+}
+
 } /* namespace kubectl */
 } /* namespace plugin */
 } /* namespace worker */
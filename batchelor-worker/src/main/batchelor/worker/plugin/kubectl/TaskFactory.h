@@ -21,6 +21,7 @@
 
 #include <batchelor/service/schemas/RunConfiguration.h>
 
+#include <batchelor/worker/plugin/kubectl/Watcher.h>
 #include <batchelor/worker/plugin/Task.h>
 #include <batchelor/worker/plugin/TaskFactory.h>
 
@@ -91,6 +92,8 @@ public:
 		std::string cmd;
 		Flag cmdFlag = Flag::fixed; // override|fixed
 
+		unsigned int checkPodStatusIntervalSec = 2;
+
 		std::string yamlFile;
 		std::string kubectlCmd;
 		std::string kubectlConfig;
@@ -156,8 +159,11 @@ public:
 	 */
 	std::unique_ptr<plugin::Task> createTask(std::condition_variable& notifyCV, std::mutex& notifyMutex, const std::vector<std::pair<std::string, std::string>>& metrics, const service::schemas::RunConfiguration& runConfiguration) override;
 
+	Watcher& getWatcher() noexcept;
+
 private:
 	Settings settings;
+	Watcher watcher;
 };
 
 } /* namespace kubectl */
@@ -0,0 +1,495 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/common/types/State.h>
+
+#include <batchelor/worker/Logger.h>
+#include <batchelor/worker/plugin/kubectl/Watcher.h>
+
+#include <esl/io/Consumer.h>
+#include <esl/io/Input.h>
+#include <esl/io/Output.h>
+#include <esl/io/output/Memory.h>
+#include <esl/io/Reader.h>
+#include <esl/system/Arguments.h>
+#include <esl/system/FileDescriptor.h>
+#include <esl/system/Process.h>
+#include <esl/system/ZSProcess.h>
+#include <esl/utility/String.h>
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace kubectl {
+namespace {
+Logger logger("batchelor::worker::plugin::kubectl::Watcher");
+
+/* jobs submitted within this window are applied with a single kubectl call */
+constexpr std::chrono::milliseconds applyWindow(100);
+
+class MyConsumer : public esl::io::Consumer {
+public:
+	MyConsumer() = default;
+
+	bool consume(esl::io::Reader& reader) override {
+		char buffer[4096];
+		std::size_t count = reader.read(buffer, sizeof(buffer));
+
+		if(count == esl::io::Reader::npos) {
+			return false;
+		}
+
+		str << std::string(buffer, count);
+
+		return true;
+	}
+
+	std::stringstream& getStringStream() noexcept {
+		return str;
+	}
+
+private:
+	std::stringstream str;
+};
+
+int toCount(const std::string& str) {
+	/* custom-columns prints "<none>" for fields that are not set */
+	if(str.empty() || str == "<none>") {
+		return 0;
+	}
+	return std::stoi(str);
+}
+
+bool isEqual(const plugin::Task::Status& status1, const plugin::Task::Status& status2) noexcept {
+	return status1.state == status2.state && status1.returnCode == status2.returnCode && status1.message == status2.message;
+}
+}
+
+Watcher::Watcher(std::string aKubectlCmd, std::chrono::milliseconds aInterval)
+: kubectlCmd(std::move(aKubectlCmd)),
+  interval(aInterval),
+  thread(&Watcher::run, this)
+{ }
+
+Watcher::~Watcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+	thread.join();
+}
+
+void Watcher::add(const std::string& taskId, std::string deploymentYAML, OnStatus onStatus) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Job& job = jobs[taskId];
+		job.deploymentYAML = std::move(deploymentYAML);
+		job.status.state = common::types::State::Type::running;
+		job.status.returnCode = 0;
+		job.onStatus = std::move(onStatus);
+		hasPendingJobs = true;
+	}
+	cv.notify_all();
+}
+
+void Watcher::cancel(const std::string& taskId) {
+	/* The job is deleted by the watcher thread, because the caller might hold the mutex that is used by the status callback. */
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iter = jobs.find(taskId);
+		if(iter == jobs.end() || iter->second.canceled) {
+			return;
+		}
+		iter->second.canceled = true;
+		hasPendingJobs = true;
+	}
+	cv.notify_all();
+}
+
+void Watcher::run() {
+	std::chrono::steady_clock::time_point nextUpdate = std::chrono::steady_clock::now() + interval;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		cv.wait_until(lock, nextUpdate, [this] {
+			return stopping || hasPendingJobs;
+		});
+		if(stopping) {
+			break;
+		}
+		if(hasPendingJobs) {
+			cv.wait_for(lock, applyWindow, [this] {
+				return stopping;
+			});
+			if(stopping) {
+				break;
+			}
+		}
+		lock.unlock();
+
+		try {
+			processPendingJobs();
+			if(std::chrono::steady_clock::now() >= nextUpdate) {
+				updateJobs();
+				nextUpdate = std::chrono::steady_clock::now() + interval;
+			}
+		}
+		catch(const std::exception& e) {
+			logger.warn << "Watching jobs failed because of exception: \"" << e.what() << "\"\n";
+		}
+		catch(...) {
+			logger.warn << "Watching jobs failed because of unknown exception.\n";
+		}
+
+		lock.lock();
+	}
+}
+
+void Watcher::processPendingJobs() {
+	std::vector<std::pair<std::string, std::string>> jobsToApply;
+	std::vector<std::pair<std::string, bool>> jobsToCancel;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		hasPendingJobs = false;
+		for(auto& job : jobs) {
+			if(job.second.canceled) {
+				if(!job.second.deleted) {
+					job.second.deleted = true;
+					jobsToCancel.push_back(std::make_pair(job.first, job.second.applied));
+				}
+			}
+			else if(!job.second.applied) {
+				jobsToApply.push_back(std::make_pair(job.first, std::move(job.second.deploymentYAML)));
+				job.second.applied = true;
+			}
+		}
+	}
+
+	for(const auto& jobToCancel : jobsToCancel) {
+		if(jobToCancel.second) {
+			/* the job disappears from the list of jobs, then "Cancel executed" is reported by updateJobs() */
+			deleteJob(jobToCancel.first);
+		}
+		else {
+			plugin::Task::Status status;
+			status.state = common::types::State::Type::signaled;
+			status.returnCode = 0;
+			status.message = "Cancel executed";
+			report(jobToCancel.first, status);
+		}
+	}
+
+	if(jobsToApply.empty()) {
+		return;
+	}
+
+	/* apply all jobs as one multi-document manifest */
+	std::string deploymentYAML;
+	for(const auto& jobToApply : jobsToApply) {
+		deploymentYAML += "---\n" + jobToApply.second;
+	}
+
+	std::string output;
+	std::string error;
+	if(apply(deploymentYAML, output, error)) {
+		logger.debug << "applied " << jobsToApply.size() << " jobs\n";
+		return;
+	}
+
+	/* kubectl applies the valid documents even if others fail. With "-o name" it prints "job.batch/${TASK_ID}" for each applied job. */
+	std::set<std::string> appliedTaskIds;
+	std::stringstream outputStream(output);
+	std::string line;
+	while(std::getline(outputStream, line, '\n')) {
+		line = esl::utility::String::trim(line);
+		std::size_t pos = line.rfind('/');
+		appliedTaskIds.insert(pos == std::string::npos ? line : line.substr(pos+1));
+	}
+
+	for(const auto& jobToApply : jobsToApply) {
+		if(appliedTaskIds.count(jobToApply.first) > 0) {
+			continue;
+		}
+
+		/* report the error lines that are related to this job, otherwise the whole error output */
+		std::string message;
+		std::stringstream errorStream(error);
+		while(std::getline(errorStream, line, '\n')) {
+			if(line.find(jobToApply.first) != std::string::npos) {
+				message += line + "\n";
+			}
+		}
+
+		plugin::Task::Status status;
+		status.state = common::types::State::Type::signaled;
+		status.returnCode = 1;
+		status.message = "Applying batch config failed: " + (message.empty() ? error : message);
+		report(jobToApply.first, status);
+	}
+}
+
+void Watcher::updateJobs() {
+	std::vector<std::pair<std::string, bool>> appliedJobs;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(const auto& job : jobs) {
+			if(job.second.applied) {
+				appliedJobs.push_back(std::make_pair(job.first, job.second.canceled));
+			}
+		}
+	}
+
+	if(appliedJobs.empty()) {
+		return;
+	}
+
+	/* If kubectl fails, the jobs keep their current status and we try again next time. */
+	std::map<std::string, JobStatus> jobStatusByTaskId;
+	if(!listJobs(jobStatusByTaskId)) {
+		return;
+	}
+
+	std::map<std::string, std::string> warningByObjectName;
+	if(!listWarnings(warningByObjectName)) {
+		return;
+	}
+
+	for(const auto& appliedJob : appliedJobs) {
+		const std::string& taskId = appliedJob.first;
+		plugin::Task::Status status;
+		status.state = common::types::State::Type::running;
+		status.returnCode = 0;
+
+		auto jobStatusIter = jobStatusByTaskId.find(taskId);
+		if(jobStatusIter == jobStatusByTaskId.end()) {
+			if(appliedJob.second) {
+				status.state = common::types::State::Type::signaled;
+				status.message = "Cancel executed";
+			}
+			else {
+				status.state = common::types::State::Type::zombie;
+				status.message = "Could not get description of job";
+			}
+		}
+		// ... 1 Succeeded / . Failed
+		else if(jobStatusIter->second.succeeded > 0) {
+			status.state = common::types::State::Type::done;
+		}
+		// ... 7 Failed
+		else if(jobStatusIter->second.failed > 0) {
+			// 1 Active / 0 Succeeded / 7 Failed
+			if(jobStatusIter->second.active > 0) {
+				status.message = std::to_string(jobStatusIter->second.failed) + " failures";
+			}
+			// 0 Active / 0 Succeeded / 7 Failed
+			else {
+				status.state = common::types::State::Type::done;
+				status.returnCode = 1;
+			}
+		}
+
+		/* Events are reported for the job itself and for its pods, e.g. "${TASK_ID}-d6z6q" */
+		std::string warning;
+		for(auto iter = warningByObjectName.lower_bound(taskId); iter != warningByObjectName.end() && iter->first.compare(0, taskId.size(), taskId) == 0; ++iter) {
+			if(iter->first.size() == taskId.size() || iter->first[taskId.size()] == '-') {
+				warning = iter->second;
+				break;
+			}
+		}
+
+		if(status.state == common::types::State::Type::running) {
+			if(!warning.empty()) {
+				if(!appliedJob.second) {
+					deleteJob(taskId);
+				}
+				status.state = common::types::State::Type::zombie;
+				status.returnCode = 1;
+				status.message = warning;
+			}
+		}
+		else if(status.message.empty()) {
+			status.message = warning;
+		}
+
+		report(taskId, status);
+	}
+}
+
+bool Watcher::apply(const std::string& deploymentYAML, std::string& output, std::string& error) const {
+	try {
+		esl::io::output::Memory deploymentYamlProducer(deploymentYAML.data(), deploymentYAML.size());
+		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
+		MyConsumer kubectlOutput;
+		MyConsumer kubectlError;
+
+		(*process)[esl::system::FileDescriptor::getIn()] << esl::io::Output(deploymentYamlProducer);
+		(*process)[esl::system::FileDescriptor::getOut()] >> esl::io::Input(kubectlOutput);
+		(*process)[esl::system::FileDescriptor::getErr()] >> esl::io::Input(kubectlError);
+
+		auto returnCode = process->execute(esl::system::Arguments(kubectlCmd + " apply -o name -f -"));
+		logger.debug << "apply done, rc=" << returnCode << "\n";
+
+		if(returnCode != 0) {
+			output = kubectlOutput.getStringStream().str();
+			error = kubectlError.getStringStream().str();
+			return false;
+		}
+	}
+	catch(const std::exception& e) {
+		error = "Execution failed because of exception: \"" + std::string(e.what()) + "\"";
+		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
+		return false;
+	}
+	catch(...) {
+		error = "Execution failed because of exception.";
+		logger.warn << "Execution failed because of unknown exception.\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool Watcher::execute(const std::string& arguments, std::string& output) const {
+	try {
+		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
+		MyConsumer kubectlOutput;
+
+		(*process)[esl::system::FileDescriptor::getOut()] >> esl::io::Input(kubectlOutput);
+
+		auto returnCode = process->execute(esl::system::Arguments(kubectlCmd + " " + arguments));
+		if(returnCode != 0) {
+			logger.warn << "Execution of \"" << arguments << "\" failed with return code " << returnCode << "\n";
+			return false;
+		}
+		output = kubectlOutput.getStringStream().str();
+	}
+	catch(const std::exception& e) {
+		logger.warn << "Execution of \"" << arguments << "\" failed because of exception: \"" << e.what() << "\"\n";
+		return false;
+	}
+	catch(...) {
+		logger.warn << "Execution of \"" << arguments << "\" failed because of unknown exception.\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool Watcher::listJobs(std::map<std::string, JobStatus>& jobStatusByTaskId) const {
+	std::string output;
+	if(!execute(std::string("get jobs -l ") + taskIdLabel + " --no-headers -o custom-columns=NAME:.metadata.name,ACTIVE:.status.active,SUCCEEDED:.status.succeeded,FAILED:.status.failed", output)) {
+		return false;
+	}
+
+	std::stringstream ss(output);
+	std::string line;
+	while(std::getline(ss, line, '\n')) {
+		// ${TASK_ID}   1   <none>   <none>
+		std::vector<std::string> values = esl::utility::String::split(esl::utility::String::trim(line), ' ', true);
+		if(values.size() != 4) {
+			continue;
+		}
+
+		try {
+			JobStatus& jobStatus = jobStatusByTaskId[values[0]];
+			jobStatus.active = toCount(values[1]);
+			jobStatus.succeeded = toCount(values[2]);
+			jobStatus.failed = toCount(values[3]);
+		}
+		catch(const std::exception& e) {
+			logger.warn << "Cannot convert status of job: \"" << line << "\"\n";
+			jobStatusByTaskId.erase(values[0]);
+		}
+	}
+
+	return true;
+}
+
+bool Watcher::listWarnings(std::map<std::string, std::string>& warningByObjectName) const {
+	std::string output;
+	if(!execute("get events --field-selector type=Warning --no-headers -o custom-columns=NAME:.involvedObject.name,REASON:.reason,MESSAGE:.message", output)) {
+		return false;
+	}
+
+	std::stringstream ss(output);
+	std::string line;
+	while(std::getline(ss, line, '\n')) {
+		// ${TASK_ID}-d6z6q   FailedMount   MountVolume.SetUp failed for volume "secret-mounts" : secret "k8s-batch" not found
+		line = esl::utility::String::trim(line);
+		std::size_t pos = line.find(' ');
+		if(pos == std::string::npos) {
+			continue;
+		}
+		warningByObjectName.insert(std::make_pair(line.substr(0, pos), line));
+	}
+
+	return true;
+}
+
+void Watcher::deleteJob(const std::string& taskId) const noexcept {
+	try {
+		std::unique_ptr<esl::system::Process> process = esl::system::ZSProcess::createNative();
+		auto returnCode = process->execute(esl::system::Arguments(kubectlCmd + " delete job " + taskId));
+		logger.debug << "canceled task id " << taskId << " and received return code " << returnCode << "\n";
+	}
+	catch(const std::exception& e) {
+		logger.warn << "Execution failed because of exception: \"" << e.what() << "\"\n";
+	}
+	catch(...) {
+		logger.warn << "Execution failed because of unknown exception.\n";
+	}
+}
+
+void Watcher::report(const std::string& taskId, const plugin::Task::Status& status) {
+	OnStatus onStatus;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iter = jobs.find(taskId);
+		if(iter == jobs.end() || isEqual(iter->second.status, status)) {
+			return;
+		}
+		iter->second.status = status;
+		onStatus = iter->second.onStatus;
+		if(status.state != common::types::State::Type::running) {
+			jobs.erase(iter);
+		}
+	}
+
+	onStatus(status);
+}
+
+} /* namespace kubectl */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
@@ -0,0 +1,100 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHELOR_WORKER_PLUGIN_KUBECTL_WATCHER_H_
+#define BATCHELOR_WORKER_PLUGIN_KUBECTL_WATCHER_H_
+
+#include <batchelor/worker/plugin/Task.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace batchelor {
+namespace worker {
+namespace plugin {
+namespace kubectl {
+
+/* Watcher tracks all jobs of a task factory with one thread. Per interval it lists the
+ * jobs labeled with "batchelor-task-id" and the warning events of the namespace once
+ * and dispatches the result to the registered tasks, instead of running kubectl per task.
+ * Jobs added within a short window are applied together with one kubectl call.
+ */
+class Watcher {
+public:
+	static constexpr const char* taskIdLabel = "batchelor-task-id";
+
+	/* Called from the watcher thread every time the status of the job has changed.
+	 * The task is removed from the watcher after a status has been reported that is not running. */
+	using OnStatus = std::function<void(const plugin::Task::Status&)>;
+
+	Watcher(std::string kubectlCmd, std::chrono::milliseconds interval);
+	~Watcher();
+
+	void add(const std::string& taskId, std::string deploymentYAML, OnStatus onStatus);
+	void cancel(const std::string& taskId);
+
+private:
+	struct Job {
+		std::string deploymentYAML;
+		bool applied = false;
+		bool canceled = false;
+		bool deleted = false;
+		plugin::Task::Status status;
+		OnStatus onStatus;
+	};
+
+	struct JobStatus {
+		int active = 0;
+		int succeeded = 0;
+		int failed = 0;
+	};
+
+	const std::string kubectlCmd;
+	const std::chrono::milliseconds interval;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::map<std::string, Job> jobs;
+	bool hasPendingJobs = false; // jobs to apply or to cancel
+	bool stopping = false;
+	std::thread thread;
+
+	void run();
+	void processPendingJobs();
+	void updateJobs();
+
+	bool apply(const std::string& deploymentYAML, std::string& output, std::string& error) const;
+	bool execute(const std::string& arguments, std::string& output) const;
+	bool listJobs(std::map<std::string, JobStatus>& jobStatusByTaskId) const;
+	bool listWarnings(std::map<std::string, std::string>& warningByObjectName) const;
+	void deleteJob(const std::string& taskId) const noexcept;
+
+	void report(const std::string& taskId, const plugin::Task::Status& status);
+};
+
+} /* namespace kubectl */
+} /* namespace plugin */
+} /* namespace worker */
+} /* namespace batchelor */
+
+#endif /* BATCHELOR_WORKER_PLUGIN_KUBECTL_WATCHER_H_ */
@@ -0,0 +1,248 @@
+/*
+ * This file is part of Batchelor.
+ * Copyright (C) 2023-2024 Sven Lukas
+ *
+ * Batchelor is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Batchelor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with Batchelor.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <batchelor/common/types/State.h>
+
+#include <batchelor/worker/plugin/kubectl/Watcher.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/* Runs the shared kubectl watcher against fake-kubectl.sh, which keeps the jobs of the "cluster" in a state directory.
+ * Usage: batchelor-worker-test-kubectl-watcher <path of fake-kubectl.sh>
+ */
+
+namespace {
+using batchelor::common::types::State;
+using batchelor::worker::plugin::Task;
+using batchelor::worker::plugin::kubectl::Watcher;
+
+constexpr std::chrono::milliseconds interval(200);
+constexpr std::chrono::milliseconds timeout(5000);
+
+int failures = 0;
+
+void check(bool condition, const std::string& description) {
+	if(!condition) {
+		std::cerr << "FAILED: " << description << "\n";
+		++failures;
+	}
+}
+
+class Cluster {
+public:
+	Cluster() {
+		char dirTemplate[] = "/tmp/batchelor-kubectl-XXXXXX";
+		if(mkdtemp(dirTemplate) == nullptr) {
+			throw std::runtime_error("Cannot create state directory");
+		}
+		dir = dirTemplate;
+		std::filesystem::create_directories(dir / "jobs");
+	}
+
+	~Cluster() {
+		std::error_code errorCode;
+		std::filesystem::remove_all(dir, errorCode);
+	}
+
+	const std::filesystem::path& getDir() const noexcept {
+		return dir;
+	}
+
+	void setJob(const std::string& name, const std::string& columns) {
+		std::ofstream(dir / "jobs" / name) << columns << "\n";
+	}
+
+	void addEvent(const std::string& line) {
+		std::ofstream(dir / "events", std::ios::app) << line << "\n";
+	}
+
+	bool hasJob(const std::string& name) const {
+		return std::filesystem::exists(dir / "jobs" / name);
+	}
+
+	/* number of kubectl calls whose arguments start with prefix */
+	int countCalls(const std::string& prefix) const {
+		std::ifstream calls(dir / "calls");
+		std::string line;
+		int count = 0;
+		while(std::getline(calls, line)) {
+			if(line.compare(0, prefix.size(), prefix) == 0) {
+				++count;
+			}
+		}
+		return count;
+	}
+
+private:
+	std::filesystem::path dir;
+};
+
+class Statuses {
+public:
+	Watcher::OnStatus onStatus(const std::string& taskId) {
+		return [this, taskId](const Task::Status& status) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				statuses[taskId] = status;
+				++reports[taskId];
+			}
+			cv.notify_all();
+		};
+	}
+
+	/* waits until a status other than "running" has been reported */
+	bool waitFinal(const std::string& taskId, Task::Status& status) {
+		std::unique_lock<std::mutex> lock(mutex);
+		bool found = cv.wait_for(lock, timeout, [&] {
+			auto iter = statuses.find(taskId);
+			return iter != statuses.end() && iter->second.state != State::Type::running;
+		});
+		if(found) {
+			status = statuses[taskId];
+		}
+		return found;
+	}
+
+	int getReports(const std::string& taskId) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return reports[taskId];
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::map<std::string, Task::Status> statuses;
+	std::map<std::string, int> reports;
+};
+
+std::string makeJob(const std::string& taskId) {
+	return "apiVersion: batch/v1\nkind: Job\nmetadata:\n  name: " + taskId + "\n  labels:\n    " + Watcher::taskIdLabel + ": " + taskId + "\n";
+}
+
+bool waitUntil(const std::function<bool()>& condition) {
+	auto endTS = std::chrono::steady_clock::now() + timeout;
+	while(!condition()) {
+		if(std::chrono::steady_clock::now() >= endTS) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+void testBatchAndStatus(const std::string& fakeKubectl) {
+	Cluster cluster;
+	Statuses statuses;
+	std::unique_ptr<Watcher> watcher(new Watcher("/bin/sh " + fakeKubectl + " " + cluster.getDir().string(), interval));
+
+	/* jobs added within the apply window are applied with one call */
+	for(const char* taskId : {"task-a", "task-b", "task-c", "task-d"}) {
+		watcher->add(taskId, makeJob(taskId), statuses.onStatus(taskId));
+	}
+	check(waitUntil([&] { return cluster.hasJob("task-a") && cluster.hasJob("task-d"); }), "jobs have been applied");
+	check(cluster.countCalls("apply") == 1, "four jobs are applied with one kubectl call");
+
+	cluster.setJob("task-a", "0 1 <none>");
+	cluster.setJob("task-b", "0 <none> 3");
+	cluster.setJob("task-c", "1 <none> 2");
+	cluster.addEvent("task-d-x7k2p   FailedMount   MountVolume.SetUp failed for volume \"secret\"");
+
+	Task::Status status;
+	check(statuses.waitFinal("task-a", status) && status.state == State::Type::done && status.returnCode == 0, "succeeded job is done with return code 0");
+	check(statuses.waitFinal("task-b", status) && status.state == State::Type::done && status.returnCode == 1, "failed job is done with return code 1");
+	check(statuses.waitFinal("task-d", status) && status.state == State::Type::zombie && status.message.find("FailedMount") != std::string::npos, "job with warning event of its pod is zombie");
+	check(waitUntil([&] { return !cluster.hasJob("task-d"); }), "job with warning event has been deleted");
+
+	/* retrying job stays running, but reports its failures once */
+	check(waitUntil([&] { return statuses.getReports("task-c") == 1; }), "retrying job reports its failures");
+	std::this_thread::sleep_for(3 * interval);
+	check(statuses.getReports("task-c") == 1, "unchanged status is not reported again");
+
+	/* the jobs of all tasks are listed with one call per interval, not one call per task */
+	watcher.reset();
+	int listCalls = cluster.countCalls("get jobs");
+	int eventCalls = cluster.countCalls("get events");
+	check(listCalls > 0 && eventCalls >= listCalls - 1 && eventCalls <= listCalls, "jobs and events are listed together");
+	check(cluster.countCalls("") == cluster.countCalls("apply") + listCalls + eventCalls + cluster.countCalls("delete job task-d"), "no kubectl call per task");
+}
+
+void testApplyFailure(const std::string& fakeKubectl) {
+	Cluster cluster;
+	Statuses statuses;
+	Watcher watcher("/bin/sh " + fakeKubectl + " " + cluster.getDir().string(), interval);
+
+	watcher.add("task-good", makeJob("task-good"), statuses.onStatus("task-good"));
+	watcher.add("task-invalid", makeJob("task-invalid"), statuses.onStatus("task-invalid"));
+
+	Task::Status status;
+	check(statuses.waitFinal("task-invalid", status) && status.state == State::Type::signaled && status.message.find("task-invalid") != std::string::npos, "rejected job is signaled with its error line");
+	check(status.message.find("task-good") == std::string::npos, "error of rejected job does not mention other jobs");
+	check(cluster.hasJob("task-good") && statuses.getReports("task-good") == 0, "valid job of the same apply keeps running");
+}
+
+void testCancel(const std::string& fakeKubectl) {
+	Cluster cluster;
+	Statuses statuses;
+	Watcher watcher("/bin/sh " + fakeKubectl + " " + cluster.getDir().string(), interval);
+
+	/* canceled within the apply window, so it is never applied */
+	watcher.add("task-early", makeJob("task-early"), statuses.onStatus("task-early"));
+	watcher.cancel("task-early");
+
+	Task::Status status;
+	check(statuses.waitFinal("task-early", status) && status.state == State::Type::signaled && status.message == "Cancel executed", "job canceled before apply is signaled");
+	check(!cluster.hasJob("task-early") && cluster.countCalls("apply") == 0, "job canceled before apply is not applied");
+
+	watcher.add("task-late", makeJob("task-late"), statuses.onStatus("task-late"));
+	check(waitUntil([&] { return cluster.hasJob("task-late"); }), "job has been applied");
+	watcher.cancel("task-late");
+
+	check(statuses.waitFinal("task-late", status) && status.state == State::Type::signaled && status.message == "Cancel executed", "applied job is signaled after it has been deleted");
+	check(cluster.countCalls("delete job task-late") == 1, "applied job is deleted once");
+}
+} /* anonymous namespace */
+
+int main(int argc, char** argv) {
+	if(argc != 2) {
+		std::cerr << "usage: " << argv[0] << " <path of fake-kubectl.sh>\n";
+		return 2;
+	}
+
+	testBatchAndStatus(argv[1]);
+	testApplyFailure(argv[1]);
+	testCancel(argv[1]);
+
+	if(failures > 0) {
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "all checks passed\n";
+	return 0;
+}
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Fake kubectl for WatcherTest. The first argument is a state directory that the test prepares:
+#   jobs/<name>  status columns "ACTIVE SUCCEEDED FAILED" of a job, e.g. "1 <none> <none>"
+#   events       output of "get events", one warning per line
+#   calls        every invocation is appended as one line
+# Documents of "apply" are identified by a line "name: <name>". Names that contain "invalid" are rejected.
+
+state="$1"
+shift
+echo "$*" >> "$state/calls"
+mkdir -p "$state/jobs"
+
+case "$1 $2" in
+"apply -o")
+	rc=0
+	for name in $(sed -n 's/^ *name: *//p'); do
+		case "$name" in
+		*invalid*)
+			echo "Error from server (Invalid): Job.batch \"$name\" is invalid" >&2
+			rc=1
+			;;
+		*)
+			echo "1 <none> <none>" > "$state/jobs/$name"
+			echo "job.batch/$name"
+			;;
+		esac
+	done
+	exit $rc
+	;;
+"get jobs")
+	for file in "$state"/jobs/*; do
+		[ -f "$file" ] && echo "$(basename "$file")   $(cat "$file")"
+	done
+	exit 0
+	;;
+"get events")
+	[ -f "$state/events" ] && cat "$state/events"
+	exit 0
+	;;
+"delete job")
+	rm -f "$state/jobs/$3"
+	exit 0
+	;;
+esac
+
+echo "fake-kubectl: unsupported arguments: $*" >&2
+exit 1